@@ -0,0 +1,107 @@
+/*****************************************************************************
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "common.h"
+#include "utils_procfs.h"
+#include "tap.h"
+
+int main(void) {
+	plan_tests(20);
+
+	const char psi_memory[] = "some avg10=1.50 avg60=0.75 avg300=0.10 total=123456\n"
+							  "full avg10=0.50 avg60=0.25 avg300=0.00 total=4567\n";
+
+	mp_psi_result psi = mp_parse_pressure(psi_memory, strlen(psi_memory));
+	ok(psi.errorcode == OK, "PSI: parsing succeeds");
+	ok(psi.some_present && psi.full_present, "PSI: some and full lines are found");
+	ok(psi.some.avg10 == 1.5 && psi.some.avg60 == 0.75 && psi.some.avg300 == 0.1,
+	   "PSI: some averages are correct");
+	ok(psi.some.total == 123456, "PSI: some total is correct");
+	ok(psi.full.avg10 == 0.5 && psi.full.total == 4567, "PSI: full values are correct");
+
+	/* older kernels do not have a "full" line for cpu */
+	const char psi_cpu[] = "some avg10=0.00 avg60=0.01 avg300=0.02 total=42";
+	psi = mp_parse_pressure(psi_cpu, strlen(psi_cpu));
+	ok(psi.errorcode == OK && psi.some_present && !psi.full_present,
+	   "PSI: a missing full line is accepted");
+	ok(psi.some.avg300 == 0.02 && psi.some.total == 42,
+	   "PSI: values without trailing newline are parsed");
+
+	const char psi_garbage[] = "full avg10=0.00 avg60=0.01 avg300=0.02 total=42\nfoo bar\n";
+	psi = mp_parse_pressure(psi_garbage, strlen(psi_garbage));
+	ok(psi.errorcode == ERROR, "PSI: a missing some line is an error");
+
+	psi = mp_read_pressure_file("/does/not/exist");
+	ok(psi.errorcode == ERROR, "PSI: a missing file is an error");
+
+	mp_procfs_field meminfo_fields[] = {
+		{.key = "MemTotal"},
+		{.key = "MemAvailable"},
+		{.key = "HugePages_Total"},
+		{.key = "Swap"},
+		{.key = "DoesNotExist"},
+	};
+	mp_procfs_keyset keyset;
+	ok(mp_procfs_keyset_init(&keyset, meminfo_fields, 5) == OK, "KV: keyset is initialized");
+
+	const char meminfo[] = "MemTotal:       32767776 kB\n"
+						   "MemFree:         1693508 kB\n"
+						   "MemAvailable:   23807480 kB\n"
+						   "Active(anon):    6108756 kB\n"
+						   "HugePages_Total:       4\n"
+						   "Swap: 1024 512 512\n"
+						   "MemTotalButLonger: 1 kB\n";
+	ok(mp_procfs_parse_kv(meminfo, strlen(meminfo), &keyset) == 4, "KV: four fields are found");
+	ok(meminfo_fields[0].found && meminfo_fields[0].values[0] == 32767776ULL * 1024,
+	   "KV: kB values are converted to bytes");
+	ok(meminfo_fields[1].values[0] == 23807480ULL * 1024, "KV: MemAvailable is correct");
+	ok(meminfo_fields[2].values[0] == 4, "KV: values without unit are kept");
+	ok(meminfo_fields[3].number_of_values == 3 && meminfo_fields[3].values[2] == 512,
+	   "KV: multiple values on one line are recorded");
+	ok(!meminfo_fields[4].found, "KV: missing keys are not found");
+
+	const char vmstat[] = "nr_free_pages 844851\npswpin 4711\npswpout 81615\npgmajfault 401";
+	mp_procfs_field vmstat_fields[] = {
+		{.key = "pgmajfault"},
+		{.key = "pswpin"},
+	};
+	mp_procfs_keyset_init(&keyset, vmstat_fields, 2);
+	ok(mp_procfs_parse_kv(vmstat, strlen(vmstat), &keyset) == 2 &&
+		   vmstat_fields[0].values[0] == 401 && vmstat_fields[1].values[0] == 4711,
+	   "KV: space separated files are parsed");
+
+	/* a file with a line longer than the read buffer, like "intr" in /proc/stat */
+	char stat_path[] = "/tmp/test_procfs_XXXXXX";
+	int stat_fd = mkstemp(stat_path);
+	FILE *stat_file = fdopen(stat_fd, "w");
+	fprintf(stat_file, "cpu 1 2 3 4\nintr 1");
+	for (int i = 0; i < 10000; i++) {
+		fprintf(stat_file, " %d", i);
+	}
+	fprintf(stat_file, "\nprocs_running 3\nprocs_blocked 1\n");
+	fclose(stat_file);
+
+	mp_proc_stat_procs procs = mp_read_proc_stat_procs(stat_path);
+	ok(procs.errorcode == OK, "KV: long lines are skipped");
+	ok(procs.procs_running == 3 && procs.procs_blocked == 1, "KV: run queue values are correct");
+	unlink(stat_path);
+
+	ok(mp_procfs_read_kv("/does/not/exist", &keyset) == ERROR, "KV: a missing file is an error");
+
+	return exit_status();
+}
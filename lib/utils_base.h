@@ -83,6 +83,32 @@ char *np_extract_value(const char *, const char *, char);
  */
 int mp_translate_state(char *);
 
+/*
+ * State retention: keep data between plugin invocations in a file below
+ * MP_STATE_PATH (or the compiled in state directory)
+ */
+#define NP_STATE_FORMAT_VERSION 1
+
+typedef struct state_data_struct {
+	time_t time;
+	void *data;
+	size_t length; /* Of binary data */
+	int errorcode;
+} state_data;
+
+typedef struct state_key_struct {
+	char *name;
+	char *plugin_name;
+	int data_version;
+	char *_filename;
+	state_data *state_data;
+} state_key;
+
+state_data *np_state_read(state_key stateKey);
+state_key np_enable_state(char *keyname, int expected_data_version, const char *plugin_name,
+						  int argc, char **argv);
+void np_state_write_string(state_key stateKey, time_t timestamp, char *stringToStore);
+
 void np_init(char *, int argc, char **argv);
 void np_set_args(int argc, char **argv);
 void np_cleanup(void);
@@ -0,0 +1,428 @@
+/*****************************************************************************
+ *
+ * Library for reading Linux procfs files
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * This file contains helpers to read and parse files from /proc which are
+ * used by several plugins. The parsers work on buffers and are tested by
+ * libtap
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "../plugins/common.h"
+#include "utils_procfs.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* PSI files consist of two short lines, this is plenty */
+#define PSI_BUFFER_SIZE 256
+
+/* /proc/meminfo is about 1.5KiB, /proc/vmstat about 5KiB, so most files need only one read */
+#define KV_BUFFER_SIZE 8192
+
+#define KV_TABLE_SIZE (sizeof(((mp_procfs_keyset *)0)->table))
+
+/* FNV-1a, good enough for a few dozen short keys */
+static size_t hash_key(const char *key, size_t length) {
+	uint32_t hash = 2166136261U;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= 16777619U;
+	}
+	return hash % KV_TABLE_SIZE;
+}
+
+int mp_procfs_keyset_init(mp_procfs_keyset keyset[static 1], mp_procfs_field fields[],
+						  size_t number_of_fields) {
+	if (number_of_fields > MP_PROCFS_MAX_FIELDS) {
+		return ERROR;
+	}
+
+	memset(keyset, 0, sizeof(*keyset));
+	keyset->fields = fields;
+	keyset->number_of_fields = number_of_fields;
+
+	for (size_t i = 0; i < number_of_fields; i++) {
+		fields[i].found = false;
+		fields[i].number_of_values = 0;
+		keyset->key_lengths[i] = strlen(fields[i].key);
+
+		size_t slot = hash_key(fields[i].key, keyset->key_lengths[i]);
+		while (keyset->table[slot] != 0) {
+			slot = (slot + 1) % KV_TABLE_SIZE;
+		}
+		keyset->table[slot] = (unsigned char)(i + 1);
+	}
+
+	return OK;
+}
+
+static mp_procfs_field *lookup_key(mp_procfs_keyset keyset[static 1], const char *key,
+								   size_t length) {
+	size_t slot = hash_key(key, length);
+	while (keyset->table[slot] != 0) {
+		size_t index = keyset->table[slot] - 1U;
+		if (keyset->key_lengths[index] == length &&
+			memcmp(keyset->fields[index].key, key, length) == 0) {
+			return &keyset->fields[index];
+		}
+		slot = (slot + 1) % KV_TABLE_SIZE;
+	}
+	return NULL;
+}
+
+/*
+ * Parses one line (without the newline), returns true if it was a new field
+ */
+static bool parse_kv_line(const char *line, const char *line_end,
+						  mp_procfs_keyset keyset[static 1]) {
+	const char *key_end = line;
+	while (key_end < line_end && *key_end != ':' && *key_end != ' ' && *key_end != '\t') {
+		key_end++;
+	}
+
+	mp_procfs_field *field = lookup_key(keyset, line, (size_t)(key_end - line));
+	if (field == NULL) {
+		return false;
+	}
+
+	bool new_field = !field->found;
+	field->number_of_values = 0;
+
+	const char *cursor = key_end;
+	if (cursor < line_end && *cursor == ':') {
+		cursor++;
+	}
+
+	while (cursor < line_end && field->number_of_values < MP_PROCFS_MAX_VALUES) {
+		while (cursor < line_end && (*cursor == ' ' || *cursor == '\t')) {
+			cursor++;
+		}
+
+		if (cursor >= line_end || *cursor < '0' || *cursor > '9') {
+			break;
+		}
+
+		unsigned long long value = 0;
+		while (cursor < line_end && *cursor >= '0' && *cursor <= '9') {
+			value = (value * 10) + (unsigned long long)(*cursor - '0');
+			cursor++;
+		}
+		field->values[field->number_of_values++] = value;
+	}
+
+	while (cursor < line_end && *cursor == ' ') {
+		cursor++;
+	}
+
+	/* the kernel means KiB */
+	if ((line_end - cursor) >= 2 && cursor[0] == 'k' && cursor[1] == 'B') {
+		for (size_t i = 0; i < field->number_of_values; i++) {
+			field->values[i] *= 1024;
+		}
+	}
+
+	field->found = field->number_of_values > 0;
+	return new_field && field->found;
+}
+
+size_t mp_procfs_parse_kv(const char *buffer, size_t length, mp_procfs_keyset keyset[static 1]) {
+	size_t fields_found = 0;
+	const char *buffer_end = buffer + length;
+	const char *line = buffer;
+
+	while (line < buffer_end) {
+		const char *line_end = memchr(line, '\n', (size_t)(buffer_end - line));
+		if (line_end == NULL) {
+			line_end = buffer_end;
+		}
+
+		if (parse_kv_line(line, line_end, keyset)) {
+			fields_found++;
+		}
+
+		line = line_end + 1;
+	}
+
+	return fields_found;
+}
+
+int mp_procfs_read_kv(const char *path, mp_procfs_keyset keyset[static 1]) {
+	for (size_t i = 0; i < keyset->number_of_fields; i++) {
+		keyset->fields[i].found = false;
+		keyset->fields[i].number_of_values = 0;
+	}
+
+	int file_descriptor = open(path, O_RDONLY);
+	if (file_descriptor < 0) {
+		return ERROR;
+	}
+
+	char buffer[KV_BUFFER_SIZE];
+	size_t filled = 0;
+	size_t fields_found = 0;
+	bool skipping_long_line = false;
+
+	while (true) {
+		ssize_t bytes_read = read(file_descriptor, buffer + filled, sizeof(buffer) - filled);
+		if (bytes_read < 0) {
+			close(file_descriptor);
+			return ERROR;
+		}
+
+		filled += (size_t)bytes_read;
+		bool end_of_file = (bytes_read == 0);
+
+		/* only hand over complete lines, unless the file ended */
+		char *last_newline = NULL;
+		for (size_t i = filled; i > 0; i--) {
+			if (buffer[i - 1] == '\n') {
+				last_newline = &buffer[i - 1];
+				break;
+			}
+		}
+		size_t complete = end_of_file ? filled : 0;
+		if (!end_of_file && last_newline != NULL) {
+			complete = (size_t)(last_newline - buffer) + 1;
+		}
+
+		char *start = buffer;
+		if (skipping_long_line && complete > 0) {
+			/* drop the rest of a line that did not fit into the buffer */
+			char *newline = memchr(buffer, '\n', complete);
+			start = (newline != NULL) ? newline + 1 : buffer + complete;
+			skipping_long_line = (newline == NULL);
+		}
+
+		if (!skipping_long_line && start < buffer + complete) {
+			fields_found += mp_procfs_parse_kv(start, (size_t)(buffer + complete - start), keyset);
+		}
+
+		if (end_of_file || fields_found == keyset->number_of_fields) {
+			break;
+		}
+
+		if (complete == 0 && filled == sizeof(buffer)) {
+			/* a single line longer than the buffer, e.g. "intr" in /proc/stat */
+			skipping_long_line = true;
+			filled = 0;
+			continue;
+		}
+
+		memmove(buffer, buffer + complete, filled - complete);
+		filled -= complete;
+	}
+
+	close(file_descriptor);
+	return (int)fields_found;
+}
+
+mp_psi_result mp_parse_pressure(const char *buffer, size_t length) {
+	mp_psi_result result = {
+		.errorcode = ERROR,
+		.some_present = false,
+		.full_present = false,
+	};
+
+	const char *buffer_end = buffer + length;
+	const char *line = buffer;
+
+	while (line < buffer_end) {
+		const char *line_end = memchr(line, '\n', (size_t)(buffer_end - line));
+		if (line_end == NULL) {
+			line_end = buffer_end;
+		}
+
+		/* copy the line, so sscanf does not run past the end of the buffer */
+		char line_copy[PSI_BUFFER_SIZE];
+		size_t line_length = (size_t)(line_end - line);
+		if (line_length >= sizeof(line_copy)) {
+			line_length = sizeof(line_copy) - 1;
+		}
+		memcpy(line_copy, line, line_length);
+		line_copy[line_length] = '\0';
+
+		mp_psi_line tmp = {0};
+		char kind[5] = "";
+		if (sscanf(line_copy, "%4s avg10=%lf avg60=%lf avg300=%lf total=%llu", kind, &tmp.avg10,
+				   &tmp.avg60, &tmp.avg300, &tmp.total) == 5) {
+			if (strcmp(kind, "some") == 0) {
+				result.some = tmp;
+				result.some_present = true;
+			} else if (strcmp(kind, "full") == 0) {
+				result.full = tmp;
+				result.full_present = true;
+			}
+		}
+
+		line = line_end + 1;
+	}
+
+	if (result.some_present) {
+		result.errorcode = OK;
+	}
+
+	return result;
+}
+
+mp_psi_result mp_read_pressure_file(const char *path) {
+	mp_psi_result result = {
+		.errorcode = ERROR,
+	};
+
+	int file_descriptor = open(path, O_RDONLY);
+	if (file_descriptor < 0) {
+		return result;
+	}
+
+	char buffer[PSI_BUFFER_SIZE];
+	ssize_t bytes_read = read(file_descriptor, buffer, sizeof(buffer));
+	close(file_descriptor);
+
+	if (bytes_read <= 0) {
+		return result;
+	}
+
+	return mp_parse_pressure(buffer, (size_t)bytes_read);
+}
+
+/* asprintf which dies instead of failing, xasprintf is only available to the plugins */
+static char *format_string(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static char *format_string(const char *format, ...) {
+	va_list args;
+	va_start(args, format);
+	char *result = NULL;
+	int length = vasprintf(&result, format, args);
+	va_end(args);
+
+	if (length < 0) {
+		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+	}
+	return result;
+}
+
+static void add_pressure_perfdata(mp_subcheck sc[static 1], const char *label_prefix,
+								  const char *kind, mp_psi_line line) {
+	struct {
+		const char *name;
+		double value;
+	} averages[] = {
+		{"avg60", line.avg60},
+		{"avg300", line.avg300},
+	};
+
+	for (size_t i = 0; i < sizeof(averages) / sizeof(averages[0]); i++) {
+		mp_perfdata pd_avg = perfdata_init();
+		pd_avg.label = format_string("%s_%s_%s", label_prefix, kind, averages[i].name);
+		pd_avg.uom = "%";
+		pd_avg = mp_set_pd_value(pd_avg, averages[i].value);
+		pd_avg = mp_set_pd_min_value(pd_avg, mp_create_pd_value(0));
+		pd_avg = mp_set_pd_max_value(pd_avg, mp_create_pd_value(100));
+		mp_add_perfdata_to_subcheck(sc, pd_avg);
+	}
+
+	// accumulated stall time in microseconds
+	mp_perfdata pd_total = perfdata_init();
+	pd_total.label = format_string("%s_%s_total_us", label_prefix, kind);
+	pd_total.uom = "c";
+	pd_total = mp_set_pd_value(pd_total, line.total);
+	mp_add_perfdata_to_subcheck(sc, pd_total);
+}
+
+mp_subcheck mp_evaluate_pressure(const char *resource_name, const char *label_prefix,
+								 const char *path, mp_thresholds thresholds) {
+	mp_subcheck sc = mp_subcheck_init();
+
+	mp_psi_result psi = mp_read_pressure_file(path);
+	if (psi.errorcode != OK) {
+		sc = mp_set_subcheck_state(sc, STATE_UNKNOWN);
+		sc.output = format_string(_("%s: failed to read pressure stall information from %s"),
+								  resource_name, path);
+		return sc;
+	}
+
+	mp_perfdata pd_some_avg10 = perfdata_init();
+	pd_some_avg10.label = format_string("%s_some_avg10", label_prefix);
+	pd_some_avg10.uom = "%";
+	pd_some_avg10 = mp_set_pd_value(pd_some_avg10, psi.some.avg10);
+	pd_some_avg10 = mp_set_pd_min_value(pd_some_avg10, mp_create_pd_value(0));
+	pd_some_avg10 = mp_set_pd_max_value(pd_some_avg10, mp_create_pd_value(100));
+	pd_some_avg10 = mp_pd_set_thresholds(pd_some_avg10, thresholds);
+
+	sc = mp_set_subcheck_state(sc, mp_get_pd_status(pd_some_avg10));
+	mp_add_perfdata_to_subcheck(&sc, pd_some_avg10);
+	add_pressure_perfdata(&sc, label_prefix, "some", psi.some);
+
+	char *some_output =
+		format_string("%s: some %.2f%%, %.2f%%, %.2f%%", resource_name, psi.some.avg10,
+					  psi.some.avg60, psi.some.avg300);
+
+	if (!psi.full_present) {
+		sc.output = format_string("%s (10s, 60s, 300s)", some_output);
+		free(some_output);
+		return sc;
+	}
+
+	mp_perfdata pd_full_avg10 = perfdata_init();
+	pd_full_avg10.label = format_string("%s_full_avg10", label_prefix);
+	pd_full_avg10.uom = "%";
+	pd_full_avg10 = mp_set_pd_value(pd_full_avg10, psi.full.avg10);
+	pd_full_avg10 = mp_set_pd_min_value(pd_full_avg10, mp_create_pd_value(0));
+	pd_full_avg10 = mp_set_pd_max_value(pd_full_avg10, mp_create_pd_value(100));
+	mp_add_perfdata_to_subcheck(&sc, pd_full_avg10);
+	add_pressure_perfdata(&sc, label_prefix, "full", psi.full);
+
+	sc.output = format_string("%s - full %.2f%%, %.2f%%, %.2f%% (10s, 60s, 300s)", some_output,
+							  psi.full.avg10, psi.full.avg60, psi.full.avg300);
+	free(some_output);
+	return sc;
+}
+
+mp_proc_stat_procs mp_read_proc_stat_procs(const char *path) {
+	mp_proc_stat_procs result = {
+		.errorcode = ERROR,
+	};
+
+	mp_procfs_field fields[] = {
+		{.key = "procs_running"},
+		{.key = "procs_blocked"},
+	};
+
+	mp_procfs_keyset keyset;
+	mp_procfs_keyset_init(&keyset, fields, sizeof(fields) / sizeof(fields[0]));
+
+	if (mp_procfs_read_kv(path, &keyset) != 2) {
+		return result;
+	}
+
+	result.procs_running = fields[0].values[0];
+	result.procs_blocked = fields[1].values[0];
+	result.errorcode = OK;
+
+	return result;
+}
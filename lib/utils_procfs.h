@@ -0,0 +1,108 @@
+#pragma once
+/* Header file for utils_procfs, helpers to read Linux procfs files */
+
+#include "../config.h"
+#include "./output.h"
+#include "./thresholds.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MP_PROC_PRESSURE_CPU    "/proc/pressure/cpu"
+#define MP_PROC_PRESSURE_MEMORY "/proc/pressure/memory"
+#define MP_PROC_PRESSURE_IO     "/proc/pressure/io"
+#define MP_PROC_STAT            "/proc/stat"
+#define MP_PROC_MEMINFO         "/proc/meminfo"
+#define MP_PROC_VMSTAT          "/proc/vmstat"
+
+/*
+ * Generic parser for "key: value [kB]" (/proc/meminfo) and "key value"
+ * (/proc/vmstat, /proc/stat, cgroup memory.stat) style files.
+ *
+ * The caller describes the keys it is interested in with an array of
+ * mp_procfs_field, mp_procfs_keyset_init precomputes a hash table for them
+ * once. A file is then read with as few read() calls as possible into a stack
+ * buffer and every line is looked up in the table, so all fields are
+ * returned from a single pass. Values with a "kB" suffix are converted to
+ * bytes. Up to MP_PROCFS_MAX_VALUES numbers per line are recorded (e.g.
+ * "Swap: total used free" on NetBSD).
+ */
+#define MP_PROCFS_MAX_VALUES 3
+#define MP_PROCFS_MAX_FIELDS 64
+
+typedef struct {
+	const char *key;
+	bool found;
+	size_t number_of_values;
+	unsigned long long values[MP_PROCFS_MAX_VALUES];
+} mp_procfs_field;
+
+typedef struct {
+	mp_procfs_field *fields;
+	size_t number_of_fields;
+	size_t key_lengths[MP_PROCFS_MAX_FIELDS];
+	/* open addressing table, entries are indices into fields + 1, 0 is empty */
+	unsigned char table[MP_PROCFS_MAX_FIELDS * 2];
+} mp_procfs_keyset;
+
+/*
+ * Returns OK or ERROR if there are too many fields
+ */
+int mp_procfs_keyset_init(mp_procfs_keyset keyset[static 1], mp_procfs_field fields[],
+						  size_t number_of_fields);
+
+/*
+ * Parse a buffer with complete lines, returns the number of fields found
+ */
+size_t mp_procfs_parse_kv(const char *buffer, size_t length, mp_procfs_keyset keyset[static 1]);
+
+/*
+ * Read and parse a file, returns the number of fields found or ERROR if the
+ * file could not be read
+ */
+int mp_procfs_read_kv(const char *path, mp_procfs_keyset keyset[static 1]);
+
+/*
+ * One line of a pressure stall information (PSI) file, e.g.
+ * "some avg10=0.31 avg60=0.12 avg300=0.05 total=1234567"
+ * The averages are percentages, total is the accumulated stall time in microseconds
+ */
+typedef struct {
+	double avg10;
+	double avg60;
+	double avg300;
+	unsigned long long total;
+} mp_psi_line;
+
+typedef struct {
+	int errorcode;
+	bool some_present;
+	mp_psi_line some;
+	bool full_present;
+	mp_psi_line full;
+} mp_psi_result;
+
+/*
+ * Parse the content of a PSI file (/proc/pressure/{cpu,memory,io} or a cgroup
+ * *.pressure file). errorcode is OK if at least the "some" line was found
+ */
+mp_psi_result mp_parse_pressure(const char *buffer, size_t length);
+mp_psi_result mp_read_pressure_file(const char *path);
+
+/*
+ * Read a PSI file and evaluate the "some" avg10 value against the thresholds. The subcheck
+ * carries the averages and total stall times of the "some" and "full" lines as perfdata,
+ * labelled <label_prefix>_some_avg10 etc. The output starts with resource_name.
+ */
+mp_subcheck mp_evaluate_pressure(const char *resource_name, const char *label_prefix,
+								 const char *path, mp_thresholds thresholds);
+
+/*
+ * Run queue related counters from /proc/stat
+ */
+typedef struct {
+	int errorcode;
+	unsigned long long procs_running;
+	unsigned long long procs_blocked;
+} mp_proc_stat_procs;
+
+mp_proc_stat_procs mp_read_proc_stat_procs(const char *path);
@@ -61,6 +61,7 @@ const char *email = "devel@monitoring-plugins.org";
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/stat.h>
 
 #if defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL)
 #	include <openssl/opensslv.h>
@@ -68,10 +69,6 @@ const char *email = "devel@monitoring-plugins.org";
 
 #include <netdb.h>
 
-enum {
-	REGS = 2,
-};
-
 #include "regex.h"
 
 // Globals
@@ -85,6 +82,21 @@ extern bool add_sslctx_verify_fun;
 static X509 *cert = NULL;
 #endif /* defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL) */
 
+/* perfdata label, name of the threshold options and output of the phases of a transfer */
+static const struct {
+	const char *label;
+	const char *option;
+	const char *description;
+} curl_phase_names[CURL_PHASE_COUNT] = {
+	[CURL_PHASE_NAMELOOKUP] = {"time_namelookup", "namelookup", "Name lookup time"},
+	[CURL_PHASE_CONNECT] = {"time_connect", "connect", "Connection time"},
+	[CURL_PHASE_TLS] = {"time_tls", "tls", "TLS handshake time"},
+	[CURL_PHASE_HEADERS] = {"time_headers", "headers", "Time to send the request"},
+	[CURL_PHASE_FIRSTBYTE] = {"time_firstbyte", "firstbyte", "Time to first byte"},
+	[CURL_PHASE_TRANSFER] = {"time_transfer", "transfer", "Transfer time"},
+	[CURL_PHASE_REDIRECT] = {"time_redirect", "redirect", "Redirect time"},
+};
+
 typedef struct {
 	int errorcode;
 	check_curl_config config;
@@ -93,6 +105,11 @@ static check_curl_config_wrapper process_arguments(int /*argc*/, char ** /*argv*
 
 static mp_subcheck check_http(check_curl_config /*config*/, check_curl_working_state workingState,
 							  long redir_depth);
+static mp_subcheck check_http_evaluate(check_curl_config /*config*/,
+									   check_curl_working_state workingState,
+									   check_curl_global_state curl_state, CURLcode res,
+									   const char *error_buffer, long redir_depth);
+static mp_check check_http_multi(check_curl_config /*config*/);
 
 typedef struct {
 	long redir_depth;
@@ -123,9 +140,11 @@ int main(int argc, char **argv) {
 #ifdef __OpenBSD__
 	/* - rpath is required to read --extra-opts, CA and/or client certs
 	 * - wpath is required to write --cookie-jar (possibly given up later)
+	 * - wpath, cpath and flock are required to update the --session-cache files
+	 *   (possibly given up later)
 	 * - inet is required for sockets
 	 * - dns is required for name lookups */
-	pledge("stdio rpath wpath inet dns", NULL);
+	pledge("stdio rpath wpath cpath flock inet dns", NULL);
 #endif // __OpenBSD__
 
 	setlocale(LC_ALL, "");
@@ -144,9 +163,20 @@ int main(int argc, char **argv) {
 	const check_curl_config config = tmp_config.config;
 
 #ifdef __OpenBSD__
-	if (!config.curl_config.cookie_jar_file) {
+	if (config.curl_config.session_cache_dir) {
+		/* the cache files are locked, created with mkstemp and renamed into place */
+		if (verbose >= 2) {
+			printf(_("* \"--session-cache\" is used, keeping \"wpath cpath flock\" pledge(2)\n"));
+		}
+	} else if (config.curl_config.cookie_jar_file) {
+		if (verbose >= 2) {
+			printf(_("* No \"--session-cache\" is used, giving up \"cpath flock\" pledge(2)\n"));
+		}
+		pledge("stdio rpath wpath inet dns", NULL);
+	} else {
 		if (verbose >= 2) {
-			printf(_("* No \"--cookie-jar\" is used, giving up \"wpath\" pledge(2)\n"));
+			printf(_("* No \"--cookie-jar\" or \"--session-cache\" is used, giving up "
+					 "\"wpath cpath flock\" pledge(2)\n"));
 		}
 		pledge("stdio rpath inet dns", NULL);
 	}
@@ -156,6 +186,16 @@ int main(int argc, char **argv) {
 		mp_set_format(config.output_format);
 	}
 
+	if (config.targets_count > 0) {
+		mp_check overall = check_http_multi(config);
+		mp_exit(overall);
+	}
+
+	if (config.sweep_targets_count > 0) {
+		mp_check overall = check_curl_certificate_sweep(config);
+		mp_exit(overall);
+	}
+
 	check_curl_working_state working_state = config.initial_config;
 
 	mp_check overall = mp_check_init();
@@ -199,11 +239,15 @@ int verify_callback(int preverify_ok, X509_STORE_CTX *x509_ctx) {
 #	ifdef MOPL_USE_OPENSSL
 CURLcode sslctxfun(CURL *curl, SSL_CTX *sslctx, void *parm) {
 	(void)curl; // ignore unused parameter
-	(void)parm; // ignore unused parameter
 	if (add_sslctx_verify_fun) {
 		SSL_CTX_set_verify(sslctx, SSL_VERIFY_PEER, verify_callback);
 	}
 
+	/* parm is the session cache of the transfer, if --session-cache is used */
+	if (parm != NULL) {
+		check_curl_session_cache_setup_ssl_ctx(sslctx, parm);
+	}
+
 	// workaround for issue:
 	// OpenSSL SSL_read: error:0A000126:SSL routines::unexpected eof while reading, errno 0
 	// see discussion https://github.com/openssl/openssl/discussions/22690
@@ -216,6 +260,131 @@ CURLcode sslctxfun(CURL *curl, SSL_CTX *sslctx, void *parm) {
 #	endif /* MOPL_USE_OPENSSL */
 #endif     /* HAVE_SSL */
 
+/* reads a time of the transfer in seconds, the *_T variants have microsecond resolution */
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 61, 0)
+#	define GET_CURL_TIME(curl, info, target)                                                      \
+		do {                                                                                       \
+			curl_off_t microseconds = 0;                                                           \
+			handle_curl_option_return_code(curl_easy_getinfo(curl, info##_T, &microseconds),       \
+										   #info "_T");                                            \
+			(target) = (double)microseconds / 1000000.0;                                           \
+		} while (0)
+#else
+#	define GET_CURL_TIME(curl, info, target)                                                      \
+		handle_curl_option_return_code(curl_easy_getinfo(curl, info, &(target)), #info)
+#endif
+
+/* reads a speed of the transfer in bytes per second */
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 55, 0)
+#	define GET_CURL_SPEED(curl, info, target)                                                     \
+		do {                                                                                       \
+			curl_off_t bytes_per_second = 0;                                                       \
+			handle_curl_option_return_code(curl_easy_getinfo(curl, info##_T, &bytes_per_second),   \
+										   #info "_T");                                            \
+			(target) = (double)bytes_per_second;                                                   \
+		} while (0)
+#else
+#	define GET_CURL_SPEED(curl, info, target)                                                     \
+		handle_curl_option_return_code(curl_easy_getinfo(curl, info, &(target)), #info)
+#endif
+
+/*
+ * Adds the timings of the single phases of the transfer. Phases with thresholds get their own
+ * subcheck, the others are only added as perfdata with -E.
+ */
+static void add_phase_timings(mp_subcheck sc_result[static 1], CURL *curl,
+							  const check_curl_config config, bool use_ssl, double total_time) {
+	bool phase_thresholds_set = false;
+	for (size_t i = 0; i < CURL_PHASE_COUNT; i++) {
+		if (config.phase_thlds[i].warning_is_set || config.phase_thlds[i].critical_is_set) {
+			phase_thresholds_set = true;
+		}
+	}
+
+	if (!config.show_extended_perfdata && !phase_thresholds_set) {
+		return;
+	}
+
+	double time_namelookup = 0;
+	double time_connect = 0;
+	double time_appconnect = 0;
+	double time_pretransfer = 0;
+	double time_starttransfer = 0;
+	double time_redirect = 0;
+	GET_CURL_TIME(curl, CURLINFO_NAMELOOKUP_TIME, time_namelookup);
+	GET_CURL_TIME(curl, CURLINFO_CONNECT_TIME, time_connect);
+	GET_CURL_TIME(curl, CURLINFO_APPCONNECT_TIME, time_appconnect);
+	GET_CURL_TIME(curl, CURLINFO_PRETRANSFER_TIME, time_pretransfer);
+	GET_CURL_TIME(curl, CURLINFO_STARTTRANSFER_TIME, time_starttransfer);
+	GET_CURL_TIME(curl, CURLINFO_REDIRECT_TIME, time_redirect);
+
+	double phase_values[CURL_PHASE_COUNT] = {
+		[CURL_PHASE_NAMELOOKUP] = time_namelookup,
+		[CURL_PHASE_CONNECT] = time_connect,
+		[CURL_PHASE_TLS] = time_appconnect - time_connect,
+		[CURL_PHASE_HEADERS] = time_pretransfer - time_appconnect,
+		[CURL_PHASE_FIRSTBYTE] = time_starttransfer,
+		[CURL_PHASE_TRANSFER] = total_time - time_starttransfer,
+		[CURL_PHASE_REDIRECT] = time_redirect,
+	};
+
+	for (size_t i = 0; i < CURL_PHASE_COUNT; i++) {
+		if (i == CURL_PHASE_TLS && !use_ssl) {
+			/* thresholds for a handshake which did not happen can not be met */
+			if (config.phase_thlds[i].warning_is_set || config.phase_thlds[i].critical_is_set) {
+				mp_subcheck sc_phase = mp_subcheck_init();
+				sc_phase = mp_set_subcheck_state(sc_phase, STATE_UNKNOWN);
+				xasprintf(&sc_phase.output, "%s: no TLS handshake, the URL does not use TLS",
+						  curl_phase_names[i].description);
+				mp_add_subcheck_to_subcheck(sc_result, sc_phase);
+			}
+			continue;
+		}
+
+		mp_perfdata pd_phase = perfdata_init();
+		pd_phase.value = mp_create_pd_value(phase_values[i]);
+		pd_phase.label = (char *)curl_phase_names[i].label;
+		pd_phase.uom = "s";
+
+		if (i == CURL_PHASE_CONNECT) {
+			pd_phase = mp_set_pd_max_value(pd_phase,
+										   mp_create_pd_value(config.curl_config.socket_timeout));
+			/* the connection time used the global thresholds before it had its own */
+			pd_phase = mp_pd_set_thresholds(pd_phase, config.thlds);
+		}
+
+		if (config.phase_thlds[i].warning_is_set || config.phase_thlds[i].critical_is_set) {
+			pd_phase = mp_pd_set_thresholds(pd_phase, config.phase_thlds[i]);
+
+			mp_subcheck sc_phase = mp_subcheck_init();
+			sc_phase = mp_set_subcheck_state(sc_phase, mp_get_pd_status(pd_phase));
+			xasprintf(&sc_phase.output, "%s: %fs", curl_phase_names[i].description,
+					  phase_values[i]);
+			mp_add_perfdata_to_subcheck(&sc_phase, pd_phase);
+			mp_add_subcheck_to_subcheck(sc_result, sc_phase);
+		} else if (config.show_extended_perfdata) {
+			mp_add_perfdata_to_subcheck(sc_result, pd_phase);
+		}
+	}
+
+	if (config.show_extended_perfdata) {
+		double speed_download = 0;
+		double speed_upload = 0;
+		GET_CURL_SPEED(curl, CURLINFO_SPEED_DOWNLOAD, speed_download);
+		GET_CURL_SPEED(curl, CURLINFO_SPEED_UPLOAD, speed_upload);
+
+		mp_perfdata pd_speed_download = perfdata_init();
+		pd_speed_download.value = mp_create_pd_value((unsigned long long)speed_download);
+		pd_speed_download.label = "speed_download";
+		mp_add_perfdata_to_subcheck(sc_result, pd_speed_download);
+
+		mp_perfdata pd_speed_upload = perfdata_init();
+		pd_speed_upload.value = mp_create_pd_value((unsigned long long)speed_upload);
+		pd_speed_upload.label = "speed_upload";
+		mp_add_perfdata_to_subcheck(sc_result, pd_speed_upload);
+	}
+}
+
 mp_subcheck check_http(const check_curl_config config, check_curl_working_state workingState,
 					   long redir_depth) {
 
@@ -228,13 +397,7 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 
 	check_curl_global_state curl_state = conf_curl_struct.curl_state;
 	workingState = conf_curl_struct.working_state;
-
-	mp_subcheck sc_result = mp_subcheck_init();
-
-	char *url = fmt_url(workingState);
-	xasprintf(&sc_result.output, "Testing %s", url);
-	// TODO add some output here URL or something
-	free(url);
+	check_curl_configure_body_matcher(&curl_state, &config);
 
 	// ==============
 	// do the request
@@ -245,6 +408,32 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 		printf("* curl_easy_perform returned: %s\n", curl_easy_strerror(res));
 	}
 
+	return check_http_evaluate(config, workingState, curl_state, res, errbuf, redir_depth);
+}
+
+/*
+ * Evaluates a finished transfer, used for the single request of check_http and for every
+ * transfer of the multi URL mode
+ */
+mp_subcheck check_http_evaluate(const check_curl_config config,
+								check_curl_working_state workingState,
+								check_curl_global_state curl_state, CURLcode res,
+								const char *error_buffer, long redir_depth) {
+	mp_subcheck sc_result = mp_subcheck_init();
+
+	char *url = fmt_url(workingState);
+	xasprintf(&sc_result.output, "Testing %s", url);
+	free(url);
+
+	/* an early stop of the transfer by the body matcher is not an error */
+	bool body_truncated = false;
+	if (res == CURLE_WRITE_ERROR && curl_state.body_matcher->aborted) {
+		body_truncated = true;
+		res = CURLE_OK;
+	}
+	curlhelp_body_matcher_finish(curl_state.body_matcher);
+	check_curl_session_cache_save(curl_state.session_cache, curl_state.curl, res);
+
 	if (verbose >= 2 && workingState.http_post_data) {
 		printf("**** REQUEST CONTENT ****\n%s\n", workingState.http_post_data);
 	}
@@ -258,7 +447,8 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 			printf("* adding a subcheck for the certificate\n");
 		}
 		mp_subcheck sc_certificate = check_curl_certificate_checks(
-			curl_state.curl, cert, config.days_till_exp_warn, config.days_till_exp_crit);
+			curl_state.curl, cert, config.days_till_exp_warn, config.days_till_exp_crit,
+			config.curl_config.session_cache_dir);
 
 		mp_add_subcheck_to_subcheck(&sc_result, sc_certificate);
 		if (!config.continue_after_check_cert) {
@@ -278,12 +468,12 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 		/* Custom handling for timeouts, state might be set to non CRITICAL */
 		if (res == CURLE_OPERATION_TIMEDOUT) {
 			xasprintf(&sc_curl.output, _("cURL returned %d - %s"), res,
-					  errbuf[0] ? errbuf : curl_easy_strerror(res));
+					  error_buffer[0] ? error_buffer : curl_easy_strerror(res));
 			sc_curl = mp_set_subcheck_state(sc_curl, config.on_timeout_result_state);
 		} else {
 			xasprintf(&sc_curl.output,
 					  _("Error while performing connection: cURL returned %d - %s"), res,
-					  errbuf[0] ? errbuf : curl_easy_strerror(res));
+					  error_buffer[0] ? error_buffer : curl_easy_strerror(res));
 			sc_curl = mp_set_subcheck_state(sc_curl, STATE_CRITICAL);
 		}
 		mp_add_subcheck_to_subcheck(&sc_result, sc_curl);
@@ -301,7 +491,8 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 
 	curl_state.status_line_initialized = true;
 
-	size_t page_len = get_content_length(curl_state.header_buf, curl_state.body_buf);
+	size_t page_len =
+		get_content_length(curl_state.header_buf, curl_state.body_matcher->body_length);
 
 	double total_time;
 	handle_curl_option_return_code(
@@ -312,6 +503,10 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 		&sc_curl.output, "%s %d %s - %ld bytes in %.3f second response time",
 		string_statuscode(curl_state.status_line->http_major, curl_state.status_line->http_minor),
 		curl_state.status_line->http_code, curl_state.status_line->msg, page_len, total_time);
+	if (body_truncated) {
+		xasprintf(&sc_curl.output, "%s (transfer stopped after %zu bytes of the body)",
+				  sc_curl.output, curl_state.body_matcher->body_length);
+	}
 	sc_curl = mp_set_subcheck_state(sc_curl, STATE_OK);
 	mp_add_subcheck_to_subcheck(&sc_result, sc_curl);
 
@@ -338,77 +533,7 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 
 	mp_add_subcheck_to_subcheck(&sc_result, sc_total_time);
 
-	if (config.show_extended_perfdata) {
-		// overall connection time
-		mp_perfdata pd_time_connect = perfdata_init();
-		double time_connect;
-		handle_curl_option_return_code(
-			curl_easy_getinfo(curl_state.curl, CURLINFO_CONNECT_TIME, &time_connect),
-			"CURLINFO_CONNECT_TIME");
-
-		mp_perfdata_value pd_val_time_connect = mp_create_pd_value(time_connect);
-		pd_time_connect.value = pd_val_time_connect;
-		pd_time_connect.label = "time_connect";
-		pd_time_connect.uom = "s";
-		pd_time_connect = mp_set_pd_max_value(
-			pd_time_connect, mp_create_pd_value(config.curl_config.socket_timeout));
-
-		pd_time_connect = mp_pd_set_thresholds(pd_time_connect, config.thlds);
-		mp_add_perfdata_to_subcheck(&sc_result, pd_time_connect);
-
-		// application connection time, used to compute other timings
-		double time_appconnect;
-		handle_curl_option_return_code(
-			curl_easy_getinfo(curl_state.curl, CURLINFO_APPCONNECT_TIME, &time_appconnect),
-			"CURLINFO_APPCONNECT_TIME");
-
-		if (workingState.use_ssl) {
-			mp_perfdata pd_time_tls = perfdata_init();
-			{
-				mp_perfdata_value pd_val_time_tls =
-					mp_create_pd_value(time_appconnect - time_connect);
-
-				pd_time_tls.value = pd_val_time_tls;
-			}
-			pd_time_tls.label = "time_tls";
-			pd_time_tls.uom = "s";
-			mp_add_perfdata_to_subcheck(&sc_result, pd_time_tls);
-		}
-
-		mp_perfdata pd_time_headers = perfdata_init();
-		{
-			double time_headers;
-			handle_curl_option_return_code(
-				curl_easy_getinfo(curl_state.curl, CURLINFO_PRETRANSFER_TIME, &time_headers),
-				"CURLINFO_PRETRANSFER_TIME");
-
-			mp_perfdata_value pd_val_time_headers =
-				mp_create_pd_value(time_headers - time_appconnect);
-
-			pd_time_headers.value = pd_val_time_headers;
-		}
-		pd_time_headers.label = "time_headers";
-		pd_time_headers.uom = "s";
-		mp_add_perfdata_to_subcheck(&sc_result, pd_time_headers);
-
-		mp_perfdata pd_time_firstbyte = perfdata_init();
-		double time_firstbyte;
-		handle_curl_option_return_code(
-			curl_easy_getinfo(curl_state.curl, CURLINFO_STARTTRANSFER_TIME, &time_firstbyte),
-			"CURLINFO_STARTTRANSFER_TIME");
-
-		mp_perfdata_value pd_val_time_firstbyte = mp_create_pd_value(time_firstbyte);
-		pd_time_firstbyte.value = pd_val_time_firstbyte;
-		pd_time_firstbyte.label = "time_firstbyte";
-		pd_time_firstbyte.uom = "s";
-		mp_add_perfdata_to_subcheck(&sc_result, pd_time_firstbyte);
-
-		mp_perfdata pd_time_transfer = perfdata_init();
-		pd_time_transfer.value = mp_create_pd_value(total_time - time_firstbyte);
-		pd_time_transfer.label = "time_transfer";
-		pd_time_transfer.uom = "s";
-		mp_add_perfdata_to_subcheck(&sc_result, pd_time_transfer);
-	}
+	add_phase_timings(&sc_result, curl_state.curl, config, workingState.use_ssl, total_time);
 
 	/* return a CRITICAL status if we couldn't read any data */
 	if (strlen(curl_state.header_buf->buf) == 0 && strlen(curl_state.body_buf->buf) == 0) {
@@ -576,7 +701,7 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 		sc_string_expect = mp_set_subcheck_default_state(sc_string_expect, STATE_OK);
 		xasprintf(&sc_string_expect.output, "Expect string \"%s\" in body", config.string_expect);
 
-		if (!strstr(curl_state.body_buf->buf, config.string_expect)) {
+		if (!curl_state.body_matcher->string_found) {
 			char output_string_search[30] = "";
 			strncpy(&output_string_search[0], config.string_expect, sizeof(output_string_search));
 
@@ -598,9 +723,8 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 	if (strlen(config.regexp)) {
 		mp_subcheck sc_body_regex = mp_subcheck_init();
 		xasprintf(&sc_body_regex.output, "Regex \"%s\" in body matched", config.regexp);
-		regmatch_t pmatch[REGS];
 
-		int errcode = regexec(&config.compiled_regex, curl_state.body_buf->buf, REGS, pmatch, 0);
+		int errcode = curl_state.body_matcher->regex_result;
 
 		if (errcode == 0) {
 			// got a match
@@ -629,6 +753,14 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 		mp_add_subcheck_to_subcheck(&sc_result, sc_body_regex);
 	}
 
+	if (curl_state.body_matcher->json) {
+		check_curl_json_evaluate(curl_state.body_matcher->json, &sc_result);
+	}
+
+	if (curl_state.body_matcher->prometheus) {
+		check_curl_prometheus_evaluate(curl_state.body_matcher->prometheus, &sc_result);
+	}
+
 	// size a.k.a. page length
 	mp_perfdata pd_page_length = perfdata_init();
 	mp_perfdata_value pd_val_page_length = mp_create_pd_value(page_len);
@@ -672,6 +804,191 @@ mp_subcheck check_http(const check_curl_config config, check_curl_working_state
 	return sc_result;
 }
 
+typedef struct {
+	check_curl_working_state working_state;
+	check_curl_global_state curl_state;
+	CURLcode result;
+	char error_buffer[CURL_ERROR_SIZE];
+} multi_transfer;
+
+/*
+ * Prefixes all perfdata labels of a subcheck tree, so the values of several targets can be
+ * told apart
+ */
+static void prefix_perfdata_labels(mp_subcheck subcheck[static 1], const char *prefix) {
+	for (pd_list *perfdata = subcheck->perfdata; perfdata != NULL; perfdata = perfdata->next) {
+		if (perfdata->data.label != NULL) {
+			xasprintf(&perfdata->data.label, "%s_%s", prefix, perfdata->data.label);
+		}
+	}
+	for (mp_subcheck_list *child = subcheck->subchecks; child != NULL; child = child->next) {
+		prefix_perfdata_labels(&child->subcheck, prefix);
+	}
+}
+
+/*
+ * Multi URL mode: all targets are requested concurrently with one curl multi handle.
+ * DNS results, TLS sessions and connections are shared between the transfers (and the
+ * requests of the check_http style redirection), so many URLs on the same server cost
+ * only one lookup and one handshake. With --multi-path the requests wait for the first
+ * connection and are sent over it as HTTP/2 (or HTTP/3) streams.
+ */
+mp_check check_http_multi(check_curl_config config) {
+	CURLSH *share = curl_share_init();
+	if (share == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_share_init failed\n");
+	}
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	/* a resumed TLS session does not provide the certificate of the server */
+	if (!config.check_cert) {
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	}
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 57, 0)
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+	config.curl_config.share = share;
+
+	CURLM *multi = curl_multi_init();
+	if (multi == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_multi_init failed\n");
+	}
+
+	if (config.multiplex) {
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 47, 0)
+		if (config.curl_config.curl_http_version == CURL_HTTP_VERSION_NONE) {
+			config.curl_config.curl_http_version = CURL_HTTP_VERSION_2TLS;
+		}
+#endif
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 43, 0)
+		curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
+		/* HTTP/1.x can not multiplex, the requests then reuse one connection after another */
+		curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, 1L);
+	}
+
+	multi_transfer *transfers = calloc(config.targets_count, sizeof(multi_transfer));
+	if (transfers == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+	}
+
+	for (size_t i = 0; i < config.targets_count; i++) {
+		check_curl_configure_curl_wrapper conf_curl_struct = check_curl_configure_curl(
+			config.curl_config, config.targets[i], config.check_cert,
+			config.on_redirect_dependent, config.followmethod, config.max_depth);
+
+		transfers[i].curl_state = conf_curl_struct.curl_state;
+		transfers[i].working_state = conf_curl_struct.working_state;
+		transfers[i].result = CURLE_OK;
+		check_curl_configure_body_matcher(&transfers[i].curl_state, &config);
+
+		/* the global error buffer would be overwritten by concurrent transfers */
+		handle_curl_option_return_code(curl_easy_setopt(transfers[i].curl_state.curl,
+														CURLOPT_ERRORBUFFER,
+														transfers[i].error_buffer),
+									   "CURLOPT_ERRORBUFFER");
+		handle_curl_option_return_code(
+			curl_easy_setopt(transfers[i].curl_state.curl, CURLOPT_PRIVATE, &transfers[i]),
+			"CURLOPT_PRIVATE");
+		if (config.check_cert) {
+			handle_curl_option_return_code(
+				curl_easy_setopt(transfers[i].curl_state.curl, CURLOPT_SSL_SESSIONID_CACHE, 0L),
+				"CURLOPT_SSL_SESSIONID_CACHE");
+		}
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 43, 0)
+		if (config.multiplex) {
+			/* wait for the connection of the first transfer instead of opening more */
+			handle_curl_option_return_code(
+				curl_easy_setopt(transfers[i].curl_state.curl, CURLOPT_PIPEWAIT, 1L),
+				"CURLOPT_PIPEWAIT");
+		}
+#endif
+
+		if (curl_multi_add_handle(multi, transfers[i].curl_state.curl) != CURLM_OK) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_multi_add_handle failed\n");
+		}
+	}
+
+	/* the certificate of the OpenSSL verify callback is a single global, which does not
+	 * work with concurrent handshakes, use the certificate info of every transfer instead */
+	add_sslctx_verify_fun = false;
+
+	int still_running = 0;
+	do {
+		CURLMcode multi_result = curl_multi_perform(multi, &still_running);
+		if (multi_result == CURLM_OK && still_running) {
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 66, 0)
+			multi_result = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+#else
+			multi_result = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+#endif
+		}
+
+		if (multi_result != CURLM_OK) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - curl multi interface failed: %s\n",
+				curl_multi_strerror(multi_result));
+		}
+
+		CURLMsg *message;
+		int messages_left;
+		while ((message = curl_multi_info_read(multi, &messages_left)) != NULL) {
+			if (message->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			multi_transfer *transfer = NULL;
+			curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+			transfer->result = message->data.result;
+
+			if (verbose > 1) {
+				char *url = fmt_url(transfer->working_state);
+				printf("* transfer of %s returned: %s\n", url,
+					   curl_easy_strerror(transfer->result));
+				free(url);
+			}
+		}
+	} while (still_running);
+
+	mp_check overall = mp_check_init();
+	long connections = 0;
+	for (size_t i = 0; i < config.targets_count; i++) {
+		long new_connections = 0;
+		curl_easy_getinfo(transfers[i].curl_state.curl, CURLINFO_NUM_CONNECTS, &new_connections);
+		connections += new_connections;
+
+		curl_multi_remove_handle(multi, transfers[i].curl_state.curl);
+		/* reset for every transfer, a redirection might have used the callback again */
+		is_openssl_callback = false;
+
+		mp_subcheck sc_target = check_http_evaluate(config, transfers[i].working_state,
+													 transfers[i].curl_state, transfers[i].result,
+													 transfers[i].error_buffer, 0);
+
+		char *label_prefix = NULL;
+		xasprintf(&label_prefix, "url%zu", i + 1);
+		prefix_perfdata_labels(&sc_target, label_prefix);
+		free(label_prefix);
+
+		mp_add_subcheck_to_check(&overall, sc_target);
+	}
+
+	/* only --multi-path promises to reuse connections, so only there they are worth reporting */
+	if (config.multiplex) {
+		mp_subcheck sc_connections = mp_subcheck_init();
+		sc_connections = mp_set_subcheck_state(sc_connections, STATE_OK);
+		xasprintf(&sc_connections.output, "%zu requests used %ld new connection(s)",
+				  config.targets_count, connections);
+		mp_perfdata pd_connections = perfdata_init();
+		pd_connections.label = "connections";
+		pd_connections.value = mp_create_pd_value(connections);
+		mp_add_perfdata_to_subcheck(&sc_connections, pd_connections);
+		mp_add_subcheck_to_check(&overall, sc_connections);
+	}
+
+	curl_multi_cleanup(multi);
+
+	return overall;
+}
+
 int uri_strcmp(const UriTextRangeA range, const char *stringToCompare) {
 	if (!range.first) {
 		return -1;
@@ -928,6 +1245,120 @@ redir_wrapper redir(curlhelp_write_curlbuf *header_buf, const check_curl_config
 	return result;
 }
 
+typedef struct {
+	int errorcode;
+	check_curl_working_state working_state;
+} url_target_wrapper;
+
+/*
+ * Derives the working state for one target of the multi URL mode from a full URL
+ * (http[s]://host[:port][/path][?query]). All other request parameters (method, body, ...)
+ * are taken from the initial working state. If an address was given with -I, all
+ * connections go there and the host of the URL is only used as host name.
+ */
+static url_target_wrapper parse_url_target(const char *url,
+										   check_curl_working_state initial_state) {
+	url_target_wrapper result = {
+		.errorcode = ERROR,
+		.working_state = initial_state,
+	};
+
+	UriParserStateA state;
+	UriUriA uri;
+	state.uri = &uri;
+	if (uriParseUriA(&state, url) != URI_SUCCESS) {
+		return result;
+	}
+
+	char buf[DEFAULT_BUFFER_SIZE];
+	if (!uri_strcmp(uri.scheme, "https")) {
+		result.working_state.use_ssl = true;
+		result.working_state.serverPort = HTTPS_PORT;
+	} else if (!uri_strcmp(uri.scheme, "http")) {
+		result.working_state.use_ssl = false;
+		result.working_state.serverPort = HTTP_PORT;
+	} else {
+		uriFreeUriMembersA(&uri);
+		return result;
+	}
+
+	uri_string_wrapper host = uri_string(uri.hostText, buf, DEFAULT_BUFFER_SIZE);
+	if (host.errorcode != 0 || strlen(host.uri_string) == 0) {
+		uriFreeUriMembersA(&uri);
+		return result;
+	}
+
+	if (initial_state.server_address != NULL) {
+		result.working_state.host_name = strdup(host.uri_string);
+	} else {
+		result.working_state.server_address = strdup(host.uri_string);
+		result.working_state.host_name = NULL;
+	}
+
+	/* the path starts right after the authority part */
+	const char *authority_end = uri.hostText.afterLast;
+	if (uri.hostData.ip6) {
+		authority_end++; /* closing bracket */
+	}
+	if (uri.portText.first) {
+		uri_string_wrapper port = uri_string(uri.portText, buf, DEFAULT_BUFFER_SIZE);
+		if (port.errorcode != 0 || !is_intnonneg(port.uri_string) ||
+			strtol(port.uri_string, NULL, 10) > MAX_PORT) {
+			uriFreeUriMembersA(&uri);
+			return result;
+		}
+		result.working_state.serverPort = (unsigned short)strtol(port.uri_string, NULL, 10);
+		authority_end = uri.portText.afterLast;
+	}
+	result.working_state.virtualPort = result.working_state.serverPort;
+
+	size_t path_length = strcspn(authority_end, "#");
+	if (path_length == 0) {
+		result.working_state.server_url = strdup(DEFAULT_SERVER_URL);
+	} else if (authority_end[0] == '?') {
+		xasprintf(&result.working_state.server_url, "/%.*s", (int)path_length, authority_end);
+	} else {
+		result.working_state.server_url = strndup(authority_end, path_length);
+	}
+
+	uriFreeUriMembersA(&uri);
+
+	result.errorcode = OK;
+	return result;
+}
+
+/*
+ * Reads URLs for the multi URL mode from a file, one per line. Empty lines and lines
+ * starting with '#' are ignored
+ */
+static void read_url_list(const char *path, char ***urls, size_t urls_count[static 1]) {
+	FILE *url_file = fopen(path, "r");
+	if (url_file == NULL) {
+		usage2(_("file does not exist or is not readable"), path);
+	}
+
+	char line[MAX_INPUT_BUFFER];
+	while (fgets(line, sizeof(line), url_file) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		char *url = line;
+		while (isspace((unsigned char)*url)) {
+			url++;
+		}
+		if (*url == '\0' || *url == '#') {
+			continue;
+		}
+
+		*urls = realloc(*urls, sizeof(char *) * (*urls_count + 1));
+		if (*urls == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+		}
+		(*urls)[(*urls_count)++] = strdup(url);
+	}
+
+	fclose(url_file);
+}
+
 check_curl_config_wrapper process_arguments(int argc, char **argv) {
 	enum {
 		INVERT_REGEX = CHAR_MAX + 1,
@@ -943,6 +1374,38 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 		OUTPUT_FORMAT,
 		NO_PROXY,
 		TIMEOUT_RESULT,
+		MULTI_URL,
+		MULTI_PATH,
+		URL_LIST,
+		STOP_ON_MATCH,
+		MAX_BODY_SIZE,
+		SESSION_CACHE,
+		DNS_CACHE_TTL,
+		TLS_SESSION_TTL,
+		JSON_EXPECT,
+		JSON_VALUE,
+		JSON_WARNING,
+		JSON_CRITICAL,
+		PROMETHEUS,
+		PROMETHEUS_WARNING,
+		PROMETHEUS_CRITICAL,
+		CERT_SWEEP,
+		SWEEP_CONCURRENCY,
+		/* warning and critical of every phase, in the order of check_curl_phase */
+		WARNING_NAMELOOKUP,
+		CRITICAL_NAMELOOKUP,
+		WARNING_CONNECT,
+		CRITICAL_CONNECT,
+		WARNING_TLS,
+		CRITICAL_TLS,
+		WARNING_HEADERS,
+		CRITICAL_HEADERS,
+		WARNING_FIRSTBYTE,
+		CRITICAL_FIRSTBYTE,
+		WARNING_TRANSFER,
+		CRITICAL_TRANSFER,
+		WARNING_REDIRECT,
+		CRITICAL_REDIRECT,
 	};
 
 	static struct option longopts[] = {
@@ -993,6 +1456,37 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 		{"haproxy-protocol", no_argument, 0, HAPROXY_PROTOCOL},
 		{"output-format", required_argument, 0, OUTPUT_FORMAT},
 		{"timeout-result", required_argument, 0, TIMEOUT_RESULT},
+		{"multi-url", required_argument, 0, MULTI_URL},
+		{"multi-path", required_argument, 0, MULTI_PATH},
+		{"url-list", required_argument, 0, URL_LIST},
+		{"stop-on-match", no_argument, 0, STOP_ON_MATCH},
+		{"max-body-size", required_argument, 0, MAX_BODY_SIZE},
+		{"session-cache", required_argument, 0, SESSION_CACHE},
+		{"dns-cache-ttl", required_argument, 0, DNS_CACHE_TTL},
+		{"tls-session-ttl", required_argument, 0, TLS_SESSION_TTL},
+		{"json-expect", required_argument, 0, JSON_EXPECT},
+		{"json-value", required_argument, 0, JSON_VALUE},
+		{"json-warning", required_argument, 0, JSON_WARNING},
+		{"json-critical", required_argument, 0, JSON_CRITICAL},
+		{"prometheus", required_argument, 0, PROMETHEUS},
+		{"prometheus-warning", required_argument, 0, PROMETHEUS_WARNING},
+		{"prometheus-critical", required_argument, 0, PROMETHEUS_CRITICAL},
+		{"cert-sweep", required_argument, 0, CERT_SWEEP},
+		{"sweep-concurrency", required_argument, 0, SWEEP_CONCURRENCY},
+		{"warning-namelookup", required_argument, 0, WARNING_NAMELOOKUP},
+		{"critical-namelookup", required_argument, 0, CRITICAL_NAMELOOKUP},
+		{"warning-connect", required_argument, 0, WARNING_CONNECT},
+		{"critical-connect", required_argument, 0, CRITICAL_CONNECT},
+		{"warning-tls", required_argument, 0, WARNING_TLS},
+		{"critical-tls", required_argument, 0, CRITICAL_TLS},
+		{"warning-headers", required_argument, 0, WARNING_HEADERS},
+		{"critical-headers", required_argument, 0, CRITICAL_HEADERS},
+		{"warning-firstbyte", required_argument, 0, WARNING_FIRSTBYTE},
+		{"critical-firstbyte", required_argument, 0, CRITICAL_FIRSTBYTE},
+		{"warning-transfer", required_argument, 0, WARNING_TRANSFER},
+		{"critical-transfer", required_argument, 0, CRITICAL_TRANSFER},
+		{"warning-redirect", required_argument, 0, WARNING_REDIRECT},
+		{"critical-redirect", required_argument, 0, CRITICAL_REDIRECT},
 		{0, 0, 0, 0}};
 
 	check_curl_config_wrapper result = {
@@ -1029,6 +1523,15 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 	bool specify_port = false;
 	bool enable_tls = false;
 	char *tls_option_optarg = NULL;
+	char **urls = NULL;
+	size_t urls_count = 0;
+	/* paths of the multiplexed mode, requested from the host given with -H/-I */
+	char **paths = NULL;
+	size_t paths_count = 0;
+	/* thresholds for the following --json-value options */
+	mp_thresholds json_thresholds = mp_thresholds_init();
+	/* thresholds for the following --prometheus options */
+	mp_thresholds prometheus_thresholds = mp_thresholds_init();
 
 	while (true) {
 		int option_index = getopt_long(
@@ -1338,6 +1841,7 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 			}
 
 			result.config.compiled_regex = preg;
+			result.config.regex_linespan = !(cflags & REG_NEWLINE);
 			break;
 		case INVERT_REGEX:
 			result.config.invert_regex = true;
@@ -1438,6 +1942,158 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 			strncpy(result.config.curl_config.no_proxy, optarg, DEFAULT_BUFFER_SIZE - 1);
 			result.config.curl_config.no_proxy[DEFAULT_BUFFER_SIZE - 1] = 0;
 			break;
+		case MULTI_URL:
+			urls = realloc(urls, sizeof(char *) * (urls_count + 1));
+			if (urls == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+			}
+			urls[urls_count++] = optarg;
+			break;
+		case MULTI_PATH:
+			if (optarg[0] != '/') {
+				usage2(_("Invalid path, expecting an absolute path"), optarg);
+			}
+			paths = realloc(paths, sizeof(char *) * (paths_count + 1));
+			if (paths == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+			}
+			paths[paths_count++] = optarg;
+			break;
+		case URL_LIST:
+			read_url_list(optarg, &urls, &urls_count);
+			break;
+		case CERT_SWEEP:
+			check_curl_sweep_read_targets(optarg, &result.config.sweep_targets,
+										  &result.config.sweep_targets_count);
+			break;
+		case SWEEP_CONCURRENCY:
+			if (!is_intpos(optarg)) {
+				usage2(_("Invalid sweep concurrency, expecting a positive number"), optarg);
+			}
+			result.config.sweep_concurrency = strtoul(optarg, NULL, 10);
+			break;
+		case STOP_ON_MATCH:
+			result.config.stop_on_match = true;
+			break;
+		case MAX_BODY_SIZE:
+			if (!is_intpos(optarg)) {
+				usage2(_("Invalid body size, expecting a positive number of bytes"), optarg);
+			}
+			result.config.max_body_size = strtoul(optarg, NULL, 10);
+			break;
+		case SESSION_CACHE: {
+			struct stat cache_dir_stat;
+			if (stat(optarg, &cache_dir_stat) != 0 || !S_ISDIR(cache_dir_stat.st_mode) ||
+				access(optarg, W_OK | X_OK) != 0) {
+				usage2(_("Session cache is not a writable directory"), optarg);
+			}
+			result.config.curl_config.session_cache_dir = optarg;
+		} break;
+		case DNS_CACHE_TTL:
+			if (!is_intnonneg(optarg)) {
+				usage2(_("Invalid DNS cache TTL, expecting a number of seconds"), optarg);
+			}
+			result.config.curl_config.dns_cache_ttl = strtol(optarg, NULL, 10);
+			break;
+		case TLS_SESSION_TTL:
+			if (!is_intnonneg(optarg)) {
+				usage2(_("Invalid TLS session TTL, expecting a number of seconds"), optarg);
+			}
+			result.config.curl_config.tls_session_ttl = strtol(optarg, NULL, 10);
+			break;
+		case JSON_EXPECT:
+		case JSON_VALUE: {
+			check_curl_json_query_wrapper query =
+				check_curl_json_parse_query(optarg, option_index == JSON_EXPECT);
+			if (query.errorcode != OK) {
+				usage2(query.error, optarg);
+			}
+			query.query.thresholds = json_thresholds;
+
+			result.config.json_queries =
+				realloc(result.config.json_queries,
+						sizeof(check_curl_json_query) * (result.config.json_queries_count + 1));
+			if (result.config.json_queries == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+			}
+			result.config.json_queries[result.config.json_queries_count++] = query.query;
+		} break;
+		case JSON_WARNING:
+		case JSON_CRITICAL: {
+			mp_range_parsed json_range = mp_parse_range_string(optarg);
+			if (json_range.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse JSON %s threshold: %s",
+					option_index == JSON_CRITICAL ? "critical" : "warning", optarg);
+			}
+			if (option_index == JSON_CRITICAL) {
+				json_thresholds = mp_thresholds_set_crit(json_thresholds, json_range.range);
+			} else {
+				json_thresholds = mp_thresholds_set_warn(json_thresholds, json_range.range);
+			}
+		} break;
+		case PROMETHEUS: {
+			check_curl_prometheus_selector_wrapper selector =
+				check_curl_prometheus_parse_selector(optarg);
+			if (selector.errorcode != OK) {
+				usage2(selector.error, optarg);
+			}
+			selector.selector.thresholds = prometheus_thresholds;
+
+			size_t selectors_count = result.config.prometheus_selectors_count;
+			result.config.prometheus_selectors =
+				realloc(result.config.prometheus_selectors,
+						sizeof(check_curl_prometheus_selector) * (selectors_count + 1));
+			if (result.config.prometheus_selectors == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+			}
+			result.config.prometheus_selectors[result.config.prometheus_selectors_count++] =
+				selector.selector;
+		} break;
+		case PROMETHEUS_WARNING:
+		case PROMETHEUS_CRITICAL: {
+			mp_range_parsed prometheus_range = mp_parse_range_string(optarg);
+			if (prometheus_range.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse metrics %s threshold: %s",
+					option_index == PROMETHEUS_CRITICAL ? "critical" : "warning", optarg);
+			}
+			if (option_index == PROMETHEUS_CRITICAL) {
+				prometheus_thresholds =
+					mp_thresholds_set_crit(prometheus_thresholds, prometheus_range.range);
+			} else {
+				prometheus_thresholds =
+					mp_thresholds_set_warn(prometheus_thresholds, prometheus_range.range);
+			}
+		} break;
+		case WARNING_NAMELOOKUP:
+		case CRITICAL_NAMELOOKUP:
+		case WARNING_CONNECT:
+		case CRITICAL_CONNECT:
+		case WARNING_TLS:
+		case CRITICAL_TLS:
+		case WARNING_HEADERS:
+		case CRITICAL_HEADERS:
+		case WARNING_FIRSTBYTE:
+		case CRITICAL_FIRSTBYTE:
+		case WARNING_TRANSFER:
+		case CRITICAL_TRANSFER:
+		case WARNING_REDIRECT:
+		case CRITICAL_REDIRECT: {
+			int phase = (option_index - WARNING_NAMELOOKUP) / 2;
+			bool is_critical = ((option_index - WARNING_NAMELOOKUP) % 2) == 1;
+
+			mp_range_parsed phase_range = mp_parse_range_string(optarg);
+			if (phase_range.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse %s %s threshold: %s",
+					curl_phase_names[phase].option, is_critical ? "critical" : "warning", optarg);
+			}
+			if (is_critical) {
+				result.config.phase_thlds[phase] =
+					mp_thresholds_set_crit(result.config.phase_thlds[phase], phase_range.range);
+			} else {
+				result.config.phase_thlds[phase] =
+					mp_thresholds_set_warn(result.config.phase_thlds[phase], phase_range.range);
+			}
+		} break;
 		case '?':
 			/* print short usage statement if args not parsable */
 			usage5();
@@ -1551,7 +2207,17 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 		result.config.initial_config.host_name = strdup(argv[option_counter++]);
 	}
 
-	if (result.config.initial_config.server_address == NULL) {
+	if (result.config.sweep_targets_count > 0) {
+		if (!result.config.check_cert) {
+			usage4(_("--cert-sweep needs the certificate thresholds of -C"));
+		}
+		if (urls_count > 0 || paths_count > 0) {
+			usage4(_("--cert-sweep can not be combined with --multi-url or --multi-path"));
+		}
+	}
+
+	if (result.config.initial_config.server_address == NULL && urls_count == 0 &&
+		result.config.sweep_targets_count == 0) {
 		if (result.config.initial_config.host_name == NULL) {
 			usage4(_("You must specify a server address or host name"));
 		} else {
@@ -1581,6 +2247,30 @@ check_curl_config_wrapper process_arguments(int argc, char **argv) {
 		}
 	}
 
+	if (urls_count > 0 || paths_count > 0) {
+		result.config.targets =
+			calloc(urls_count + paths_count, sizeof(check_curl_working_state));
+		if (result.config.targets == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+		}
+
+		for (size_t i = 0; i < urls_count; i++) {
+			url_target_wrapper target = parse_url_target(urls[i], result.config.initial_config);
+			if (target.errorcode != OK) {
+				usage2(_("Invalid URL, expecting http[s]://host[:port][/path]"), urls[i]);
+			}
+			result.config.targets[i] = target.working_state;
+		}
+
+		for (size_t i = 0; i < paths_count; i++) {
+			result.config.targets[urls_count + i] = result.config.initial_config;
+			result.config.targets[urls_count + i].server_url = paths[i];
+		}
+
+		result.config.targets_count = urls_count + paths_count;
+		result.config.multiplex = paths_count > 0;
+	}
+
 	return result;
 }
 
@@ -1731,7 +2421,16 @@ void print_help(void) {
 	printf("    %s\n", _("Any other tags to be sent in http header. Use multiple times for "
 						 "additional headers"));
 	printf(" %s\n", "-E, --extended-perfdata");
-	printf("    %s\n", _("Print additional performance data"));
+	printf("    %s\n", _("Print additional performance data: the times of the single phases of"));
+	printf("    %s\n", _("the transfer and the download and upload speed in bytes per second"));
+	printf(" %s\n", "--warning-PHASE=THRESHOLD, --critical-PHASE=THRESHOLD");
+	printf("    %s\n", _("Thresholds in seconds for a single phase of the transfer, evaluated"));
+	printf("    %s\n", _("independently of the total time (-w, -c). PHASE is one of namelookup,"));
+	printf("    %s\n", _("connect (including the name lookup), tls, headers (from the handshake"));
+	printf("    %s\n", _("until the request is sent), firstbyte (from the start of the transfer),"));
+	printf("    %s\n", _("transfer (from the first to the last byte) or redirect (all followed"));
+	printf("    %s\n", _("redirects, only with -f curl). Thresholds for tls are UNKNOWN for URLs"));
+	printf("    %s\n", _("without TLS"));
 	printf(" %s\n", "-B, --show-body");
 	printf("    %s\n", _("Print body content below status line"));
 	// printf(" %s\n", "-L, --link");
@@ -1744,6 +2443,34 @@ void print_help(void) {
 	printf(" %s\n", "--max-redirs=INTEGER");
 	printf("    %s", _("Maximal number of redirects (default: "));
 	printf("%d)\n", DEFAULT_MAX_REDIRS);
+	printf(" %s\n", "--stop-on-match");
+	printf("    %s\n", _("Stop receiving the body as soon as the string (-s) and the regex"));
+	printf("    %s\n", _("(-r, -R) are found. The response time and size cover only what was"));
+	printf("    %s\n", _("received"));
+	printf(" %s\n", "--max-body-size=INTEGER");
+	printf("    %s\n", _("Stop receiving the body after INTEGER bytes, -s and -r only search"));
+	printf("    %s\n", _("the received part"));
+	printf(" %s\n", "--json-expect=PATH==VALUE, --json-expect=PATH!=VALUE");
+	printf("    %s\n", _("Compare a value of a JSON body with a JSON string, number, true, false"));
+	printf("    %s\n", _("or null, CRITICAL if it differs or is missing. PATH starts with $ and"));
+	printf("    %s\n", _("continues with .key, [\"key\"] or [index], e.g. '$.status==\"UP\"'"));
+	printf("    %s\n", _("Can be given multiple times"));
+	printf(" %s\n", "--json-value=PATH");
+	printf("    %s\n", _("Report the number at PATH of a JSON body as performance data, booleans"));
+	printf("    %s\n", _("are reported as 0 and 1. Can be given multiple times"));
+	printf(" %s\n", "--json-warning=THRESHOLD, --json-critical=THRESHOLD");
+	printf("    %s\n", _("Thresholds for the --json-value options following them"));
+	printf("    %s\n", _("The JSON body is parsed while it is received, it is only kept in"));
+	printf("    %s\n", _("memory if -s, -r, -B or -v need it"));
+	printf(" %s\n", "--prometheus=SELECTOR");
+	printf("    %s\n", _("Select series of a metrics endpoint in the Prometheus text format by"));
+	printf("    %s\n", _("name and label matchers (=, !=, =~, !~), e.g."));
+	printf("    %s\n", _("'http_requests_total{code=~\"5..\",method!=\"GET\"}'. Every series"));
+	printf("    %s\n", _("becomes performance data, UNKNOWN if none is found. The label of"));
+	printf("    %s\n", _("http_requests_total{code=\"500\"} is http_requests_total_code_500. Can"));
+	printf("    %s\n", _("be given multiple times, the body is parsed while it is received"));
+	printf(" %s\n", "--prometheus-warning=THRESHOLD, --prometheus-critical=THRESHOLD");
+	printf("    %s\n", _("Thresholds for every series of the --prometheus options following them"));
 	printf(" %s\n", "-m, --pagesize=INTEGER<:INTEGER>");
 	printf("    %s\n",
 		   _("Minimum page size required (bytes) : Maximum page size required (bytes)"));
@@ -1764,6 +2491,43 @@ void print_help(void) {
 		   _("the cookies to disk. Only enabling the engine without saving to disk requires"));
 	printf("    %s\n",
 		   _("handling multiple requests internally to curl, so use it with --onredirect=curl"));
+	printf(" %s\n", "--multi-url=URL");
+	printf("    %s\n", _("Check URL (http[s]://host[:port][/path]), use multiple times to check"));
+	printf("    %s\n", _("several URLs concurrently. All other options apply to every URL, DNS"));
+	printf("    %s\n", _("lookups, TLS sessions and connections are shared. If -I is given, all"));
+	printf("    %s\n", _("requests are sent to this address. Perfdata labels are prefixed with"));
+	printf("    %s\n", _("'urlN_', N being the position of the URL"));
+	printf(" %s\n", "--url-list=FILE");
+	printf("    %s\n", _("Like --multi-url, but read the URLs from FILE, one per line"));
+	printf(" %s\n", "--multi-path=PATH");
+	printf("    %s\n", _("Request PATH from the server given with -H/-I, use multiple times to"));
+	printf("    %s\n", _("check several paths at once. The requests are sent as concurrent"));
+	printf("    %s\n", _("streams over a single HTTP/2 connection (HTTP/3 with --http-version=3)."));
+	printf("    %s\n", _("Plain HTTP/1.x servers get the requests one after another over one"));
+	printf("    %s\n", _("connection. Perfdata labels are prefixed like with --multi-url, the"));
+	printf("    %s\n", _("number of new connections is reported as 'connections'"));
+	printf(" %s\n", "--cert-sweep=FILE");
+	printf("    %s\n", _("Check the certificates of all servers in FILE against -C, one"));
+	printf("    %s\n", _("host[:port] per line (port 443 by default). Only the TLS handshakes"));
+	printf("    %s\n", _("are done, many of them at once. Every server gets its own result."));
+	printf("    %s\n", _("-t, -4/-6, -S, -D and --ca-cert apply to every handshake"));
+	printf(" %s\n", "--sweep-concurrency=INTEGER");
+	printf("    %s\n", _("Number of handshakes of --cert-sweep in flight at the same time"));
+	printf("    %s", _("(default: "));
+	printf("%d)\n", DEFAULT_SWEEP_CONCURRENCY);
+	printf(" %s\n", "--session-cache=DIRECTORY");
+	printf("    %s\n", _("Keep the resolved address and the TLS session of every host:port in"));
+	printf("    %s\n", _("DIRECTORY, so later checks skip the DNS lookup and resume the session."));
+	printf("    %s\n", _("Certificates are still verified. With -C a full handshake is done to"));
+	printf("    %s\n", _("get the certificate, its common name and expiry are cached by SHA-256"));
+	printf("    %s\n", _("fingerprint then. Names resolved by a proxy are not cached"));
+	printf(" %s\n", "--dns-cache-ttl=SECONDS");
+	printf("    %s", _("How long a cached address is used (default: "));
+	printf("%d)\n", DEFAULT_DNS_CACHE_TTL);
+	printf(" %s\n", "--tls-session-ttl=SECONDS");
+	printf("    %s\n", _("Maximum age of a cached TLS session, the server may limit it further"));
+	printf("    %s", _("(default: "));
+	printf("%d)\n", DEFAULT_TLS_SESSION_TTL);
 	printf("\n");
 
 	printf(UT_WARN_CRIT);
@@ -1928,12 +2692,27 @@ void print_usage(void) {
 	printf("       [--noproxy=<comma separated list of hosts, IP addresses, IP CIDR subnets>\n");
 	printf("       [--http-version=<version>] [--enable-automatic-decompression]\n");
 	printf("       [--cookie-jar=<cookie jar file>\n");
+	printf("       [--session-cache=<directory>]\n");
+	printf("       [--json-expect=<path>==<value>] [--json-warning=<threshold>]\n");
+	printf("       [--json-critical=<threshold>] [--json-value=<path>]\n");
+	printf("       [--prometheus-warning=<threshold>] [--prometheus-critical=<threshold>]\n");
+	printf("       [--prometheus=<selector>]\n");
 	printf(" %s -H <vhost> | -I <IP-address> -C <warn_age>[,<crit_age>]\n", progname);
 	printf("       [-p <port>] [-t <timeout>] [-4|-6] [--sni]\n");
+	printf(" %s --multi-url <URL> [--multi-url <URL>...] | --url-list <file> [-I <IP-address>]\n",
+		   progname);
+	printf(" %s -H <vhost> | -I <IP-address> --multi-path <path> [--multi-path <path>...]\n",
+		   progname);
+	printf("       [options of the first form]\n");
+	printf(" %s --cert-sweep <file> -C <warn_age>[,<crit_age>] [--sweep-concurrency <number>]\n",
+		   progname);
+	printf("       [-t <timeout>] [-4|-6] [-D] [--ca-cert <file>] [--session-cache=<directory>]\n");
 	printf("\n");
 #ifdef LIBCURL_FEATURE_SSL
 	printf("%s\n", _("In the first form, make an HTTP request."));
-	printf("%s\n\n", _("In the second form, connect to the server and check the TLS certificate."));
+	printf("%s\n", _("In the second form, connect to the server and check the TLS certificate."));
+	printf("%s\n", _("In the third form, make HTTP requests to several URLs or paths at once."));
+	printf("%s\n\n", _("In the fourth form, check the TLS certificates of a list of servers."));
 #endif
 }
 
@@ -0,0 +1,606 @@
+/*****************************************************************************
+ *
+ * Persistent DNS, TLS session and certificate cache for check_curl
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Checks running every minute against the same servers spend most of their
+ * connection time in name resolution and the TLS handshake. With
+ * --session-cache the resolved address and the TLS session of every
+ * host:port are kept in a small file, so later runs connect directly and
+ * resume the session. Certificates are still verified, the verification
+ * result and the server certificate are part of the stored session.
+ *
+ * With -C the facts of the server certificate are kept as well, a run
+ * against an unchanged certificate only has to compute its fingerprint.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_curl_cache.h"
+#include "./check_curl_helpers.h"
+#include "../utils.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sha256.h"
+
+extern int verbose;
+
+/* a session with the server certificate is a few KiB, anything larger is not ours */
+#define SESSION_CACHE_MAX_FILE_SIZE 65536
+
+static char *session_cache_path(const char *directory, const char *host, unsigned short port) {
+	char *file_name = NULL;
+	xasprintf(&file_name, "%s_%u", host, port);
+
+	/* host names and IP addresses only, but keep the file inside the directory anyway */
+	for (char *cursor = file_name; *cursor != '\0'; cursor++) {
+		if (!isalnum((unsigned char)*cursor) && *cursor != '.' && *cursor != '-') {
+			*cursor = '_';
+		}
+	}
+	if (file_name[0] == '.') {
+		file_name[0] = '_';
+	}
+
+	char *path = NULL;
+	xasprintf(&path, "%s/%s", directory, file_name);
+	free(file_name);
+	return path;
+}
+
+/* FNV-1a, only to tell different settings apart */
+static void session_cache_context(const char *settings, char context[static 17]) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (const char *cursor = settings; *cursor != '\0'; cursor++) {
+		hash ^= (unsigned char)*cursor;
+		hash *= 1099511628211ULL;
+	}
+	snprintf(context, 17, "%016llx", (unsigned long long)hash);
+}
+
+static char *hex_encode(const unsigned char *data, size_t length) {
+	static const char digits[] = "0123456789abcdef";
+	char *result = malloc((length * 2) + 1);
+	if (result == NULL) {
+		return NULL;
+	}
+	for (size_t i = 0; i < length; i++) {
+		result[2 * i] = digits[data[i] >> 4];
+		result[(2 * i) + 1] = digits[data[i] & 0x0f];
+	}
+	result[length * 2] = '\0';
+	return result;
+}
+
+static int hex_value(char digit) {
+	if (digit >= '0' && digit <= '9') {
+		return digit - '0';
+	}
+	if (digit >= 'a' && digit <= 'f') {
+		return digit - 'a' + 10;
+	}
+	return -1;
+}
+
+static unsigned char *hex_decode(const char *hex, size_t hex_length, size_t *length) {
+	if (hex_length == 0 || hex_length % 2 != 0) {
+		return NULL;
+	}
+	unsigned char *result = malloc(hex_length / 2);
+	if (result == NULL) {
+		return NULL;
+	}
+	for (size_t i = 0; i < hex_length / 2; i++) {
+		int high = hex_value(hex[2 * i]);
+		int low = hex_value(hex[(2 * i) + 1]);
+		if (high < 0 || low < 0) {
+			free(result);
+			return NULL;
+		}
+		result[i] = (unsigned char)((high << 4) | low);
+	}
+	*length = hex_length / 2;
+	return result;
+}
+
+/*
+ * Parses the records of an already locked file into cache, expired records are skipped
+ */
+static void session_cache_read(int file_descriptor, check_curl_session_cache *cache) {
+	struct stat file_stat;
+	if (fstat(file_descriptor, &file_stat) != 0 || file_stat.st_size <= 0 ||
+		file_stat.st_size > SESSION_CACHE_MAX_FILE_SIZE) {
+		return;
+	}
+
+	char *content = malloc((size_t)file_stat.st_size + 1);
+	if (content == NULL) {
+		return;
+	}
+	ssize_t bytes_read = pread(file_descriptor, content, (size_t)file_stat.st_size, 0);
+	if (bytes_read <= 0) {
+		free(content);
+		return;
+	}
+	content[bytes_read] = '\0';
+
+	char *expected_key = NULL;
+	xasprintf(&expected_key, "%s:%u", cache->host, cache->port);
+
+	time_t now = time(NULL);
+	bool key_matches = false;
+	char *save_pointer = NULL;
+	for (char *line = strtok_r(content, "\n", &save_pointer); line != NULL;
+		 line = strtok_r(NULL, "\n", &save_pointer)) {
+		if (strncmp(line, "key ", 4) == 0) {
+			key_matches = (strcmp(line + 4, expected_key) == 0);
+			continue;
+		}
+
+		/* file names of different hosts might collide, ignore records of other hosts */
+		if (!key_matches) {
+			break;
+		}
+
+		long long expires = 0;
+		int offset = 0;
+		if (strncmp(line, "dns ", 4) == 0) {
+			char name[MAX_IPV4_HOSTLENGTH + 1];
+			char address[INET6_ADDRSTRLEN];
+			if (sscanf(line + 4, "%lld %255s %45s", &expires, name, address) == 3 &&
+				expires > now) {
+				free(cache->dns_name);
+				cache->dns_name = strdup(name);
+				strcpy(cache->address, address);
+				cache->address_expires = (time_t)expires;
+			}
+		} else if (strncmp(line, "tls ", 4) == 0) {
+			char context[17];
+			if (sscanf(line + 4, "%lld %16s %n", &expires, context, &offset) == 2 &&
+				expires > now && strcmp(context, cache->tls_context) == 0) {
+				const char *hex = line + 4 + offset;
+				size_t length = 0;
+				unsigned char *session = hex_decode(hex, strlen(hex), &length);
+				if (session != NULL) {
+					free(cache->tls_session);
+					cache->tls_session = session;
+					cache->tls_session_length = length;
+					cache->tls_expires = (time_t)expires;
+				}
+			}
+		}
+	}
+
+	free(expected_key);
+	free(content);
+}
+
+check_curl_session_cache *check_curl_session_cache_open(const char *directory, const char *host,
+														unsigned short port, long dns_ttl,
+														long tls_ttl, const char *tls_settings) {
+	check_curl_session_cache *cache = calloc(1, sizeof(check_curl_session_cache));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->path = session_cache_path(directory, host, port);
+	cache->host = strdup(host);
+	cache->port = port;
+	cache->dns_ttl = dns_ttl;
+	cache->tls_ttl = tls_ttl;
+	session_cache_context(tls_settings, cache->tls_context);
+	cache->dns_enabled = true;
+	cache->resume_tls = true;
+
+	int file_descriptor = open(cache->path, O_RDONLY);
+	if (file_descriptor < 0) {
+		if (errno != ENOENT && verbose >= 1) {
+			printf("* session cache: can not open %s: %s\n", cache->path, strerror(errno));
+		}
+		return cache;
+	}
+
+	if (flock(file_descriptor, LOCK_SH) == 0) {
+		session_cache_read(file_descriptor, cache);
+	}
+	close(file_descriptor);
+
+	if (verbose >= 1) {
+		printf("* session cache: %s has %s address and %s TLS session\n", cache->path,
+			   cache->address[0] != '\0' ? "an" : "no", cache->tls_session ? "a" : "no");
+	}
+
+	return cache;
+}
+
+const char *check_curl_session_cache_get_address(check_curl_session_cache *cache,
+												 const char *name) {
+	if (cache == NULL || !cache->dns_enabled) {
+		return NULL;
+	}
+
+	/* IP addresses do not need to be resolved */
+	unsigned char buffer[sizeof(struct in6_addr)];
+	if (inet_pton(AF_INET, name, buffer) == 1 || inet_pton(AF_INET6, name, buffer) == 1) {
+		cache->dns_enabled = false;
+		return NULL;
+	}
+
+	/* remember the name, the address curl connects to is saved for it later */
+	if (cache->dns_name == NULL || strcmp(cache->dns_name, name) != 0) {
+		free(cache->dns_name);
+		cache->dns_name = strdup(name);
+		cache->address[0] = '\0';
+		return NULL;
+	}
+
+	if (cache->address[0] == '\0') {
+		return NULL;
+	}
+
+	cache->address_from_cache = true;
+	return cache->address;
+}
+
+void check_curl_session_cache_set_resolve(check_curl_session_cache *cache, CURL *curl) {
+	const char *address = check_curl_session_cache_get_address(cache, cache->host);
+	if (address == NULL) {
+		return;
+	}
+
+	char entry[DEFAULT_BUFFER_SIZE];
+	if (strchr(address, ':') != NULL) {
+		snprintf(entry, sizeof(entry), "%s:%u:[%s]", cache->host, cache->port, address);
+	} else {
+		snprintf(entry, sizeof(entry), "%s:%u:%s", cache->host, cache->port, address);
+	}
+	cache->resolve = curl_slist_append(NULL, entry);
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_RESOLVE, cache->resolve),
+								   "CURLOPT_RESOLVE");
+
+	if (verbose >= 1) {
+		printf("* session cache: curl CURLOPT_RESOLVE: %s\n", entry);
+	}
+}
+
+static void session_cache_write(check_curl_session_cache *cache, bool new_address,
+								bool drop_address, bool drop_tls_session) {
+	int file_descriptor = open(cache->path, O_RDWR | O_CREAT, 0600);
+	if (file_descriptor < 0) {
+		if (verbose >= 1) {
+			printf("* session cache: can not write %s: %s\n", cache->path, strerror(errno));
+		}
+		return;
+	}
+
+	if (flock(file_descriptor, LOCK_EX) != 0) {
+		close(file_descriptor);
+		return;
+	}
+
+	/* another check might have updated the file in the meantime, keep its records unless
+	 * there is something new */
+	check_curl_session_cache current = {
+		.host = cache->host,
+		.port = cache->port,
+	};
+	strcpy(current.tls_context, cache->tls_context);
+	session_cache_read(file_descriptor, &current);
+
+	if (drop_address) {
+		current.address[0] = '\0';
+	} else if (new_address) {
+		free(current.dns_name);
+		current.dns_name = strdup(cache->dns_name);
+		strcpy(current.address, cache->address);
+		current.address_expires = cache->address_expires;
+	}
+
+	if (drop_tls_session) {
+		free(current.tls_session);
+		current.tls_session = NULL;
+	} else if (cache->tls_session_updated) {
+		free(current.tls_session);
+		current.tls_session = cache->tls_session;
+		current.tls_session_length = cache->tls_session_length;
+		current.tls_expires = cache->tls_expires;
+	}
+
+	FILE *file = NULL;
+	if (ftruncate(file_descriptor, 0) != 0 || (file = fdopen(file_descriptor, "w")) == NULL) {
+		close(file_descriptor);
+	} else {
+		fprintf(file, "key %s:%u\n", cache->host, cache->port);
+		if (current.address[0] != '\0') {
+			fprintf(file, "dns %lld %s %s\n", (long long)current.address_expires,
+					current.dns_name, current.address);
+		}
+		if (current.tls_session != NULL) {
+			char *hex = hex_encode(current.tls_session, current.tls_session_length);
+			if (hex != NULL) {
+				fprintf(file, "tls %lld %s %s\n", (long long)current.tls_expires,
+						current.tls_context, hex);
+				free(hex);
+			}
+		}
+		/* closing the file releases the lock */
+		fclose(file);
+	}
+
+	free(current.dns_name);
+	if (current.tls_session != cache->tls_session) {
+		free(current.tls_session);
+	}
+}
+
+void check_curl_session_cache_save(check_curl_session_cache *cache, CURL *curl, CURLcode res) {
+	if (cache == NULL) {
+		return;
+	}
+
+	bool new_address = false;
+	bool drop_address = false;
+	bool drop_tls_session = false;
+
+	if (res != CURLE_OK) {
+		/* the server might have moved or lost its session keys, start over next time */
+		drop_address = cache->address_from_cache;
+		drop_tls_session = cache->tls_session_from_cache && !cache->tls_session_updated;
+		cache->tls_session_updated = false;
+	} else if (cache->dns_enabled && !cache->address_from_cache && cache->dns_name != NULL) {
+		/* after a redirection the primary IP belongs to another host */
+		long redirect_count = 0;
+		char *primary_ip = NULL;
+		curl_easy_getinfo(curl, CURLINFO_REDIRECT_COUNT, &redirect_count);
+		curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &primary_ip);
+		if (redirect_count == 0 && primary_ip != NULL && primary_ip[0] != '\0' &&
+			strlen(primary_ip) < sizeof(cache->address)) {
+			strcpy(cache->address, primary_ip);
+			cache->address_expires = time(NULL) + cache->dns_ttl;
+			new_address = true;
+		}
+	}
+
+	if (verbose >= 1 && cache->tls_resumed) {
+		printf("* session cache: TLS session was resumed\n");
+	}
+
+	if (!drop_address && !drop_tls_session && !new_address && !cache->tls_session_updated) {
+		return;
+	}
+
+	session_cache_write(cache, new_address, drop_address, drop_tls_session);
+}
+
+void check_curl_session_cache_free(check_curl_session_cache *cache) {
+	if (cache == NULL) {
+		return;
+	}
+	free(cache->path);
+	free(cache->host);
+	free(cache->dns_name);
+	free(cache->tls_session);
+	if (cache->resolve != NULL) {
+		curl_slist_free_all(cache->resolve);
+	}
+	free(cache);
+}
+
+#if defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL)
+static int session_cache_index = -1;
+
+static void session_cache_store_session(check_curl_session_cache *cache, SSL_SESSION *session) {
+#	if OPENSSL_VERSION_NUMBER >= 0x10101000L
+	/* without a session id or ticket there is nothing to resume */
+	if (!SSL_SESSION_is_resumable(session)) {
+		return;
+	}
+#	endif
+
+	int length = i2d_SSL_SESSION(session, NULL);
+	if (length <= 0) {
+		return;
+	}
+	unsigned char *der = malloc((size_t)length);
+	if (der == NULL) {
+		return;
+	}
+	unsigned char *cursor = der;
+	i2d_SSL_SESSION(session, &cursor);
+
+	/* a resumed session is not new, keep its expiry */
+	if (cache->tls_session != NULL && cache->tls_session_length == (size_t)length &&
+		memcmp(cache->tls_session, der, (size_t)length) == 0) {
+		free(der);
+		return;
+	}
+
+	free(cache->tls_session);
+	cache->tls_session = der;
+	cache->tls_session_length = (size_t)length;
+	cache->tls_session_updated = true;
+
+	time_t expires = (time_t)SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session);
+	cache->tls_expires = min(expires, time(NULL) + cache->tls_ttl);
+}
+
+static void session_cache_info_callback(const SSL *ssl, int where, int ret) {
+	(void)ret;
+	check_curl_session_cache *cache =
+		SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), session_cache_index);
+	if (cache == NULL) {
+		return;
+	}
+
+	/* curl does not set a session of its own for a new handle, so the cached one can be
+	 * offered right before the ClientHello is sent */
+	if ((where & SSL_CB_HANDSHAKE_START) && cache->resume_tls && cache->tls_session != NULL &&
+		SSL_get_session(ssl) == NULL) {
+		const unsigned char *cursor = cache->tls_session;
+		SSL_SESSION *session = d2i_SSL_SESSION(NULL, &cursor, (long)cache->tls_session_length);
+		if (session != NULL) {
+			SSL_set_session((SSL *)ssl, session);
+			SSL_SESSION_free(session);
+			cache->tls_session_from_cache = true;
+		}
+	}
+
+	if ((where & SSL_CB_HANDSHAKE_DONE) && SSL_session_reused((SSL *)ssl)) {
+		cache->tls_resumed = true;
+	}
+}
+
+/* TLS 1.3 sessions are only complete with the ticket, which arrives after the handshake */
+static int session_cache_new_session(SSL *ssl, SSL_SESSION *session) {
+	check_curl_session_cache *cache =
+		SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), session_cache_index);
+	if (cache == NULL) {
+		return 0;
+	}
+
+	session_cache_store_session(cache, session);
+
+	/* let curl keep its own copy, if it asked for one */
+	if (cache->curl_new_session_callback != NULL) {
+		return cache->curl_new_session_callback(ssl, session);
+	}
+	return 0;
+}
+
+void check_curl_session_cache_setup_ssl_ctx(SSL_CTX *sslctx, check_curl_session_cache *cache) {
+	if (session_cache_index < 0) {
+		session_cache_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+		if (session_cache_index < 0) {
+			return;
+		}
+	}
+
+	SSL_CTX_set_ex_data(sslctx, session_cache_index, cache);
+	SSL_CTX_set_info_callback(sslctx, session_cache_info_callback);
+
+	cache->curl_new_session_callback = SSL_CTX_sess_get_new_cb(sslctx);
+	SSL_CTX_set_session_cache_mode(sslctx, SSL_CTX_get_session_cache_mode(sslctx) |
+											   SSL_SESS_CACHE_CLIENT);
+	SSL_CTX_sess_set_new_cb(sslctx, session_cache_new_session);
+}
+#endif /* defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL) */
+
+void check_curl_certificate_fingerprint(const unsigned char *der, size_t der_length,
+										check_curl_certificate_facts *facts) {
+	unsigned char digest[SHA256_DIGEST_SIZE];
+	sha256_buffer((const char *)der, der_length, digest);
+
+	char *hex = hex_encode(digest, sizeof(digest));
+	if (hex == NULL) {
+		facts->fingerprint[0] = '\0';
+		return;
+	}
+	strcpy(facts->fingerprint, hex);
+	free(hex);
+}
+
+static char *certificate_cache_path(const char *directory, const char *fingerprint) {
+	char *path = NULL;
+	/* session files are named <host>_<port>, the port never has 64 digits */
+	xasprintf(&path, "%s/cert_%s", directory, fingerprint);
+	return path;
+}
+
+bool check_curl_certificate_cache_get(const char *directory, check_curl_certificate_facts *facts) {
+	if (facts->fingerprint[0] == '\0') {
+		return false;
+	}
+
+	char *path = certificate_cache_path(directory, facts->fingerprint);
+	FILE *file = fopen(path, "r");
+	free(path);
+	if (file == NULL) {
+		return false;
+	}
+
+	char line[DEFAULT_BUFFER_SIZE];
+	bool found = false;
+	if (fgets(line, sizeof(line), file) != NULL) {
+		char fingerprint[65];
+		long long expiry = 0;
+		int offset = 0;
+		line[strcspn(line, "\n")] = '\0';
+		if (sscanf(line, "cert %64s %lld %n", fingerprint, &expiry, &offset) == 2 &&
+			offset > 0 && strcmp(fingerprint, facts->fingerprint) == 0 &&
+			strlen(line + offset) < sizeof(facts->common_name)) {
+			strcpy(facts->common_name, line + offset);
+			facts->expiry = (time_t)expiry;
+			found = true;
+		}
+	}
+	fclose(file);
+
+	if (verbose >= 1) {
+		printf("* certificate cache: %s %s\n", facts->fingerprint, found ? "found" : "invalid");
+	}
+	return found;
+}
+
+void check_curl_certificate_cache_put(const char *directory,
+									  const check_curl_certificate_facts *facts) {
+	if (facts->fingerprint[0] == '\0' || strchr(facts->common_name, '\n') != NULL) {
+		return;
+	}
+
+	char *path = certificate_cache_path(directory, facts->fingerprint);
+	char *temporary_path = NULL;
+	xasprintf(&temporary_path, "%s.XXXXXX", path);
+
+	int file_descriptor = mkstemp(temporary_path);
+	FILE *file = file_descriptor < 0 ? NULL : fdopen(file_descriptor, "w");
+	if (file == NULL) {
+		if (verbose >= 1) {
+			printf("* certificate cache: can not write %s: %s\n", path, strerror(errno));
+		}
+		if (file_descriptor >= 0) {
+			close(file_descriptor);
+			unlink(temporary_path);
+		}
+		free(temporary_path);
+		free(path);
+		return;
+	}
+
+	fprintf(file, "cert %s %lld %s\n", facts->fingerprint, (long long)facts->expiry,
+			facts->common_name);
+	if (fclose(file) != 0 || rename(temporary_path, path) != 0) {
+		unlink(temporary_path);
+	} else if (verbose >= 1) {
+		printf("* certificate cache: stored %s\n", path);
+	}
+
+	free(temporary_path);
+	free(path);
+}
@@ -0,0 +1,128 @@
+#pragma once
+/* Persistent DNS, TLS session and certificate cache of check_curl, see --session-cache */
+
+#include "../common.h"
+#include <curl/curl.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+
+enum {
+	DEFAULT_DNS_CACHE_TTL = 300,
+	DEFAULT_TLS_SESSION_TTL = 3600,
+	/* like MAX_CN_LENGTH of sslutils.c */
+	CERTIFICATE_CACHE_MAX_CN_LENGTH = 256,
+};
+
+/*
+ * Every host:port has its own file in the cache directory, containing up to two records:
+ *
+ *   key <host>:<port>
+ *   dns <expires> <name> <address>
+ *   tls <expires> <context> <hex encoded DER of the SSL_SESSION>
+ *
+ * The context is a hash of the TLS settings (verification, CA and client certificate), a
+ * session which was verified with other settings is not resumed.
+ *
+ * Readers hold a shared lock, writers an exclusive lock (flock) on the file while it is
+ * accessed. The lock is not held during the transfer.
+ */
+typedef struct {
+	char *path;
+	char *host;
+	unsigned short port;
+
+	long dns_ttl;
+	long tls_ttl;
+
+	/* addresses are not cached if a proxy resolves the names */
+	bool dns_enabled;
+	/* name which was resolved to address, may differ from host if -I is given */
+	char *dns_name;
+	char address[INET6_ADDRSTRLEN];
+	time_t address_expires;
+	bool address_from_cache;
+	/* the entry for CURLOPT_RESOLVE */
+	struct curl_slist *resolve;
+
+	char tls_context[17];
+	/* DER encoded session, from the file and later from the handshake */
+	unsigned char *tls_session;
+	size_t tls_session_length;
+	time_t tls_expires;
+	bool tls_session_from_cache;
+	bool tls_session_updated;
+	/* offer the cached session to the server, off if the certificate is needed (-C) */
+	bool resume_tls;
+	bool tls_resumed;
+#if defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL)
+	int (*curl_new_session_callback)(SSL *, SSL_SESSION *);
+#endif
+} check_curl_session_cache;
+
+/*
+ * Opens the cache entry of host:port in directory and reads it, returns NULL if the
+ * cache can not be used. tls_settings describes everything which influences the
+ * verification of the server
+ */
+check_curl_session_cache *check_curl_session_cache_open(const char *directory, const char *host,
+														unsigned short port, long dns_ttl,
+														long tls_ttl, const char *tls_settings);
+
+/*
+ * Returns the cached address of name or NULL if there is no valid one
+ */
+const char *check_curl_session_cache_get_address(check_curl_session_cache *cache,
+												 const char *name);
+
+/*
+ * Points curl to the cached address of the host with CURLOPT_RESOLVE
+ */
+void check_curl_session_cache_set_resolve(check_curl_session_cache *cache, CURL *curl);
+
+/*
+ * Records the address (and TLS session) of a finished transfer and writes the file.
+ * A failed transfer removes the entries which were taken from the cache.
+ */
+void check_curl_session_cache_save(check_curl_session_cache *cache, CURL *curl, CURLcode res);
+
+void check_curl_session_cache_free(check_curl_session_cache *cache);
+
+#if defined(HAVE_SSL) && defined(MOPL_USE_OPENSSL)
+/*
+ * Called from the CURLOPT_SSL_CTX_FUNCTION, offers the cached session in the handshake
+ * and records new sessions
+ */
+void check_curl_session_cache_setup_ssl_ctx(SSL_CTX *sslctx, check_curl_session_cache *cache);
+#endif
+
+/*
+ * What the certificate check needs to know about a server certificate. A certificate never
+ * changes, so these are cached without expiry by the SHA-256 fingerprint of its DER
+ * encoding, one file per certificate:
+ *
+ *   cert <fingerprint> <expiry> <common name>
+ *
+ * Files are replaced with rename(), readers never see a partial file and need no lock.
+ */
+typedef struct {
+	char fingerprint[65];
+	char common_name[CERTIFICATE_CACHE_MAX_CN_LENGTH];
+	time_t expiry;
+} check_curl_certificate_facts;
+
+/*
+ * Sets the fingerprint of facts from the DER encoded certificate
+ */
+void check_curl_certificate_fingerprint(const unsigned char *der, size_t der_length,
+										check_curl_certificate_facts *facts);
+
+/*
+ * Looks up the certificate with the fingerprint of facts and fills in the other fields,
+ * returns false if it is not cached
+ */
+bool check_curl_certificate_cache_get(const char *directory, check_curl_certificate_facts *facts);
+
+void check_curl_certificate_cache_put(const char *directory,
+									  const check_curl_certificate_facts *facts);
@@ -9,10 +9,12 @@
 #include <string.h>
 #include <sys/socket.h>
 #include "../utils.h"
+#include "../netutils.h"
 #include "check_curl.d/config.h"
 #include "output.h"
 #include "perfdata.h"
 #include "states.h"
+#include "base64.h"
 
 extern int verbose;
 char errbuf[MAX_INPUT_BUFFER];
@@ -39,6 +41,8 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 				.status_line = NULL,
 				.put_buf_initialized = false,
 				.put_buf = NULL,
+				.body_matcher = NULL,
+				.session_cache = NULL,
 
 				.header_list = NULL,
 				.host = NULL,
@@ -232,6 +236,39 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 			"CURLOPT_HAPROXYPROTOCOL");
 	}
 
+	/* the persistent cache is keyed by the host and port of the URL, names resolved by a
+	 * proxy are not cached */
+	if (config.session_cache_dir != NULL) {
+		const char *url_host = (working_state.use_ssl && working_state.host_name != NULL)
+								   ? working_state.host_name
+								   : working_state.server_address;
+		char *url_host_clean = strdup(url_host);
+		if (url_host_clean[0] == '[' && strlen(url_host_clean) > 2) {
+			url_host_clean[strlen(url_host_clean) - 1] = '\0';
+			memmove(url_host_clean, url_host_clean + 1, strlen(url_host_clean));
+		}
+
+		char *tls_settings = NULL;
+		xasprintf(&tls_settings, "verify=%d ssl_version=%ld ca=%s cert=%s key=%s",
+				  config.verify_peer_and_host, config.ssl_version,
+				  config.ca_cert ? config.ca_cert : "", config.client_cert ? config.client_cert : "",
+				  config.client_privkey ? config.client_privkey : "");
+
+		result.curl_state.session_cache = check_curl_session_cache_open(
+			config.session_cache_dir, url_host_clean, working_state.serverPort,
+			config.dns_cache_ttl, config.tls_session_ttl, tls_settings);
+		free(tls_settings);
+		free(url_host_clean);
+
+		if (result.curl_state.session_cache != NULL) {
+			result.curl_state.session_cache->dns_enabled =
+				have_local_resolution && strcmp(working_state.http_method, "CONNECT") != 0 &&
+				strstr(working_state.server_url, "http") != working_state.server_url;
+			/* a resumed session does not contain the certificate chain for -C */
+			result.curl_state.session_cache->resume_tls = !check_cert;
+		}
+	}
+
 	/* fill dns resolve cache to make curl connect to the given server_address instead of the */
 	/* host_name, only required for ssl, because we use the host_name later on to make SNI happy */
 	char dnscache[DEFAULT_BUFFER_SIZE];
@@ -250,8 +287,12 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 		}
 
 		int res;
-		if ((res = lookup_host(tmp_mod_address, addrstr, DEFAULT_BUFFER_SIZE / 2,
-							   config.sin_family)) != 0) {
+		const char *cached_address =
+			check_curl_session_cache_get_address(result.curl_state.session_cache, tmp_mod_address);
+		if (cached_address != NULL) {
+			snprintf(addrstr, DEFAULT_BUFFER_SIZE / 2, "%s", cached_address);
+		} else if ((res = lookup_host(tmp_mod_address, addrstr, DEFAULT_BUFFER_SIZE / 2,
+									  config.sin_family)) != 0) {
 			die(STATE_CRITICAL,
 				_("Unable to lookup IP address for '%s': getaddrinfo returned %d - %s"),
 				working_state.server_address, res, gai_strerror(res));
@@ -265,6 +306,9 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 		if (verbose >= 1) {
 			printf("* curl CURLOPT_RESOLVE: %s\n", dnscache);
 		}
+	} else if (result.curl_state.session_cache != NULL) {
+		check_curl_session_cache_set_resolve(result.curl_state.session_cache,
+											 result.curl_state.curl);
 	}
 
 	// If server_address is an IPv6 address it must be surround by square brackets
@@ -360,9 +404,17 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 			curl_slist_append(result.curl_state.header_list, http_header);
 	}
 
-	/* always close connection, be nice to servers */
-	snprintf(http_header, DEFAULT_BUFFER_SIZE, "Connection: close");
-	result.curl_state.header_list = curl_slist_append(result.curl_state.header_list, http_header);
+	/* always close connection, be nice to servers, unless connections are shared between
+	 * several requests */
+	if (config.share == NULL) {
+		snprintf(http_header, DEFAULT_BUFFER_SIZE, "Connection: close");
+		result.curl_state.header_list =
+			curl_slist_append(result.curl_state.header_list, http_header);
+	} else {
+		handle_curl_option_return_code(
+			curl_easy_setopt(result.curl_state.curl, CURLOPT_SHARE, config.share),
+			"CURLOPT_SHARE");
+	}
 
 	/* attach additional headers supplied by the user */
 	/* optionally send any other header tag */
@@ -505,6 +557,16 @@ check_curl_configure_curl(const check_curl_static_curl_config config,
 		handle_curl_option_return_code(
 			curl_easy_setopt(result.curl_state.curl, CURLOPT_SSL_CTX_FUNCTION, sslctxfun),
 			"CURLOPT_SSL_CTX_FUNCTION");
+		/* the TLS sessions are handled with OpenSSL functions */
+		curlhelp_ssl_library ctx_ssl_library = curlhelp_get_ssl_library();
+		if (result.curl_state.session_cache != NULL &&
+			(ctx_ssl_library == CURLHELP_SSL_LIBRARY_OPENSSL ||
+			 ctx_ssl_library == CURLHELP_SSL_LIBRARY_LIBRESSL)) {
+			handle_curl_option_return_code(curl_easy_setopt(result.curl_state.curl,
+															CURLOPT_SSL_CTX_DATA,
+															result.curl_state.session_cache),
+										   "CURLOPT_SSL_CTX_DATA");
+		}
 	}
 #	endif
 #endif /* LIBCURL_FEATURE_SSL */
@@ -707,6 +769,12 @@ check_curl_working_state check_curl_working_state_init(void) {
 check_curl_config check_curl_config_init(void) {
 	check_curl_config tmp = {
 		.initial_config = check_curl_working_state_init(),
+		.targets = NULL,
+		.targets_count = 0,
+		.multiplex = false,
+		.sweep_targets = NULL,
+		.sweep_targets_count = 0,
+		.sweep_concurrency = DEFAULT_SWEEP_CONCURRENCY,
 
 		.curl_config =
 			{
@@ -729,6 +797,10 @@ check_curl_config check_curl_config_init(void) {
 				.user_auth = "",
 				.http_content_type = NULL,
 				.cookie_jar_file = NULL,
+				.share = NULL,
+				.session_cache_dir = NULL,
+				.dns_cache_ttl = DEFAULT_DNS_CACHE_TTL,
+				.tls_session_ttl = DEFAULT_TLS_SESSION_TTL,
 			},
 		.max_depth = DEFAULT_MAX_REDIRS,
 		.followmethod = FOLLOW_HTTP_CURL,
@@ -739,6 +811,13 @@ check_curl_config check_curl_config_init(void) {
 		.compiled_regex = {},
 		.state_regex = STATE_CRITICAL,
 		.invert_regex = false,
+		.regex_linespan = false,
+		.stop_on_match = false,
+		.max_body_size = 0,
+		.json_queries = NULL,
+		.json_queries_count = 0,
+		.prometheus_selectors = NULL,
+		.prometheus_selectors_count = 0,
 		.check_cert = false,
 		.continue_after_check_cert = false,
 		.days_till_exp_warn = 0,
@@ -766,6 +845,10 @@ check_curl_config check_curl_config_init(void) {
 	snprintf(tmp.curl_config.user_agent, DEFAULT_BUFFER_SIZE, "%s/v%s (monitoring-plugins %s, %s)",
 			 "check_curl", NP_VERSION, VERSION, curl_version());
 
+	for (size_t i = 0; i < CURL_PHASE_COUNT; i++) {
+		tmp.phase_thlds[i] = mp_thresholds_init();
+	}
+
 	return tmp;
 }
 
@@ -824,8 +907,7 @@ const char *curlhelp_get_ssl_library_string(const curlhelp_ssl_library ssl_libra
 	}
 }
 
-size_t get_content_length(const curlhelp_write_curlbuf *header_buf,
-						  const curlhelp_write_curlbuf *body_buf) {
+size_t get_content_length(const curlhelp_write_curlbuf *header_buf, size_t body_length) {
 	struct phr_header headers[255];
 	size_t nof_headers = 255;
 	size_t msglen;
@@ -840,12 +922,12 @@ size_t get_content_length(const curlhelp_write_curlbuf *header_buf,
 
 	char *content_length_s = get_header_value(headers, nof_headers, "content-length");
 	if (!content_length_s) {
-		return header_buf->buflen + body_buf->buflen;
+		return header_buf->buflen + body_length;
 	}
 
 	content_length_s += strspn(content_length_s, " \t");
 	size_t content_length = atoi(content_length_s);
-	if (content_length != body_buf->buflen) {
+	if (content_length != body_length) {
 		/* TODO: should we warn if the actual and the reported body length don't match? */
 	}
 
@@ -853,7 +935,7 @@ size_t get_content_length(const curlhelp_write_curlbuf *header_buf,
 		free(content_length_s);
 	}
 
-	return header_buf->buflen + body_buf->buflen;
+	return header_buf->buflen + body_length;
 }
 
 mp_subcheck check_document_dates(const curlhelp_write_curlbuf *header_buf, const int maximum_age) {
@@ -1159,6 +1241,161 @@ size_t curlhelp_buffer_write_callback(void *buffer, size_t size, size_t nmemb, v
 	return size * nmemb;
 }
 
+/*
+ * Even with REG_NEWLINE a pattern can match a newline through a literal newline, a bracket
+ * expression like [[:space:]] or an escape like \s. Errs on the side of true.
+ */
+static bool regex_may_match_newline(const char *pattern) {
+	return strpbrk(pattern, "[\\\n") != NULL;
+}
+
+/*
+ * Replaces the body write callback with one which matches the expected string and regex
+ * while the body is received, so the transfer can be stopped early
+ */
+void check_curl_configure_body_matcher(check_curl_global_state curl_state[static 1],
+									   const check_curl_config *config) {
+	curlhelp_body_matcher *matcher = calloc(1, sizeof(curlhelp_body_matcher));
+	if (matcher == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating body matcher\n");
+	}
+
+	matcher->body_buf = curl_state->body_buf;
+	if (strlen(config->string_expect)) {
+		matcher->string_expect = config->string_expect;
+		matcher->string_expect_length = strlen(config->string_expect);
+	}
+	if (strlen(config->regexp)) {
+		matcher->regex = &config->compiled_regex;
+		matcher->regex_per_line = !config->regex_linespan;
+		matcher->regex_rescan_body = regex_may_match_newline(config->regexp);
+		matcher->regex_result = REG_NOMATCH;
+	}
+	if (config->json_queries_count > 0) {
+		matcher->json =
+			check_curl_json_parser_new(config->json_queries, config->json_queries_count);
+	}
+	if (config->prometheus_selectors_count > 0) {
+		matcher->prometheus = check_curl_prometheus_parser_new(config->prometheus_selectors,
+																config->prometheus_selectors_count);
+	}
+	/* the JSON and metrics parsers alone do not need the body in memory */
+	matcher->keep_body = (matcher->json == NULL && matcher->prometheus == NULL) ||
+						 matcher->string_expect || matcher->regex || config->show_body ||
+						 verbose >= 2;
+	matcher->stop_on_match = config->stop_on_match;
+	matcher->max_body_size = config->max_body_size;
+
+	curl_state->body_matcher = matcher;
+
+	handle_curl_option_return_code(curl_easy_setopt(curl_state->curl, CURLOPT_WRITEFUNCTION,
+													curlhelp_body_match_write_callback),
+								   "CURLOPT_WRITEFUNCTION");
+	handle_curl_option_return_code(
+		curl_easy_setopt(curl_state->curl, CURLOPT_WRITEDATA, (void *)matcher),
+		"CURLOPT_WRITEDATA");
+}
+
+static void body_matcher_scan(curlhelp_body_matcher *matcher) {
+	curlhelp_write_curlbuf *body = matcher->body_buf;
+
+	if (matcher->string_expect && !matcher->string_found) {
+		if (strstr(body->buf + matcher->string_scan_pos, matcher->string_expect) != NULL) {
+			matcher->string_found = true;
+		} else if (body->buflen >= matcher->string_expect_length) {
+			matcher->string_scan_pos = body->buflen - matcher->string_expect_length + 1;
+		}
+	}
+
+	if (matcher->regex && !matcher->regex_decided && matcher->regex_per_line) {
+		/* only complete lines, the last one might continue in the next chunk */
+		size_t end = body->buflen;
+		while (end > matcher->regex_scan_pos && body->buf[end - 1] != '\n') {
+			end--;
+		}
+
+		if (end > matcher->regex_scan_pos) {
+			char saved = body->buf[end];
+			body->buf[end] = '\0';
+			int result = regexec(matcher->regex, body->buf + matcher->regex_scan_pos, 0, NULL, 0);
+			body->buf[end] = saved;
+
+			matcher->regex_scan_pos = end;
+			if (result != REG_NOMATCH) {
+				matcher->regex_result = result;
+				matcher->regex_decided = true;
+			}
+		}
+	}
+}
+
+size_t curlhelp_body_match_write_callback(void *buffer, size_t size, size_t nmemb, void *stream) {
+	curlhelp_body_matcher *matcher = (curlhelp_body_matcher *)stream;
+	size_t length = size * nmemb;
+
+	bool limit_reached = false;
+	if (matcher->max_body_size > 0 && matcher->body_length + length > matcher->max_body_size) {
+		length = matcher->max_body_size - matcher->body_length;
+		limit_reached = true;
+	}
+	matcher->body_length += length;
+
+	if (matcher->keep_body) {
+		if (curlhelp_buffer_write_callback(buffer, 1, length, matcher->body_buf) != length) {
+			return 0;
+		}
+		body_matcher_scan(matcher);
+	}
+
+	if (matcher->json) {
+		check_curl_json_parser_feed(matcher->json, buffer, length);
+	}
+	if (matcher->prometheus) {
+		check_curl_prometheus_parser_feed(matcher->prometheus, buffer, length);
+	}
+
+	bool all_matched = (matcher->string_expect || matcher->regex || matcher->json) &&
+					   (!matcher->string_expect || matcher->string_found) &&
+					   (!matcher->regex || matcher->regex_decided) &&
+					   (!matcher->json || check_curl_json_parser_decided(matcher->json)) &&
+					   /* every line of a metrics endpoint may contain a selected series */
+					   !matcher->prometheus;
+
+	if (limit_reached || (matcher->stop_on_match && all_matched)) {
+		if (verbose >= 2) {
+			printf("* stopping the transfer after %zu bytes of the body (%s)\n",
+				   matcher->body_length,
+				   limit_reached ? "size limit reached" : "all expectations met");
+		}
+		/* returning less than was handed over makes libcurl abort with CURLE_WRITE_ERROR */
+		matcher->aborted = true;
+		return 0;
+	}
+
+	return size * nmemb;
+}
+
+/*
+ * Checks the rest of the body, after the transfer is finished or aborted
+ */
+void curlhelp_body_matcher_finish(curlhelp_body_matcher *matcher) {
+	if (matcher->regex && !matcher->regex_decided) {
+		/* a match within one line is a match of the body, but not the other way around */
+		size_t start = (matcher->regex_per_line && !matcher->regex_rescan_body)
+						   ? matcher->regex_scan_pos
+						   : 0;
+		matcher->regex_result =
+			regexec(matcher->regex, matcher->body_buf->buf + start, 0, NULL, 0);
+		matcher->regex_decided = true;
+	}
+	if (matcher->json) {
+		check_curl_json_parser_finish(matcher->json);
+	}
+	if (matcher->prometheus) {
+		check_curl_prometheus_parser_finish(matcher->prometheus);
+	}
+}
+
 void cleanup(check_curl_global_state global_state) {
 	if (global_state.status_line_initialized) {
 		curlhelp_free_statusline(global_state.status_line);
@@ -1197,6 +1434,8 @@ void cleanup(check_curl_global_state global_state) {
 	if (global_state.host) {
 		curl_slist_free_all(global_state.host);
 	}
+
+	check_curl_session_cache_free(global_state.session_cache);
 }
 
 int lookup_host(const char *host, char *buf, size_t buflen, sa_family_t addr_family) {
@@ -1306,8 +1545,75 @@ void test_file(char *path) {
 mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_warn,
 										 int days_till_exp_crit);
 
+#if defined(LIBCURL_FEATURE_SSL) && defined(MOPL_USE_OPENSSL)
+/*
+ * Checks the certificate with the facts from the certificate cache, only a certificate which
+ * is not in the cache is parsed. der is the encoded certificate, certificate may be NULL and
+ * is parsed from der then. Takes ownership of certificate.
+ */
+static mp_subcheck check_certificate_with_cache(X509 *certificate, const unsigned char *der,
+												size_t der_length, const char *cache_directory,
+												int warn_days_till_exp, int crit_days_till_exp) {
+	check_curl_certificate_facts facts = {0};
+	check_curl_certificate_fingerprint(der, der_length, &facts);
+
+	if (check_curl_certificate_cache_get(cache_directory, &facts)) {
+		if (certificate != NULL) {
+			X509_free(certificate);
+		}
+		return mp_net_ssl_check_certificate_expiry(facts.common_name, facts.expiry,
+												   warn_days_till_exp, crit_days_till_exp);
+	}
+
+	if (certificate == NULL) {
+		const unsigned char *cursor = der;
+		certificate = d2i_X509(NULL, &cursor, (long)der_length);
+		if (certificate == NULL) {
+			mp_subcheck sc_cert_result = mp_subcheck_init();
+			xasprintf(&sc_cert_result.output,
+					  _("Cannot read certificate from CERTINFO information - DER error"));
+			sc_cert_result = mp_set_subcheck_state(sc_cert_result, STATE_CRITICAL);
+			return sc_cert_result;
+		}
+	}
+
+	/* errors are not cached, the full check reports them */
+	if (np_net_ssl_get_certificate_expiry(certificate, facts.common_name,
+										  sizeof(facts.common_name), &facts.expiry) == NULL) {
+		check_curl_certificate_cache_put(cache_directory, &facts);
+	}
+	return mp_net_ssl_check_certificate(certificate, warn_days_till_exp, crit_days_till_exp);
+}
+
+/*
+ * Decodes the base64 body of a PEM certificate, returns NULL if it is not one
+ */
+static unsigned char *pem_certificate_to_der(const char *pem, size_t *der_length) {
+	const char *begin = strstr(pem, "-----BEGIN CERTIFICATE-----");
+	if (begin == NULL) {
+		return NULL;
+	}
+	begin += strlen("-----BEGIN CERTIFICATE-----");
+	const char *end = strstr(begin, "-----END CERTIFICATE-----");
+	if (end == NULL) {
+		return NULL;
+	}
+
+	/* the context makes the decoder skip the line breaks */
+	struct base64_decode_context context;
+	base64_decode_ctx_init(&context);
+	char *der = NULL;
+	idx_t length = 0;
+	if (!base64_decode_alloc_ctx(&context, begin, end - begin, &der, &length) || der == NULL) {
+		return NULL;
+	}
+	*der_length = (size_t)length;
+	return (unsigned char *)der;
+}
+#endif
+
 mp_subcheck check_curl_certificate_checks(CURL *curl, X509 *cert, int warn_days_till_exp,
-										  int crit_days_till_exp) {
+										  int crit_days_till_exp, const char *cache_directory) {
 	mp_subcheck sc_cert_result = mp_subcheck_init();
 	sc_cert_result = mp_set_subcheck_default_state(sc_cert_result, STATE_OK);
 
@@ -1317,6 +1623,17 @@ mp_subcheck check_curl_certificate_checks(CURL *curl, X509 *cert, int warn_days_
 		/* check certificate with OpenSSL functions, curl has been built against OpenSSL
 		 * and we actually have OpenSSL in the monitoring tools
 		 */
+		if (cache_directory != NULL && cert != NULL) {
+			unsigned char *der = NULL;
+			int der_length = i2d_X509(cert, &der);
+			if (der_length > 0) {
+				mp_subcheck sc_cached =
+					check_certificate_with_cache(cert, der, (size_t)der_length, cache_directory,
+												 warn_days_till_exp, crit_days_till_exp);
+				OPENSSL_free(der);
+				return sc_cached;
+			}
+		}
 		return mp_net_ssl_check_certificate(cert, warn_days_till_exp, crit_days_till_exp);
 #	else  /* MOPL_USE_OPENSSL */
 		xasprintf(&result.output, "HTTP CRITICAL - Cannot retrieve certificates - OpenSSL "
@@ -1363,6 +1680,18 @@ mp_subcheck check_curl_certificate_checks(CURL *curl, X509 *cert, int warn_days_
 				return sc_cert_result;
 			}
 
+			/* with the cache a known certificate is not parsed at all */
+			size_t der_length = 0;
+			unsigned char *der = NULL;
+			if (cache_directory != NULL &&
+				(der = pem_certificate_to_der(raw_cert, &der_length)) != NULL) {
+				mp_subcheck sc_cached =
+					check_certificate_with_cache(NULL, der, der_length, cache_directory,
+												 warn_days_till_exp, crit_days_till_exp);
+				free(der);
+				return sc_cached;
+			}
+
 			BIO *cert_BIO = BIO_new(BIO_s_mem());
 			BIO_write(cert_BIO, raw_cert, (int)strlen(raw_cert));
 
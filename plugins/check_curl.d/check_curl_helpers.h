@@ -1,4 +1,6 @@
 #include "./config.h"
+#include "./check_curl_cache.h"
+#include "./check_curl_sweep.h"
 #include <curl/curl.h>
 #include "../picohttpparser/picohttpparser.h"
 #include "output.h"
@@ -37,6 +39,45 @@ typedef struct {
 	char *first_line; /* a copy of the first line */
 } curlhelp_statusline;
 
+/* for matching the body while it is received, see curlhelp_body_match_write_callback */
+typedef struct {
+	curlhelp_write_curlbuf *body_buf;
+
+	/* fixed string, NULL if not used */
+	const char *string_expect;
+	size_t string_expect_length;
+	bool string_found;
+	/* offset in body_buf where the next search starts, overlapping the previous chunk by
+	 * string_expect_length - 1 bytes so matches across chunk boundaries are found */
+	size_t string_scan_pos;
+
+	/* regular expression, NULL if not used */
+	const regex_t *regex;
+	/* the regex does not span lines, so it can be applied to every complete line */
+	bool regex_per_line;
+	/* the pattern might match a newline, so a failed per line search is repeated on the body */
+	bool regex_rescan_body;
+	bool regex_decided;
+	/* 0, REG_NOMATCH or an error of regexec */
+	int regex_result;
+	size_t regex_scan_pos;
+
+	/* --json-expect and --json-value, NULL if not used */
+	check_curl_json_parser *json;
+	/* --prometheus, NULL if not used */
+	check_curl_prometheus_parser *prometheus;
+
+	/* bytes of the body received so far, they are only kept in body_buf if keep_body is set */
+	size_t body_length;
+	bool keep_body;
+
+	/* abort the transfer as soon as all expectations are met */
+	bool stop_on_match;
+	/* abort the transfer after this many bytes of the body, 0 is unlimited */
+	size_t max_body_size;
+	bool aborted;
+} curlhelp_body_matcher;
+
 typedef struct {
 	bool curl_global_initialized;
 	bool curl_easy_initialized;
@@ -53,6 +94,10 @@ typedef struct {
 	bool put_buf_initialized;
 	curlhelp_read_curlbuf *put_buf;
 
+	curlhelp_body_matcher *body_matcher;
+
+	check_curl_session_cache *session_cache;
+
 	CURL *curl;
 
 	struct curl_slist *header_list;
@@ -89,6 +134,12 @@ size_t curlhelp_buffer_write_callback(void * /*buffer*/, size_t /*size*/, size_t
 									  void * /*stream*/);
 void curlhelp_freewritebuffer(curlhelp_write_curlbuf * /*buf*/);
 
+void check_curl_configure_body_matcher(check_curl_global_state curl_state[static 1],
+									   const check_curl_config *config);
+size_t curlhelp_body_match_write_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/,
+										  void * /*stream*/);
+void curlhelp_body_matcher_finish(curlhelp_body_matcher * /*matcher*/);
+
 int curlhelp_initreadbuffer(curlhelp_read_curlbuf **buf, const char * /*data*/, size_t /*datalen*/);
 size_t curlhelp_buffer_read_callback(void * /*buffer*/, size_t /*size*/, size_t /*nmemb*/,
 									 void * /*stream*/);
@@ -109,8 +160,7 @@ void curlhelp_free_statusline(curlhelp_statusline * /*status_line*/);
 char *get_header_value(const struct phr_header *headers, size_t nof_headers, const char *header);
 mp_subcheck check_document_dates(const curlhelp_write_curlbuf * /*header_buf*/,
 								 int /*maximum_age*/);
-size_t get_content_length(const curlhelp_write_curlbuf *header_buf,
-						  const curlhelp_write_curlbuf *body_buf);
+size_t get_content_length(const curlhelp_write_curlbuf *header_buf, size_t body_length);
 int lookup_host(const char *host, char *buf, size_t buflen, sa_family_t addr_family);
 CURLcode sslctxfun(CURL *curl, SSL_CTX *sslctx, void *parm);
 
@@ -123,8 +173,11 @@ bool expected_statuscode(const char *reply, const char *statuscodes);
 char *string_statuscode(int major, int minor);
 
 void test_file(char *path);
+/*
+ * cache_directory is the directory of the certificate cache or NULL
+ */
 mp_subcheck check_curl_certificate_checks(CURL *curl, X509 *cert, int warn_days_till_exp,
-										  int crit_days_till_exp);
+										  int crit_days_till_exp, const char *cache_directory);
 char *fmt_url(check_curl_working_state workingState);
 
 /* hostname_gets_resolved_locally determines if the host or the proxy resolves the target hostname.
@@ -0,0 +1,771 @@
+/*****************************************************************************
+ *
+ * Streaming JSON assertions for check_curl
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Health and metrics endpoints answer with JSON documents which can be
+ * several megabytes large. Instead of building a tree of the whole
+ * document, the body is fed through a tokenizer while it is received. The
+ * tokenizer only keeps the path to the current value and copies the values
+ * which are asked for with --json-expect and --json-value.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_curl_json.h"
+#include "../utils.h"
+#include "../../lib/perfdata.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const check_curl_json_query json_root_query = {
+	.path = "$",
+	.segments_count = 0,
+};
+
+static bool json_is_space(char character) {
+	return character == ' ' || character == '\t' || character == '\n' || character == '\r';
+}
+
+static bool json_is_number_character(char character) {
+	return isdigit((unsigned char)character) || character == '-' || character == '+' ||
+		   character == '.' || character == 'e' || character == 'E';
+}
+
+static check_curl_json_query_wrapper json_query_error(const char *error) {
+	check_curl_json_query_wrapper result = {
+		.errorcode = ERROR,
+		.error = error,
+	};
+	return result;
+}
+
+static void json_add_segment(check_curl_json_query *query, const char *key, size_t key_length,
+							 long index) {
+	query->segments =
+		realloc(query->segments, (query->segments_count + 1) * sizeof(check_curl_json_segment));
+	if (query->segments == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory parsing a JSON path\n");
+	}
+
+	check_curl_json_segment *segment = &query->segments[query->segments_count++];
+	segment->key = key ? strndup(key, key_length) : NULL;
+	segment->key_length = key_length;
+	segment->index = index;
+}
+
+check_curl_json_query_wrapper check_curl_json_parse_query(const char *expression,
+														  bool is_assertion) {
+	check_curl_json_query_wrapper result = {
+		.errorcode = OK,
+	};
+	check_curl_json_query *query = &result.query;
+	query->thresholds = mp_thresholds_init();
+
+	const char *pos = expression;
+	while (json_is_space(*pos)) {
+		pos++;
+	}
+	if (*pos != '$') {
+		return json_query_error(_("the path has to start with $"));
+	}
+
+	const char *path_start = pos++;
+	while (*pos == '.' || *pos == '[') {
+		if (*pos == '.') {
+			pos++;
+			size_t key_length = strcspn(pos, ".[=! \t");
+			if (key_length == 0) {
+				return json_query_error(_("empty key in the path"));
+			}
+			json_add_segment(query, pos, key_length, 0);
+			pos += key_length;
+		} else if (isdigit((unsigned char)pos[1])) {
+			char *end;
+			errno = 0;
+			long index = strtol(pos + 1, &end, 10);
+			if (errno != 0 || *end != ']') {
+				return json_query_error(_("invalid array index in the path"));
+			}
+			json_add_segment(query, NULL, 0, index);
+			pos = end + 1;
+		} else if (pos[1] == '"' || pos[1] == '\'') {
+			const char *key = pos + 2;
+			const char *end = strchr(key, pos[1]);
+			if (end == NULL || end[1] != ']') {
+				return json_query_error(_("unterminated key in the path"));
+			}
+			json_add_segment(query, key, end - key, 0);
+			pos = end + 2;
+		} else {
+			return json_query_error(_("expecting an index or a quoted key after ["));
+		}
+	}
+	query->path = strndup(path_start, pos - path_start);
+
+	if (strncmp(query->path, "$.", 2) == 0) {
+		query->label = query->path + 2;
+	} else if (query->path[1] != '\0') {
+		query->label = query->path + 1;
+	} else {
+		query->label = "value";
+	}
+
+	while (json_is_space(*pos)) {
+		pos++;
+	}
+
+	if (!is_assertion) {
+		if (*pos != '\0') {
+			return json_query_error(_("unexpected text after the path"));
+		}
+		query->comparison = CHECK_CURL_JSON_EXTRACT;
+		return result;
+	}
+
+	if (strncmp(pos, "==", 2) == 0) {
+		query->comparison = CHECK_CURL_JSON_EQUAL;
+	} else if (strncmp(pos, "!=", 2) == 0) {
+		query->comparison = CHECK_CURL_JSON_NOT_EQUAL;
+	} else {
+		return json_query_error(_("expecting == or != after the path"));
+	}
+	pos += 2;
+
+	/* the expected value is a JSON document of its own, so it is unescaped like the body */
+	check_curl_json_parser *value_parser = check_curl_json_parser_new(&json_root_query, 1);
+	check_curl_json_parser_feed(value_parser, pos, strlen(pos));
+	check_curl_json_parser_finish(value_parser);
+
+	check_curl_json_match *value = &value_parser->matches[0];
+	if (value_parser->error != NULL || !value->found || value->type == CHECK_CURL_JSON_OBJECT ||
+		value->type == CHECK_CURL_JSON_ARRAY) {
+		check_curl_json_parser_free(value_parser);
+		return json_query_error(_("expecting a JSON string, number, true, false or null"));
+	}
+	if (value->value_truncated) {
+		check_curl_json_parser_free(value_parser);
+		return json_query_error(_("the expected value is too long"));
+	}
+
+	query->expected_type = value->type;
+	query->expected = value->value;
+	query->expected_length = value->value_length;
+	value->value = NULL;
+	check_curl_json_parser_free(value_parser);
+
+	return result;
+}
+
+check_curl_json_parser *check_curl_json_parser_new(const check_curl_json_query *queries,
+												   size_t queries_count) {
+	check_curl_json_parser *parser = calloc(1, sizeof(check_curl_json_parser));
+	if (parser == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating the JSON parser\n");
+	}
+
+	parser->queries = queries;
+	parser->queries_count = queries_count;
+	parser->matches = calloc(queries_count, sizeof(check_curl_json_match));
+	if (parser->matches == NULL && queries_count > 0) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating the JSON parser\n");
+	}
+	parser->state = JSON_STATE_VALUE;
+
+	return parser;
+}
+
+static void json_set_error(check_curl_json_parser *parser, const char *error) {
+	parser->error = error;
+	parser->state = JSON_STATE_ERROR;
+}
+
+static bool json_path_matches(const check_curl_json_parser *parser,
+							  const check_curl_json_query *query) {
+	if (query->segments_count != parser->depth) {
+		return false;
+	}
+
+	for (size_t i = 0; i < parser->depth; i++) {
+		const check_curl_json_frame *frame = &parser->frames[i];
+		const check_curl_json_segment *segment = &query->segments[i];
+
+		if (segment->key == NULL) {
+			if (!frame->is_array || frame->index != segment->index) {
+				return false;
+			}
+		} else if (frame->is_array || frame->key_truncated ||
+				   frame->key_length != segment->key_length ||
+				   memcmp(frame->key, segment->key, segment->key_length) != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * A value starts at the current position. Containers are recorded right away, scalars
+ * are copied until they end if a query asks for them.
+ */
+static void json_value_begin(check_curl_json_parser *parser, check_curl_json_type type) {
+	parser->capturing = false;
+	parser->value_type = type;
+	parser->value_length = 0;
+	parser->value_truncated = false;
+
+	if (parser->matches_found == parser->queries_count) {
+		return;
+	}
+
+	for (size_t i = 0; i < parser->queries_count; i++) {
+		if (parser->matches[i].found || !json_path_matches(parser, &parser->queries[i])) {
+			continue;
+		}
+
+		if (type == CHECK_CURL_JSON_OBJECT || type == CHECK_CURL_JSON_ARRAY) {
+			parser->matches[i].found = true;
+			parser->matches[i].type = type;
+			parser->matches_found++;
+		} else {
+			parser->capturing = true;
+		}
+	}
+}
+
+static void json_value_end(check_curl_json_parser *parser) {
+	if (parser->capturing) {
+		for (size_t i = 0; i < parser->queries_count; i++) {
+			check_curl_json_match *match = &parser->matches[i];
+			if (match->found || !json_path_matches(parser, &parser->queries[i])) {
+				continue;
+			}
+
+			match->found = true;
+			match->type = parser->value_type;
+			match->value = strndup(parser->value, parser->value_length);
+			if (match->value == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory copying a JSON value\n");
+			}
+			match->value_length = parser->value_length;
+			match->value_truncated = parser->value_truncated;
+			parser->matches_found++;
+		}
+		parser->capturing = false;
+	}
+
+	parser->state = parser->depth == 0 ? JSON_STATE_DONE : JSON_STATE_AFTER_VALUE;
+}
+
+static void json_append(check_curl_json_parser *parser, char character) {
+	if (parser->in_key) {
+		check_curl_json_frame *frame = &parser->frames[parser->depth - 1];
+		if (frame->key_length < CHECK_CURL_JSON_MAX_KEY) {
+			frame->key[frame->key_length++] = character;
+		} else {
+			frame->key_truncated = true;
+		}
+	} else if (parser->capturing) {
+		/* one byte stays free for the terminating zero */
+		if (parser->value_length < CHECK_CURL_JSON_MAX_VALUE - 1) {
+			parser->value[parser->value_length++] = character;
+		} else {
+			parser->value_truncated = true;
+		}
+	}
+}
+
+static void json_append_code_point(check_curl_json_parser *parser, unsigned int code_point) {
+	if (code_point < 0x80) {
+		json_append(parser, (char)code_point);
+	} else if (code_point < 0x800) {
+		json_append(parser, (char)(0xC0 | (code_point >> 6)));
+		json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+	} else if (code_point < 0x10000) {
+		json_append(parser, (char)(0xE0 | (code_point >> 12)));
+		json_append(parser, (char)(0x80 | ((code_point >> 6) & 0x3F)));
+		json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+	} else {
+		json_append(parser, (char)(0xF0 | (code_point >> 18)));
+		json_append(parser, (char)(0x80 | ((code_point >> 12) & 0x3F)));
+		json_append(parser, (char)(0x80 | ((code_point >> 6) & 0x3F)));
+		json_append(parser, (char)(0x80 | (code_point & 0x3F)));
+	}
+}
+
+/* a high surrogate which is not followed by a low one is replaced */
+static void json_flush_surrogate(check_curl_json_parser *parser) {
+	if (parser->high_surrogate != 0) {
+		json_append_code_point(parser, 0xFFFD);
+		parser->high_surrogate = 0;
+	}
+}
+
+static void json_unicode_escape(check_curl_json_parser *parser, unsigned int code_point) {
+	if (code_point >= 0xDC00 && code_point <= 0xDFFF && parser->high_surrogate != 0) {
+		code_point = 0x10000 + ((parser->high_surrogate - 0xD800) << 10) + (code_point - 0xDC00);
+		parser->high_surrogate = 0;
+		json_append_code_point(parser, code_point);
+		return;
+	}
+
+	json_flush_surrogate(parser);
+	if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+		parser->high_surrogate = code_point;
+	} else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+		json_append_code_point(parser, 0xFFFD);
+	} else {
+		json_append_code_point(parser, code_point);
+	}
+}
+
+static void json_push(check_curl_json_parser *parser, bool is_array) {
+	if (parser->depth == CHECK_CURL_JSON_MAX_DEPTH) {
+		json_set_error(parser, _("the document is nested too deeply"));
+		return;
+	}
+
+	if (parser->depth == parser->frames_size) {
+		size_t new_size = parser->frames_size ? parser->frames_size * 2 : 16;
+		check_curl_json_frame *frames =
+			realloc(parser->frames, new_size * sizeof(check_curl_json_frame));
+		if (frames == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory parsing the JSON body\n");
+		}
+		parser->frames = frames;
+		parser->frames_size = new_size;
+	}
+
+	check_curl_json_frame *frame = &parser->frames[parser->depth++];
+	frame->is_array = is_array;
+	frame->index = 0;
+	frame->key_length = 0;
+	frame->key_truncated = false;
+
+	parser->state = is_array ? JSON_STATE_ARRAY_FIRST : JSON_STATE_OBJECT_FIRST;
+}
+
+static void json_pop(check_curl_json_parser *parser, bool is_array) {
+	if (parser->frames[parser->depth - 1].is_array != is_array) {
+		json_set_error(parser, _("mismatched closing bracket"));
+		return;
+	}
+
+	parser->depth--;
+	json_value_end(parser);
+}
+
+static void json_begin_key(check_curl_json_parser *parser) {
+	check_curl_json_frame *frame = &parser->frames[parser->depth - 1];
+	frame->key_length = 0;
+	frame->key_truncated = false;
+	parser->in_key = true;
+	parser->state = JSON_STATE_STRING;
+}
+
+static void json_number_end(check_curl_json_parser *parser) {
+	if (parser->capturing && !parser->value_truncated) {
+		char *end;
+		parser->value[parser->value_length] = '\0';
+		strtod(parser->value, &end);
+		if (*end != '\0') {
+			json_set_error(parser, _("invalid number"));
+			return;
+		}
+	}
+	json_value_end(parser);
+}
+
+static void json_begin_value(check_curl_json_parser *parser, char character) {
+	switch (character) {
+	case '{':
+		json_value_begin(parser, CHECK_CURL_JSON_OBJECT);
+		json_push(parser, false);
+		break;
+	case '[':
+		json_value_begin(parser, CHECK_CURL_JSON_ARRAY);
+		json_push(parser, true);
+		break;
+	case '"':
+		json_value_begin(parser, CHECK_CURL_JSON_STRING);
+		parser->in_key = false;
+		parser->state = JSON_STATE_STRING;
+		break;
+	case 't':
+		json_value_begin(parser, CHECK_CURL_JSON_TRUE);
+		parser->literal = "true";
+		parser->literal_pos = 1;
+		parser->state = JSON_STATE_LITERAL;
+		break;
+	case 'f':
+		json_value_begin(parser, CHECK_CURL_JSON_FALSE);
+		parser->literal = "false";
+		parser->literal_pos = 1;
+		parser->state = JSON_STATE_LITERAL;
+		break;
+	case 'n':
+		json_value_begin(parser, CHECK_CURL_JSON_NULL);
+		parser->literal = "null";
+		parser->literal_pos = 1;
+		parser->state = JSON_STATE_LITERAL;
+		break;
+	default:
+		if (character == '-' || isdigit((unsigned char)character)) {
+			json_value_begin(parser, CHECK_CURL_JSON_NUMBER);
+			json_append(parser, character);
+			parser->state = JSON_STATE_NUMBER;
+		} else {
+			json_set_error(parser, _("unexpected character, expecting a value"));
+		}
+	}
+}
+
+static void json_step(check_curl_json_parser *parser, char character) {
+	switch (parser->state) {
+	case JSON_STATE_VALUE:
+	case JSON_STATE_ARRAY_FIRST:
+		if (json_is_space(character)) {
+			break;
+		}
+		if (character == ']' && parser->state == JSON_STATE_ARRAY_FIRST) {
+			json_pop(parser, true);
+			break;
+		}
+		json_begin_value(parser, character);
+		break;
+	case JSON_STATE_OBJECT_FIRST:
+	case JSON_STATE_KEY:
+		if (json_is_space(character)) {
+			break;
+		}
+		if (character == '}' && parser->state == JSON_STATE_OBJECT_FIRST) {
+			json_pop(parser, false);
+		} else if (character == '"') {
+			json_begin_key(parser);
+		} else {
+			json_set_error(parser, _("unexpected character, expecting a key"));
+		}
+		break;
+	case JSON_STATE_COLON:
+		if (character == ':') {
+			parser->state = JSON_STATE_VALUE;
+		} else if (!json_is_space(character)) {
+			json_set_error(parser, _("unexpected character, expecting ':'"));
+		}
+		break;
+	case JSON_STATE_AFTER_VALUE:
+		if (json_is_space(character)) {
+			break;
+		}
+		if (character == ',') {
+			check_curl_json_frame *frame = &parser->frames[parser->depth - 1];
+			if (frame->is_array) {
+				frame->index++;
+				parser->state = JSON_STATE_VALUE;
+			} else {
+				parser->state = JSON_STATE_KEY;
+			}
+		} else if (character == ']' || character == '}') {
+			json_pop(parser, character == ']');
+		} else {
+			json_set_error(parser, _("unexpected character, expecting ',' or a closing bracket"));
+		}
+		break;
+	case JSON_STATE_STRING:
+		if (character == '\\') {
+			parser->state = JSON_STATE_STRING_ESCAPE;
+			break;
+		}
+		json_flush_surrogate(parser);
+		if (character == '"') {
+			if (parser->in_key) {
+				parser->in_key = false;
+				parser->state = JSON_STATE_COLON;
+			} else {
+				json_value_end(parser);
+			}
+		} else if ((unsigned char)character < 0x20) {
+			json_set_error(parser, _("control character in a string"));
+		} else {
+			json_append(parser, character);
+		}
+		break;
+	case JSON_STATE_STRING_ESCAPE: {
+		const char *escapes = "\"\"\\\\//b\bf\fn\nr\rt\t";
+		parser->state = JSON_STATE_STRING;
+		if (character == 'u') {
+			parser->unicode = 0;
+			parser->unicode_digits = 0;
+			parser->state = JSON_STATE_STRING_UNICODE;
+			break;
+		}
+		for (const char *escape = escapes; *escape != '\0'; escape += 2) {
+			if (*escape == character) {
+				json_flush_surrogate(parser);
+				json_append(parser, escape[1]);
+				return;
+			}
+		}
+		json_set_error(parser, _("invalid escape sequence in a string"));
+	} break;
+	case JSON_STATE_STRING_UNICODE:
+		if (!isxdigit((unsigned char)character)) {
+			json_set_error(parser, _("invalid unicode escape in a string"));
+			break;
+		}
+		parser->unicode = parser->unicode * 16 +
+						  (isdigit((unsigned char)character)
+							   ? (unsigned int)(character - '0')
+							   : (unsigned int)(tolower((unsigned char)character) - 'a' + 10));
+		if (++parser->unicode_digits == 4) {
+			json_unicode_escape(parser, parser->unicode);
+			parser->state = JSON_STATE_STRING;
+		}
+		break;
+	case JSON_STATE_NUMBER:
+		/* the first character after the number was handled in check_curl_json_parser_feed */
+		json_append(parser, character);
+		break;
+	case JSON_STATE_LITERAL:
+		if (character != parser->literal[parser->literal_pos]) {
+			json_set_error(parser, _("invalid literal"));
+			break;
+		}
+		if (parser->literal[++parser->literal_pos] == '\0') {
+			json_value_end(parser);
+		}
+		break;
+	case JSON_STATE_DONE:
+		if (!json_is_space(character)) {
+			json_set_error(parser, _("unexpected data after the end of the document"));
+		}
+		break;
+	case JSON_STATE_ERROR:
+		break;
+	}
+}
+
+bool check_curl_json_parser_feed(check_curl_json_parser *parser, const char *data,
+								 size_t length) {
+	for (size_t i = 0; i < length; i++) {
+		/* strings nobody asked for are skipped up to the next quote or escape */
+		if (parser->state == JSON_STATE_STRING && !parser->in_key && !parser->capturing) {
+			while (i < length && data[i] != '"' && data[i] != '\\') {
+				i++;
+			}
+			if (i == length) {
+				break;
+			}
+		}
+
+		if (parser->state == JSON_STATE_NUMBER && !json_is_number_character(data[i])) {
+			json_number_end(parser);
+		}
+		if (parser->state != JSON_STATE_ERROR) {
+			json_step(parser, data[i]);
+		}
+
+		if (parser->state == JSON_STATE_ERROR) {
+			/* the offset points to the offending byte */
+			parser->offset += i;
+			return false;
+		}
+	}
+
+	parser->offset += length;
+	return true;
+}
+
+void check_curl_json_parser_finish(check_curl_json_parser *parser) {
+	if (parser->state == JSON_STATE_NUMBER) {
+		json_number_end(parser);
+	}
+	if (parser->state != JSON_STATE_DONE && parser->state != JSON_STATE_ERROR) {
+		json_set_error(parser, _("unexpected end of the document"));
+	}
+}
+
+bool check_curl_json_parser_decided(const check_curl_json_parser *parser) {
+	return parser->matches_found == parser->queries_count || parser->state == JSON_STATE_ERROR;
+}
+
+void check_curl_json_parser_free(check_curl_json_parser *parser) {
+	if (parser == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < parser->queries_count; i++) {
+		free(parser->matches[i].value);
+	}
+	free(parser->matches);
+	free(parser->frames);
+	free(parser);
+}
+
+static char *json_value_to_string(check_curl_json_type type, const char *value) {
+	char *result = NULL;
+	switch (type) {
+	case CHECK_CURL_JSON_STRING:
+		xasprintf(&result, "\"%s\"", value);
+		break;
+	case CHECK_CURL_JSON_NUMBER:
+		xasprintf(&result, "%s", value);
+		break;
+	case CHECK_CURL_JSON_TRUE:
+		xasprintf(&result, "true");
+		break;
+	case CHECK_CURL_JSON_FALSE:
+		xasprintf(&result, "false");
+		break;
+	case CHECK_CURL_JSON_NULL:
+		xasprintf(&result, "null");
+		break;
+	case CHECK_CURL_JSON_OBJECT:
+		xasprintf(&result, "an object");
+		break;
+	case CHECK_CURL_JSON_ARRAY:
+		xasprintf(&result, "an array");
+		break;
+	case CHECK_CURL_JSON_NONE:
+	default:
+		xasprintf(&result, "nothing");
+	}
+	return result;
+}
+
+static bool json_values_equal(const check_curl_json_query *query,
+							  const check_curl_json_match *match) {
+	if (match->type != query->expected_type || match->value_truncated) {
+		return false;
+	}
+
+	switch (match->type) {
+	case CHECK_CURL_JSON_STRING:
+		return match->value_length == query->expected_length &&
+			   memcmp(match->value, query->expected, query->expected_length) == 0;
+	case CHECK_CURL_JSON_NUMBER:
+		return strtod(match->value, NULL) == strtod(query->expected, NULL);
+	default:
+		return true;
+	}
+}
+
+/*
+ * Numbers, strings containing a number and booleans (as 0 and 1) become perfdata
+ */
+static bool json_value_to_perfdata(const check_curl_json_match *match,
+								   mp_perfdata_value *result) {
+	switch (match->type) {
+	case CHECK_CURL_JSON_TRUE:
+	case CHECK_CURL_JSON_FALSE:
+		*result = mp_create_pd_value(match->type == CHECK_CURL_JSON_TRUE ? 1 : 0);
+		return true;
+	case CHECK_CURL_JSON_NUMBER:
+	case CHECK_CURL_JSON_STRING:
+		break;
+	default:
+		return false;
+	}
+
+	if (match->value_length == 0 || match->value_truncated) {
+		return false;
+	}
+
+	char *end;
+	if (strpbrk(match->value, ".eE") == NULL) {
+		errno = 0;
+		long long integer = strtoll(match->value, &end, 10);
+		if (errno == 0 && *end == '\0') {
+			*result = mp_create_pd_value(integer);
+			return true;
+		}
+	}
+
+	double number = strtod(match->value, &end);
+	if (*end != '\0') {
+		return false;
+	}
+	*result = mp_create_pd_value(number);
+	return true;
+}
+
+void check_curl_json_evaluate(const check_curl_json_parser *parser, mp_subcheck *sc_result) {
+	for (size_t i = 0; i < parser->queries_count; i++) {
+		const check_curl_json_query *query = &parser->queries[i];
+		const check_curl_json_match *match = &parser->matches[i];
+
+		mp_subcheck sc_json = mp_subcheck_init();
+
+		if (!match->found) {
+			if (parser->error != NULL) {
+				xasprintf(&sc_json.output,
+						  _("%s not found, body is not valid JSON: %s at byte %zu"), query->path,
+						  parser->error, parser->offset);
+			} else {
+				xasprintf(&sc_json.output, _("%s not found in body"), query->path);
+			}
+			/* a missing metric is unknown, a missing assertion fails like a missing string */
+			sc_json = mp_set_subcheck_state(sc_json, query->comparison == CHECK_CURL_JSON_EXTRACT
+														 ? STATE_UNKNOWN
+														 : STATE_CRITICAL);
+			mp_add_subcheck_to_subcheck(sc_result, sc_json);
+			continue;
+		}
+
+		char *value = json_value_to_string(match->type, match->value);
+
+		if (query->comparison == CHECK_CURL_JSON_EXTRACT) {
+			mp_perfdata_value pd_value;
+			if (!json_value_to_perfdata(match, &pd_value)) {
+				xasprintf(&sc_json.output, _("%s is %s, not a number"), query->path, value);
+				sc_json = mp_set_subcheck_state(sc_json, STATE_UNKNOWN);
+			} else {
+				mp_perfdata pd_json = perfdata_init();
+				pd_json.label = query->label;
+				pd_json.value = pd_value;
+				pd_json = mp_pd_set_thresholds(pd_json, query->thresholds);
+
+				xasprintf(&sc_json.output, "%s is %s", query->path, value);
+				sc_json = mp_set_subcheck_state(sc_json, mp_get_pd_status(pd_json));
+				mp_add_perfdata_to_subcheck(&sc_json, pd_json);
+			}
+		} else {
+			char *expected = json_value_to_string(query->expected_type, query->expected);
+			bool equal = json_values_equal(query, match);
+
+			if (equal == (query->comparison == CHECK_CURL_JSON_EQUAL)) {
+				xasprintf(&sc_json.output, "%s is %s", query->path, value);
+				sc_json = mp_set_subcheck_state(sc_json, STATE_OK);
+			} else {
+				xasprintf(&sc_json.output, _("%s is %s, expected %s%s"), query->path, value,
+						  query->comparison == CHECK_CURL_JSON_EQUAL ? "" : _("anything but "),
+						  expected);
+				sc_json = mp_set_subcheck_state(sc_json, STATE_CRITICAL);
+			}
+			free(expected);
+		}
+
+		free(value);
+		mp_add_subcheck_to_subcheck(sc_result, sc_json);
+	}
+}
@@ -0,0 +1,166 @@
+#pragma once
+/* Streaming evaluation of JSON bodies of check_curl, see --json-expect and --json-value */
+
+#include "../common.h"
+#include "../../lib/output.h"
+#include "../../lib/thresholds.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+enum {
+	/* deeper documents are rejected instead of growing the stack without limit */
+	CHECK_CURL_JSON_MAX_DEPTH = 512,
+	/* longer keys never match a query */
+	CHECK_CURL_JSON_MAX_KEY = 256,
+	/* longer values are truncated, the comparison with them fails */
+	CHECK_CURL_JSON_MAX_VALUE = 1024,
+};
+
+typedef enum {
+	CHECK_CURL_JSON_NONE,
+	CHECK_CURL_JSON_STRING,
+	CHECK_CURL_JSON_NUMBER,
+	CHECK_CURL_JSON_TRUE,
+	CHECK_CURL_JSON_FALSE,
+	CHECK_CURL_JSON_NULL,
+	CHECK_CURL_JSON_OBJECT,
+	CHECK_CURL_JSON_ARRAY,
+} check_curl_json_type;
+
+/* one step of a path, either the member key of an object or the index in an array */
+typedef struct {
+	char *key;
+	size_t key_length;
+	long index;
+} check_curl_json_segment;
+
+typedef enum {
+	/* --json-value, the number is reported as perfdata */
+	CHECK_CURL_JSON_EXTRACT,
+	/* --json-expect with == or != */
+	CHECK_CURL_JSON_EQUAL,
+	CHECK_CURL_JSON_NOT_EQUAL,
+} check_curl_json_comparison;
+
+typedef struct {
+	/* the path as given, e.g. $.queue.depth or $.checks[0]["status"] */
+	char *path;
+	/* label of the perfdata, the path without the leading "$." */
+	char *label;
+	check_curl_json_segment *segments;
+	size_t segments_count;
+
+	check_curl_json_comparison comparison;
+	/* the value after the comparison, strings are unescaped */
+	check_curl_json_type expected_type;
+	char *expected;
+	size_t expected_length;
+
+	mp_thresholds thresholds;
+} check_curl_json_query;
+
+typedef struct {
+	int errorcode;
+	const char *error;
+	check_curl_json_query query;
+} check_curl_json_query_wrapper;
+
+/*
+ * Parses a query: a path starting with $, followed by ".key", "[index]" or ["key"] steps.
+ * Assertions must be followed by == or != and a JSON string, number, true, false or null.
+ */
+check_curl_json_query_wrapper check_curl_json_parse_query(const char *expression,
+														  bool is_assertion);
+
+/* what was found for a query */
+typedef struct {
+	bool found;
+	check_curl_json_type type;
+	/* unescaped string or the text of the number */
+	char *value;
+	size_t value_length;
+	bool value_truncated;
+} check_curl_json_match;
+
+typedef enum {
+	JSON_STATE_VALUE,
+	JSON_STATE_ARRAY_FIRST,
+	JSON_STATE_OBJECT_FIRST,
+	JSON_STATE_KEY,
+	JSON_STATE_COLON,
+	JSON_STATE_AFTER_VALUE,
+	JSON_STATE_STRING,
+	JSON_STATE_STRING_ESCAPE,
+	JSON_STATE_STRING_UNICODE,
+	JSON_STATE_NUMBER,
+	JSON_STATE_LITERAL,
+	JSON_STATE_DONE,
+	JSON_STATE_ERROR,
+} check_curl_json_state;
+
+/* an open object or array */
+typedef struct {
+	bool is_array;
+	long index;
+	char key[CHECK_CURL_JSON_MAX_KEY];
+	size_t key_length;
+	bool key_truncated;
+} check_curl_json_frame;
+
+/*
+ * Tokenizer which is fed the body in chunks of any size. Only the open containers and
+ * the values of matching paths are kept, never the whole document.
+ */
+typedef struct {
+	const check_curl_json_query *queries;
+	size_t queries_count;
+	check_curl_json_match *matches;
+	size_t matches_found;
+
+	check_curl_json_state state;
+	check_curl_json_frame *frames;
+	size_t frames_size;
+	size_t depth;
+
+	/* the current string is an object key */
+	bool in_key;
+	/* the current scalar is at the path of a query */
+	bool capturing;
+	check_curl_json_type value_type;
+	char value[CHECK_CURL_JSON_MAX_VALUE];
+	size_t value_length;
+	bool value_truncated;
+
+	const char *literal;
+	size_t literal_pos;
+	unsigned int unicode;
+	int unicode_digits;
+	unsigned int high_surrogate;
+
+	size_t offset;
+	const char *error;
+} check_curl_json_parser;
+
+check_curl_json_parser *check_curl_json_parser_new(const check_curl_json_query *queries,
+												   size_t queries_count);
+
+/*
+ * Feeds the next chunk of the document, returns false once the document is invalid
+ */
+bool check_curl_json_parser_feed(check_curl_json_parser *parser, const char *data,
+								 size_t length);
+
+/*
+ * Ends the document, a number at the top level is only complete here
+ */
+void check_curl_json_parser_finish(check_curl_json_parser *parser);
+
+/* every query has a result, nothing more is learned from the rest of the document */
+bool check_curl_json_parser_decided(const check_curl_json_parser *parser);
+
+void check_curl_json_parser_free(check_curl_json_parser *parser);
+
+/*
+ * Adds one subcheck per query to sc_result, values of --json-value become perfdata
+ */
+void check_curl_json_evaluate(const check_curl_json_parser *parser, mp_subcheck *sc_result);
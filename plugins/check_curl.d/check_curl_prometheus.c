@@ -0,0 +1,581 @@
+/*****************************************************************************
+ *
+ * Prometheus text format evaluation for check_curl
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Many services only expose their state on a Prometheus /metrics endpoint,
+ * which can contain tens of thousands of series. The body is split into
+ * lines while it is received and every line is parsed where it is. Only
+ * the names of the metrics are compared for most lines, the labels are
+ * parsed for the lines of selected metrics and only matching series are
+ * copied.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_curl_prometheus.h"
+#include "../utils.h"
+#include "../../lib/perfdata.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool prometheus_is_name_character(char character, bool first) {
+	return isalpha((unsigned char)character) || character == '_' || character == ':' ||
+		   (!first && isdigit((unsigned char)character));
+}
+
+static size_t prometheus_name_length(const char *text, size_t length) {
+	size_t name_length = 0;
+	while (name_length < length &&
+		   prometheus_is_name_character(text[name_length], name_length == 0)) {
+		name_length++;
+	}
+	return name_length;
+}
+
+static size_t prometheus_skip_space(const char *text, size_t length, size_t pos) {
+	while (pos < length && (text[pos] == ' ' || text[pos] == '\t')) {
+		pos++;
+	}
+	return pos;
+}
+
+/*
+ * Finds the end of a quoted label value starting after the opening quote, returns the
+ * position of the closing quote or length if there is none
+ */
+static size_t prometheus_value_end(const char *text, size_t length, size_t pos) {
+	while (pos < length && text[pos] != '"') {
+		pos += (text[pos] == '\\') ? 2 : 1;
+	}
+	return pos < length ? pos : length;
+}
+
+/*
+ * Unescapes a label value into buffer, returns false if it does not fit
+ */
+static bool prometheus_unescape(const char *value, size_t length, char *buffer,
+								size_t buffer_size) {
+	size_t out = 0;
+	for (size_t i = 0; i < length; i++) {
+		char character = value[i];
+		if (character == '\\' && i + 1 < length) {
+			character = value[++i] == 'n' ? '\n' : value[i];
+		}
+		if (out + 1 >= buffer_size) {
+			return false;
+		}
+		buffer[out++] = character;
+	}
+	buffer[out] = '\0';
+	return true;
+}
+
+static check_curl_prometheus_selector_wrapper prometheus_selector_error(const char *error) {
+	check_curl_prometheus_selector_wrapper result = {
+		.errorcode = ERROR,
+		.error = error,
+	};
+	return result;
+}
+
+check_curl_prometheus_selector_wrapper
+check_curl_prometheus_parse_selector(const char *selector) {
+	check_curl_prometheus_selector_wrapper result = {
+		.errorcode = OK,
+	};
+	check_curl_prometheus_selector *parsed = &result.selector;
+	parsed->selector = strdup(selector);
+	parsed->thresholds = mp_thresholds_init();
+
+	size_t length = strlen(selector);
+	size_t pos = prometheus_skip_space(selector, length, 0);
+	size_t name_length = prometheus_name_length(selector + pos, length - pos);
+	if (name_length == 0) {
+		return prometheus_selector_error(_("the selector has to start with a metric name"));
+	}
+	parsed->name = strndup(selector + pos, name_length);
+	parsed->name_length = name_length;
+	pos = prometheus_skip_space(selector, length, pos + name_length);
+
+	if (pos < length && selector[pos] == '{') {
+		pos = prometheus_skip_space(selector, length, pos + 1);
+		while (pos < length && selector[pos] != '}') {
+			size_t label_length = prometheus_name_length(selector + pos, length - pos);
+			if (label_length == 0) {
+				return prometheus_selector_error(_("expecting a label name"));
+			}
+
+			check_curl_prometheus_matcher matcher = {
+				.label = strndup(selector + pos, label_length),
+				.label_length = label_length,
+			};
+			pos = prometheus_skip_space(selector, length, pos + label_length);
+
+			if (strncmp(selector + pos, "=~", 2) == 0) {
+				matcher.type = PROMETHEUS_MATCH_REGEX;
+				pos += 2;
+			} else if (strncmp(selector + pos, "!~", 2) == 0) {
+				matcher.type = PROMETHEUS_MATCH_NOT_REGEX;
+				pos += 2;
+			} else if (strncmp(selector + pos, "!=", 2) == 0) {
+				matcher.type = PROMETHEUS_MATCH_NOT_EQUAL;
+				pos += 2;
+			} else if (selector[pos] == '=') {
+				matcher.type = PROMETHEUS_MATCH_EQUAL;
+				pos += 1;
+			} else {
+				return prometheus_selector_error(_("expecting =, !=, =~ or !~ after the label"));
+			}
+
+			pos = prometheus_skip_space(selector, length, pos);
+			if (selector[pos] != '"') {
+				return prometheus_selector_error(_("expecting a quoted label value"));
+			}
+			size_t value_end = prometheus_value_end(selector, length, pos + 1);
+			if (value_end == length) {
+				return prometheus_selector_error(_("unterminated label value"));
+			}
+
+			matcher.value = calloc(value_end - pos, 1);
+			if (matcher.value == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory parsing a selector\n");
+			}
+			prometheus_unescape(selector + pos + 1, value_end - pos - 1, matcher.value,
+								value_end - pos);
+			pos = prometheus_skip_space(selector, length, value_end + 1);
+
+			if (matcher.type == PROMETHEUS_MATCH_REGEX ||
+				matcher.type == PROMETHEUS_MATCH_NOT_REGEX) {
+				/* regular expressions match the whole value like in PromQL */
+				char *anchored;
+				xasprintf(&anchored, "^(%s)$", matcher.value);
+				int errcode = regcomp(&matcher.regex, anchored, REG_EXTENDED | REG_NOSUB);
+				free(anchored);
+				if (errcode != 0) {
+					return prometheus_selector_error(_("invalid regular expression"));
+				}
+			}
+
+			parsed->matchers =
+				realloc(parsed->matchers,
+						(parsed->matchers_count + 1) * sizeof(check_curl_prometheus_matcher));
+			if (parsed->matchers == NULL) {
+				die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory parsing a selector\n");
+			}
+			parsed->matchers[parsed->matchers_count++] = matcher;
+
+			if (pos < length && selector[pos] == ',') {
+				pos = prometheus_skip_space(selector, length, pos + 1);
+			} else if (pos < length && selector[pos] != '}') {
+				return prometheus_selector_error(_("expecting , or } after a label matcher"));
+			}
+		}
+		if (pos == length) {
+			return prometheus_selector_error(_("missing } at the end of the selector"));
+		}
+		pos = prometheus_skip_space(selector, length, pos + 1);
+	}
+
+	if (pos != length) {
+		return prometheus_selector_error(_("unexpected text after the selector"));
+	}
+
+	return result;
+}
+
+check_curl_prometheus_parser *
+check_curl_prometheus_parser_new(const check_curl_prometheus_selector *selectors,
+								 size_t selectors_count) {
+	check_curl_prometheus_parser *parser = calloc(1, sizeof(check_curl_prometheus_parser));
+	if (parser == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating the metrics parser\n");
+	}
+
+	parser->selectors = selectors;
+	parser->selectors_count = selectors_count;
+	parser->results = calloc(selectors_count, sizeof(check_curl_prometheus_result));
+	if (parser->results == NULL && selectors_count > 0) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating the metrics parser\n");
+	}
+
+	return parser;
+}
+
+/* a label of a series, pointing into the line */
+typedef struct {
+	const char *name;
+	size_t name_length;
+	const char *value;
+	size_t value_length;
+} prometheus_label;
+
+static bool prometheus_matcher_matches(const check_curl_prometheus_matcher *matcher,
+									   const prometheus_label *labels, size_t labels_count) {
+	/* a missing label matches like an empty one */
+	const char *value = "";
+	size_t value_length = 0;
+	for (size_t i = 0; i < labels_count; i++) {
+		if (labels[i].name_length == matcher->label_length &&
+			memcmp(labels[i].name, matcher->label, matcher->label_length) == 0) {
+			value = labels[i].value;
+			value_length = labels[i].value_length;
+			break;
+		}
+	}
+
+	char unescaped[MAX_INPUT_BUFFER];
+	if (!prometheus_unescape(value, value_length, unescaped, sizeof(unescaped))) {
+		return false;
+	}
+
+	switch (matcher->type) {
+	case PROMETHEUS_MATCH_EQUAL:
+		return strcmp(unescaped, matcher->value) == 0;
+	case PROMETHEUS_MATCH_NOT_EQUAL:
+		return strcmp(unescaped, matcher->value) != 0;
+	case PROMETHEUS_MATCH_REGEX:
+		return regexec(&matcher->regex, unescaped, 0, NULL, 0) == 0;
+	case PROMETHEUS_MATCH_NOT_REGEX:
+		return regexec(&matcher->regex, unescaped, 0, NULL, 0) != 0;
+	}
+	return false;
+}
+
+/*
+ * Builds a perfdata label like http_requests_total_code_500 from the name and the labels of a
+ * series, the characters of the label values which are not allowed in names become '_'
+ */
+static char *prometheus_perfdata_label(const char *name, size_t name_length,
+									   const prometheus_label *labels, size_t labels_count) {
+	size_t length = name_length;
+	for (size_t i = 0; i < labels_count; i++) {
+		length += 2 + labels[i].name_length + labels[i].value_length;
+	}
+
+	char *label = malloc(length + 1);
+	if (label == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory recording a sample\n");
+	}
+
+	memcpy(label, name, name_length);
+	size_t pos = name_length;
+	for (size_t i = 0; i < labels_count; i++) {
+		label[pos++] = '_';
+		memcpy(label + pos, labels[i].name, labels[i].name_length);
+		pos += labels[i].name_length;
+		label[pos++] = '_';
+		for (size_t j = 0; j < labels[i].value_length; j++) {
+			char character = labels[i].value[j];
+			label[pos++] = prometheus_is_name_character(character, false) ? character : '_';
+		}
+	}
+	label[pos] = '\0';
+	return label;
+}
+
+static void prometheus_add_sample(check_curl_prometheus_result *result, const char *series,
+								  size_t series_length, size_t name_length,
+								  const prometheus_label *labels, size_t labels_count,
+								  double value) {
+	if (result->samples_count == result->samples_size) {
+		result->samples_size = result->samples_size ? result->samples_size * 2 : 8;
+		result->samples =
+			realloc(result->samples, result->samples_size * sizeof(check_curl_prometheus_sample));
+		if (result->samples == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory recording a sample\n");
+		}
+	}
+
+	check_curl_prometheus_sample *sample = &result->samples[result->samples_count++];
+	sample->series = strndup(series, series_length);
+	sample->label = prometheus_perfdata_label(series, name_length, labels, labels_count);
+	sample->value = value;
+}
+
+/*
+ * Parses one line of the exposition format:
+ *   metric_name{label="value",...} value [timestamp]
+ */
+static void prometheus_line(check_curl_prometheus_parser *parser, const char *line,
+							size_t length) {
+	if (length > 0 && line[length - 1] == '\r') {
+		length--;
+	}
+	size_t pos = prometheus_skip_space(line, length, 0);
+	if (pos == length || line[pos] == '#') {
+		return;
+	}
+	parser->lines++;
+
+	const char *name = line + pos;
+	size_t name_length = prometheus_name_length(name, length - pos);
+	if (name_length == 0) {
+		parser->invalid_lines++;
+		return;
+	}
+
+	/* most lines end here, the labels are only parsed for selected metrics */
+	bool selected = false;
+	for (size_t i = 0; i < parser->selectors_count && !selected; i++) {
+		selected = parser->selectors[i].name_length == name_length &&
+				   memcmp(parser->selectors[i].name, name, name_length) == 0;
+	}
+	if (!selected) {
+		return;
+	}
+
+	prometheus_label labels[CHECK_CURL_PROMETHEUS_MAX_LABELS];
+	size_t labels_count = 0;
+	pos += name_length;
+	if (pos < length && line[pos] == '{') {
+		pos = prometheus_skip_space(line, length, pos + 1);
+		while (pos < length && line[pos] != '}') {
+			size_t label_length = prometheus_name_length(line + pos, length - pos);
+			size_t value_start = prometheus_skip_space(line, length, pos + label_length);
+			if (label_length == 0 || labels_count == CHECK_CURL_PROMETHEUS_MAX_LABELS ||
+				value_start + 1 >= length || line[value_start] != '=') {
+				parser->invalid_lines++;
+				return;
+			}
+			value_start = prometheus_skip_space(line, length, value_start + 1);
+			if (value_start >= length || line[value_start] != '"') {
+				parser->invalid_lines++;
+				return;
+			}
+			size_t value_end = prometheus_value_end(line, length, value_start + 1);
+			if (value_end == length) {
+				parser->invalid_lines++;
+				return;
+			}
+
+			labels[labels_count++] = (prometheus_label){
+				.name = line + pos,
+				.name_length = label_length,
+				.value = line + value_start + 1,
+				.value_length = value_end - value_start - 1,
+			};
+
+			pos = prometheus_skip_space(line, length, value_end + 1);
+			if (pos < length && line[pos] == ',') {
+				pos = prometheus_skip_space(line, length, pos + 1);
+			} else if (pos < length && line[pos] != '}') {
+				/* the labels must be separated by commas */
+				parser->invalid_lines++;
+				return;
+			}
+		}
+		if (pos == length) {
+			parser->invalid_lines++;
+			return;
+		}
+		pos++;
+	}
+	size_t series_length = line + pos - name;
+
+	pos = prometheus_skip_space(line, length, pos);
+	size_t value_length = 0;
+	while (pos + value_length < length && line[pos + value_length] != ' ' &&
+		   line[pos + value_length] != '\t') {
+		value_length++;
+	}
+	/* the value is the only part which needs a terminated copy, for strtod */
+	char value_text[64];
+	if (value_length == 0 || value_length >= sizeof(value_text)) {
+		parser->invalid_lines++;
+		return;
+	}
+	memcpy(value_text, line + pos, value_length);
+	value_text[value_length] = '\0';
+	char *end;
+	double value = strtod(value_text, &end);
+	if (*end != '\0') {
+		parser->invalid_lines++;
+		return;
+	}
+
+	for (size_t i = 0; i < parser->selectors_count; i++) {
+		const check_curl_prometheus_selector *selector = &parser->selectors[i];
+		if (selector->name_length != name_length ||
+			memcmp(selector->name, name, name_length) != 0) {
+			continue;
+		}
+
+		bool matches = true;
+		for (size_t j = 0; j < selector->matchers_count && matches; j++) {
+			matches = prometheus_matcher_matches(&selector->matchers[j], labels, labels_count);
+		}
+		if (matches) {
+			prometheus_add_sample(&parser->results[i], name, series_length, name_length, labels,
+								  labels_count, value);
+		}
+	}
+}
+
+static void prometheus_partial_line_append(check_curl_prometheus_parser *parser,
+										   const char *data, size_t length) {
+	if (parser->partial_line_overflow ||
+		parser->partial_line_length + length > CHECK_CURL_PROMETHEUS_MAX_LINE) {
+		parser->partial_line_overflow = true;
+		return;
+	}
+
+	if (parser->partial_line == NULL) {
+		parser->partial_line = malloc(CHECK_CURL_PROMETHEUS_MAX_LINE);
+		if (parser->partial_line == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - out of memory allocating the line buffer\n");
+		}
+	}
+	memcpy(parser->partial_line + parser->partial_line_length, data, length);
+	parser->partial_line_length += length;
+}
+
+static void prometheus_partial_line_end(check_curl_prometheus_parser *parser) {
+	if (parser->partial_line_overflow) {
+		parser->lines++;
+		parser->invalid_lines++;
+	} else {
+		prometheus_line(parser, parser->partial_line, parser->partial_line_length);
+	}
+	parser->partial_line_length = 0;
+	parser->partial_line_overflow = false;
+}
+
+void check_curl_prometheus_parser_feed(check_curl_prometheus_parser *parser, const char *data,
+									   size_t length) {
+	size_t pos = 0;
+
+	/* complete the line of the previous chunk */
+	if (parser->partial_line_length > 0 || parser->partial_line_overflow) {
+		const char *newline = memchr(data, '\n', length);
+		size_t part_length = newline ? (size_t)(newline - data) : length;
+		prometheus_partial_line_append(parser, data, part_length);
+		if (newline == NULL) {
+			return;
+		}
+		prometheus_partial_line_end(parser);
+		pos = part_length + 1;
+	}
+
+	while (pos < length) {
+		const char *newline = memchr(data + pos, '\n', length - pos);
+		if (newline == NULL) {
+			prometheus_partial_line_append(parser, data + pos, length - pos);
+			return;
+		}
+		prometheus_line(parser, data + pos, newline - (data + pos));
+		pos = newline - data + 1;
+	}
+}
+
+void check_curl_prometheus_parser_finish(check_curl_prometheus_parser *parser) {
+	if (parser->partial_line_length > 0 || parser->partial_line_overflow) {
+		prometheus_partial_line_end(parser);
+	}
+}
+
+void check_curl_prometheus_parser_free(check_curl_prometheus_parser *parser) {
+	if (parser == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < parser->selectors_count; i++) {
+		for (size_t j = 0; j < parser->results[i].samples_count; j++) {
+			free(parser->results[i].samples[j].series);
+			free(parser->results[i].samples[j].label);
+		}
+		free(parser->results[i].samples);
+	}
+	free(parser->results);
+	free(parser->partial_line);
+	free(parser);
+}
+
+static mp_perfdata_value prometheus_pd_value(double value) {
+	/* counters and gauges are mostly whole numbers, they are printed without fraction */
+	if (value > -9007199254740992.0 && value < 9007199254740992.0 &&
+		(double)(long long)value == value) {
+		return mp_create_pd_value((long long)value);
+	}
+	return mp_create_pd_value(value);
+}
+
+void check_curl_prometheus_evaluate(const check_curl_prometheus_parser *parser,
+									mp_subcheck *sc_result) {
+	for (size_t i = 0; i < parser->selectors_count; i++) {
+		const check_curl_prometheus_selector *selector = &parser->selectors[i];
+		const check_curl_prometheus_result *result = &parser->results[i];
+
+		mp_subcheck sc_metric = mp_subcheck_init();
+
+		if (result->samples_count == 0) {
+			xasprintf(&sc_metric.output, _("%s: no series found in %zu lines"),
+					  selector->selector, parser->lines);
+			sc_metric = mp_set_subcheck_state(sc_metric, STATE_UNKNOWN);
+			mp_add_subcheck_to_subcheck(sc_result, sc_metric);
+			continue;
+		}
+
+		mp_state_enum state = STATE_OK;
+		size_t violations = 0;
+		size_t not_finite = 0;
+		for (size_t j = 0; j < result->samples_count; j++) {
+			const check_curl_prometheus_sample *sample = &result->samples[j];
+			/* NaN and infinite values (e.g. empty summaries) can not be compared */
+			if (!isfinite(sample->value)) {
+				not_finite++;
+				continue;
+			}
+
+			mp_perfdata pd_sample = perfdata_init();
+			pd_sample.label = sample->label;
+			pd_sample.value = prometheus_pd_value(sample->value);
+			pd_sample = mp_pd_set_thresholds(pd_sample, selector->thresholds);
+
+			mp_state_enum sample_state = mp_get_pd_status(pd_sample);
+			if (sample_state != STATE_OK) {
+				violations++;
+			}
+			state = max_state_alt(state, sample_state);
+			mp_add_perfdata_to_subcheck(&sc_metric, pd_sample);
+		}
+
+		if (result->samples_count == 1 && not_finite == 0) {
+			xasprintf(&sc_metric.output, "%s is %g", result->samples[0].series,
+					  result->samples[0].value);
+		} else {
+			xasprintf(&sc_metric.output, _("%s: %zu series"), selector->selector,
+					  result->samples_count);
+			if (violations > 0) {
+				xasprintf(&sc_metric.output, _("%s, %zu outside the thresholds"), sc_metric.output,
+						  violations);
+			}
+			if (not_finite > 0) {
+				xasprintf(&sc_metric.output, _("%s, %zu not a finite number"), sc_metric.output,
+						  not_finite);
+			}
+		}
+		sc_metric = mp_set_subcheck_state(sc_metric, state);
+		mp_add_subcheck_to_subcheck(sc_result, sc_metric);
+	}
+}
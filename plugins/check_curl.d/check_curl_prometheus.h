@@ -0,0 +1,112 @@
+#pragma once
+/* Streaming evaluation of Prometheus text format bodies of check_curl, see --prometheus */
+
+#include "../common.h"
+#include "../../lib/output.h"
+#include "../../lib/thresholds.h"
+#include "regex.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+enum {
+	/* longer lines are skipped, they do not fit into the buffer for lines split by chunks */
+	CHECK_CURL_PROMETHEUS_MAX_LINE = 65536,
+	/* series with more labels are skipped if they are selected */
+	CHECK_CURL_PROMETHEUS_MAX_LABELS = 64,
+};
+
+typedef enum {
+	PROMETHEUS_MATCH_EQUAL,
+	PROMETHEUS_MATCH_NOT_EQUAL,
+	PROMETHEUS_MATCH_REGEX,
+	PROMETHEUS_MATCH_NOT_REGEX,
+} check_curl_prometheus_match_type;
+
+/* one label matcher of a selector, e.g. code=~"5.." */
+typedef struct {
+	char *label;
+	size_t label_length;
+	check_curl_prometheus_match_type type;
+	char *value;
+	/* anchored like in PromQL, only for =~ and !~ */
+	regex_t regex;
+} check_curl_prometheus_matcher;
+
+typedef struct {
+	/* the selector as given, e.g. http_requests_total{method="GET",code=~"5.."} */
+	char *selector;
+	char *name;
+	size_t name_length;
+	check_curl_prometheus_matcher *matchers;
+	size_t matchers_count;
+
+	mp_thresholds thresholds;
+} check_curl_prometheus_selector;
+
+typedef struct {
+	int errorcode;
+	const char *error;
+	check_curl_prometheus_selector selector;
+} check_curl_prometheus_selector_wrapper;
+
+/*
+ * Parses a selector: a metric name, optionally followed by label matchers in braces
+ * with the operators =, !=, =~ and !~ like in PromQL
+ */
+check_curl_prometheus_selector_wrapper
+check_curl_prometheus_parse_selector(const char *selector);
+
+/* a sample of a selected series */
+typedef struct {
+	/* name and labels as they appear in the body */
+	char *series;
+	/* name and labels joined with '_' and without special characters, for the perfdata */
+	char *label;
+	double value;
+} check_curl_prometheus_sample;
+
+typedef struct {
+	check_curl_prometheus_sample *samples;
+	size_t samples_count;
+	size_t samples_size;
+} check_curl_prometheus_result;
+
+/*
+ * Line parser which is fed the body in chunks of any size. Lines are parsed where they
+ * are in the chunk, only a line which is split between two chunks is copied. Lines of
+ * metrics nobody asked for are skipped after comparing the name.
+ */
+typedef struct {
+	const check_curl_prometheus_selector *selectors;
+	size_t selectors_count;
+	check_curl_prometheus_result *results;
+
+	/* the beginning of a line which continues in the next chunk */
+	char *partial_line;
+	size_t partial_line_length;
+	bool partial_line_overflow;
+
+	size_t lines;
+	size_t invalid_lines;
+} check_curl_prometheus_parser;
+
+check_curl_prometheus_parser *
+check_curl_prometheus_parser_new(const check_curl_prometheus_selector *selectors,
+								 size_t selectors_count);
+
+void check_curl_prometheus_parser_feed(check_curl_prometheus_parser *parser, const char *data,
+									   size_t length);
+
+/*
+ * Ends the body, the last line does not need a newline
+ */
+void check_curl_prometheus_parser_finish(check_curl_prometheus_parser *parser);
+
+void check_curl_prometheus_parser_free(check_curl_prometheus_parser *parser);
+
+/*
+ * Adds one subcheck per selector to sc_result, every selected sample becomes perfdata
+ * and is compared with the thresholds of the selector
+ */
+void check_curl_prometheus_evaluate(const check_curl_prometheus_parser *parser,
+									mp_subcheck *sc_result);
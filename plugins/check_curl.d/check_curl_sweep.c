@@ -0,0 +1,327 @@
+/*****************************************************************************
+ *
+ * Certificate expiry sweep for check_curl
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Checking the certificates of thousands of servers with one check_curl
+ * process per server spends most of the time starting processes and
+ * waiting for one handshake after another. With --cert-sweep a single
+ * process connects to all servers of a list with a curl multi handle,
+ * stops every transfer right after the TLS handshake (CURLOPT_CONNECT_ONLY)
+ * and checks the certificates the handshakes delivered.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_curl_sweep.h"
+#include "./check_curl_helpers.h"
+#include "../utils.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern int verbose;
+extern bool is_openssl_callback;
+
+check_curl_sweep_target_wrapper check_curl_sweep_parse_target(const char *line) {
+	check_curl_sweep_target_wrapper result = {
+		.errorcode = ERROR,
+		.target =
+			{
+				.host = NULL,
+				.port = HTTPS_PORT,
+			},
+	};
+
+	const char *host = line;
+	size_t host_length = 0;
+	const char *port = NULL;
+	if (line[0] == '[') {
+		const char *end = strchr(line, ']');
+		if (end == NULL || end == line + 1) {
+			return result;
+		}
+		host = line + 1;
+		host_length = (size_t)(end - host);
+		if (end[1] == ':') {
+			port = end + 2;
+		} else if (end[1] != '\0') {
+			return result;
+		}
+	} else {
+		const char *colon = strchr(line, ':');
+		/* an IPv6 address without brackets has no port */
+		if (colon != NULL && strchr(colon + 1, ':') == NULL) {
+			host_length = (size_t)(colon - line);
+			port = colon + 1;
+		} else {
+			host_length = strlen(line);
+		}
+	}
+
+	if (host_length == 0 || strcspn(host, " \t/") < host_length) {
+		return result;
+	}
+
+	if (port != NULL) {
+		long port_number = strtol(port, NULL, 10);
+		if (port[0] == '\0' || strspn(port, "0123456789") != strlen(port) || port_number < 1 ||
+			port_number > MAX_PORT) {
+			return result;
+		}
+		result.target.port = (unsigned short)port_number;
+	}
+
+	result.target.host = strndup(host, host_length);
+	result.errorcode = OK;
+	return result;
+}
+
+void check_curl_sweep_read_targets(const char *path, check_curl_sweep_target **targets,
+								   size_t targets_count[static 1]) {
+	FILE *list_file = fopen(path, "r");
+	if (list_file == NULL) {
+		usage2(_("file does not exist or is not readable"), path);
+	}
+
+	char line[MAX_INPUT_BUFFER];
+	while (fgets(line, sizeof(line), list_file) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		char *entry = line;
+		while (isspace((unsigned char)*entry)) {
+			entry++;
+		}
+		if (*entry == '\0' || *entry == '#') {
+			continue;
+		}
+		for (char *end = entry + strlen(entry); end > entry && isspace((unsigned char)end[-1]);
+			 end--) {
+			end[-1] = '\0';
+		}
+
+		check_curl_sweep_target_wrapper parsed = check_curl_sweep_parse_target(entry);
+		if (parsed.errorcode != OK) {
+			usage2(_("Invalid server in the sweep list, expecting host[:port]"), entry);
+		}
+
+		*targets = realloc(*targets, sizeof(check_curl_sweep_target) * (*targets_count + 1));
+		if (*targets == NULL) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+		}
+		(*targets)[(*targets_count)++] = parsed.target;
+	}
+
+	fclose(list_file);
+}
+
+typedef struct {
+	CURL *curl;
+	char *url;
+	char error_buffer[CURL_ERROR_SIZE];
+} sweep_transfer;
+
+static void sweep_start(CURLM *multi, sweep_transfer *transfer,
+						const check_curl_sweep_target *target,
+						const check_curl_static_curl_config *curl_config) {
+	if (strchr(target->host, ':') != NULL) {
+		xasprintf(&transfer->url, "https://[%s]:%u/", target->host, target->port);
+	} else {
+		xasprintf(&transfer->url, "https://%s:%u/", target->host, target->port);
+	}
+
+	transfer->curl = curl_easy_init();
+	if (transfer->curl == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_easy_init failed\n");
+	}
+	CURL *curl = transfer->curl;
+
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_URL, transfer->url),
+								   "CURLOPT_URL");
+	/* the transfer is done once the connection and the handshake are */
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L),
+								   "CURLOPT_CONNECT_ONLY");
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_CERTINFO, 1L),
+								   "CURLOPT_CERTINFO");
+	/* a resumed session does not provide the certificate of the server */
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L),
+								   "CURLOPT_SSL_SESSIONID_CACHE");
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L),
+								   "CURLOPT_NOSIGNAL");
+	handle_curl_option_return_code(
+		curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, curl_config->socket_timeout),
+		"CURLOPT_CONNECTTIMEOUT");
+	handle_curl_option_return_code(
+		curl_easy_setopt(curl, CURLOPT_TIMEOUT, curl_config->socket_timeout), "CURLOPT_TIMEOUT");
+	handle_curl_option_return_code(
+		curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->error_buffer),
+		"CURLOPT_ERRORBUFFER");
+	handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer),
+								   "CURLOPT_PRIVATE");
+	handle_curl_option_return_code(
+		curl_easy_setopt(curl, CURLOPT_SSLVERSION, curl_config->ssl_version),
+		"CURLOPT_SSLVERSION");
+
+	if (curl_config->verify_peer_and_host) {
+		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L),
+									   "CURLOPT_SSL_VERIFYPEER");
+		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L),
+									   "CURLOPT_SSL_VERIFYHOST");
+	} else {
+		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L),
+									   "CURLOPT_SSL_VERIFYPEER");
+		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L),
+									   "CURLOPT_SSL_VERIFYHOST");
+	}
+	if (curl_config->ca_cert != NULL) {
+		handle_curl_option_return_code(curl_easy_setopt(curl, CURLOPT_CAINFO, curl_config->ca_cert),
+									   "CURLOPT_CAINFO");
+	}
+
+	if (curl_config->sin_family == AF_INET) {
+		handle_curl_option_return_code(
+			curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4), "CURLOPT_IPRESOLVE");
+	} else if (curl_config->sin_family == AF_INET6) {
+		handle_curl_option_return_code(
+			curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V6), "CURLOPT_IPRESOLVE");
+	}
+
+	if (verbose >= 2) {
+		printf("* sweep: connecting to %s\n", transfer->url);
+	}
+
+	if (curl_multi_add_handle(multi, curl) != CURLM_OK) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_multi_add_handle failed\n");
+	}
+}
+
+static mp_subcheck sweep_evaluate(const check_curl_config *config,
+								  const check_curl_sweep_target *target,
+								  sweep_transfer *transfer, CURLcode res) {
+	mp_subcheck sc_target;
+	if (res != CURLE_OK) {
+		sc_target = mp_subcheck_init();
+		xasprintf(&sc_target.output, "%s", transfer->error_buffer[0] != '\0'
+											   ? transfer->error_buffer
+											   : curl_easy_strerror(res));
+		sc_target = mp_set_subcheck_state(sc_target, STATE_CRITICAL);
+	} else {
+		/* the certificates come from CURLINFO_CERTINFO, not from the verify callback */
+		is_openssl_callback = false;
+		sc_target = check_curl_certificate_checks(transfer->curl, NULL, config->days_till_exp_warn,
+												  config->days_till_exp_crit,
+												  config->curl_config.session_cache_dir);
+	}
+
+	char *output = sc_target.output;
+	if (strchr(target->host, ':') != NULL) {
+		xasprintf(&sc_target.output, "[%s]:%u - %s", target->host, target->port, output);
+	} else {
+		xasprintf(&sc_target.output, "%s:%u - %s", target->host, target->port, output);
+	}
+	return sc_target;
+}
+
+mp_check check_curl_certificate_sweep(check_curl_config config) {
+	CURLM *multi = curl_multi_init();
+	if (multi == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - curl_multi_init failed\n");
+	}
+
+	size_t count = config.sweep_targets_count;
+	sweep_transfer *transfers = calloc(count, sizeof(sweep_transfer));
+	mp_subcheck *results = calloc(count, sizeof(mp_subcheck));
+	if (transfers == NULL || results == NULL) {
+		die(STATE_UNKNOWN, "HTTP UNKNOWN - Unable to allocate memory\n");
+	}
+
+	/* a window of transfers moves over the list, so open sockets and handles stay bounded */
+	size_t next = 0;
+	size_t running = 0;
+	while (next < count && running < config.sweep_concurrency) {
+		sweep_start(multi, &transfers[next], &config.sweep_targets[next], &config.curl_config);
+		next++;
+		running++;
+	}
+
+	while (running > 0) {
+		int still_running = 0;
+		CURLMcode multi_result = curl_multi_perform(multi, &still_running);
+		if (multi_result == CURLM_OK && still_running) {
+#if LIBCURL_VERSION_NUM >= MAKE_LIBCURL_VERSION(7, 66, 0)
+			multi_result = curl_multi_poll(multi, NULL, 0, 1000, NULL);
+#else
+			multi_result = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+#endif
+		}
+
+		if (multi_result != CURLM_OK) {
+			die(STATE_UNKNOWN, "HTTP UNKNOWN - curl multi interface failed: %s\n",
+				curl_multi_strerror(multi_result));
+		}
+
+		CURLMsg *message;
+		int messages_left;
+		while ((message = curl_multi_info_read(multi, &messages_left)) != NULL) {
+			if (message->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			sweep_transfer *transfer = NULL;
+			CURL *curl = message->easy_handle;
+			CURLcode res = message->data.result;
+			curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&transfer);
+			size_t index = (size_t)(transfer - transfers);
+
+			if (verbose >= 2) {
+				printf("* sweep: %s returned: %s\n", transfer->url, curl_easy_strerror(res));
+			}
+
+			results[index] = sweep_evaluate(&config, &config.sweep_targets[index], transfer, res);
+
+			/* closes the connection, which CURLOPT_CONNECT_ONLY keeps open */
+			curl_multi_remove_handle(multi, curl);
+			curl_easy_cleanup(curl);
+			free(transfer->url);
+			running--;
+
+			if (next < count) {
+				sweep_start(multi, &transfers[next], &config.sweep_targets[next],
+							&config.curl_config);
+				next++;
+				running++;
+			}
+		}
+	}
+
+	/* subchecks are prepended, add them backwards to keep the order of the list */
+	mp_check overall = mp_check_init();
+	for (size_t i = count; i > 0; i--) {
+		mp_add_subcheck_to_check(&overall, results[i - 1]);
+	}
+
+	free(results);
+	free(transfers);
+	curl_multi_cleanup(multi);
+
+	return overall;
+}
@@ -0,0 +1,34 @@
+#pragma once
+/* Certificate expiry sweep of check_curl over many servers, see --cert-sweep */
+
+#include "./config.h"
+#include "../../lib/output.h"
+#include <stddef.h>
+
+enum {
+	DEFAULT_SWEEP_CONCURRENCY = 64,
+};
+
+typedef struct {
+	int errorcode;
+	check_curl_sweep_target target;
+} check_curl_sweep_target_wrapper;
+
+/*
+ * Parses host[:port] or [IPv6 address][:port], the port defaults to 443
+ */
+check_curl_sweep_target_wrapper check_curl_sweep_parse_target(const char *line);
+
+/*
+ * Reads the servers of the sweep from a file, one per line. Empty lines and lines
+ * starting with '#' are ignored
+ */
+void check_curl_sweep_read_targets(const char *path, check_curl_sweep_target **targets,
+								   size_t targets_count[static 1]);
+
+/*
+ * Connects to every server, does only the TLS handshake and checks the expiry of its
+ * certificate against -C. At most config.sweep_concurrency handshakes are in flight at a
+ * time. Returns one subcheck per server, in the order of the list.
+ */
+mp_check check_curl_certificate_sweep(check_curl_config config);
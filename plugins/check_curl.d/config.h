@@ -10,6 +10,8 @@
 #include "curl/curl.h"
 #include "perfdata.h"
 #include "regex.h"
+#include "check_curl_json.h"
+#include "check_curl_prometheus.h"
 
 enum {
 	MAX_RE_SIZE = 1024,
@@ -30,6 +32,18 @@ enum {
 	STICKY_PORT = 2
 };
 
+/* phases of a transfer which can have their own thresholds, see --warning-<phase> */
+typedef enum {
+	CURL_PHASE_NAMELOOKUP,
+	CURL_PHASE_CONNECT,
+	CURL_PHASE_TLS,
+	CURL_PHASE_HEADERS,
+	CURL_PHASE_FIRSTBYTE,
+	CURL_PHASE_TRANSFER,
+	CURL_PHASE_REDIRECT,
+	CURL_PHASE_COUNT
+} check_curl_phase;
+
 #define HTTP_EXPECT         "HTTP/"
 #define DEFAULT_BUFFER_SIZE 2048
 #define DEFAULT_SERVER_URL  "/"
@@ -57,6 +71,12 @@ typedef struct {
 
 check_curl_working_state check_curl_working_state_init();
 
+/* a server of the certificate sweep, see --cert-sweep */
+typedef struct {
+	char *host;
+	unsigned short port;
+} check_curl_sweep_target;
+
 typedef struct {
 	bool automatic_decompression;
 	bool haproxy_protocol;
@@ -77,11 +97,30 @@ typedef struct {
 	char user_auth[MAX_INPUT_BUFFER];
 	char *http_content_type;
 	char *cookie_jar_file;
+	/* share handle for DNS, TLS sessions and connections in multi URL mode, keeps connections
+	 * open if set */
+	CURLSH *share;
+	/* directory of the persistent DNS and TLS session cache, NULL if disabled */
+	char *session_cache_dir;
+	long dns_cache_ttl;
+	long tls_session_ttl;
 } check_curl_static_curl_config;
 
 typedef struct {
 	check_curl_working_state initial_config;
 
+	// targets of the multi URL mode, checked concurrently if targets_count > 0
+	check_curl_working_state *targets;
+	size_t targets_count;
+	// send the requests to one server as concurrent streams over one connection (--multi-path)
+	bool multiplex;
+
+	// servers of the certificate sweep, only their TLS handshakes are done (--cert-sweep)
+	check_curl_sweep_target *sweep_targets;
+	size_t sweep_targets_count;
+	// number of handshakes in flight at the same time
+	size_t sweep_concurrency;
+
 	check_curl_static_curl_config curl_config;
 	long max_depth;
 	int followmethod;
@@ -97,11 +136,27 @@ typedef struct {
 
 	mp_state_enum state_regex;
 	bool invert_regex;
+	// the regex was compiled without REG_NEWLINE (--linespan)
+	bool regex_linespan;
+
+	// stop the transfer as soon as the body expectations are met
+	bool stop_on_match;
+	// stop the transfer after this many bytes of the body, 0 is unlimited
+	size_t max_body_size;
+	// --json-expect and --json-value, evaluated while the body is received
+	check_curl_json_query *json_queries;
+	size_t json_queries_count;
+	// --prometheus, series of a metrics endpoint in the text format
+	check_curl_prometheus_selector *prometheus_selectors;
+	size_t prometheus_selectors_count;
 	bool check_cert;
 	bool continue_after_check_cert;
 	int days_till_exp_warn;
 	int days_till_exp_crit;
 	mp_thresholds thlds;
+	// thresholds for the single phases of the transfer, every phase with a threshold is
+	// evaluated in its own subcheck
+	mp_thresholds phase_thlds[CURL_PHASE_COUNT];
 	mp_range page_length_limits;
 	bool page_length_limits_is_set;
 	struct {
@@ -34,11 +34,11 @@ const char *copyright = "2000-2024";
 const char *email = "devel@monitoring-plugins.org";
 
 #include "common.h"
-#include "popen.h"
 #include "utils.h"
 #include "netutils.h"
 #include "states.h"
 #include "check_hpjd.d/config.h"
+#include "check_snmp.d/check_snmp_helpers.h"
 
 #define DEFAULT_COMMUNITY "public"
 
@@ -58,6 +58,41 @@ const char *email = "devel@monitoring-plugins.org";
 #define ONLINE  0
 #define OFFLINE 1
 
+// the status OIDs in the order of the GET request
+enum {
+	LINE_STATUS,
+	PAPER_STATUS,
+	INTERVENTION_REQUIRED,
+	PERIPHERAL_ERROR,
+	PAPER_JAM,
+	PAPER_OUT,
+	TONER_LOW,
+	PAGE_PUNT,
+	MEMORY_OUT,
+	DOOR_OPEN,
+	PAPER_OUTPUT,
+	STATUS_DISPLAY,
+	NUMBER_OF_STATUS_OIDS
+};
+
+static const char *status_oids[NUMBER_OF_STATUS_OIDS] = {
+	[LINE_STATUS] = HPJD_LINE_STATUS ".0",
+	[PAPER_STATUS] = HPJD_PAPER_STATUS ".0",
+	[INTERVENTION_REQUIRED] = HPJD_INTERVENTION_REQUIRED ".0",
+	[PERIPHERAL_ERROR] = HPJD_GD_PERIPHERAL_ERROR ".0",
+	[PAPER_JAM] = HPJD_GD_PAPER_JAM ".0",
+	[PAPER_OUT] = HPJD_GD_PAPER_OUT ".0",
+	[TONER_LOW] = HPJD_GD_TONER_LOW ".0",
+	[PAGE_PUNT] = HPJD_GD_PAGE_PUNT ".0",
+	[MEMORY_OUT] = HPJD_GD_MEMORY_OUT ".0",
+	[DOOR_OPEN] = HPJD_GD_DOOR_OPEN ".0",
+	[PAPER_OUTPUT] = HPJD_GD_PAPER_OUTPUT ".0",
+	[STATUS_DISPLAY] = HPJD_GD_STATUS_DISPLAY ".0",
+};
+
+// used by the SNMP helpers of check_snmp
+int verbose = 0;
+
 typedef struct {
 	int errorcode;
 	check_hpjd_config config;
@@ -66,6 +101,13 @@ static check_hpjd_config_wrapper process_arguments(int /*argc*/, char ** /*argv*
 static void print_help(void);
 void print_usage(void);
 
+typedef struct {
+	mp_state_enum state;
+	char *output;
+} printer_status;
+static printer_status evaluate_printer(const char *host, snmp_responces response,
+									   bool check_paper_out);
+
 int main(int argc, char **argv) {
 	setlocale(LC_ALL, "");
 	bindtextdomain(PACKAGE, LOCALEDIR);
@@ -74,6 +116,10 @@ int main(int argc, char **argv) {
 	/* Parse extra opts if any */
 	argv = np_extra_opts(&argc, argv, progname);
 
+	// the OIDs are numeric, loading the MIB files would only cost time
+	setenv("MIBS", "", 1);
+	init_snmp("check_hpjd");
+
 	check_hpjd_config_wrapper tmp_config = process_arguments(argc, argv);
 
 	if (tmp_config.errorcode == ERROR) {
@@ -82,196 +128,177 @@ int main(int argc, char **argv) {
 
 	const check_hpjd_config config = tmp_config.config;
 
-	char query_string[512];
-	/* removed ' 2>1' at end of command 10/27/1999 - EG */
-	/* create the query string */
-	sprintf(query_string, "%s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0 %s.0",
-			HPJD_LINE_STATUS, HPJD_PAPER_STATUS, HPJD_INTERVENTION_REQUIRED,
-			HPJD_GD_PERIPHERAL_ERROR, HPJD_GD_PAPER_JAM, HPJD_GD_PAPER_OUT, HPJD_GD_TONER_LOW,
-			HPJD_GD_PAGE_PUNT, HPJD_GD_MEMORY_OUT, HPJD_GD_DOOR_OPEN, HPJD_GD_PAPER_OUTPUT,
-			HPJD_GD_STATUS_DISPLAY);
-
-	/* get the command to run */
-	char command_line[1024];
-	sprintf(command_line, "%s -OQa -m : -v 1 -c %s %s:%u %s", PATH_TO_SNMPGET, config.community,
-			config.address, config.port, query_string);
-
-	/* run the command */
-	child_process = spopen(command_line);
-	if (child_process == NULL) {
-		printf(_("Could not open pipe: %s\n"), command_line);
-		return STATE_UNKNOWN;
+	if (signal(SIGALRM, socket_timeout_alarm_handler) == SIG_ERR) {
+		usage4(_("Cannot catch SIGALRM"));
 	}
 
-	child_stderr = fdopen(child_stderr_array[fileno(child_process)], "r");
-	if (child_stderr == NULL) {
-		printf(_("Could not open stderr for %s\n"), command_line);
-	}
+	check_snmp_config_snmp_parameters parameters = check_snmp_config_init().snmp_params;
+	parameters.snmp_session.version = SNMP_VERSION_1;
+	parameters.snmp_session.community = (unsigned char *)config.community;
+	parameters.snmp_session.community_len = strlen(config.community);
 
-	mp_state_enum result = STATE_OK;
+	check_snmp_test_unit test_units[NUMBER_OF_STATUS_OIDS];
+	for (size_t i = 0; i < NUMBER_OF_STATUS_OIDS; i++) {
+		test_units[i] = check_snmp_test_unit_init();
+		test_units[i].oid = (char *)status_oids[i];
+	}
+	parameters.test_units = test_units;
+	parameters.num_of_test_units = NUMBER_OF_STATUS_OIDS;
 
-	int line_status = ONLINE;
-	int paper_status = 0;
-	int intervention_required = 0;
-	int peripheral_error = 0;
-	int paper_jam = 0;
-	int paper_out = 0;
-	int toner_low = 0;
-	int page_punt = 0;
-	int memory_out = 0;
-	int door_open = 0;
-	int paper_output = 0;
-	char display_message[MAX_INPUT_BUFFER];
-
-	char input_buffer[MAX_INPUT_BUFFER];
-	char *errmsg = malloc(MAX_INPUT_BUFFER);
-	int line = 0;
-
-	while (fgets(input_buffer, MAX_INPUT_BUFFER - 1, child_process)) {
-		/* strip the newline character from the end of the input */
-		if (input_buffer[strlen(input_buffer) - 1] == '\n') {
-			input_buffer[strlen(input_buffer) - 1] = 0;
-		}
+	char **peernames = calloc(config.number_of_hosts, sizeof(char *));
+	if (peernames == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	for (size_t i = 0; i < config.number_of_hosts; i++) {
+		xasprintf(&peernames[i], "%s:%u", config.hosts[i], config.port);
+	}
 
-		line++;
+	// one GET for all status OIDs per printer, all printers at the same time
+	snmp_responces *responses = do_snmp_queries(parameters, peernames, config.number_of_hosts,
+												DEFAULT_MAX_REQUESTS_IN_FLIGHT);
 
-		char *temp_buffer = strtok(input_buffer, "=");
-		temp_buffer = strtok(NULL, "=");
+	if (config.number_of_hosts == 1) {
+		printer_status status =
+			evaluate_printer(config.hosts[0], responses[0], config.check_paper_out);
+		printf("%s\n", status.output);
+		exit(status.state);
+	}
 
-		if (temp_buffer == NULL && line < 13) {
-			result = STATE_UNKNOWN;
-			strcpy(errmsg, input_buffer);
-		} else {
-			switch (line) {
-			case 1: /* 1st line should contain the line status */
-				line_status = atoi(temp_buffer);
-				break;
-			case 2: /* 2nd line should contain the paper status */
-				paper_status = atoi(temp_buffer);
-				break;
-			case 3: /* 3rd line should be intervention required */
-				intervention_required = atoi(temp_buffer);
-				break;
-			case 4: /* 4th line should be peripheral error */
-				peripheral_error = atoi(temp_buffer);
-				break;
-			case 5: /* 5th line should contain the paper jam status */
-				paper_jam = atoi(temp_buffer);
-				break;
-			case 6: /* 6th line should contain the paper out status */
-				paper_out = atoi(temp_buffer);
-				break;
-			case 7: /* 7th line should contain the toner low status */
-				toner_low = atoi(temp_buffer);
-				break;
-			case 8: /* did data come too slow for engine */
-				page_punt = atoi(temp_buffer);
-				break;
-			case 9: /* did we run out of memory */
-				memory_out = atoi(temp_buffer);
-				break;
-			case 10: /* is there a door open */
-				door_open = atoi(temp_buffer);
-				break;
-			case 11: /* is output tray full */
-				paper_output = atoi(temp_buffer);
-				break;
-			case 12: /* display panel message */
-				strcpy(display_message, temp_buffer + 1);
-				break;
-			default: /* fold multiline message */
-				strncat(display_message, input_buffer,
-						sizeof(display_message) - strlen(display_message) - 1);
-			}
+	mp_state_enum result = STATE_OK;
+	size_t number_of_problems = 0;
+	printer_status *statuses = calloc(config.number_of_hosts, sizeof(printer_status));
+	if (statuses == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	for (size_t i = 0; i < config.number_of_hosts; i++) {
+		statuses[i] = evaluate_printer(config.hosts[i], responses[i], config.check_paper_out);
+		result = max_state(result, statuses[i].state);
+		if (statuses[i].state != STATE_OK) {
+			number_of_problems++;
 		}
+	}
 
-		/* break out of the read loop if we encounter an error */
-		if (result != STATE_OK) {
-			break;
-		}
+	printf(_("%zu printers checked, %zu of them not ok\n"), config.number_of_hosts,
+		   number_of_problems);
+	for (size_t i = 0; i < config.number_of_hosts; i++) {
+		printf("%s: %s\n", config.hosts[i], statuses[i].output);
 	}
 
-	/* WARNING if output found on stderr */
-	if (fgets(input_buffer, MAX_INPUT_BUFFER - 1, child_stderr)) {
-		result = max_state(result, STATE_WARNING);
-		/* remove CRLF */
-		if (input_buffer[strlen(input_buffer) - 1] == '\n') {
-			input_buffer[strlen(input_buffer) - 1] = 0;
-		}
-		sprintf(errmsg, "%s", input_buffer);
+	exit(result);
+}
+
+static long integer_value(const response_value *value) {
+	switch (value->type) {
+	case ASN_INTEGER:
+		return (long)value->value.intVal;
+	case ASN_GAUGE: // same as ASN_UNSIGNED
+	case ASN_COUNTER:
+	case ASN_TIMETICKS:
+	case ASN_UINTEGER:
+		return (long)value->value.uIntVal;
+	case ASN_OCTET_STR:
+		return atol(value->string_response);
+	default:
+		return 0;
 	}
+}
 
-	/* close stderr */
-	(void)fclose(child_stderr);
+/*
+ * Turns the status OIDs of a printer into the state and the line of the plugin output
+ */
+static printer_status evaluate_printer(const char *host, snmp_responces response,
+									   bool check_paper_out) {
+	printer_status status = {
+		.state = STATE_OK,
+	};
 
-	/* close the pipe */
-	if (spclose(child_process)) {
-		result = max_state(result, STATE_WARNING);
+	if (response.errorcode != OK) {
+		if (response.error_state == STATE_CRITICAL) {
+			// the printer could not be reached
+			status.state = STATE_CRITICAL;
+			xasprintf(&status.output, _("Timeout: No Response from %s"), host);
+		} else {
+			status.state = STATE_UNKNOWN;
+			status.output = response.error_message;
+		}
+		return status;
 	}
 
-	/* if there wasn't any output, display an error */
-	if (line == 0) {
-		/* might not be the problem, but most likely is. */
-		result = STATE_UNKNOWN;
-		xasprintf(&errmsg, "%s : Timeout from host %s\n", errmsg, config.address);
+	for (size_t i = 0; i < NUMBER_OF_STATUS_OIDS; i++) {
+		unsigned char type = response.response_values[i].type;
+		if (response.response_values[i].oid_length == 0 || type == SNMP_NOSUCHOBJECT ||
+			type == SNMP_NOSUCHINSTANCE || type == SNMP_ENDOFMIBVIEW) {
+			status.state = STATE_UNKNOWN;
+			xasprintf(&status.output, _("No value for %s from %s"), status_oids[i], host);
+			return status;
+		}
 	}
 
-	/* if we had no read errors, check the printer status results... */
-	if (result == STATE_OK) {
+	const response_value *values = response.response_values;
+	char *display_message = "";
+	if (values[STATUS_DISPLAY].type == ASN_OCTET_STR) {
+		display_message = values[STATUS_DISPLAY].string_response;
+	}
 
-		if (paper_jam) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Paper Jam"));
-		} else if (paper_out) {
-			if (config.check_paper_out) {
-				result = STATE_WARNING;
-			}
-			strcpy(errmsg, _("Out of Paper"));
-		} else if (line_status == OFFLINE) {
-			if (strcmp(errmsg, "POWERSAVE ON") != 0) {
-				result = STATE_WARNING;
-				strcpy(errmsg, _("Printer Offline"));
-			}
-		} else if (peripheral_error) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Peripheral Error"));
-		} else if (intervention_required) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Intervention Required"));
-		} else if (toner_low) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Toner Low"));
-		} else if (memory_out) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Insufficient Memory"));
-		} else if (door_open) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("A Door is Open"));
-		} else if (paper_output) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Output Tray is Full"));
-		} else if (page_punt) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Data too Slow for Engine"));
-		} else if (paper_status) {
-			result = STATE_WARNING;
-			strcpy(errmsg, _("Unknown Paper Error"));
+	const char *errmsg = NULL;
+	if (integer_value(&values[PAPER_JAM])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Paper Jam");
+	} else if (integer_value(&values[PAPER_OUT])) {
+		if (check_paper_out) {
+			status.state = STATE_WARNING;
 		}
+		errmsg = _("Out of Paper");
+	} else if (integer_value(&values[LINE_STATUS]) == OFFLINE) {
+		if (strcmp(display_message, "POWERSAVE ON") != 0) {
+			status.state = STATE_WARNING;
+			errmsg = _("Printer Offline");
+		}
+	} else if (integer_value(&values[PERIPHERAL_ERROR])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Peripheral Error");
+	} else if (integer_value(&values[INTERVENTION_REQUIRED])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Intervention Required");
+	} else if (integer_value(&values[TONER_LOW])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Toner Low");
+	} else if (integer_value(&values[MEMORY_OUT])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Insufficient Memory");
+	} else if (integer_value(&values[DOOR_OPEN])) {
+		status.state = STATE_WARNING;
+		errmsg = _("A Door is Open");
+	} else if (integer_value(&values[PAPER_OUTPUT])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Output Tray is Full");
+	} else if (integer_value(&values[PAGE_PUNT])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Data too Slow for Engine");
+	} else if (integer_value(&values[PAPER_STATUS])) {
+		status.state = STATE_WARNING;
+		errmsg = _("Unknown Paper Error");
 	}
 
-	if (result == STATE_OK) {
-		printf(_("Printer ok - (%s)\n"), display_message);
-	} else if (result == STATE_UNKNOWN) {
-		printf("%s\n", errmsg);
-		/* if printer could not be reached, escalate to critical */
-		if (strstr(errmsg, "Timeout")) {
-			result = STATE_CRITICAL;
-		}
-	} else if (result == STATE_WARNING) {
-		printf("%s (%s)\n", errmsg, display_message);
+	// snmpget used to print the display message in quotes
+	if (status.state == STATE_OK) {
+		xasprintf(&status.output, _("Printer ok - (\"%s\")"), display_message);
+	} else {
+		xasprintf(&status.output, "%s (\"%s\")", errmsg, display_message);
 	}
+	return status;
+}
 
-	exit(result);
+static void add_host(check_hpjd_config *config, char *host) {
+	if (!is_host(host)) {
+		usage2(_("Invalid hostname/address"), host);
+	}
+
+	config->hosts = realloc(config->hosts, (config->number_of_hosts + 1) * sizeof(char *));
+	if (config->hosts == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	config->hosts[config->number_of_hosts++] = host;
 }
 
 /* process command-line arguments */
@@ -304,11 +331,9 @@ check_hpjd_config_wrapper process_arguments(int argc, char **argv) {
 		}
 
 		switch (option_index) {
-		case 'H': /* hostname */
-			if (is_host(optarg)) {
-				result.config.address = strscpy(result.config.address, optarg);
-			} else {
-				usage2(_("Invalid hostname/address"), optarg);
+		case 'H': /* hostname(s) */
+			for (char *host = strtok(optarg, ","); host != NULL; host = strtok(NULL, ",")) {
+				add_host(&result.config, host);
 			}
 			break;
 		case 'C': /* community */
@@ -336,12 +361,11 @@ check_hpjd_config_wrapper process_arguments(int argc, char **argv) {
 	}
 
 	int c = optind;
-	if (result.config.address == NULL) {
-		if (is_host(argv[c])) {
-			result.config.address = argv[c++];
-		} else {
-			usage2(_("Invalid hostname/address"), argv[c]);
+	if (result.config.number_of_hosts == 0) {
+		if (argv[c] == NULL) {
+			usage4(_("No hostname/address given"));
 		}
+		add_host(&result.config, argv[c++]);
 	}
 
 	if (result.config.community == NULL) {
@@ -362,7 +386,8 @@ void print_help(void) {
 	printf(COPYRIGHT, copyright, email);
 
 	printf("%s\n", _("This plugin tests the STATUS of an HP printer with a JetDirect card."));
-	printf("%s\n", _("Net-snmp must be installed on the computer running the plugin."));
+	printf("%s\n", _("Several printers may be given as a comma separated list, they are queried"));
+	printf("%s\n", _("concurrently and get one line of output each."));
 
 	printf("\n\n");
 
@@ -387,5 +412,5 @@ void print_help(void) {
 
 void print_usage(void) {
 	printf("%s\n", _("Usage:"));
-	printf("%s -H host [-C community] [-p port] [-D]\n", progname);
+	printf("%s -H host[,host...] [-C community] [-p port] [-D]\n", progname);
 }
@@ -7,7 +7,9 @@
 #define DEFAULT_PORT "161"
 
 typedef struct {
-	char *address;
+	// the printers, they are queried concurrently if there are several
+	char **hosts;
+	size_t number_of_hosts;
 	char *community;
 	unsigned int port;
 	bool check_paper_out;
@@ -16,7 +18,8 @@ typedef struct {
 
 check_hpjd_config check_hpjd_config_init() {
 	check_hpjd_config tmp = {
-		.address = NULL,
+		.hosts = NULL,
+		.number_of_hosts = 0,
 		.community = NULL,
 		.port = (unsigned int)atoi(DEFAULT_PORT),
 		.check_paper_out = true,
@@ -43,6 +43,7 @@ const char *email = "devel@monitoring-plugins.org";
 #include "utils.h"
 #include <ctype.h>
 #include "states.h"
+#include "picohttpparser/picohttpparser.h"
 
 #define STICKY_NONE 0
 #define STICKY_HOST 1
@@ -151,6 +152,21 @@ void print_help(void);
 void print_usage(void);
 static char *unchunk_content(const char *content);
 
+/* Framing of the response as far as it has been received, so reading can stop at the end of
+ * the message instead of waiting for the server to close the connection */
+typedef struct {
+	bool headers_done;
+	/* no usable framing, the end of the message is the end of the connection */
+	bool until_close;
+	bool chunked;
+	size_t header_length;
+	size_t content_length;
+	struct phr_chunked_decoder decoder;
+} response_reader;
+
+static bool response_complete(response_reader *reader, const char *page, size_t pagesize,
+							  size_t new_bytes);
+
 int main(int argc, char **argv) {
 	int result = STATE_UNKNOWN;
 
@@ -667,6 +683,110 @@ bool process_arguments(int argc, char **argv) {
 	return true;
 }
 
+/* Returns true if the value of a header ends with the given token, like "gzip, chunked" does
+ * with chunked. The parser strips trailing whitespace from values */
+static bool header_value_ends_with(const struct phr_header *header, const char *token) {
+	size_t token_length = strlen(token);
+	if (header->value_len < token_length) {
+		return false;
+	}
+	const char *start = header->value + header->value_len - token_length;
+	if (strncasecmp(start, token, token_length) != 0) {
+		return false;
+	}
+	return start == header->value || start[-1] == ' ' || start[-1] == ',' || start[-1] == '\t';
+}
+
+/* Called after every read with the number of bytes the read added to the page.
+ * Returns true once the complete message is in the page */
+static bool response_complete(response_reader *reader, const char *page, size_t pagesize,
+							  size_t new_bytes) {
+	if (reader->until_close) {
+		return false;
+	}
+
+	size_t new_body_bytes = new_bytes;
+	if (!reader->headers_done) {
+		int major_version;
+		int minor_version;
+		int status;
+		const char *message;
+		size_t message_length;
+		struct phr_header headers[100];
+		size_t headers_count = sizeof(headers) / sizeof(headers[0]);
+
+		int result = phr_parse_response(page, pagesize, &major_version, &minor_version, &status,
+										&message, &message_length, headers, &headers_count,
+										pagesize - new_bytes);
+		if (result == -2) {
+			return false;
+		}
+		if (result == -1 || status < 200) {
+			/* malformed, too many headers or an interim response like 100 Continue, the old
+			 * way of reading still copes with those */
+			reader->until_close = true;
+			return false;
+		}
+
+		reader->headers_done = true;
+		reader->header_length = (size_t)result;
+		if (status == 204 || status == 304 || strcmp(http_method, "HEAD") == 0) {
+			return true;
+		}
+
+		bool has_content_length = false;
+		for (size_t i = 0; i < headers_count; i++) {
+			if (headers[i].name_len == strlen("Transfer-Encoding") &&
+				strncasecmp(headers[i].name, "Transfer-Encoding", headers[i].name_len) == 0) {
+				reader->chunked = header_value_ends_with(&headers[i], "chunked");
+				if (!reader->chunked) {
+					reader->until_close = true;
+					return false;
+				}
+			} else if (headers[i].name_len == strlen("Content-Length") &&
+					   strncasecmp(headers[i].name, "Content-Length", headers[i].name_len) == 0) {
+				char value[32];
+				char *end;
+				if (headers[i].value_len == 0 || headers[i].value_len >= sizeof(value)) {
+					reader->until_close = true;
+					return false;
+				}
+				memcpy(value, headers[i].value, headers[i].value_len);
+				value[headers[i].value_len] = '\0';
+				unsigned long long content_length = strtoull(value, &end, 10);
+				if (*end != '\0' || !isdigit((unsigned char)value[0]) ||
+					(has_content_length && content_length != reader->content_length)) {
+					reader->until_close = true;
+					return false;
+				}
+				reader->content_length = (size_t)content_length;
+				has_content_length = true;
+			}
+		}
+
+		if (!reader->chunked && !has_content_length) {
+			reader->until_close = true;
+			return false;
+		}
+		new_body_bytes = pagesize - reader->header_length;
+	}
+
+	if (reader->chunked) {
+		/* the decoder works in place, so it gets a copy and the page stays as it was read.
+		 * A read is never larger than the buffer */
+		memcpy(buffer, page + pagesize - new_body_bytes, new_body_bytes);
+		size_t decoded_length = new_body_bytes;
+		ssize_t result = phr_decode_chunked(&reader->decoder, buffer, &decoded_length);
+		if (result == -1) {
+			reader->until_close = true;
+			return false;
+		}
+		return result >= 0;
+	}
+
+	return pagesize - reader->header_length >= reader->content_length;
+}
+
 /* Returns 1 if we're done processing the document body; 0 to keep going */
 static int document_headers_done(char *full_page) {
 	const char *body;
@@ -969,6 +1089,7 @@ int check_http(void) {
 	int http_status;
 	int i = 0;
 	size_t pagesize = 0;
+	size_t full_page_size = 0;
 	char *full_page;
 	char *full_page_new;
 	char *buf;
@@ -1161,34 +1282,46 @@ int check_http(void) {
 	microsec_headers = deltime(tv_temp);
 	elapsed_time_headers = (double)microsec_headers / 1.0e6;
 
-	/* fetch the page */
-	full_page = strdup("");
+	/* fetch the page, the buffer grows geometrically and the reads go straight into it */
+	full_page_size = 4 * MAX_INPUT_BUFFER;
+	if ((full_page = malloc(full_page_size)) == NULL) {
+		die(STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
+	}
+	full_page[0] = '\0';
+	response_reader reader = {0};
+	reader.decoder.consume_trailer = 1;
 	gettimeofday(&tv_temp, NULL);
-	while ((i = my_recv(buffer, MAX_INPUT_BUFFER - 1)) > 0) {
+	while ((i = my_recv(&full_page[pagesize], MAX_INPUT_BUFFER - 1)) > 0) {
 		if ((i >= 1) && (elapsed_time_firstbyte <= 0.000001)) {
 			microsec_firstbyte = deltime(tv_temp);
 			elapsed_time_firstbyte = (double)microsec_firstbyte / 1.0e6;
 		}
-		while ((pos = memchr(buffer, '\0', i))) {
+		while ((pos = memchr(&full_page[pagesize], '\0', i))) {
 			/* replace nul character with a blank */
 			*pos = ' ';
 		}
-		buffer[i] = '\0';
-
-		if ((full_page_new = realloc(full_page, pagesize + i + 1)) == NULL) {
-			die(STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
-		}
-
-		memmove(&full_page_new[pagesize], buffer, i + 1);
-
-		full_page = full_page_new;
 
 		pagesize += i;
+		full_page[pagesize] = '\0';
 
 		if (no_body && document_headers_done(full_page)) {
 			i = 0;
 			break;
 		}
+
+		if (response_complete(&reader, full_page, pagesize, (size_t)i)) {
+			/* the server may keep the connection open although we asked it to close it */
+			i = 0;
+			break;
+		}
+
+		if (full_page_size - pagesize < MAX_INPUT_BUFFER) {
+			full_page_size *= 2;
+			if ((full_page_new = realloc(full_page, full_page_size)) == NULL) {
+				die(STATE_UNKNOWN, _("HTTP UNKNOWN - Could not allocate memory for full_page\n"));
+			}
+			full_page = full_page_new;
+		}
 	}
 	microsec_transfer = deltime(tv_temp);
 	elapsed_time_transfer = (double)microsec_transfer / 1.0e6;
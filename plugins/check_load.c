@@ -41,6 +41,7 @@ const char *email = "devel@monitoring-plugins.org";
 #include "../lib/output.h"
 #include "../lib/perfdata.h"
 #include "../lib/thresholds.h"
+#include "../lib/utils_procfs.h"
 #include "check_load.d/config.h"
 
 // getloadavg comes from gnulib
@@ -66,11 +67,13 @@ typedef struct {
 	char **top_processes;
 } top_processes_result;
 static top_processes_result get_top_consuming_processes(unsigned long n_procs_to_show);
+static mp_subcheck evaluate_run_queue(check_load_config config);
 
 typedef struct {
 	mp_range load[3];
 } parsed_thresholds;
-static parsed_thresholds get_threshold(char *arg) {
+/* parses one to three comma separated numbers, dies with error_message if there are none */
+static parsed_thresholds parse_threshold_triplet(char *arg, const char *error_message) {
 	size_t index;
 	char *str = arg;
 	char *tmp_pointer;
@@ -103,7 +106,7 @@ static parsed_thresholds get_threshold(char *arg) {
 
 	/* empty argument or non-floatish, so warn about it and die */
 	if (!index && !valid) {
-		usage(_("Warning threshold must be float or float triplet!\n"));
+		usage(error_message);
 	}
 
 	if (index != 2) {
@@ -116,6 +119,16 @@ static parsed_thresholds get_threshold(char *arg) {
 	return result;
 }
 
+static parsed_thresholds get_threshold(char *arg) {
+	return parse_threshold_triplet(arg, _("Warning threshold must be float or float triplet!\n"));
+}
+
+static parsed_thresholds get_pressure_threshold(char *arg) {
+	return parse_threshold_triplet(
+		arg, _("Pressure threshold must be a percentage or a triplet of percentages for CPU, "
+			   "memory and IO!\n"));
+}
+
 int main(int argc, char **argv) {
 	setlocale(LC_ALL, "");
 	bindtextdomain(PACKAGE, LOCALEDIR);
@@ -256,6 +269,25 @@ int main(int argc, char **argv) {
 
 	mp_add_subcheck_to_check(&overall, load_sc);
 
+	if (config.check_pressure) {
+		mp_subcheck pressure_sc = mp_subcheck_init();
+		pressure_sc = mp_set_subcheck_default_state(pressure_sc, STATE_OK);
+		pressure_sc.output = "Pressure Stall Information";
+
+		mp_add_subcheck_to_subcheck(&pressure_sc,
+									mp_evaluate_pressure("CPU", "cpu", MP_PROC_PRESSURE_CPU,
+														 config.th_pressure[PRESSURE_CPU]));
+		mp_add_subcheck_to_subcheck(
+			&pressure_sc, mp_evaluate_pressure("Memory", "memory", MP_PROC_PRESSURE_MEMORY,
+											   config.th_pressure[PRESSURE_MEMORY]));
+		mp_add_subcheck_to_subcheck(&pressure_sc,
+									mp_evaluate_pressure("IO", "io", MP_PROC_PRESSURE_IO,
+														 config.th_pressure[PRESSURE_IO]));
+
+		mp_add_subcheck_to_check(&overall, pressure_sc);
+		mp_add_subcheck_to_check(&overall, evaluate_run_queue(config));
+	}
+
 	if (config.n_procs_to_show > 0) {
 		mp_subcheck top_proc_sc = mp_subcheck_init();
 		top_proc_sc = mp_set_subcheck_state(top_proc_sc, STATE_OK);
@@ -282,16 +314,31 @@ static check_load_config_wrapper process_arguments(int argc, char **argv) {
 
 	enum {
 		output_format_index = CHAR_MAX + 1,
+		pressure_index,
+		warning_pressure_index,
+		critical_pressure_index,
+		warning_procs_running_index,
+		critical_procs_running_index,
+		warning_procs_blocked_index,
+		critical_procs_blocked_index,
 	};
 
-	static struct option longopts[] = {{"warning", required_argument, 0, 'w'},
-									   {"critical", required_argument, 0, 'c'},
-									   {"percpu", no_argument, 0, 'r'},
-									   {"version", no_argument, 0, 'V'},
-									   {"help", no_argument, 0, 'h'},
-									   {"procs-to-show", required_argument, 0, 'n'},
-									   {"output-format", required_argument, 0, output_format_index},
-									   {0, 0, 0, 0}};
+	static struct option longopts[] = {
+		{"warning", required_argument, 0, 'w'},
+		{"critical", required_argument, 0, 'c'},
+		{"percpu", no_argument, 0, 'r'},
+		{"version", no_argument, 0, 'V'},
+		{"help", no_argument, 0, 'h'},
+		{"procs-to-show", required_argument, 0, 'n'},
+		{"pressure", no_argument, 0, pressure_index},
+		{"warning-pressure", required_argument, 0, warning_pressure_index},
+		{"critical-pressure", required_argument, 0, critical_pressure_index},
+		{"warning-procs-running", required_argument, 0, warning_procs_running_index},
+		{"critical-procs-running", required_argument, 0, critical_procs_running_index},
+		{"warning-procs-blocked", required_argument, 0, warning_procs_blocked_index},
+		{"critical-procs-blocked", required_argument, 0, critical_procs_blocked_index},
+		{"output-format", required_argument, 0, output_format_index},
+		{0, 0, 0, 0}};
 
 	check_load_config_wrapper result = {
 		.errorcode = OK,
@@ -343,6 +390,49 @@ static check_load_config_wrapper process_arguments(int argc, char **argv) {
 		case 'r': /* Divide load average by number of CPUs */
 			result.config.take_into_account_cpus = true;
 			break;
+		case pressure_index:
+			result.config.check_pressure = true;
+			break;
+		case warning_pressure_index: {
+			parsed_thresholds warning_range = get_pressure_threshold(optarg);
+			for (size_t i = 0; i < PRESSURE_RESOURCES; i++) {
+				result.config.th_pressure[i] =
+					mp_thresholds_set_warn(result.config.th_pressure[i], warning_range.load[i]);
+			}
+			result.config.check_pressure = true;
+		} break;
+		case critical_pressure_index: {
+			parsed_thresholds critical_range = get_pressure_threshold(optarg);
+			for (size_t i = 0; i < PRESSURE_RESOURCES; i++) {
+				result.config.th_pressure[i] =
+					mp_thresholds_set_crit(result.config.th_pressure[i], critical_range.load[i]);
+			}
+			result.config.check_pressure = true;
+		} break;
+		case warning_procs_running_index:
+		case critical_procs_running_index:
+		case warning_procs_blocked_index:
+		case critical_procs_blocked_index: {
+			mp_range_parsed tmp = mp_parse_range_string(optarg);
+			if (tmp.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse run queue threshold: %s", optarg);
+			}
+
+			if (option_index == warning_procs_running_index) {
+				result.config.th_procs_running =
+					mp_thresholds_set_warn(result.config.th_procs_running, tmp.range);
+			} else if (option_index == critical_procs_running_index) {
+				result.config.th_procs_running =
+					mp_thresholds_set_crit(result.config.th_procs_running, tmp.range);
+			} else if (option_index == warning_procs_blocked_index) {
+				result.config.th_procs_blocked =
+					mp_thresholds_set_warn(result.config.th_procs_blocked, tmp.range);
+			} else {
+				result.config.th_procs_blocked =
+					mp_thresholds_set_crit(result.config.th_procs_blocked, tmp.range);
+			}
+			result.config.check_pressure = true;
+		} break;
 		case 'V': /* version */
 			print_revision(progname, NP_VERSION);
 			exit(STATE_UNKNOWN);
@@ -423,6 +513,18 @@ void print_help(void) {
 	printf(" %s\n", "-n, --procs-to-show=NUMBER_OF_PROCS");
 	printf("    %s\n", _("Number of processes to show when printing the top consuming processes."));
 	printf("    %s\n", _("NUMBER_OF_PROCS=0 disables this feature. Default value is 0"));
+	printf(" %s\n", "--pressure");
+	printf("    %s\n", _("Additionally check pressure stall information (/proc/pressure/*) and"));
+	printf("    %s\n", _("the number of running and blocked processes (/proc/stat)"));
+	printf(" %s\n", "--warning-pressure=WCPU,WMEMORY,WIO");
+	printf("    %s\n", _("Warning thresholds for the \"some avg10\" stall percentage"));
+	printf(" %s\n", "--critical-pressure=CCPU,CMEMORY,CIO");
+	printf("    %s\n", _("Critical thresholds for the \"some avg10\" stall percentage"));
+	printf(" %s\n", "--warning-procs-running=RANGE, --critical-procs-running=RANGE");
+	printf("    %s\n", _("Thresholds for the number of runnable processes"));
+	printf(" %s\n", "--warning-procs-blocked=RANGE, --critical-procs-blocked=RANGE");
+	printf("    %s\n", _("Thresholds for the number of processes blocked on IO"));
+	printf("    %s\n", _("All of the pressure thresholds imply --pressure"));
 
 	printf(UT_OUTPUT_FORMAT);
 	printf(UT_SUPPORT);
@@ -432,6 +534,10 @@ void print_usage(void) {
 	printf("%s\n", _("Usage:"));
 	printf("%s [-r] -w WLOAD1,WLOAD5,WLOAD15 -c CLOAD1,CLOAD5,CLOAD15 [-n NUMBER_OF_PROCS]\n",
 		   progname);
+	printf("       [--pressure] [--warning-pressure=WCPU,WMEMORY,WIO]\n");
+	printf("       [--critical-pressure=CCPU,CMEMORY,CIO] [--warning-procs-running=RANGE]\n");
+	printf("       [--critical-procs-running=RANGE] [--warning-procs-blocked=RANGE]\n");
+	printf("       [--critical-procs-blocked=RANGE]\n");
 }
 
 #ifdef PS_USES_PROCPCPU
@@ -492,3 +598,41 @@ static top_processes_result get_top_consuming_processes(unsigned long n_procs_to
 
 	return result;
 }
+
+static mp_subcheck evaluate_run_queue(check_load_config config) {
+	mp_subcheck run_queue_sc = mp_subcheck_init();
+	run_queue_sc = mp_set_subcheck_default_state(run_queue_sc, STATE_OK);
+
+	mp_proc_stat_procs procs = mp_read_proc_stat_procs(MP_PROC_STAT);
+	if (procs.errorcode != OK) {
+		run_queue_sc = mp_set_subcheck_state(run_queue_sc, STATE_UNKNOWN);
+		xasprintf(&run_queue_sc.output, _("Failed to read run queue from %s"), MP_PROC_STAT);
+		return run_queue_sc;
+	}
+
+	run_queue_sc.output = "Run queue";
+
+	mp_perfdata pd_running = perfdata_init();
+	pd_running.label = "procs_running";
+	pd_running = mp_set_pd_value(pd_running, procs.procs_running);
+	pd_running = mp_pd_set_thresholds(pd_running, config.th_procs_running);
+
+	mp_subcheck running_sc = mp_subcheck_init();
+	running_sc = mp_set_subcheck_state(running_sc, mp_get_pd_status(pd_running));
+	mp_add_perfdata_to_subcheck(&running_sc, pd_running);
+	xasprintf(&running_sc.output, "Running processes: %llu", procs.procs_running);
+	mp_add_subcheck_to_subcheck(&run_queue_sc, running_sc);
+
+	mp_perfdata pd_blocked = perfdata_init();
+	pd_blocked.label = "procs_blocked";
+	pd_blocked = mp_set_pd_value(pd_blocked, procs.procs_blocked);
+	pd_blocked = mp_pd_set_thresholds(pd_blocked, config.th_procs_blocked);
+
+	mp_subcheck blocked_sc = mp_subcheck_init();
+	blocked_sc = mp_set_subcheck_state(blocked_sc, mp_get_pd_status(pd_blocked));
+	mp_add_perfdata_to_subcheck(&blocked_sc, pd_blocked);
+	xasprintf(&blocked_sc.output, "Processes blocked on IO: %llu", procs.procs_blocked);
+	mp_add_subcheck_to_subcheck(&run_queue_sc, blocked_sc);
+
+	return run_queue_sc;
+}
@@ -2,12 +2,27 @@
 
 #include "output.h"
 #include "thresholds.h"
+
+/* Resources with pressure stall information, in the order of the threshold triplets */
+enum {
+	PRESSURE_CPU,
+	PRESSURE_MEMORY,
+	PRESSURE_IO,
+	PRESSURE_RESOURCES,
+};
+
 typedef struct {
 	mp_thresholds th_load[3];
 
 	bool take_into_account_cpus;
 	unsigned long n_procs_to_show;
 
+	// pressure stall information (thresholds apply to "some avg10") and run queue
+	bool check_pressure;
+	mp_thresholds th_pressure[PRESSURE_RESOURCES];
+	mp_thresholds th_procs_running;
+	mp_thresholds th_procs_blocked;
+
 	mp_output_format output_format;
 	bool output_format_set;
 } check_load_config;
@@ -24,6 +39,16 @@ check_load_config check_load_config_init() {
 		.take_into_account_cpus = false,
 		.n_procs_to_show = 0,
 
+		.check_pressure = false,
+		.th_pressure =
+			{
+				mp_thresholds_init(),
+				mp_thresholds_init(),
+				mp_thresholds_init(),
+			},
+		.th_procs_running = mp_thresholds_init(),
+		.th_procs_blocked = mp_thresholds_init(),
+
 		.output_format_set = false,
 	};
 	return tmp;
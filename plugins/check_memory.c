@@ -0,0 +1,546 @@
+/*****************************************************************************
+ *
+ * Monitoring check_memory plugin
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * This file contains the check_memory plugin
+ *
+ * This plugin checks the memory usage and memory pressure of the local
+ * system and optionally of a cgroup (v2) on Linux.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+const char *progname = "check_memory";
+const char *copyright = "2026";
+const char *email = "devel@monitoring-plugins.org";
+
+#include "./common.h"
+#include "./utils.h"
+#include "../lib/states.h"
+#include "../lib/output.h"
+#include "../lib/perfdata.h"
+#include "../lib/thresholds.h"
+#include "../lib/utils_procfs.h"
+#include "check_memory.d/config.h"
+#include <fcntl.h>
+
+#ifndef PROC_MEMINFO
+#	define PROC_MEMINFO MP_PROC_MEMINFO
+#endif
+
+typedef struct {
+	int errorcode;
+	check_memory_config config;
+} check_memory_config_wrapper;
+static check_memory_config_wrapper process_arguments(int /*argc*/, char ** /*argv*/);
+
+void print_help(void);
+void print_usage(void);
+
+/* Fields from /proc/meminfo, in the order of the meminfo_fields array */
+enum {
+	MEM_TOTAL,
+	MEM_FREE,
+	MEM_AVAILABLE,
+	MEM_BUFFERS,
+	MEM_CACHED,
+	MEM_ANON_PAGES,
+	MEM_SHMEM,
+	MEM_SRECLAIMABLE,
+	MEM_HUGEPAGES_TOTAL,
+	MEM_HUGEPAGES_FREE,
+	MEM_HUGEPAGES_RSVD,
+	MEM_HUGEPAGES_SURP,
+	MEM_HUGEPAGESIZE,
+	MEM_NUMBER_OF_FIELDS,
+};
+
+static mp_subcheck evaluate_available_memory(mp_procfs_field fields[], check_memory_config config);
+static mp_subcheck evaluate_memory_usage(mp_procfs_field fields[]);
+static mp_subcheck evaluate_huge_pages(mp_procfs_field fields[]);
+static mp_subcheck evaluate_cgroup(check_memory_config config);
+
+int main(int argc, char **argv) {
+	setlocale(LC_ALL, "");
+	bindtextdomain(PACKAGE, LOCALEDIR);
+	textdomain(PACKAGE);
+
+	/* Parse extra opts if any */
+	argv = np_extra_opts(&argc, argv, progname);
+
+	check_memory_config_wrapper tmp_config = process_arguments(argc, argv);
+	if (tmp_config.errorcode == ERROR) {
+		usage4(_("Could not parse arguments"));
+	}
+
+	const check_memory_config config = tmp_config.config;
+
+	mp_check overall = mp_check_init();
+	if (config.output_format_is_set) {
+		mp_set_format(config.output_format);
+	}
+
+	mp_procfs_field meminfo_fields[MEM_NUMBER_OF_FIELDS] = {
+		[MEM_TOTAL] = {.key = "MemTotal"},
+		[MEM_FREE] = {.key = "MemFree"},
+		[MEM_AVAILABLE] = {.key = "MemAvailable"},
+		[MEM_BUFFERS] = {.key = "Buffers"},
+		[MEM_CACHED] = {.key = "Cached"},
+		[MEM_ANON_PAGES] = {.key = "AnonPages"},
+		[MEM_SHMEM] = {.key = "Shmem"},
+		[MEM_SRECLAIMABLE] = {.key = "SReclaimable"},
+		[MEM_HUGEPAGES_TOTAL] = {.key = "HugePages_Total"},
+		[MEM_HUGEPAGES_FREE] = {.key = "HugePages_Free"},
+		[MEM_HUGEPAGES_RSVD] = {.key = "HugePages_Rsvd"},
+		[MEM_HUGEPAGES_SURP] = {.key = "HugePages_Surp"},
+		[MEM_HUGEPAGESIZE] = {.key = "Hugepagesize"},
+	};
+
+	mp_procfs_keyset keyset;
+	mp_procfs_keyset_init(&keyset, meminfo_fields, MEM_NUMBER_OF_FIELDS);
+
+	if (mp_procfs_read_kv(PROC_MEMINFO, &keyset) == ERROR || !meminfo_fields[MEM_TOTAL].found ||
+		!meminfo_fields[MEM_FREE].found) {
+		mp_subcheck sc_meminfo = mp_subcheck_init();
+		sc_meminfo = mp_set_subcheck_state(sc_meminfo, STATE_UNKNOWN);
+		xasprintf(&sc_meminfo.output, _("Failed to read memory information from %s"),
+				  PROC_MEMINFO);
+		mp_add_subcheck_to_check(&overall, sc_meminfo);
+		mp_exit(overall);
+	}
+
+	mp_add_subcheck_to_check(&overall, evaluate_available_memory(meminfo_fields, config));
+	mp_add_subcheck_to_check(&overall, evaluate_memory_usage(meminfo_fields));
+
+	if (meminfo_fields[MEM_HUGEPAGES_TOTAL].found &&
+		meminfo_fields[MEM_HUGEPAGES_TOTAL].values[0] > 0) {
+		mp_add_subcheck_to_check(&overall, evaluate_huge_pages(meminfo_fields));
+	}
+
+	if (config.check_pressure) {
+		mp_subcheck sc_pressure =
+			mp_evaluate_pressure(_("Memory pressure"), "memory", MP_PROC_PRESSURE_MEMORY,
+								 config.th_pressure);
+		mp_add_subcheck_to_check(&overall, sc_pressure);
+	}
+
+	if (config.cgroup_path != NULL) {
+		mp_add_subcheck_to_check(&overall, evaluate_cgroup(config));
+	}
+
+	mp_exit(overall);
+}
+
+static mp_perfdata bytes_perfdata(const char *label, unsigned long long value) {
+	mp_perfdata result = perfdata_init();
+	result.label = (char *)label;
+	result.uom = "B";
+	result = mp_set_pd_value(result, value);
+	result = mp_set_pd_min_value(result, mp_create_pd_value(0));
+	return result;
+}
+
+static mp_subcheck evaluate_available_memory(mp_procfs_field fields[], check_memory_config config) {
+	mp_subcheck sc_available = mp_subcheck_init();
+
+	unsigned long long mem_total = fields[MEM_TOTAL].values[0];
+	unsigned long long mem_available = 0;
+	if (fields[MEM_AVAILABLE].found) {
+		mem_available = fields[MEM_AVAILABLE].values[0];
+	} else {
+		// Kernels before 3.14 do not provide MemAvailable, this is the traditional estimation
+		mem_available = fields[MEM_FREE].values[0] + fields[MEM_BUFFERS].values[0] +
+						fields[MEM_CACHED].values[0];
+	}
+
+	double available_percent = 0;
+	if (mem_total > 0) {
+		available_percent = 100 * (double)mem_available / (double)mem_total;
+	}
+
+	mp_perfdata pd_available_percent = perfdata_init();
+	pd_available_percent.label = "available";
+	pd_available_percent.uom = "%";
+	pd_available_percent = mp_set_pd_value(pd_available_percent, available_percent);
+	pd_available_percent = mp_set_pd_min_value(pd_available_percent, mp_create_pd_value(0));
+	pd_available_percent = mp_set_pd_max_value(pd_available_percent, mp_create_pd_value(100));
+	pd_available_percent = mp_pd_set_thresholds(pd_available_percent, config.th_available);
+
+	sc_available = mp_set_subcheck_state(sc_available, mp_get_pd_status(pd_available_percent));
+	mp_add_perfdata_to_subcheck(&sc_available, pd_available_percent);
+
+	mp_perfdata pd_available = bytes_perfdata("mem_available", mem_available);
+	pd_available = mp_set_pd_max_value(pd_available, mp_create_pd_value(mem_total));
+	mp_add_perfdata_to_subcheck(&sc_available, pd_available);
+
+	mp_perfdata pd_free = bytes_perfdata("mem_free", fields[MEM_FREE].values[0]);
+	pd_free = mp_set_pd_max_value(pd_free, mp_create_pd_value(mem_total));
+	mp_add_perfdata_to_subcheck(&sc_available, pd_free);
+
+	mp_add_perfdata_to_subcheck(&sc_available, bytes_perfdata("mem_total", mem_total));
+
+	xasprintf(&sc_available.output, _("%.2f%% available (%lluMiB out of %lluMiB)"),
+			  available_percent, mem_available >> 20, mem_total >> 20);
+
+	return sc_available;
+}
+
+static mp_subcheck evaluate_memory_usage(mp_procfs_field fields[]) {
+	mp_subcheck sc_usage = mp_subcheck_init();
+	sc_usage = mp_set_subcheck_default_state(sc_usage, STATE_OK);
+
+	unsigned long long page_cache = fields[MEM_CACHED].values[0] + fields[MEM_BUFFERS].values[0];
+	unsigned long long anon = fields[MEM_ANON_PAGES].values[0];
+
+	mp_add_perfdata_to_subcheck(&sc_usage, bytes_perfdata("page_cache", page_cache));
+	mp_add_perfdata_to_subcheck(&sc_usage, bytes_perfdata("anon", anon));
+	mp_add_perfdata_to_subcheck(&sc_usage, bytes_perfdata("shmem", fields[MEM_SHMEM].values[0]));
+	mp_add_perfdata_to_subcheck(&sc_usage, bytes_perfdata("slab_reclaimable",
+														  fields[MEM_SRECLAIMABLE].values[0]));
+
+	xasprintf(&sc_usage.output, _("Page cache: %lluMiB, anonymous: %lluMiB, shared: %lluMiB"),
+			  page_cache >> 20, anon >> 20, fields[MEM_SHMEM].values[0] >> 20);
+
+	return sc_usage;
+}
+
+static mp_subcheck evaluate_huge_pages(mp_procfs_field fields[]) {
+	mp_subcheck sc_huge_pages = mp_subcheck_init();
+	sc_huge_pages = mp_set_subcheck_default_state(sc_huge_pages, STATE_OK);
+
+	unsigned long long total = fields[MEM_HUGEPAGES_TOTAL].values[0];
+
+	mp_perfdata pd_total = perfdata_init();
+	pd_total.label = "hugepages_total";
+	pd_total = mp_set_pd_value(pd_total, total);
+	mp_add_perfdata_to_subcheck(&sc_huge_pages, pd_total);
+
+	struct {
+		const char *label;
+		unsigned long long value;
+	} counts[] = {
+		{"hugepages_free", fields[MEM_HUGEPAGES_FREE].values[0]},
+		{"hugepages_reserved", fields[MEM_HUGEPAGES_RSVD].values[0]},
+		{"hugepages_surplus", fields[MEM_HUGEPAGES_SURP].values[0]},
+	};
+
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+		mp_perfdata pd_count = perfdata_init();
+		pd_count.label = (char *)counts[i].label;
+		pd_count = mp_set_pd_value(pd_count, counts[i].value);
+		pd_count = mp_set_pd_min_value(pd_count, mp_create_pd_value(0));
+		pd_count = mp_set_pd_max_value(pd_count, mp_create_pd_value(total));
+		mp_add_perfdata_to_subcheck(&sc_huge_pages, pd_count);
+	}
+
+	xasprintf(&sc_huge_pages.output, _("Huge pages: %llu of %llu free (page size %lluKiB)"),
+			  fields[MEM_HUGEPAGES_FREE].values[0], total,
+			  fields[MEM_HUGEPAGESIZE].values[0] >> 10);
+
+	return sc_huge_pages;
+}
+
+/*
+ * Reads a cgroup file with a single value, "max" is returned as unlimited
+ */
+typedef struct {
+	int errorcode;
+	bool unlimited;
+	unsigned long long value;
+} cgroup_value;
+
+static cgroup_value read_cgroup_value(const char *cgroup_dir, const char *file) {
+	cgroup_value result = {
+		.errorcode = ERROR,
+		.unlimited = false,
+	};
+
+	char *path = NULL;
+	xasprintf(&path, "%s/%s", cgroup_dir, file);
+
+	int file_descriptor = open(path, O_RDONLY);
+	free(path);
+	if (file_descriptor < 0) {
+		return result;
+	}
+
+	char buffer[64];
+	ssize_t bytes_read = read(file_descriptor, buffer, sizeof(buffer) - 1);
+	close(file_descriptor);
+	if (bytes_read <= 0) {
+		return result;
+	}
+	buffer[bytes_read] = '\0';
+
+	if (strncmp(buffer, "max", strlen("max")) == 0) {
+		result.unlimited = true;
+		result.errorcode = OK;
+		return result;
+	}
+
+	char *end = NULL;
+	result.value = strtoull(buffer, &end, 10);
+	if (end != buffer) {
+		result.errorcode = OK;
+	}
+
+	return result;
+}
+
+static mp_subcheck evaluate_cgroup(check_memory_config config) {
+	mp_subcheck sc_cgroup = mp_subcheck_init();
+
+	char *cgroup_dir = NULL;
+	if (config.cgroup_path[0] == '/') {
+		cgroup_dir = config.cgroup_path;
+	} else {
+		xasprintf(&cgroup_dir, "%s/%s", CGROUP_V2_MOUNTPOINT, config.cgroup_path);
+	}
+
+	cgroup_value current = read_cgroup_value(cgroup_dir, "memory.current");
+	if (current.errorcode != OK) {
+		sc_cgroup = mp_set_subcheck_state(sc_cgroup, STATE_UNKNOWN);
+		xasprintf(&sc_cgroup.output, _("Failed to read memory.current of cgroup %s"),
+				  cgroup_dir);
+		return sc_cgroup;
+	}
+
+	cgroup_value max = read_cgroup_value(cgroup_dir, "memory.max");
+
+	mp_perfdata pd_current = bytes_perfdata("cgroup_current", current.value);
+	if (max.errorcode == OK && !max.unlimited) {
+		pd_current = mp_set_pd_max_value(pd_current, mp_create_pd_value(max.value));
+	}
+	mp_add_perfdata_to_subcheck(&sc_cgroup, pd_current);
+
+	xasprintf(&sc_cgroup.output, _("cgroup %s: %lluMiB used"), cgroup_dir, current.value >> 20);
+
+	if (max.errorcode == OK && !max.unlimited && max.value > 0) {
+		double used_percent = 100 * (double)current.value / (double)max.value;
+
+		mp_perfdata pd_used_percent = perfdata_init();
+		pd_used_percent.label = "cgroup_used";
+		pd_used_percent.uom = "%";
+		pd_used_percent = mp_set_pd_value(pd_used_percent, used_percent);
+		pd_used_percent = mp_set_pd_min_value(pd_used_percent, mp_create_pd_value(0));
+		pd_used_percent = mp_set_pd_max_value(pd_used_percent, mp_create_pd_value(100));
+		pd_used_percent = mp_pd_set_thresholds(pd_used_percent, config.th_cgroup);
+
+		sc_cgroup = mp_set_subcheck_state(sc_cgroup, mp_get_pd_status(pd_used_percent));
+		mp_add_perfdata_to_subcheck(&sc_cgroup, pd_used_percent);
+
+		xasprintf(&sc_cgroup.output, _("%s (%.2f%% of %lluMiB)"), sc_cgroup.output, used_percent,
+				  max.value >> 20);
+	} else {
+		sc_cgroup = mp_set_subcheck_state(sc_cgroup, STATE_OK);
+		xasprintf(&sc_cgroup.output, _("%s (no limit)"), sc_cgroup.output);
+	}
+
+	// split of the cgroup memory, the values in memory.stat are in Bytes
+	mp_procfs_field stat_fields[] = {
+		{.key = "anon"},
+		{.key = "file"},
+	};
+	mp_procfs_keyset keyset;
+	mp_procfs_keyset_init(&keyset, stat_fields, sizeof(stat_fields) / sizeof(stat_fields[0]));
+
+	char *stat_path = NULL;
+	xasprintf(&stat_path, "%s/memory.stat", cgroup_dir);
+	if (mp_procfs_read_kv(stat_path, &keyset) == 2) {
+		mp_add_perfdata_to_subcheck(&sc_cgroup,
+									bytes_perfdata("cgroup_anon", stat_fields[0].values[0]));
+		mp_add_perfdata_to_subcheck(&sc_cgroup,
+									bytes_perfdata("cgroup_file", stat_fields[1].values[0]));
+	}
+	free(stat_path);
+
+	if (config.check_pressure) {
+		char *pressure_path = NULL;
+		xasprintf(&pressure_path, "%s/memory.pressure", cgroup_dir);
+		mp_add_subcheck_to_subcheck(&sc_cgroup,
+									mp_evaluate_pressure(_("Memory pressure"), "cgroup_memory",
+														 pressure_path, config.th_pressure));
+	}
+
+	return sc_cgroup;
+}
+
+/* process command-line arguments */
+static check_memory_config_wrapper process_arguments(int argc, char **argv) {
+	enum {
+		output_format_index = CHAR_MAX + 1,
+		pressure_index,
+		warning_pressure_index,
+		critical_pressure_index,
+		warning_cgroup_index,
+		critical_cgroup_index,
+	};
+
+	static struct option longopts[] = {
+		{"warning", required_argument, 0, 'w'},
+		{"critical", required_argument, 0, 'c'},
+		{"cgroup", required_argument, 0, 'C'},
+		{"pressure", no_argument, 0, pressure_index},
+		{"warning-pressure", required_argument, 0, warning_pressure_index},
+		{"critical-pressure", required_argument, 0, critical_pressure_index},
+		{"warning-cgroup", required_argument, 0, warning_cgroup_index},
+		{"critical-cgroup", required_argument, 0, critical_cgroup_index},
+		{"version", no_argument, 0, 'V'},
+		{"help", no_argument, 0, 'h'},
+		{"output-format", required_argument, 0, output_format_index},
+		{0, 0, 0, 0}};
+
+	check_memory_config_wrapper result = {
+		.errorcode = OK,
+		.config = check_memory_config_init(),
+	};
+
+	while (true) {
+		int option = 0;
+		int option_index = getopt_long(argc, argv, "Vhw:c:C:", longopts, &option);
+
+		if (CHECK_EOF(option_index)) {
+			break;
+		}
+
+		switch (option_index) {
+		case output_format_index: {
+			parsed_output_format parser = mp_parse_output_format(optarg);
+			if (!parser.parsing_success) {
+				printf("Invalid output format: %s\n", optarg);
+				exit(STATE_UNKNOWN);
+			}
+
+			result.config.output_format_is_set = true;
+			result.config.output_format = parser.output_format;
+			break;
+		}
+		case 'w':
+		case 'c':
+		case warning_pressure_index:
+		case critical_pressure_index:
+		case warning_cgroup_index:
+		case critical_cgroup_index: {
+			mp_range_parsed tmp = mp_parse_range_string(optarg);
+			if (tmp.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse threshold: %s", optarg);
+			}
+
+			check_memory_config *config = &result.config;
+			switch (option_index) {
+			case 'w':
+				config->th_available = mp_thresholds_set_warn(config->th_available, tmp.range);
+				break;
+			case 'c':
+				config->th_available = mp_thresholds_set_crit(config->th_available, tmp.range);
+				break;
+			case warning_pressure_index:
+				config->th_pressure = mp_thresholds_set_warn(config->th_pressure, tmp.range);
+				config->check_pressure = true;
+				break;
+			case critical_pressure_index:
+				config->th_pressure = mp_thresholds_set_crit(config->th_pressure, tmp.range);
+				config->check_pressure = true;
+				break;
+			case warning_cgroup_index:
+				config->th_cgroup = mp_thresholds_set_warn(config->th_cgroup, tmp.range);
+				break;
+			default:
+				config->th_cgroup = mp_thresholds_set_crit(config->th_cgroup, tmp.range);
+				break;
+			}
+		} break;
+		case 'C':
+			result.config.cgroup_path = optarg;
+			break;
+		case pressure_index:
+			result.config.check_pressure = true;
+			break;
+		case 'V': /* version */
+			print_revision(progname, NP_VERSION);
+			exit(STATE_UNKNOWN);
+		case 'h': /* help */
+			print_help();
+			exit(STATE_UNKNOWN);
+		case '?': /* help */
+			usage5();
+		}
+	}
+
+	if (result.config.cgroup_path == NULL &&
+		(result.config.th_cgroup.warning_is_set || result.config.th_cgroup.critical_is_set)) {
+		usage4(_("--warning-cgroup and --critical-cgroup need a cgroup (-C)"));
+	}
+
+	return result;
+}
+
+void print_help(void) {
+	print_revision(progname, NP_VERSION);
+
+	printf(COPYRIGHT, copyright, email);
+
+	printf("%s\n", _("This plugin checks the available memory and the memory pressure of the"));
+	printf("%s\n", _("local system and optionally of a cgroup (v2)."));
+
+	printf("\n\n");
+
+	print_usage();
+
+	printf(UT_HELP_VRSN);
+	printf(UT_EXTRA_OPTS);
+
+	printf(" %s\n", "-w, --warning=RANGE");
+	printf("    %s\n", _("Warning threshold for the available memory in percent (MemAvailable)"));
+	printf(" %s\n", "-c, --critical=RANGE");
+	printf("    %s\n", _("Critical threshold for the available memory in percent (MemAvailable)"));
+	printf(" %s\n", "--pressure");
+	printf("    %s\n", _("Additionally check the memory pressure stall information"));
+	printf(" %s\n", "--warning-pressure=RANGE, --critical-pressure=RANGE");
+	printf("    %s\n", _("Thresholds for the \"some avg10\" memory stall percentage, imply"));
+	printf("    %s\n", _("--pressure"));
+	printf(" %s\n", "-C, --cgroup=PATH");
+	printf("    %s\n", _("Additionally check the memory usage of a cgroup (v2). A relative PATH"));
+	printf("    %s %s\n", _("is resolved below the cgroup v2 mount point"), CGROUP_V2_MOUNTPOINT);
+	printf(" %s\n", "--warning-cgroup=RANGE, --critical-cgroup=RANGE");
+	printf("    %s\n", _("Thresholds for the cgroup memory usage in percent of memory.max, need"));
+	printf("    %s\n", _("-C"));
+	printf(UT_OUTPUT_FORMAT);
+
+	printf("\n");
+	printf("%s\n", _("Examples:"));
+	printf(" %s\n", "check_memory -w 10: -c 5:");
+	printf("    %s\n", _("Warning if less than 10% of the memory is available, critical if less"));
+	printf("    %s\n", _("than 5%"));
+	printf(" %s\n", "check_memory -w 10: -c 5: -C system.slice/nginx.service --critical-cgroup 95");
+	printf("    %s\n", _("Additionally critical if the nginx service uses more than 95% of its"));
+	printf("    %s\n", _("memory limit"));
+
+	printf(UT_SUPPORT);
+}
+
+void print_usage(void) {
+	printf("%s\n", _("Usage:"));
+	printf("%s [-w RANGE] [-c RANGE] [--pressure] [--warning-pressure=RANGE]\n", progname);
+	printf("  [--critical-pressure=RANGE] [-C CGROUP] [--warning-cgroup=RANGE]\n");
+	printf("  [--critical-cgroup=RANGE]\n");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "output.h"
+#include "thresholds.h"
+
+#ifndef CGROUP_V2_MOUNTPOINT
+#	define CGROUP_V2_MOUNTPOINT "/sys/fs/cgroup"
+#endif
+
+typedef struct {
+	// thresholds for the available memory in percent of the total memory
+	mp_thresholds th_available;
+
+	// pressure stall information, thresholds apply to "some avg10"
+	bool check_pressure;
+	mp_thresholds th_pressure;
+
+	// cgroup v2 directory to check, thresholds apply to memory.current in percent of memory.max
+	char *cgroup_path;
+	mp_thresholds th_cgroup;
+
+	bool output_format_is_set;
+	mp_output_format output_format;
+} check_memory_config;
+
+check_memory_config check_memory_config_init() {
+	check_memory_config tmp = {
+		.th_available = mp_thresholds_init(),
+
+		.check_pressure = false,
+		.th_pressure = mp_thresholds_init(),
+
+		.cgroup_path = NULL,
+		.th_cgroup = mp_thresholds_init(),
+
+		.output_format_is_set = false,
+	};
+	return tmp;
+}
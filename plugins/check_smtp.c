@@ -62,18 +62,6 @@ typedef struct {
 } check_smtp_config_wrapper;
 static check_smtp_config_wrapper process_arguments(int /*argc*/, char ** /*argv*/);
 
-int my_recv(check_smtp_config config, void *buf, int num, int socket_descriptor,
-			bool ssl_established) {
-#ifdef HAVE_SSL
-	if ((config.use_starttls || config.use_ssl) && ssl_established) {
-		return np_net_ssl_read(buf, num);
-	}
-	return (int)read(socket_descriptor, buf, (size_t)num);
-#else /* ifndef HAVE_SSL */
-	return read(socket_descriptor, buf, len)
-#endif
-}
-
 int my_send(check_smtp_config config, void *buf, int num, int socket_descriptor,
 			bool ssl_established) {
 #ifdef HAVE_SSL
@@ -90,11 +78,8 @@ int my_send(check_smtp_config config, void *buf, int num, int socket_descriptor,
 static void print_help(void);
 void print_usage(void);
 static char *smtp_quit(check_smtp_config /*config*/, char /*buffer*/[MAX_INPUT_BUFFER],
-					   int /*socket_descriptor*/, bool /*ssl_established*/);
-static int recvline(char * /*buf*/, size_t /*bufsize*/, check_smtp_config /*config*/,
-					int /*socket_descriptor*/, bool /*ssl_established*/);
-static int recvlines(check_smtp_config /*config*/, char * /*buf*/, size_t /*bufsize*/,
-					 int /*socket_descriptor*/, bool /*ssl_established*/);
+					   np_line_reader * /*reader*/, int /*socket_descriptor*/,
+					   bool /*ssl_established*/);
 static int my_close(int /*socket_descriptor*/);
 
 static int verbose = 0;
@@ -203,6 +188,9 @@ int main(int argc, char **argv) {
 	}
 
 	/* we connected */
+	np_line_reader reader;
+	np_line_reader_init(&reader, socket_descriptor);
+
 	/* If requested, send PROXY header */
 	if (config.use_proxy_prefix) {
 		if (verbose) {
@@ -232,12 +220,13 @@ int main(int argc, char **argv) {
 		xasprintf(&sc_tls_connection.output, "TLS context established");
 		mp_add_subcheck_to_check(&overall, sc_tls_connection);
 		ssl_established = true;
+		np_line_reader_start_tls(&reader);
 	}
 #endif
 
 	/* watch for the SMTP connection string and */
 	/* return a WARNING status if we couldn't read any data */
-	if (recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established) <= 0) {
+	if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 		mp_subcheck sc_read_data = mp_subcheck_init();
 		sc_read_data = mp_set_subcheck_state(sc_read_data, STATE_WARNING);
 		xasprintf(&sc_read_data.output, "recv() failed");
@@ -253,7 +242,7 @@ int main(int argc, char **argv) {
 	my_send(config, helocmd, (int)strlen(helocmd), socket_descriptor, ssl_established);
 
 	/* allow for response to helo command to reach us */
-	if (recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established) <= 0) {
+	if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 		mp_subcheck sc_read_data = mp_subcheck_init();
 		sc_read_data = mp_set_subcheck_state(sc_read_data, STATE_WARNING);
 		xasprintf(&sc_read_data.output, "recv() failed");
@@ -269,7 +258,7 @@ int main(int argc, char **argv) {
 	}
 
 	if (config.use_starttls && !supports_tls) {
-		smtp_quit(config, buffer, socket_descriptor, ssl_established);
+		smtp_quit(config, buffer, &reader, socket_descriptor, ssl_established);
 
 		mp_subcheck sc_read_data = mp_subcheck_init();
 		sc_read_data = mp_set_subcheck_state(sc_read_data, STATE_WARNING);
@@ -284,10 +273,9 @@ int main(int argc, char **argv) {
 		send(socket_descriptor, SMTP_STARTTLS, strlen(SMTP_STARTTLS), 0);
 
 		mp_subcheck sc_starttls_init = mp_subcheck_init();
-		recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor,
-				  ssl_established); /* wait for it */
+		np_recvlines(&reader, buffer, MAX_INPUT_BUFFER); /* wait for it */
 		if (!strstr(buffer, SMTP_EXPECT)) {
-			smtp_quit(config, buffer, socket_descriptor, ssl_established);
+			smtp_quit(config, buffer, &reader, socket_descriptor, ssl_established);
 
 			xasprintf(&sc_starttls_init.output, "StartTLS not supported by server");
 			sc_starttls_init = mp_set_subcheck_state(sc_starttls_init, STATE_UNKNOWN);
@@ -311,6 +299,7 @@ int main(int argc, char **argv) {
 		mp_add_subcheck_to_check(&overall, sc_starttls_init);
 
 		ssl_established = true;
+		np_line_reader_start_tls(&reader);
 
 		/*
 		 * Resend the EHLO command.
@@ -338,7 +327,7 @@ int main(int argc, char **argv) {
 			printf(_("sent %s"), helocmd);
 		}
 
-		if (recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established) <= 0) {
+		if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 			my_close(socket_descriptor);
 
 			mp_subcheck sc_ehlo = mp_subcheck_init();
@@ -429,7 +418,7 @@ int main(int argc, char **argv) {
 
 	if (config.send_mail_from) {
 		my_send(config, cmd_str, (int)strlen(cmd_str), socket_descriptor, ssl_established);
-		if (recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established) >= 1 &&
+		if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) >= 1 &&
 			verbose) {
 			printf("%s", buffer);
 		}
@@ -439,7 +428,7 @@ int main(int argc, char **argv) {
 	while (counter < config.ncommands) {
 		xasprintf(&cmd_str, "%s%s", config.commands[counter], "\r\n");
 		my_send(config, cmd_str, (int)strlen(cmd_str), socket_descriptor, ssl_established);
-		if (recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established) >= 1 &&
+		if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) >= 1 &&
 			verbose) {
 			printf("%s", buffer);
 		}
@@ -498,8 +487,7 @@ int main(int argc, char **argv) {
 					printf(_("sent %s\n"), "AUTH LOGIN");
 				}
 
-				if ((recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor,
-							   ssl_established)) <= 0) {
+				if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 					xasprintf(&sc_auth.output, _("recv() failed after AUTH LOGIN"));
 					sc_auth = mp_set_subcheck_state(sc_auth, STATE_WARNING);
 					break;
@@ -523,8 +511,7 @@ int main(int argc, char **argv) {
 					printf(_("sent %s\n"), abuf);
 				}
 
-				if ((recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor,
-							   ssl_established)) <= 0) {
+				if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 					xasprintf(&sc_auth.output, "recv() failed after sending authuser");
 					sc_auth = mp_set_subcheck_state(sc_auth, STATE_CRITICAL);
 					break;
@@ -549,8 +536,7 @@ int main(int argc, char **argv) {
 					printf(_("sent %s\n"), abuf);
 				}
 
-				if ((recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor,
-							   ssl_established)) <= 0) {
+				if (np_recvlines(&reader, buffer, MAX_INPUT_BUFFER) <= 0) {
 					xasprintf(&sc_auth.output, "recv() failed after sending authpass");
 					sc_auth = mp_set_subcheck_state(sc_auth, STATE_CRITICAL);
 					break;
@@ -576,7 +562,7 @@ int main(int argc, char **argv) {
 	}
 
 	/* tell the server we're done */
-	smtp_quit(config, buffer, socket_descriptor, ssl_established);
+	smtp_quit(config, buffer, &reader, socket_descriptor, ssl_established);
 
 	/* finally close the connection */
 	close(socket_descriptor);
@@ -895,8 +881,8 @@ check_smtp_config_wrapper process_arguments(int argc, char **argv) {
 	return result;
 }
 
-char *smtp_quit(check_smtp_config config, char buffer[MAX_INPUT_BUFFER], int socket_descriptor,
-				bool ssl_established) {
+char *smtp_quit(check_smtp_config config, char buffer[MAX_INPUT_BUFFER], np_line_reader *reader,
+				int socket_descriptor, bool ssl_established) {
 	int sent_bytes =
 		my_send(config, SMTP_QUIT, strlen(SMTP_QUIT), socket_descriptor, ssl_established);
 	if (sent_bytes < 0) {
@@ -914,7 +900,7 @@ char *smtp_quit(check_smtp_config config, char buffer[MAX_INPUT_BUFFER], int soc
 	}
 
 	/* read the response but don't care about problems */
-	int bytes = recvlines(config, buffer, MAX_INPUT_BUFFER, socket_descriptor, ssl_established);
+	int bytes = np_recvlines(reader, buffer, MAX_INPUT_BUFFER);
 	if (verbose) {
 		if (bytes < 0) {
 			printf(_("recv() failed after QUIT."));
@@ -929,63 +915,6 @@ char *smtp_quit(check_smtp_config config, char buffer[MAX_INPUT_BUFFER], int soc
 	return buffer;
 }
 
-/*
- * Receive one line, copy it into buf and nul-terminate it.  Returns the
- * number of bytes written to buf (excluding the '\0') or 0 on EOF or <0 on
- * error.
- *
- * TODO: Reading one byte at a time is very inefficient.  Replace this by a
- * function which buffers the data, move that to netutils.c and change
- * check_smtp and other plugins to use that.  Also, remove (\r)\n.
- */
-int recvline(char *buf, size_t bufsize, check_smtp_config config, int socket_descriptor,
-			 bool ssl_established) {
-	int result;
-	size_t counter;
-
-	for (counter = result = 0; counter < bufsize - 1; counter++) {
-		if ((result = my_recv(config, &buf[counter], 1, socket_descriptor, ssl_established)) != 1) {
-			break;
-		}
-		if (buf[counter] == '\n') {
-			buf[++counter] = '\0';
-			return (int)counter;
-		}
-	}
-	return (result == 1 || counter == 0) ? -2 : result; /* -2 if out of space */
-}
-
-/*
- * Receive one or more lines, copy them into buf and nul-terminate it.  Returns
- * the number of bytes written to buf (excluding the '\0') or 0 on EOF or <0 on
- * error.  Works for all protocols which format multiline replies as follows:
- *
- * ``The format for multiline replies requires that every line, except the last,
- * begin with the reply code, followed immediately by a hyphen, `-' (also known
- * as minus), followed by text.  The last line will begin with the reply code,
- * followed immediately by <SP>, optionally some text, and <CRLF>.  As noted
- * above, servers SHOULD send the <SP> if subsequent text is not sent, but
- * clients MUST be prepared for it to be omitted.'' (RFC 2821, 4.2.1)
- *
- * TODO: Move this to netutils.c.  Also, remove \r and possibly the final \n.
- */
-int recvlines(check_smtp_config config, char *buf, size_t bufsize, int socket_descriptor,
-			  bool ssl_established) {
-	int result;
-	int counter;
-
-	for (counter = 0; /* forever */; counter += result) {
-		if (!((result = recvline(buf + counter, bufsize - counter, config, socket_descriptor,
-								 ssl_established)) > 3 &&
-			  isdigit((int)buf[counter]) && isdigit((int)buf[counter + 1]) &&
-			  isdigit((int)buf[counter + 2]) && buf[counter + 3] == '-')) {
-			break;
-		}
-	}
-
-	return (result <= 0) ? result : result + counter;
-}
-
 int my_close(int socket_descriptor) {
 	int result;
 	result = close(socket_descriptor);
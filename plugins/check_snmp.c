@@ -40,9 +40,12 @@ const char *email = "devel@monitoring-plugins.org";
 #include "../lib/utils_base.h"
 #include "../lib/output.h"
 #include "check_snmp.d/check_snmp_helpers.h"
+#include "check_snmp.d/check_snmp_state.h"
+#include "check_snmp.d/check_snmp_mib_index.h"
 
 #include <strings.h>
 #include <stdint.h>
+#include <ctype.h>
 
 #include "check_snmp.d/config.h"
 #include <stdlib.h>
@@ -60,7 +63,6 @@ const char *email = "devel@monitoring-plugins.org";
 #include <net-snmp/library/snmp_impl.h>
 #include <string.h>
 #include "../gl/regex.h"
-#include "../gl/base64.h"
 #include <assert.h>
 
 const char DEFAULT_COMMUNITY[] = "public";
@@ -81,172 +83,109 @@ typedef struct proces_arguments_wrapper {
 static process_arguments_wrapper process_arguments(int /*argc*/, char ** /*argv*/);
 static char *trim_whitespaces_and_check_quoting(char *str);
 static char *get_next_argument(char *str);
+static void add_host(check_snmp_config_snmp_parameters *params, const char *host);
+static void read_host_file(check_snmp_config_snmp_parameters *params, const char *path);
+static char *build_peername(char *host, const char *connection_prefix, const char *port);
+static check_snmp_state read_previous_state(state_key stateKey);
+static void write_state(state_key stateKey, time_t current_time, check_snmp_state_entry *entries,
+						size_t num_of_entries);
+static bool find_previous_state(const check_snmp_state_entry *entries, size_t num_of_entries,
+								const response_value *value, size_t *hint,
+								check_snmp_state_entry *result);
+static mp_check evaluate_table(check_snmp_config config, state_key stateKey, time_t current_time);
+static mp_check evaluate_hosts(check_snmp_config config, state_key stateKey, time_t current_time);
 void print_usage(void);
 void print_help(void);
 
 int verbose = 0;
 
-typedef struct {
-	int errorcode;
-	char *state_string;
-} gen_state_string_type;
-gen_state_string_type gen_state_string(check_snmp_state_entry *entries, size_t num_of_entries) {
-	char *encoded_string = NULL;
-	gen_state_string_type result = {.errorcode = OK, .state_string = NULL};
-
-	if (verbose > 1) {
-		printf("%s:\n", __FUNCTION__);
-		for (size_t i = 0; i < num_of_entries; i++) {
-			printf("Entry timestamp %lu: %s", entries[i].timestamp, ctime(&entries[i].timestamp));
-			switch (entries[i].type) {
-			case ASN_GAUGE:
-				printf("Type GAUGE\n");
-				break;
-			case ASN_TIMETICKS:
-				printf("Type TIMETICKS\n");
-				break;
-			case ASN_COUNTER:
-				printf("Type COUNTER\n");
-				break;
-			case ASN_UINTEGER:
-				printf("Type UINTEGER\n");
-				break;
-			case ASN_COUNTER64:
-				printf("Type COUNTER64\n");
-				break;
-			case ASN_FLOAT:
-				printf("Type FLOAT\n");
-				break;
-			case ASN_DOUBLE:
-				printf("Type DOUBLE\n");
-				break;
-			case ASN_INTEGER:
-				printf("Type INTEGER\n");
-				break;
-			}
-
-			switch (entries[i].type) {
-			case ASN_GAUGE:
-			case ASN_TIMETICKS:
-			case ASN_COUNTER:
-			case ASN_UINTEGER:
-			case ASN_COUNTER64:
-				printf("Value %llu\n", entries[i].value.uIntVal);
-				break;
-			case ASN_FLOAT:
-			case ASN_DOUBLE:
-				printf("Value %f\n", entries[i].value.doubleVal);
-				break;
-			case ASN_INTEGER:
-				printf("Value %lld\n", entries[i].value.intVal);
-				break;
-			}
+static void print_state_entries(const char *what, const check_snmp_state_entry *entries,
+								size_t num_of_entries) {
+	printf("%s: %zu entries\n", what, num_of_entries);
+	for (size_t i = 0; i < num_of_entries; i++) {
+		printf("Entry timestamp %lu: %s", entries[i].timestamp, ctime(&entries[i].timestamp));
+		switch (entries[i].type) {
+		case ASN_GAUGE:
+			printf("Type GAUGE\n");
+			break;
+		case ASN_TIMETICKS:
+			printf("Type TIMETICKS\n");
+			break;
+		case ASN_COUNTER:
+			printf("Type COUNTER\n");
+			break;
+		case ASN_UINTEGER:
+			printf("Type UINTEGER\n");
+			break;
+		case ASN_COUNTER64:
+			printf("Type COUNTER64\n");
+			break;
+		case ASN_FLOAT:
+			printf("Type FLOAT\n");
+			break;
+		case ASN_DOUBLE:
+			printf("Type DOUBLE\n");
+			break;
+		case ASN_INTEGER:
+			printf("Type INTEGER\n");
+			break;
 		}
-	}
 
-	idx_t encoded = base64_encode_alloc((const char *)entries,
-										(idx_t)(num_of_entries * sizeof(check_snmp_state_entry)),
-										&encoded_string);
-
-	if (encoded > 0 && encoded_string != NULL) {
-		// success
-		if (verbose > 1) {
-			printf("encoded string: %s\n", encoded_string);
-			printf("encoded string length: %lu\n", strlen(encoded_string));
+		switch (entries[i].type) {
+		case ASN_GAUGE:
+		case ASN_TIMETICKS:
+		case ASN_COUNTER:
+		case ASN_UINTEGER:
+		case ASN_COUNTER64:
+			printf("Value %llu\n", entries[i].value.uIntVal);
+			break;
+		case ASN_FLOAT:
+		case ASN_DOUBLE:
+		case ASN_INTEGER:
+			printf("Value %f\n", entries[i].value.doubleVal);
+			break;
 		}
-		result.state_string = encoded_string;
-		return result;
+		printf("Agent uptime %llu, %zu earlier samples\n", entries[i].agent_uptime,
+			   entries[i].number_of_samples);
 	}
-	result.errorcode = ERROR;
-	return result;
 }
 
-typedef struct {
-	int errorcode;
-	check_snmp_state_entry *state;
-} recover_state_data_type;
-recover_state_data_type recover_state_data(char *state_string, idx_t state_string_length) {
-	recover_state_data_type result = {.errorcode = OK, .state = NULL};
-
-	if (verbose > 1) {
-		printf("%s:\n", __FUNCTION__);
-		printf("State string: %s\n", state_string);
-		printf("State string length: %lu\n", state_string_length);
-	}
-
-	idx_t outlen = 0;
-	bool decoded =
-		base64_decode_alloc(state_string, state_string_length, (char **)&result.state, &outlen);
-
-	if (!decoded) {
-		if (verbose) {
-			printf("Failed to decode state string\n");
+/*
+ * The options are parsed after init_snmp, which needs to know beforehand whether to load
+ * the MIBs
+ */
+static bool mib_index_given(int argc, char **argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--mib-index", strlen("--mib-index")) == 0 &&
+			(argv[i][strlen("--mib-index")] == '\0' || argv[i][strlen("--mib-index")] == '=')) {
+			return true;
 		}
-		// failure to decode
-		result.errorcode = ERROR;
-		return result;
 	}
+	return false;
+}
 
-	if (result.state == NULL) {
-		// Memory Error?
-		result.errorcode = ERROR;
-		return result;
-	}
-
-	if (verbose > 1) {
-		printf("Recovered %lu entries of size %lu\n",
-			   (size_t)outlen / sizeof(check_snmp_state_entry), outlen);
-
-		for (size_t i = 0; i < (size_t)outlen / sizeof(check_snmp_state_entry); i++) {
-			printf("Entry timestamp %lu: %s", result.state[i].timestamp,
-				   ctime(&result.state[i].timestamp));
-			switch (result.state[i].type) {
-			case ASN_GAUGE:
-				printf("Type GAUGE\n");
-				break;
-			case ASN_TIMETICKS:
-				printf("Type TIMETICKS\n");
-				break;
-			case ASN_COUNTER:
-				printf("Type COUNTER\n");
-				break;
-			case ASN_UINTEGER:
-				printf("Type UINTEGER\n");
-				break;
-			case ASN_COUNTER64:
-				printf("Type COUNTER64\n");
-				break;
-			case ASN_FLOAT:
-				printf("Type FLOAT\n");
-				break;
-			case ASN_DOUBLE:
-				printf("Type DOUBLE\n");
-				break;
-			case ASN_INTEGER:
-				printf("Type INTEGER\n");
-				break;
-			}
-
-			switch (result.state[i].type) {
-			case ASN_GAUGE:
-			case ASN_TIMETICKS:
-			case ASN_COUNTER:
-			case ASN_UINTEGER:
-			case ASN_COUNTER64:
-				printf("Value %llu\n", result.state[i].value.uIntVal);
-				break;
-			case ASN_FLOAT:
-			case ASN_DOUBLE:
-				printf("Value %f\n", result.state[i].value.doubleVal);
-				break;
-			case ASN_INTEGER:
-				printf("Value %lld\n", result.state[i].value.intVal);
-				break;
+/*
+ * --mib-index-compile: writes the index of the loaded MIBs and exits without a check
+ */
+static void compile_mib_index(const char *path, char *miblist) {
+	if (miblist != NULL) {
+		for (char *module = strtok(miblist, ":"); module != NULL; module = strtok(NULL, ":")) {
+			if (strcmp(module, "ALL") == 0) {
+				read_all_mibs();
+			} else if (read_module(module) == NULL) {
+				die(STATE_UNKNOWN, _("Could not load MIB module %s\n"), module);
 			}
 		}
 	}
 
-	return result;
+	struct tree *tree_head = get_tree_head();
+	if (tree_head == NULL) {
+		die(STATE_UNKNOWN, _("No MIBs are loaded, nothing to write into the MIB index\n"));
+	}
+
+	size_t number_of_objects = check_snmp_mib_index_write(path, tree_head);
+	printf(_("Wrote %zu MIB objects to %s\n"), number_of_objects, path);
+	exit(STATE_OK);
 }
 
 int main(int argc, char **argv) {
@@ -265,6 +204,11 @@ int main(int argc, char **argv) {
 
 	np_set_args(argc, argv);
 
+	// init_snmp reads the MIB files, with a MIB index none of them are needed
+	if (mib_index_given(argc, argv)) {
+		setenv("MIBS", "", 1);
+	}
+
 	// Initialize net-snmp before touching the session we are going to use
 	init_snmp("check_snmp");
 
@@ -291,6 +235,14 @@ int main(int argc, char **argv) {
 		printf("current time: %s (timestamp: %lu)\n", ctime(&current_time), current_time);
 	}
 
+	if (config.snmp_params.table_mode) {
+		mp_exit(evaluate_table(config, stateKey, current_time));
+	}
+
+	if (config.snmp_params.number_of_hosts > 1) {
+		mp_exit(evaluate_hosts(config, stateKey, current_time));
+	}
+
 	snmp_responces response = do_snmp_query(config.snmp_params);
 
 	mp_check overall = mp_check_init();
@@ -319,32 +271,12 @@ int main(int argc, char **argv) {
 		mp_exit(overall);
 	}
 
-	check_snmp_state_entry *prev_state = NULL;
-	bool have_previous_state = false;
-
-	if (config.evaluation_params.calculate_rate) {
-		state_data *previous_state = np_state_read(stateKey);
-		if (previous_state == NULL) {
-			// failed to recover state
-			// or no previous state
-			have_previous_state = false;
-		} else {
-			// sanity check
-			recover_state_data_type prev_state_wrapper =
-				recover_state_data(previous_state->data, (idx_t)previous_state->length);
-
-			if (prev_state_wrapper.errorcode == OK) {
-				have_previous_state = true;
-				prev_state = prev_state_wrapper.state;
-			} else {
-				have_previous_state = false;
-				prev_state = NULL;
-			}
-		}
-	}
-
+	check_snmp_state prev_state = {.errorcode = ERROR};
 	check_snmp_state_entry *new_state = NULL;
+	size_t num_of_new_state_entries = 0;
 	if (config.evaluation_params.calculate_rate) {
+		prev_state = read_previous_state(stateKey);
+
 		new_state = calloc(config.snmp_params.num_of_test_units, sizeof(check_snmp_state_entry));
 		if (new_state == NULL) {
 			die(STATE_UNKNOWN, "memory allocation failed");
@@ -352,41 +284,303 @@ int main(int argc, char **argv) {
 	}
 
 	// We got the the query results, now process them
+	size_t prev_state_hint = 0;
 	for (size_t loop_index = 0; loop_index < config.snmp_params.num_of_test_units; loop_index++) {
 		if (verbose > 0) {
 			printf("loop_index: %zu\n", loop_index);
 		}
 
 		check_snmp_state_entry previous_unit_state = {};
-		if (config.evaluation_params.calculate_rate && have_previous_state) {
-			previous_unit_state = prev_state[loop_index];
+		bool have_previous_state = false;
+		if (prev_state.errorcode == OK) {
+			have_previous_state = find_previous_state(
+				prev_state.entries, prev_state.number_of_entries,
+				&response.response_values[loop_index], &prev_state_hint, &previous_unit_state);
 		}
 
 		check_snmp_evaluation single_eval =
 			evaluate_single_unit(response.response_values[loop_index], config.evaluation_params,
 								 config.snmp_params.test_units[loop_index], current_time,
-								 previous_unit_state, have_previous_state);
+								 response.agent_uptime, previous_unit_state, have_previous_state);
 
 		if (config.evaluation_params.calculate_rate &&
 			mp_compute_subcheck_state(single_eval.sc) != STATE_UNKNOWN) {
-			new_state[loop_index] = single_eval.state;
+			new_state[num_of_new_state_entries++] = single_eval.state;
 		}
 
 		mp_add_subcheck_to_check(&overall, single_eval.sc);
 	}
 
 	if (config.evaluation_params.calculate_rate) {
-		// store state
-		gen_state_string_type current_state_wrapper =
-			gen_state_string(new_state, config.snmp_params.num_of_test_units);
+		check_snmp_state_release(&prev_state);
+		write_state(stateKey, current_time, new_state, num_of_new_state_entries);
+	}
+	mp_exit(overall);
+}
 
-		if (current_state_wrapper.errorcode == OK) {
-			np_state_write_string(stateKey, current_time, current_state_wrapper.state_string);
-		} else {
-			die(STATE_UNKNOWN, "failed to create state string");
+static check_snmp_state read_previous_state(state_key stateKey) {
+	check_snmp_state result = check_snmp_state_read(stateKey._filename);
+	if (verbose > 1 && result.errorcode == OK) {
+		print_state_entries("Previous state", result.entries, result.number_of_entries);
+	}
+	return result;
+}
+
+static void write_state(state_key stateKey, time_t current_time, check_snmp_state_entry *entries,
+						size_t num_of_entries) {
+	if (num_of_entries == 0) {
+		// nothing worth to remember
+		return;
+	}
+
+	if (verbose > 1) {
+		print_state_entries("New state", entries, num_of_entries);
+	}
+	check_snmp_state_write(stateKey._filename, current_time, entries, num_of_entries);
+}
+
+/*
+ * Looks for the previous state of an OID. The previous run stored the table in the same
+ * order, so the search starts behind the last match.
+ */
+static bool find_previous_state(const check_snmp_state_entry *entries, size_t num_of_entries,
+								const response_value *value, size_t *hint,
+								check_snmp_state_entry *result) {
+	for (size_t i = 0; i < num_of_entries; i++) {
+		size_t candidate = (*hint + i) % num_of_entries;
+		if (snmp_oid_compare(entries[candidate].oid, entries[candidate].oid_length, value->oid,
+							 value->oid_length) == 0) {
+			*hint = candidate + 1;
+			*result = entries[candidate];
+			return true;
 		}
 	}
-	mp_exit(overall);
+	return false;
+}
+
+static mp_check evaluate_table(check_snmp_config config, state_key stateKey, time_t current_time) {
+	check_snmp_table table = do_snmp_table_walk(config.snmp_params);
+
+	mp_check overall = mp_check_init();
+	mp_set_ok_summary(&overall, "SNMP table walk is OK");
+
+	check_snmp_state prev_state = {.errorcode = ERROR};
+	if (config.evaluation_params.calculate_rate) {
+		prev_state = read_previous_state(stateKey);
+	}
+
+	size_t num_of_columns = config.snmp_params.num_of_test_units;
+	check_snmp_state_entry *new_state = NULL;
+	size_t num_of_new_state_entries = 0;
+	if (config.evaluation_params.calculate_rate && table.number_of_rows > 0) {
+		new_state = calloc(table.number_of_rows * num_of_columns, sizeof(check_snmp_state_entry));
+		if (new_state == NULL) {
+			die(STATE_UNKNOWN, "memory allocation failed");
+		}
+	}
+
+	mp_subcheck *row_subchecks = calloc(table.number_of_rows + 1, sizeof(mp_subcheck));
+	if (row_subchecks == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+
+	size_t prev_state_hint = 0;
+	for (size_t row_index = 0; row_index < table.number_of_rows; row_index++) {
+		check_snmp_table_row *row = &table.rows[row_index];
+
+		char *row_name = row->label;
+		if (row_name == NULL) {
+			// no label columns, name the row by its index
+			row_name = strdup("");
+			for (size_t i = 0; i < row->index_length; i++) {
+				xasprintf(&row_name, "%s%s%lu", row_name, (i == 0) ? "" : ".", row->index[i]);
+			}
+		}
+
+		mp_subcheck sc_row = mp_subcheck_init();
+		sc_row = mp_set_subcheck_default_state(sc_row, STATE_OK);
+		xasprintf(&sc_row.output, "%s", row_name);
+
+		for (size_t column = 0; column < num_of_columns; column++) {
+			check_snmp_test_unit test_unit = config.snmp_params.test_units[column];
+			const char *column_name = (test_unit.label != NULL && strcmp(test_unit.label, "") != 0)
+										  ? test_unit.label
+										  : test_unit.oid;
+			// the row is part of the label to keep the perfdata labels apart
+			xasprintf(&test_unit.label, "%s %s", row_name, column_name);
+
+			if (row->values[column].oid_length == 0) {
+				mp_subcheck sc_no_value = mp_subcheck_init();
+				xasprintf(&sc_no_value.output, "%s - no value in this row", test_unit.label);
+				sc_no_value =
+					mp_set_subcheck_state(sc_no_value, config.evaluation_params.nulloid_result);
+				mp_add_subcheck_to_subcheck(&sc_row, sc_no_value);
+				continue;
+			}
+
+			check_snmp_state_entry previous_unit_state = {};
+			bool have_previous_state = false;
+			if (prev_state.errorcode == OK) {
+				have_previous_state = find_previous_state(
+					prev_state.entries, prev_state.number_of_entries, &row->values[column],
+					&prev_state_hint, &previous_unit_state);
+			}
+
+			check_snmp_evaluation single_eval =
+				evaluate_single_unit(row->values[column], config.evaluation_params, test_unit,
+									 current_time, table.agent_uptime, previous_unit_state,
+									 have_previous_state);
+
+			if (config.evaluation_params.calculate_rate &&
+				mp_compute_subcheck_state(single_eval.sc) != STATE_UNKNOWN) {
+				new_state[num_of_new_state_entries++] = single_eval.state;
+			}
+
+			mp_add_subcheck_to_subcheck(&sc_row, single_eval.sc);
+		}
+
+		row_subchecks[row_index + 1] = sc_row;
+	}
+
+	mp_subcheck sc_walk = mp_subcheck_init();
+	if (table.number_of_rows > 0) {
+		xasprintf(&sc_walk.output, "SNMP table walk returned %zu rows in %zu requests",
+				  table.number_of_rows, table.number_of_requests);
+		sc_walk = mp_set_subcheck_state(sc_walk, STATE_OK);
+	} else {
+		xasprintf(&sc_walk.output, "SNMP table walk returned no rows");
+		sc_walk = mp_set_subcheck_state(sc_walk, config.evaluation_params.nulloid_result);
+	}
+	row_subchecks[0] = sc_walk;
+
+	// mp_add_subcheck_to_check prepends, add them backwards to keep the order of the table
+	for (size_t i = table.number_of_rows + 1; i > 0; i--) {
+		mp_add_subcheck_to_check(&overall, row_subchecks[i - 1]);
+	}
+
+	if (config.evaluation_params.calculate_rate) {
+		check_snmp_state_release(&prev_state);
+		write_state(stateKey, current_time, new_state, num_of_new_state_entries);
+	}
+
+	return overall;
+}
+
+static mp_check evaluate_hosts(check_snmp_config config, state_key stateKey, time_t current_time) {
+	size_t number_of_hosts = config.snmp_params.number_of_hosts;
+	size_t num_of_test_units = config.snmp_params.num_of_test_units;
+
+	snmp_responces *responses =
+		do_snmp_queries(config.snmp_params, config.snmp_params.hosts, number_of_hosts,
+						config.snmp_params.max_requests_in_flight);
+
+	mp_check overall = mp_check_init();
+	mp_set_ok_summary(&overall, "SNMP queries are OK");
+
+	mp_subcheck *host_subchecks = calloc(number_of_hosts, sizeof(mp_subcheck));
+	if (host_subchecks == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+
+	size_t number_of_failed_hosts = 0;
+	for (size_t host_index = 0; host_index < number_of_hosts; host_index++) {
+		const char *host = config.snmp_params.hosts[host_index];
+		snmp_responces response = responses[host_index];
+
+		mp_subcheck sc_host = mp_subcheck_init();
+		sc_host = mp_set_subcheck_default_state(sc_host, STATE_OK);
+
+		if (response.errorcode != OK) {
+			number_of_failed_hosts++;
+			xasprintf(&sc_host.output, "%s - %s", host, response.error_message);
+			host_subchecks[host_index] = mp_set_subcheck_state(sc_host, response.error_state);
+			continue;
+		}
+
+		if (response.number_of_results != num_of_test_units) {
+			number_of_failed_hosts++;
+			xasprintf(&sc_host.output,
+					  "%s - SNMP query returned %zu results, but %zu were requested", host,
+					  response.number_of_results, num_of_test_units);
+			host_subchecks[host_index] = mp_set_subcheck_state(sc_host, STATE_UNKNOWN);
+			continue;
+		}
+
+		xasprintf(&sc_host.output, "%s", host);
+
+		// every host keeps its own state, next to the one of the whole call
+		state_key host_state_key = stateKey;
+		check_snmp_state prev_state = {.errorcode = ERROR};
+		check_snmp_state_entry *new_state = NULL;
+		size_t num_of_new_state_entries = 0;
+		if (config.evaluation_params.calculate_rate) {
+			char *host_key_name = NULL;
+			xasprintf(&host_key_name, "%s_%s", stateKey.name, host);
+			for (char *ptr = host_key_name; *ptr != '\0'; ptr++) {
+				if (!isalnum((unsigned char)*ptr)) {
+					*ptr = '_';
+				}
+			}
+			host_state_key =
+				np_enable_state(host_key_name, stateKey.data_version, progname, 0, NULL);
+			prev_state = read_previous_state(host_state_key);
+
+			new_state = calloc(num_of_test_units, sizeof(check_snmp_state_entry));
+			if (new_state == NULL) {
+				die(STATE_UNKNOWN, "memory allocation failed");
+			}
+		}
+
+		size_t prev_state_hint = 0;
+		for (size_t unit = 0; unit < num_of_test_units; unit++) {
+			check_snmp_test_unit test_unit = config.snmp_params.test_units[unit];
+			const char *unit_name = (test_unit.label != NULL && strcmp(test_unit.label, "") != 0)
+										? test_unit.label
+										: test_unit.oid;
+			// the host is part of the label to keep the perfdata labels apart
+			xasprintf(&test_unit.label, "%s %s", host, unit_name);
+
+			check_snmp_state_entry previous_unit_state = {};
+			bool have_previous_state = false;
+			if (prev_state.errorcode == OK) {
+				have_previous_state = find_previous_state(
+					prev_state.entries, prev_state.number_of_entries,
+					&response.response_values[unit], &prev_state_hint, &previous_unit_state);
+			}
+
+			check_snmp_evaluation single_eval =
+				evaluate_single_unit(response.response_values[unit], config.evaluation_params,
+									 test_unit, current_time, response.agent_uptime,
+									 previous_unit_state, have_previous_state);
+
+			if (config.evaluation_params.calculate_rate &&
+				mp_compute_subcheck_state(single_eval.sc) != STATE_UNKNOWN) {
+				new_state[num_of_new_state_entries++] = single_eval.state;
+			}
+
+			mp_add_subcheck_to_subcheck(&sc_host, single_eval.sc);
+		}
+
+		if (config.evaluation_params.calculate_rate) {
+			check_snmp_state_release(&prev_state);
+			write_state(host_state_key, current_time, new_state, num_of_new_state_entries);
+			free(new_state);
+		}
+
+		host_subchecks[host_index] = sc_host;
+	}
+
+	// mp_add_subcheck_to_check prepends, add them backwards to keep the order of the hosts
+	for (size_t i = number_of_hosts; i > 0; i--) {
+		mp_add_subcheck_to_check(&overall, host_subchecks[i - 1]);
+	}
+
+	mp_subcheck sc_hosts = mp_subcheck_init();
+	xasprintf(&sc_hosts.output, "Queried %zu hosts, %zu of them failed", number_of_hosts,
+			  number_of_failed_hosts);
+	mp_add_subcheck_to_check(&overall, mp_set_subcheck_state(sc_hosts, STATE_OK));
+
+	return overall;
 }
 
 /* process command-line arguments */
@@ -399,7 +593,17 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 		connection_prefix_index,
 		output_format_index,
 		calculate_rate,
-		rate_multiplier
+		rate_multiplier,
+		rate_window_index,
+		table_index,
+		max_repetitions_index,
+		label_column_index,
+		oids_per_request_index,
+		host_file_index,
+		max_requests_in_flight_index,
+		engine_cache_index,
+		mib_index_index,
+		mib_index_compile_index
 	};
 
 	static struct option longopts[] = {
@@ -440,6 +644,16 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 		{"output-format", required_argument, 0, output_format_index},
 		{"rate", no_argument, 0, calculate_rate},
 		{"rate-multiplier", required_argument, 0, rate_multiplier},
+		{"rate-window", required_argument, 0, rate_window_index},
+		{"table", no_argument, 0, table_index},
+		{"max-repetitions", required_argument, 0, max_repetitions_index},
+		{"label-column", required_argument, 0, label_column_index},
+		{"oids-per-request", required_argument, 0, oids_per_request_index},
+		{"host-file", required_argument, 0, host_file_index},
+		{"max-requests-in-flight", required_argument, 0, max_requests_in_flight_index},
+		{"engine-cache", no_argument, 0, engine_cache_index},
+		{"mib-index", required_argument, 0, mib_index_index},
+		{"mib-index-compile", required_argument, 0, mib_index_compile_index},
 		{0, 0, 0, 0}};
 
 	if (argc < 2) {
@@ -452,6 +666,8 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 	// Count number of OIDs here first
 	int option = 0;
 	size_t oid_counter = 0;
+	char *mib_index_compile_path = NULL;
+	char *compile_miblist = NULL;
 	while (true) {
 		int option_char = getopt_long(
 			argc, argv,
@@ -474,6 +690,12 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 			}
 			break;
 		}
+		case 'm':
+			compile_miblist = optarg;
+			break;
+		case mib_index_compile_index:
+			mib_index_compile_path = optarg;
+			break;
 		case '?': /* usage */
 			usage5();
 			// fallthrough
@@ -489,6 +711,10 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 		}
 	}
 
+	if (mib_index_compile_path != NULL) {
+		compile_mib_index(mib_index_compile_path, compile_miblist);
+	}
+
 	/* Check whether at least one OID was given */
 	if (oid_counter == 0) {
 		die(STATE_UNKNOWN, _("No OIDs specified\n"));
@@ -521,6 +747,7 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 	char *miblist = NULL;
 	char *connection_prefix = NULL;
 	bool snmp_version_set_explicitely = false;
+	bool max_repetitions_set = false;
 	// TODO error checking
 	while (true) {
 		int option_char = getopt_long(
@@ -549,8 +776,10 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 			config.snmp_params.snmp_session.community = (unsigned char *)optarg;
 			config.snmp_params.snmp_session.community_len = strlen(optarg);
 			break;
-		case 'H': /* Host or server */
-			config.snmp_params.snmp_session.peername = optarg;
+		case 'H': /* Host(s) or server(s) */
+			for (char *ptr = strtok(optarg, ", "); ptr != NULL; ptr = strtok(NULL, ", ")) {
+				add_host(&config.snmp_params, ptr);
+			}
 			break;
 		case 'p': /*port number */
 			// Add port to "peername" below to not rely on argument order
@@ -846,63 +1075,95 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 				usage2(_("Rate multiplier must be a positive integer"), optarg);
 			}
 			break;
+		case rate_window_index:
+			if (!is_integer(optarg) || atoi(optarg) < 0) {
+				usage2(_("Rate window must be a non-negative integer"), optarg);
+			}
+			config.evaluation_params.rate_window = (unsigned int)atoi(optarg);
+			break;
+		case table_index:
+			config.snmp_params.table_mode = true;
+			break;
+		case max_repetitions_index:
+			if (!is_intpos(optarg) || (config.snmp_params.max_repetitions = atol(optarg)) <= 0) {
+				usage2(_("Max repetitions must be a positive integer"), optarg);
+			}
+			max_repetitions_set = true;
+			break;
+		case oids_per_request_index:
+			if (!is_intpos(optarg) || atoi(optarg) <= 0) {
+				usage2(_("OIDs per request must be a positive integer"), optarg);
+			}
+			config.snmp_params.oids_per_request = (size_t)atoi(optarg);
+			break;
+		case host_file_index:
+			read_host_file(&config.snmp_params, optarg);
+			break;
+		case max_requests_in_flight_index:
+			if (!is_intpos(optarg) || atoi(optarg) <= 0) {
+				usage2(_("Maximum number of requests in flight must be a positive integer"),
+					   optarg);
+			}
+			config.snmp_params.max_requests_in_flight = (size_t)atoi(optarg);
+			break;
+		case engine_cache_index:
+			config.snmp_params.use_engine_cache = true;
+			break;
+		case mib_index_index:
+			if (!check_snmp_mib_index_load(optarg)) {
+				die(STATE_UNKNOWN, _("Could not load MIB index %s\n"), optarg);
+			}
+			break;
+		case mib_index_compile_index:
+			break;
+		case label_column_index:
+			if (strspn(optarg, "0123456789.,") != strlen(optarg)) {
+				config.snmp_params.need_mibs = true;
+			}
+
+			for (char *ptr = strtok(optarg, ", "); ptr != NULL; ptr = strtok(NULL, ", ")) {
+				config.snmp_params.label_columns =
+					realloc(config.snmp_params.label_columns,
+							(config.snmp_params.num_of_label_columns + 1) * sizeof(char *));
+				if (config.snmp_params.label_columns == NULL) {
+					die(STATE_UNKNOWN, "memory allocation failed");
+				}
+				config.snmp_params.label_columns[config.snmp_params.num_of_label_columns++] =
+					strdup(ptr);
+			}
+			break;
 		default:
 			die(STATE_UNKNOWN, "Unknown option");
 		}
 	}
 
-	if (config.snmp_params.snmp_session.peername == NULL) {
-		config.snmp_params.snmp_session.peername = argv[optind];
+	if (config.snmp_params.number_of_hosts == 0 && argv[optind] != NULL) {
+		add_host(&config.snmp_params, argv[optind]);
 	}
 
-	// Build true peername here if necessary
-	if (connection_prefix != NULL) {
-		// We got something in the connection prefix
-		if (strcasecmp(connection_prefix, "udp") == 0) {
-			// The default, do nothing
-		} else if (strcasecmp(connection_prefix, "tcp") == 0) {
-			// use tcp/ipv4
-			xasprintf(&config.snmp_params.snmp_session.peername, "tcp:%s",
-					  config.snmp_params.snmp_session.peername);
-		} else if (strcasecmp(connection_prefix, "tcp6") == 0 ||
-				   strcasecmp(connection_prefix, "tcpv6") == 0 ||
-				   strcasecmp(connection_prefix, "tcpipv6") == 0 ||
-				   strcasecmp(connection_prefix, "udp6") == 0 ||
-				   strcasecmp(connection_prefix, "udpipv6") == 0 ||
-				   strcasecmp(connection_prefix, "udpv6") == 0) {
-			// Man page (or net-snmp) code says IPv6 addresses should be wrapped in [], but it
-			// works anyway therefore do nothing here
-			xasprintf(&config.snmp_params.snmp_session.peername, "%s:%s", connection_prefix,
-					  config.snmp_params.snmp_session.peername);
-		} else if (strcmp(connection_prefix, "tls") == 0) {
-			// TODO: Anything else to do here?
-			xasprintf(&config.snmp_params.snmp_session.peername, "tls:%s",
-					  config.snmp_params.snmp_session.peername);
-		} else if (strcmp(connection_prefix, "dtls") == 0) {
-			// TODO: Anything else to do here?
-			xasprintf(&config.snmp_params.snmp_session.peername, "dtls:%s",
-					  config.snmp_params.snmp_session.peername);
-		} else if (strcmp(connection_prefix, "unix") == 0) {
-			// TODO: Check whether this is a valid path?
-			xasprintf(&config.snmp_params.snmp_session.peername, "unix:%s",
-					  config.snmp_params.snmp_session.peername);
-		} else if (strcmp(connection_prefix, "ipx") == 0) {
-			xasprintf(&config.snmp_params.snmp_session.peername, "ipx:%s",
-					  config.snmp_params.snmp_session.peername);
-		} else {
-			// Don't know that prefix, die here
-			die(STATE_UNKNOWN, "Unknown connection prefix");
-		}
+	if (!config.snmp_params.table_mode &&
+		(max_repetitions_set || config.snmp_params.num_of_label_columns > 0)) {
+		usage4(_("--max-repetitions and --label-column require --table"));
+	}
+
+	if (config.snmp_params.table_mode && config.snmp_params.use_getnext) {
+		usage4(_("--next can not be combined with --table"));
 	}
 
 	/* Check server_address is given */
-	if (config.snmp_params.snmp_session.peername == NULL) {
+	if (config.snmp_params.number_of_hosts == 0) {
 		die(STATE_UNKNOWN, _("No host specified\n"));
 	}
 
-	if (port != NULL) {
-		xasprintf(&config.snmp_params.snmp_session.peername, "%s:%s",
-				  config.snmp_params.snmp_session.peername, port);
+	// Build true peernames here if necessary
+	for (size_t i = 0; i < config.snmp_params.number_of_hosts; i++) {
+		config.snmp_params.hosts[i] =
+			build_peername(config.snmp_params.hosts[i], connection_prefix, port);
+	}
+	config.snmp_params.snmp_session.peername = config.snmp_params.hosts[0];
+
+	if (config.snmp_params.number_of_hosts > 1 && config.snmp_params.table_mode) {
+		usage4(_("--table can only be used with a single host"));
 	}
 
 	/* check whether to load locally installed MIBS (CPU/disk intensive) */
@@ -984,6 +1245,9 @@ static process_arguments_wrapper process_arguments(int argc, char **argv) {
 		}
 	}
 
+	// a restart of the agent resets its counters, sysUpTime tells when that happened
+	config.snmp_params.query_agent_uptime = config.evaluation_params.calculate_rate;
+
 	process_arguments_wrapper result = {
 		.config = config,
 		.errorcode = OK,
@@ -1030,6 +1294,83 @@ char *get_next_argument(char *str) {
 	return NULL;
 }
 
+static void add_host(check_snmp_config_snmp_parameters *params, const char *host) {
+	char **tmp = realloc(params->hosts, (params->number_of_hosts + 1) * sizeof(char *));
+	if (tmp == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	params->hosts = tmp;
+	params->hosts[params->number_of_hosts] = strdup(host);
+	if (params->hosts[params->number_of_hosts] == NULL) {
+		die(STATE_UNKNOWN, "strdup failed");
+	}
+	params->number_of_hosts++;
+}
+
+/* one host per line, empty lines and lines starting with '#' are ignored */
+static void read_host_file(check_snmp_config_snmp_parameters *params, const char *path) {
+	FILE *host_file = fopen(path, "r");
+	if (host_file == NULL) {
+		die(STATE_UNKNOWN, _("Cannot open host file %s: %s\n"), path, strerror(errno));
+	}
+
+	char *line = NULL;
+	size_t line_size = 0;
+	while (getline(&line, &line_size, host_file) > 0) {
+		char *host = line + strspn(line, " \t");
+		host[strcspn(host, " \t\r\n#")] = '\0';
+		if (host[0] != '\0') {
+			add_host(params, host);
+		}
+	}
+
+	free(line);
+	fclose(host_file);
+}
+
+static char *build_peername(char *host, const char *connection_prefix, const char *port) {
+	char *peername = host;
+
+	if (connection_prefix != NULL) {
+		// We got something in the connection prefix
+		if (strcasecmp(connection_prefix, "udp") == 0) {
+			// The default, do nothing
+		} else if (strcasecmp(connection_prefix, "tcp") == 0) {
+			// use tcp/ipv4
+			xasprintf(&peername, "tcp:%s", host);
+		} else if (strcasecmp(connection_prefix, "tcp6") == 0 ||
+				   strcasecmp(connection_prefix, "tcpv6") == 0 ||
+				   strcasecmp(connection_prefix, "tcpipv6") == 0 ||
+				   strcasecmp(connection_prefix, "udp6") == 0 ||
+				   strcasecmp(connection_prefix, "udpipv6") == 0 ||
+				   strcasecmp(connection_prefix, "udpv6") == 0) {
+			// Man page (or net-snmp) code says IPv6 addresses should be wrapped in [], but it
+			// works anyway therefore do nothing here
+			xasprintf(&peername, "%s:%s", connection_prefix, host);
+		} else if (strcmp(connection_prefix, "tls") == 0) {
+			// TODO: Anything else to do here?
+			xasprintf(&peername, "tls:%s", host);
+		} else if (strcmp(connection_prefix, "dtls") == 0) {
+			// TODO: Anything else to do here?
+			xasprintf(&peername, "dtls:%s", host);
+		} else if (strcmp(connection_prefix, "unix") == 0) {
+			// TODO: Check whether this is a valid path?
+			xasprintf(&peername, "unix:%s", host);
+		} else if (strcmp(connection_prefix, "ipx") == 0) {
+			xasprintf(&peername, "ipx:%s", host);
+		} else {
+			// Don't know that prefix, die here
+			die(STATE_UNKNOWN, "Unknown connection prefix");
+		}
+	}
+
+	if (port != NULL) {
+		xasprintf(&peername, "%s:%s", peername, port);
+	}
+
+	return peername;
+}
+
 void print_help(void) {
 	print_revision(progname, NP_VERSION);
 
@@ -1044,6 +1385,13 @@ void print_help(void) {
 	printf(UT_HELP_VRSN);
 	printf(UT_EXTRA_OPTS);
 	printf(UT_HOST_PORT, 'p', DEFAULT_PORT);
+	printf("    %s\n", _("Several hosts may be given as a comma separated list, they are queried"));
+	printf("    %s\n", _("concurrently and checked one by one"));
+	printf(" %s\n", "--host-file=PATH");
+	printf("    %s\n", _("Read hosts from a file, one per line"));
+	printf(" %s\n", "--max-requests-in-flight=INTEGER");
+	printf("    %s %i)\n", _("Requests which are in flight at once with several hosts (default:"),
+		   DEFAULT_MAX_REQUESTS_IN_FLIGHT);
 
 	/* SNMP and Authentication Protocol */
 	printf(" %s\n", "-n, --next");
@@ -1074,6 +1422,10 @@ void print_help(void) {
 	printf("    %s\n", _("SNMPv3 authentication password"));
 	printf(" %s\n", "-X, --privpasswd=PASSWORD");
 	printf("    %s\n", _("SNMPv3 privacy password"));
+	printf(" %s\n", "--engine-cache");
+	printf("    %s\n", _("Remember engineID, engineBoots and engineTime of SNMPv3 agents next to"));
+	printf("    %s\n", _("the state files and skip the engine discovery on later runs. The"));
+	printf("    %s\n", _("discovery is repeated if the agent does not accept the cached engine"));
 	printf(" %s\n", "--connection-prefix");
 	printf("    Connection prefix, may be one of udp, udp6, tcp, unix, ipx, udp6, udpv6, udpipv6, "
 		   "tcp6, tcpv6, tcpipv6, tls, dtls - "
@@ -1088,6 +1440,27 @@ void print_help(void) {
 	printf("    %s\n", _("for symbolic OIDs.)"));
 	printf("    %s\n", _("Any data on the right hand side of the delimiter is considered"));
 	printf("    %s\n", _("to be the data that should be used in the evaluation."));
+	printf(" %s\n", "--mib-index=PATH");
+	printf("    %s\n", _("Resolve symbolic OIDs with a MIB index instead of loading the MIB files"));
+	printf("    %s\n", _("The names of enumerated values, e.g. up(1), are taken from it as well"));
+	printf(" %s\n", "--mib-index-compile=PATH");
+	printf("    %s\n", _("Write the objects of the MIBs (see -m, e.g. -m ALL) into a MIB index for"));
+	printf("    %s\n", _("--mib-index and exit, no check is run. Repeat it when the MIBs change"));
+	printf(" %s\n", "--oids-per-request=INTEGER");
+	printf("    %s %i)\n", _("Maximum number of OIDs in one request (default:"),
+		   DEFAULT_OIDS_PER_REQUEST);
+	printf("    %s\n", _("More OIDs are split into several requests which are sent without"));
+	printf("    %s\n", _("waiting for each other. Halved if the agent answers tooBig"));
+	printf(" %s\n", "--table");
+	printf("    %s\n", _("Walk the OIDs as columns of a table (e.g. ifHCInOctets,ifOperStatus)"));
+	printf("    %s\n", _("with GETBULK and check every row. Thresholds, units and labels apply"));
+	printf("    %s\n", _("per column"));
+	printf(" %s\n", "--label-column=OID(s)");
+	printf("    %s\n", _("Column(s) naming the rows of the table (e.g. ifDescr), default is"));
+	printf("    %s\n", _("the index of the row"));
+	printf(" %s\n", "--max-repetitions=INTEGER");
+	printf("    %s %i)\n", _("Rows requested per column and GETBULK request (default:"),
+		   DEFAULT_MAX_REPETITIONS);
 	printf(" %s\n", "-z, --nulloid=#");
 	printf("    %s\n", _("If the check returns a 0 length string or NULL value"));
 	printf("    %s\n", _("This option allows you to choose what status you want it to exit"));
@@ -1124,6 +1497,12 @@ void print_help(void) {
 	printf("    %s\n", _("Units label(s) for output data (e.g., 'sec.')."));
 	printf(" %s\n", "-M, --multiplier=FLOAT");
 	printf("    %s\n", _("Multiplies current value, 0 < n < 1 works as divider, defaults to 1"));
+	printf(" %s\n", "--rate-window=SECONDS");
+	printf("    %s\n", _("With --rate, compute the rate over the values of this many seconds instead"));
+	printf("    %s%i%s\n", _("of the previous one only to smooth irregular polling (at most "),
+		   CHECK_SNMP_RATE_SAMPLES, _(" values)"));
+	printf("    %s\n", _("Wraps of 32 bit counters are taken into account, a restart of the agent"));
+	printf("    %s\n", _("(sysUpTime) or a 64 bit counter going back starts over"));
 	printf(UT_OUTPUT_FORMAT);
 
 	printf(UT_CONN_TIMEOUT, DEFAULT_SOCKET_TIMEOUT);
@@ -1172,5 +1551,8 @@ void print_usage(void) {
 	printf("[-l label] [-u units] [-p port-number] [-d delimiter] [-D output-delimiter]\n");
 	printf("[-m miblist] [-P snmp version] [-N context] [-L seclevel] [-U secname]\n");
 	printf("[-a authproto] [-A authpasswd] [-x privproto] [-X privpasswd] [-4|6]\n");
-	printf("[-M multiplier]\n");
+	printf("[-M multiplier] [--rate [--rate-window=SECONDS]] [--oids-per-request=INTEGER]\n");
+	printf("[--host-file=PATH] [--max-requests-in-flight=INTEGER] [--engine-cache]\n");
+	printf("[--table [--label-column=OID] [--max-repetitions=INTEGER]] [--mib-index=PATH]\n");
+	printf("%s --mib-index-compile=PATH [-m miblist]\n", progname);
 }
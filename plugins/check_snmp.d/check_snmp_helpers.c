@@ -1,4 +1,6 @@
 #include "./check_snmp_helpers.h"
+#include "./check_snmp_state.h"
+#include "./check_snmp_mib_index.h"
 #include <string.h>
 #include "../../lib/utils_base.h"
 #include "config.h"
@@ -7,7 +9,10 @@
 #include "output.h"
 #include "states.h"
 #include <sys/stat.h>
+#include <sys/select.h>
 #include <ctype.h>
+#include <errno.h>
+#include <net-snmp/library/lcd_time.h>
 
 extern int verbose;
 
@@ -95,6 +100,12 @@ check_snmp_config check_snmp_config_init() {
 	check_snmp_config tmp = {
 		.snmp_params =
 			{
+				.hosts = NULL,
+				.number_of_hosts = 0,
+				.max_requests_in_flight = DEFAULT_MAX_REQUESTS_IN_FLIGHT,
+				.use_engine_cache = false,
+				.query_agent_uptime = false,
+
 				.use_getnext = false,
 
 				.ignore_mib_parsing_errors = false,
@@ -102,6 +113,12 @@ check_snmp_config check_snmp_config_init() {
 
 				.test_units = NULL,
 				.num_of_test_units = 0,
+				.oids_per_request = DEFAULT_OIDS_PER_REQUEST,
+
+				.table_mode = false,
+				.max_repetitions = DEFAULT_MAX_REPETITIONS,
+				.label_columns = NULL,
+				.num_of_label_columns = 0,
 			},
 
 		.evaluation_params =
@@ -121,6 +138,7 @@ check_snmp_config check_snmp_config_init() {
 
 				.calculate_rate = false,
 				.rate_multiplier = 1,
+				.rate_window = 0,
 			},
 	};
 
@@ -134,7 +152,393 @@ check_snmp_config check_snmp_config_init() {
 	return tmp;
 }
 
-snmp_responces do_snmp_query(check_snmp_config_snmp_parameters parameters) {
+/*
+ * Copies the value of a variable binding into a response_value, strings are duplicated
+ */
+static response_value snmp_variable_to_response_value(const netsnmp_variable_list *vars) {
+	response_value result = {
+		.oid_length = vars->name_length,
+		.type = vars->type,
+	};
+
+	for (size_t jdx = 0; jdx < vars->name_length; jdx++) {
+		result.oid[jdx] = vars->name[jdx];
+	}
+
+	switch (vars->type) {
+	case ASN_OCTET_STR:
+		result.string_response = strndup((char *)vars->val.string, vars->val_len);
+		if (verbose) {
+			printf("Debug: Got a string as response: %s\n", result.string_response);
+		}
+		break;
+	case ASN_OPAQUE:
+		if (verbose) {
+			printf("Debug: Got OPAQUE\n");
+		}
+		break;
+	/* Numerical values */
+	case ASN_COUNTER64: {
+		if (verbose) {
+			printf("Debug: Got counter64\n");
+		}
+		struct counter64 tmp = *(vars->val.counter64);
+		uint64_t counter = (tmp.high << 32) + tmp.low;
+		result.value.uIntVal = counter;
+	} break;
+	case ASN_GAUGE: // same as ASN_UNSIGNED
+	case ASN_TIMETICKS:
+	case ASN_COUNTER:
+	case ASN_UINTEGER:
+		if (verbose) {
+			printf("Debug: Got a Integer like\n");
+		}
+		result.value.uIntVal = (unsigned long)*(vars->val.integer);
+		break;
+	case ASN_INTEGER:
+		if (verbose) {
+			printf("Debug: Got a Integer\n");
+		}
+		result.value.intVal = *(vars->val.integer);
+		break;
+	case ASN_FLOAT:
+		if (verbose) {
+			printf("Debug: Got a float\n");
+		}
+		result.value.doubleVal = *(vars->val.floatVal);
+		break;
+	case ASN_DOUBLE:
+		if (verbose) {
+			printf("Debug: Got a double\n");
+		}
+		result.value.doubleVal = *(vars->val.doubleVal);
+		break;
+	case ASN_IPADDRESS:
+		if (verbose) {
+			printf("Debug: Got an IP address\n");
+		}
+		// TODO: print address here, state always ok? or regex match?
+		break;
+	default:
+		if (verbose) {
+			printf("Debug: Got a unmatched result type: %hhu\n", vars->type);
+		}
+		// TODO: Error here?
+		break;
+	}
+
+	return result;
+}
+
+// how a session uses the engine cache of --engine-cache
+typedef struct {
+	// NULL without engine cache
+	char *path;
+	bool from_cache;
+	// the engine as expected when the session was opened
+	unsigned int engine_boots;
+	unsigned int engine_time;
+} engine_cache_use;
+
+/*
+ * Opens a session to the agent. With the engine cache an SNMPv3 session starts with the
+ * engine remembered by an earlier run, so the library skips the engine discovery and the
+ * time synchronization.
+ */
+static struct snmp_session *open_session(struct snmp_session session, bool use_engine_cache,
+										 engine_cache_use *engine_cache) {
+	*engine_cache = (engine_cache_use){.path = NULL, .from_cache = false};
+
+	check_snmp_engine engine = {.errorcode = ERROR};
+	if (use_engine_cache && session.version == SNMP_VERSION_3 && session.peername != NULL) {
+		engine_cache->path = check_snmp_engine_cache_path(session.peername);
+		engine = check_snmp_engine_cache_read(engine_cache->path);
+	}
+
+	if (engine.errorcode == OK) {
+		if (verbose > 1) {
+			printf("Using the cached engine of %s\n", session.peername);
+		}
+		engine_cache->from_cache = true;
+		engine_cache->engine_boots = engine.engine_boots;
+		engine_cache->engine_time =
+			engine.engine_time + (unsigned int)(time(NULL) - engine.timestamp);
+
+		// the library copies these
+		session.securityEngineID = engine.engine_id;
+		session.securityEngineIDLen = engine.engine_id_length;
+		session.engineBoots = engine_cache->engine_boots;
+		session.engineTime = engine_cache->engine_time;
+	}
+
+	return snmp_open(&session);
+}
+
+/*
+ * A cached engine which the agent rejects is outdated, e.g. after the agent was
+ * reconfigured. The library resynchronizes the time by itself if it can.
+ */
+static bool engine_is_stale(const engine_cache_use *engine_cache, int snmp_error) {
+	return engine_cache->from_cache &&
+		   (snmp_error == SNMPERR_UNKNOWN_ENG_ID || snmp_error == SNMPERR_NOT_IN_TIME_WINDOW);
+}
+
+static void forget_engine(const engine_cache_use *engine_cache, const char *peername) {
+	if (verbose > 0) {
+		printf("The cached engine of %s is outdated, discovering it again\n", peername);
+	}
+	check_snmp_engine_cache_remove(engine_cache->path);
+}
+
+/*
+ * Stores the engine of a session after a successful query, unless the cache already
+ * knows it
+ */
+static void remember_engine(struct snmp_session *session, const engine_cache_use *engine_cache) {
+	if (engine_cache->path == NULL || session->securityEngineIDLen == 0 ||
+		session->securityEngineIDLen > CHECK_SNMP_ENGINE_ID_MAX_LENGTH) {
+		return;
+	}
+
+	check_snmp_engine engine = {
+		.engine_id_length = session->securityEngineIDLen,
+		.timestamp = time(NULL),
+	};
+	memcpy(engine.engine_id, session->securityEngineID, session->securityEngineIDLen);
+	if (get_enginetime(session->securityEngineID, (unsigned int)session->securityEngineIDLen,
+					   &engine.engine_boots, &engine.engine_time, TRUE) != SNMPERR_SUCCESS) {
+		return;
+	}
+
+	unsigned int drift = (engine.engine_time > engine_cache->engine_time)
+							 ? engine.engine_time - engine_cache->engine_time
+							 : engine_cache->engine_time - engine.engine_time;
+	if (engine_cache->from_cache && engine.engine_boots == engine_cache->engine_boots &&
+		drift <= ENGINE_CACHE_TIME_TOLERANCE) {
+		return;
+	}
+
+	check_snmp_engine_cache_write(engine_cache->path, engine);
+}
+
+typedef struct {
+	oid name[MAX_OID_LEN];
+	size_t length;
+} parsed_oid;
+
+// consecutive test units, sent in one PDU if they fit
+typedef struct {
+	size_t first;
+	size_t count;
+} unit_range;
+
+/*
+ * A query of the test units on one session. The units are split into PDUs of at most
+ * chunk_size variable bindings, a few of them are in flight at the same time.
+ */
+typedef struct {
+	struct snmp_session *session;
+	engine_cache_use engine_cache;
+	bool use_getnext;
+	// the units behind this index (sysUpTime.0) are always sent with GET
+	size_t getnext_count;
+	const parsed_oid *oids;
+
+	size_t chunk_size;
+	// ranges not sent yet (or to be sent again in smaller chunks), used as a stack
+	unit_range *pending;
+	size_t number_of_pending;
+	size_t in_flight;
+
+	snmp_responces result;
+	bool failed;
+	// the agent rejected the cached engine, the query has to start over
+	bool stale_engine;
+	mp_state_enum error_state;
+	char *error_message;
+} snmp_query;
+
+typedef struct {
+	snmp_query *query;
+	unit_range range;
+} snmp_query_request;
+
+static size_t requests_in_flight = 0;
+// limit over all sessions
+static size_t max_requests_in_flight = SIZE_MAX;
+
+static void snmp_query_fail(snmp_query *query, mp_state_enum state, const char *message) {
+	if (!query->failed) {
+		query->failed = true;
+		query->error_state = state;
+		query->error_message = strdup(message);
+	}
+}
+
+static void snmp_query_push_range(snmp_query *query, unit_range range) {
+	unit_range *tmp = realloc(query->pending, (query->number_of_pending + 1) * sizeof(unit_range));
+	if (tmp == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	query->pending = tmp;
+	query->pending[query->number_of_pending++] = range;
+}
+
+static int snmp_query_callback(int operation, struct snmp_session *session, int reqid,
+							   struct snmp_pdu *response, void *magic);
+
+/*
+ * Sends PDUs of pending units until the pipeline of the query is full
+ */
+static void snmp_query_send(snmp_query *query) {
+	while (!query->failed && query->number_of_pending > 0 &&
+		   query->in_flight < SNMP_PIPELINE_DEPTH && requests_in_flight < max_requests_in_flight) {
+		unit_range range = query->pending[--query->number_of_pending];
+		if (range.count > query->chunk_size) {
+			// send the beginning now, the rest later
+			snmp_query_push_range(query, (unit_range){.first = range.first + query->chunk_size,
+													  .count = range.count - query->chunk_size});
+			range.count = query->chunk_size;
+		}
+
+		// ranges never cross getnext_count, see snmp_query_init
+		bool use_getnext = query->use_getnext && range.first < query->getnext_count;
+		struct snmp_pdu *pdu = snmp_pdu_create(use_getnext ? SNMP_MSG_GETNEXT : SNMP_MSG_GET);
+		for (size_t i = range.first; i < range.first + range.count; i++) {
+			snmp_add_null_var(pdu, query->oids[i].name, query->oids[i].length);
+		}
+
+		snmp_query_request *request = malloc(sizeof(snmp_query_request));
+		if (request == NULL) {
+			die(STATE_UNKNOWN, "memory allocation failed");
+		}
+		request->query = query;
+		request->range = range;
+
+		if (verbose > 1) {
+			printf("Sending OIDs %zu to %zu\n", range.first, range.first + range.count - 1);
+		}
+
+		if (snmp_async_send(query->session, pdu, snmp_query_callback, request) == 0) {
+			int pcliberr = 0;
+			int psnmperr = 0;
+			char *pperrstring = NULL;
+			snmp_error(query->session, &pcliberr, &psnmperr, &pperrstring);
+			snmp_free_pdu(pdu);
+			free(request);
+
+			char *message = NULL;
+			xasprintf(&message, "SNMP query failed: %s", pperrstring);
+			snmp_query_fail(query, STATE_UNKNOWN, message);
+			return;
+		}
+
+		query->in_flight++;
+		requests_in_flight++;
+	}
+}
+
+static int snmp_query_callback(int operation, struct snmp_session *session, int reqid,
+							   struct snmp_pdu *response, void *magic) {
+	snmp_query_request *request = magic;
+	snmp_query *query = request->query;
+	unit_range range = request->range;
+	free(request);
+
+	query->in_flight--;
+	requests_in_flight--;
+
+	if (query->failed) {
+		return 1;
+	}
+
+	if (operation == NETSNMP_CALLBACK_OP_TIMED_OUT) {
+		// We exit with critical here for some historical reason
+		snmp_query_fail(query, STATE_CRITICAL, "SNMP query ran into a timeout");
+		return 1;
+	}
+
+	if (operation != NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE || response == NULL) {
+		snmp_query_fail(query, STATE_UNKNOWN, "SNMP query failed");
+		return 1;
+	}
+
+	if (response->command == SNMP_MSG_REPORT) {
+		int report_type = snmpv3_get_report_type(response);
+		query->stale_engine = engine_is_stale(&query->engine_cache, report_type);
+
+		char *message = NULL;
+		xasprintf(&message, "SNMP query failed: %s", snmp_api_errstring(report_type));
+		snmp_query_fail(query, STATE_UNKNOWN, message);
+		return 1;
+	}
+
+	if (response->errstat == SNMP_ERR_TOOBIG) {
+		if (range.count == 1) {
+			snmp_query_fail(query, STATE_UNKNOWN,
+							"SNMP query failed: the response for a single OID is too big");
+			return 1;
+		}
+
+		// the agent can not answer that many at once, continue with smaller chunks
+		query->chunk_size = (range.count / 2 < query->chunk_size) ? range.count / 2
+																   : query->chunk_size;
+		if (verbose > 0) {
+			printf("Response too big, sending %zu OIDs per request now\n", query->chunk_size);
+		}
+		snmp_query_push_range(query, range);
+		snmp_query_send(query);
+		return 1;
+	}
+
+	if (response->errstat != SNMP_ERR_NOERROR) {
+		char *message = NULL;
+		xasprintf(&message, "SNMP query failed: %s", snmp_errstring((int)response->errstat));
+		snmp_query_fail(query, STATE_UNKNOWN, message);
+		return 1;
+	}
+
+	size_t unit = range.first;
+	for (netsnmp_variable_list *vars = response->variables;
+		 vars != NULL && unit < range.first + range.count; vars = vars->next_variable, unit++) {
+		query->result.response_values[unit] = snmp_variable_to_response_value(vars);
+		query->result.number_of_results++;
+	}
+
+	snmp_query_send(query);
+	return 1;
+}
+
+/*
+ * Waits for responses or timeouts of the open sessions and runs their callbacks
+ */
+static void snmp_query_wait_once(void) {
+	int number_of_fds = 0;
+	int block = 1;
+	fd_set fdset;
+	struct timeval timeout;
+	FD_ZERO(&fdset);
+
+	snmp_select_info(&number_of_fds, &fdset, &timeout, &block);
+	int count = select(number_of_fds, &fdset, NULL, NULL, block ? NULL : &timeout);
+
+	if (count > 0) {
+		snmp_read(&fdset);
+	} else if (count == 0) {
+		snmp_timeout();
+	} else if (errno != EINTR) {
+		die(STATE_UNKNOWN, "select failed: %s\n", strerror(errno));
+	}
+}
+
+// sysUpTime.0 of SNMPv2-MIB, queried behind the test units with query_agent_uptime
+static const oid sysuptime_oid[] = {1, 3, 6, 1, 2, 1, 1, 3, 0};
+
+static size_t number_of_query_oids(check_snmp_config_snmp_parameters parameters) {
+	return parameters.num_of_test_units + (parameters.query_agent_uptime ? 1 : 0);
+}
+
+static parsed_oid *parse_test_unit_oids(check_snmp_config_snmp_parameters parameters) {
 	if (parameters.ignore_mib_parsing_errors) {
 		char *opt_toggle_res = snmp_mib_toggle_options("e");
 		if (opt_toggle_res != NULL) {
@@ -142,11 +546,15 @@ snmp_responces do_snmp_query(check_snmp_config_snmp_parameters parameters) {
 		}
 	}
 
-	struct snmp_pdu *pdu = NULL;
-	if (parameters.use_getnext) {
-		pdu = snmp_pdu_create(SNMP_MSG_GETNEXT);
-	} else {
-		pdu = snmp_pdu_create(SNMP_MSG_GET);
+	parsed_oid *oids = calloc(number_of_query_oids(parameters), sizeof(parsed_oid));
+	if (oids == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+
+	if (parameters.query_agent_uptime) {
+		parsed_oid *uptime = &oids[parameters.num_of_test_units];
+		memcpy(uptime->name, sysuptime_oid, sizeof(sysuptime_oid));
+		uptime->length = OID_LENGTH(sysuptime_oid);
 	}
 
 	for (size_t i = 0; i < parameters.num_of_test_units; i++) {
@@ -155,152 +563,330 @@ snmp_responces do_snmp_query(check_snmp_config_snmp_parameters parameters) {
 			printf("OID %zu to parse: %s\n", i, parameters.test_units[i].oid);
 		}
 
-		oid tmp_OID[MAX_OID_LEN];
-		size_t tmp_OID_len = MAX_OID_LEN;
-		if (snmp_parse_oid(parameters.test_units[i].oid, tmp_OID, &tmp_OID_len) != NULL) {
-			// success
-			snmp_add_null_var(pdu, tmp_OID, tmp_OID_len);
-		} else {
+		oids[i].length = MAX_OID_LEN;
+		if (check_snmp_parse_oid(parameters.test_units[i].oid, oids[i].name, &oids[i].length) ==
+			NULL) {
 			// failed
 			snmp_perror("Parsing failure");
 			die(STATE_UNKNOWN, "Failed to parse OID\n");
 		}
 	}
 
-	const int timeout_safety_tolerance = 5;
-	alarm((timeout_interval * (unsigned int)parameters.snmp_session.retries) +
-		  timeout_safety_tolerance);
+	return oids;
+}
+
+static snmp_query snmp_query_init(struct snmp_session *session,
+								  check_snmp_config_snmp_parameters parameters,
+								  const parsed_oid *oids) {
+	snmp_query query = {
+		.session = session,
+		.use_getnext = parameters.use_getnext,
+		.getnext_count = parameters.num_of_test_units,
+		.oids = oids,
+		.chunk_size = parameters.oids_per_request,
+		.result =
+			{
+				.errorcode = OK,
+				.response_values = calloc(number_of_query_oids(parameters), sizeof(response_value)),
+				.number_of_results = 0,
+			},
+	};
+
+	if (query.result.response_values == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+
+	if (parameters.use_getnext && parameters.query_agent_uptime) {
+		// GETNEXT of sysUpTime.0 would return the object behind it, it needs a GET of its own
+		snmp_query_push_range(&query,
+							  (unit_range){.first = parameters.num_of_test_units, .count = 1});
+		snmp_query_push_range(&query,
+							  (unit_range){.first = 0, .count = parameters.num_of_test_units});
+	} else {
+		snmp_query_push_range(&query,
+							  (unit_range){.first = 0, .count = number_of_query_oids(parameters)});
+	}
+	return query;
+}
+
+/*
+ * Moves sysUpTime.0 from behind the values of the test units into agent_uptime
+ */
+static void snmp_query_take_agent_uptime(snmp_responces *result,
+										 check_snmp_config_snmp_parameters parameters) {
+	if (!parameters.query_agent_uptime) {
+		return;
+	}
+
+	response_value *uptime = &result->response_values[parameters.num_of_test_units];
+	if (uptime->oid_length > 0) {
+		result->number_of_results--;
+	}
+	if (uptime->type == ASN_TIMETICKS) {
+		result->agent_uptime = uptime->value.uIntVal;
+	}
+}
+
+/*
+ * Opens a session to the agent and sends the first PDUs of the query
+ */
+static void snmp_query_start(snmp_query *query, check_snmp_config_snmp_parameters parameters,
+							 char *peername, const parsed_oid *oids) {
+	struct snmp_session session = parameters.snmp_session;
+	session.peername = peername;
+
+	engine_cache_use engine_cache;
+	struct snmp_session *active_session =
+		open_session(session, parameters.use_engine_cache, &engine_cache);
+	*query = snmp_query_init(active_session, parameters, oids);
+	query->engine_cache = engine_cache;
 
-	struct snmp_session *active_session = snmp_open(&parameters.snmp_session);
 	if (active_session == NULL) {
 		int pcliberr = 0;
 		int psnmperr = 0;
 		char *pperrstring = NULL;
-		snmp_error(&parameters.snmp_session, &pcliberr, &psnmperr, &pperrstring);
-		die(STATE_UNKNOWN, "Failed to open SNMP session: %s\n", pperrstring);
+		snmp_error(&session, &pcliberr, &psnmperr, &pperrstring);
+
+		char *message = NULL;
+		xasprintf(&message, "Failed to open SNMP session: %s", pperrstring);
+		snmp_query_fail(query, STATE_UNKNOWN, message);
+		return;
 	}
 
-	struct snmp_pdu *response = NULL;
-	int snmp_query_status = snmp_synch_response(active_session, pdu, &response);
+	snmp_query_send(query);
+}
 
-	if (!(snmp_query_status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR)) {
-		int pcliberr = 0;
-		int psnmperr = 0;
-		char *pperrstring = NULL;
-		snmp_error(active_session, &pcliberr, &psnmperr, &pperrstring);
+/*
+ * Starts a query over which failed because of an outdated cached engine, this time with
+ * the engine discovery
+ */
+static void snmp_query_restart(snmp_query *query, check_snmp_config_snmp_parameters parameters,
+							   char *peername, const parsed_oid *oids) {
+	forget_engine(&query->engine_cache, peername);
+	snmp_close(query->session);
+	free(query->pending);
+	free(query->result.response_values);
+
+	snmp_query_start(query, parameters, peername, oids);
+}
+
+snmp_responces do_snmp_query(check_snmp_config_snmp_parameters parameters) {
+	parsed_oid *oids = parse_test_unit_oids(parameters);
+
+	const int timeout_safety_tolerance = 5;
+	alarm((timeout_interval * (unsigned int)parameters.snmp_session.retries) +
+		  timeout_safety_tolerance);
+
+	snmp_query query;
+	snmp_query_start(&query, parameters, parameters.snmp_session.peername, oids);
+	while (true) {
+		while (requests_in_flight > 0) {
+			snmp_query_wait_once();
+		}
 
-		if (psnmperr == SNMPERR_TIMEOUT) {
-			// We exit with critical here for some historical reason
-			die(STATE_CRITICAL, "SNMP query ran into a timeout\n");
+		if (!(query.failed && query.stale_engine)) {
+			break;
 		}
-		die(STATE_UNKNOWN, "SNMP query failed: %s\n", pperrstring);
+		snmp_query_restart(&query, parameters, parameters.snmp_session.peername, oids);
 	}
 
-	snmp_close(active_session);
+	if (query.failed) {
+		die(query.error_state, "%s\n", query.error_message);
+	}
+
+	remember_engine(query.session, &query.engine_cache);
+	snmp_close(query.session);
 
 	/* disable alarm again */
 	alarm(0);
 
-	snmp_responces result = {
-		.errorcode = OK,
-		.response_values = calloc(parameters.num_of_test_units, sizeof(response_value)),
-		.number_of_results = 0,
-	};
+	snmp_query_take_agent_uptime(&query.result, parameters);
+	free(query.pending);
+	free(oids);
+	return query.result;
+}
+
+snmp_responces *do_snmp_queries(check_snmp_config_snmp_parameters parameters, char **hosts,
+								size_t number_of_hosts, size_t max_in_flight) {
+	parsed_oid *oids = parse_test_unit_oids(parameters);
 
-	if (result.response_values == NULL) {
-		result.errorcode = ERROR;
-		return result;
+	snmp_query *queries = calloc(number_of_hosts, sizeof(snmp_query));
+	bool *finished = calloc(number_of_hosts, sizeof(bool));
+	snmp_responces *results = calloc(number_of_hosts, sizeof(snmp_responces));
+	if (queries == NULL || finished == NULL || results == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
 	}
 
-	// We got the the query results, now process them
-	for (netsnmp_variable_list *vars = response->variables;
-		 (vars && result.number_of_results <= parameters.num_of_test_units);
-		 vars = vars->next_variable, result.number_of_results++) {
-		for (size_t jdx = 0; jdx < vars->name_length; jdx++) {
-			result.response_values[result.number_of_results].oid[jdx] = vars->name[jdx];
+	// hosts are polled in waves of at most max_in_flight, each one may take the full time
+	const int timeout_safety_tolerance = 5;
+	unsigned int waves = (unsigned int)((number_of_hosts + max_in_flight - 1) / max_in_flight);
+	alarm((timeout_interval * (unsigned int)parameters.snmp_session.retries * waves) +
+		  timeout_safety_tolerance);
+
+	max_requests_in_flight = max_in_flight;
+	size_t started = 0;
+	size_t first_unfinished = 0;
+	while (true) {
+		// capacity freed by the last responses goes to the hosts which are running already
+		for (size_t i = first_unfinished; i < started; i++) {
+			if (!finished[i]) {
+				snmp_query_send(&queries[i]);
+			}
 		}
-		result.response_values[result.number_of_results].oid_length = vars->name_length;
 
-		switch (vars->type) {
-		case ASN_OCTET_STR: {
-			result.response_values[result.number_of_results].string_response =
-				strdup((char *)vars->val.string);
-			result.response_values[result.number_of_results].type = vars->type;
-			if (verbose) {
-				printf("Debug: Got a string as response: %s\n", vars->val.string);
+		while (started < number_of_hosts && requests_in_flight < max_requests_in_flight) {
+			if (verbose > 1) {
+				printf("Starting query of %s\n", hosts[started]);
 			}
+
+			snmp_query_start(&queries[started], parameters, hosts[started], oids);
+			started++;
 		}
-			continue;
-		case ASN_OPAQUE:
-			if (verbose) {
-				printf("Debug: Got OPAQUE\n");
+
+		for (size_t i = first_unfinished; i < started; i++) {
+			snmp_query *query = &queries[i];
+			if (finished[i] || query->in_flight > 0 ||
+				(!query->failed && query->number_of_pending > 0)) {
+				continue;
+			}
+
+			if (query->failed && query->stale_engine) {
+				snmp_query_restart(query, parameters, hosts[i], oids);
+				continue;
+			}
+
+			finished[i] = true;
+			if (query->session != NULL) {
+				if (!query->failed) {
+					remember_engine(query->session, &query->engine_cache);
+				}
+				snmp_close(query->session);
+			}
+
+			results[i] = query->result;
+			if (query->failed) {
+				results[i].errorcode = ERROR;
+				results[i].error_state = query->error_state;
+				results[i].error_message = query->error_message;
+			} else {
+				snmp_query_take_agent_uptime(&results[i], parameters);
 			}
+			free(query->pending);
+		}
+
+		while (first_unfinished < started && finished[first_unfinished]) {
+			first_unfinished++;
+		}
+
+		if (first_unfinished == number_of_hosts) {
 			break;
-		/* Numerical values */
-		case ASN_COUNTER64: {
-			if (verbose) {
-				printf("Debug: Got counter64\n");
-			}
-			struct counter64 tmp = *(vars->val.counter64);
-			uint64_t counter = (tmp.high << 32) + tmp.low;
-			result.response_values[result.number_of_results].value.uIntVal = counter;
-			result.response_values[result.number_of_results].type = vars->type;
-		} break;
-		case ASN_GAUGE: // same as ASN_UNSIGNED
-		case ASN_TIMETICKS:
-		case ASN_COUNTER:
-		case ASN_UINTEGER: {
-			if (verbose) {
-				printf("Debug: Got a Integer like\n");
-			}
-			result.response_values[result.number_of_results].value.uIntVal =
-				(unsigned long)*(vars->val.integer);
-			result.response_values[result.number_of_results].type = vars->type;
-		} break;
-		case ASN_INTEGER: {
-			if (verbose) {
-				printf("Debug: Got a Integer\n");
-			}
-			result.response_values[result.number_of_results].value.intVal = *(vars->val.integer);
-			result.response_values[result.number_of_results].type = vars->type;
-		} break;
-		case ASN_FLOAT: {
-			if (verbose) {
-				printf("Debug: Got a float\n");
-			}
-			result.response_values[result.number_of_results].value.doubleVal = *(vars->val.floatVal);
-			result.response_values[result.number_of_results].type = vars->type;
-		} break;
-		case ASN_DOUBLE: {
-			if (verbose) {
-				printf("Debug: Got a double\n");
-			}
-			result.response_values[result.number_of_results].value.doubleVal = *(vars->val.doubleVal);
-			result.response_values[result.number_of_results].type = vars->type;
-		} break;
-		case ASN_IPADDRESS:
-			if (verbose) {
-				printf("Debug: Got an IP address\n");
-			}
-			result.response_values[result.number_of_results].type = vars->type;
-
-			// TODO: print address here, state always ok? or regex match?
+		}
+
+		if (requests_in_flight > 0) {
+			snmp_query_wait_once();
+		}
+	}
+
+	/* disable alarm again */
+	alarm(0);
+
+	max_requests_in_flight = SIZE_MAX;
+	free(queries);
+	free(finished);
+	free(oids);
+	return results;
+}
+
+// sysUpTime is read a few seconds after the timestamp of the query at worst
+#define AGENT_UPTIME_TOLERANCE 10
+
+/*
+ * An agent restarted if its sysUpTime went back, unless the TimeTicks wrapped around
+ * after 497 days, which is only possible if the previous value was close to that
+ */
+static bool agent_restarted(unsigned long long previous_uptime, unsigned long long uptime,
+							double elapsed_seconds) {
+	if (previous_uptime == 0 || uptime == 0 || uptime >= previous_uptime) {
+		return false;
+	}
+	return (double)previous_uptime + ((elapsed_seconds + AGENT_UPTIME_TOLERANCE) * 100) <
+		   (double)UINT32_MAX + 1;
+}
+
+/*
+ * The increase from an older to a newer value of the same OID. A Counter32 wraps around at
+ * 2^32, a Counter64 does not wrap in practice (RFC 2863), so one which went back was reset
+ * and there is no increase.
+ */
+static bool value_increase(unsigned char type, check_snmp_state_value older,
+						   check_snmp_state_value newer, double *increase) {
+	switch (type) {
+	case ASN_COUNTER:
+		if (newer.uIntVal >= older.uIntVal) {
+			*increase = (double)(newer.uIntVal - older.uIntVal);
+		} else if (older.uIntVal <= UINT32_MAX) {
+			*increase = (double)((UINT32_MAX - older.uIntVal) + newer.uIntVal + 1);
+		} else {
+			return false;
+		}
+		return true;
+	case ASN_COUNTER64:
+		if (newer.uIntVal < older.uIntVal) {
+			return false;
+		}
+		*increase = (double)(newer.uIntVal - older.uIntVal);
+		return true;
+	case ASN_GAUGE: // same as ASN_UNSIGNED
+	case ASN_TIMETICKS:
+	case ASN_UINTEGER:
+		*increase = (double)newer.intVal - (double)older.intVal;
+		return true;
+	case ASN_INTEGER:
+	case ASN_FLOAT:
+	case ASN_DOUBLE:
+		*increase = newer.doubleVal - older.doubleVal;
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Adds up the increases from the oldest sample within the window to the current value,
+ * step by step to catch every wrap. The samples before a reset are dropped. Returns false
+ * if no sample is left.
+ */
+static bool increase_over_window(check_snmp_state_entry *current, unsigned int window,
+								 double *increase, double *seconds) {
+	*increase = 0;
+	check_snmp_state_value newer = current->value;
+	time_t oldest = current->timestamp;
+
+	for (size_t i = 0; i < current->number_of_samples; i++) {
+		const check_snmp_state_sample *sample = &current->samples[i];
+		if (i > 0 && difftime(current->timestamp, sample->timestamp) > window) {
 			break;
-		default:
-			if (verbose) {
-				printf("Debug: Got a unmatched result type: %hhu\n", vars->type);
-			}
-			// TODO: Error here?
+		}
+
+		double step = 0;
+		if (!value_increase(current->type, sample->value, newer, &step)) {
+			current->number_of_samples = i;
 			break;
 		}
+
+		*increase += step;
+		newer = sample->value;
+		oldest = sample->timestamp;
 	}
 
-	return result;
+	*seconds = difftime(current->timestamp, oldest);
+	return current->number_of_samples > 0;
 }
 
 check_snmp_evaluation evaluate_single_unit(response_value response,
 										   check_snmp_evaluation_parameters eval_params,
 										   check_snmp_test_unit test_unit, time_t query_timestamp,
+										   unsigned long long agent_uptime,
 										   check_snmp_state_entry prev_state,
 										   bool have_previous_state) {
 	mp_subcheck sc_oid_test = mp_subcheck_init();
@@ -314,7 +900,8 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 	char oid_string[(MAX_OID_LEN * 2) + 1] = {};
 
 	int oid_string_result =
-		snprint_objid(oid_string, (MAX_OID_LEN * 2) + 1, response.oid, response.oid_length);
+		check_snmp_snprint_objid(oid_string, (MAX_OID_LEN * 2) + 1, response.oid,
+								 response.oid_length);
 	if (oid_string_result <= 0) {
 		// TODO error here
 		die(STATE_UNKNOWN, "snprint_objid failed\n");
@@ -329,11 +916,14 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 
 	bool got_a_numerical_value = false;
 	mp_perfdata_value pd_result_val = {0};
+	// the name of an enumerated value, e.g. "up" of ifOperStatus
+	const char *enum_label = NULL;
 
 	check_snmp_state_entry result_state = {
 		.timestamp = query_timestamp,
 		.oid_length = response.oid_length,
 		.type = response.type,
+		.agent_uptime = agent_uptime,
 	};
 
 	for (size_t i = 0; i < response.oid_length; i++) {
@@ -354,14 +944,39 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 			return result;
 		}
 	}
-	// compute rate time difference
-	double timeDiff = 0;
+	const char *no_rate_reason = "No previous data to calculate rate";
 	if (have_previous_state) {
 		if (verbose) {
 			printf("Previous timestamp: %s", ctime(&prev_state.timestamp));
 			printf("Current timestamp: %s", ctime(&query_timestamp));
 		}
-		timeDiff = difftime(query_timestamp, prev_state.timestamp) / eval_params.rate_multiplier;
+
+		if (prev_state.type != response.type) {
+			have_previous_state = false;
+		} else if (agent_restarted(prev_state.agent_uptime, agent_uptime,
+								   difftime(query_timestamp, prev_state.timestamp))) {
+			// the counters started over, nothing of before can be compared
+			have_previous_state = false;
+			no_rate_reason = "Agent restarted since the previous data";
+		}
+	}
+
+	if (have_previous_state) {
+		// the previous value becomes the newest sample, the ones outside the window are dropped
+		result_state.samples[0] = (check_snmp_state_sample){
+			.timestamp = prev_state.timestamp,
+			.value = prev_state.value,
+		};
+		result_state.number_of_samples = 1;
+		for (size_t i = 0; i < prev_state.number_of_samples &&
+						   result_state.number_of_samples < CHECK_SNMP_RATE_SAMPLES;
+			 i++) {
+			if (difftime(query_timestamp, prev_state.samples[i].timestamp) >
+				eval_params.rate_window) {
+				break;
+			}
+			result_state.samples[result_state.number_of_samples++] = prev_state.samples[i];
+		}
 	}
 
 	mp_perfdata pd_num_val = {};
@@ -423,24 +1038,9 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 		result_state.value.uIntVal = response.value.uIntVal;
 		result_state.type = response.type;
 
-		// TODO: perfdata unit counter
-		if (eval_params.calculate_rate && have_previous_state) {
-			if (prev_state.value.uIntVal > response.value.uIntVal) {
-				// overflow
-				unsigned long long tmp =
-					(UINT64_MAX - prev_state.value.uIntVal) + response.value.uIntVal;
-
-				tmp /= timeDiff;
-				pd_result_val = mp_create_pd_value(tmp);
-			} else {
-				pd_result_val = mp_create_pd_value(
-					(response.value.uIntVal - prev_state.value.uIntVal) / timeDiff);
-			}
-		} else {
-			// It's only a counter if we cont compute rate
-			pd_num_val.uom = "c";
-			pd_result_val = mp_create_pd_value(response.value.uIntVal);
-		}
+		// only a counter, the rate below replaces it
+		pd_num_val.uom = "c";
+		pd_result_val = mp_create_pd_value(response.value.uIntVal);
 		break;
 	case ASN_GAUGE: // same as ASN_UNSIGNED
 	case ASN_TIMETICKS:
@@ -463,25 +1063,15 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 			treated_value = lround(processed);
 		}
 
-		result_state.value.intVal = treated_value;
-
-		if (eval_params.calculate_rate && have_previous_state) {
-			if (verbose > 2) {
-				printf("%s: Rate calculation (int/counter/gauge): prev: %lli\n", __FUNCTION__,
-					   prev_state.value.intVal);
-				printf("%s: Rate calculation (int/counter/gauge): current: %lli\n", __FUNCTION__,
-					   treated_value);
-			}
-			double rate = (treated_value - prev_state.value.intVal) / timeDiff;
-			pd_result_val = mp_create_pd_value(rate);
+		if (response.type == ASN_COUNTER) {
+			// the wrap is at 2^32 of the raw value, the multiplier is applied to the rate
+			result_state.value.uIntVal = response.value.uIntVal;
+			pd_num_val.uom = "c";
 		} else {
-			pd_result_val = mp_create_pd_value(treated_value);
-
-			if (response.type == ASN_COUNTER) {
-				pd_num_val.uom = "c";
-			}
+			result_state.value.intVal = treated_value;
 		}
 
+		pd_result_val = mp_create_pd_value(treated_value);
 	} break;
 	case ASN_INTEGER: {
 		if (eval_params.multiplier_set || eval_params.offset_set) {
@@ -496,22 +1086,12 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 			}
 
 			result_state.value.doubleVal = processed;
-
-			if (eval_params.calculate_rate && have_previous_state) {
-				pd_result_val =
-					mp_create_pd_value((processed - prev_state.value.doubleVal) / timeDiff);
-			} else {
-				pd_result_val = mp_create_pd_value(processed);
-			}
+			pd_result_val = mp_create_pd_value(processed);
 		} else {
-			result_state.value.intVal = response.value.intVal;
-
-			if (eval_params.calculate_rate && have_previous_state) {
-				pd_result_val = mp_create_pd_value(
-					(response.value.intVal - prev_state.value.intVal) / timeDiff);
-			} else {
-				pd_result_val = mp_create_pd_value(response.value.intVal);
-			}
+			result_state.value.doubleVal = (double)response.value.intVal;
+			pd_result_val = mp_create_pd_value(response.value.intVal);
+			enum_label = check_snmp_enum_label(response.oid, response.oid_length,
+											   response.value.intVal);
 		}
 
 		got_a_numerical_value = true;
@@ -528,11 +1108,7 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 			tmp *= eval_params.multiplier;
 		}
 
-		if (eval_params.calculate_rate && have_previous_state) {
-			pd_result_val = mp_create_pd_value((tmp - prev_state.value.doubleVal) / timeDiff);
-		} else {
-			pd_result_val = mp_create_pd_value(tmp);
-		}
+		pd_result_val = mp_create_pd_value(tmp);
 		got_a_numerical_value = true;
 
 		result_state.value.doubleVal = tmp;
@@ -542,6 +1118,29 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 		break;
 	}
 
+	bool have_rate = false;
+	if (got_a_numerical_value && eval_params.calculate_rate && have_previous_state) {
+		double increase = 0;
+		double seconds = 0;
+		have_rate = increase_over_window(&result_state, eval_params.rate_window, &increase,
+										 &seconds);
+		if (have_rate) {
+			if (verbose > 2) {
+				printf("%s: Rate calculation: increase of %g in %g seconds over %zu samples\n",
+					   __FUNCTION__, increase, seconds, result_state.number_of_samples);
+			}
+
+			if ((response.type == ASN_COUNTER || response.type == ASN_COUNTER64) &&
+				eval_params.multiplier_set) {
+				increase *= eval_params.multiplier;
+			}
+			pd_num_val.uom = NULL;
+			pd_result_val = mp_create_pd_value(increase / (seconds / eval_params.rate_multiplier));
+		} else {
+			no_rate_reason = "Counter was reset since the previous data";
+		}
+	}
+
 	if (got_a_numerical_value) {
 		if (eval_params.use_oid_as_perf_data_label) {
 			// Use oid for perdata label
@@ -553,7 +1152,7 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 			pd_num_val.label = strdup(test_unit.oid);
 		}
 
-		if (!(eval_params.calculate_rate && !have_previous_state)) {
+		if (!eval_params.calculate_rate || have_rate) {
 			// some kind of numerical value
 			if (test_unit.unit_value != NULL && strcmp(test_unit.unit_value, "") != 0) {
 				pd_num_val.uom = test_unit.unit_value;
@@ -568,6 +1167,10 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 				xasprintf(&sc_oid_test.output, "%s%s", sc_oid_test.output, test_unit.unit_value);
 			}
 
+			if (enum_label != NULL && !eval_params.calculate_rate) {
+				xasprintf(&sc_oid_test.output, "%s (%s)", sc_oid_test.output, enum_label);
+			}
+
 			if (test_unit.threshold.warning_is_set || test_unit.threshold.critical_is_set) {
 				pd_num_val = mp_pd_set_thresholds(pd_num_val, test_unit.threshold);
 				mp_state_enum tmp_state = mp_get_pd_status(pd_num_val);
@@ -585,11 +1188,11 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 
 			mp_add_perfdata_to_subcheck(&sc_oid_test, pd_num_val);
 		} else {
-			// should calculate rate, but there is no previous state, so first run
+			// should calculate rate, but there is no previous state, e.g. on the first run
 			// exit with ok now
 			sc_oid_test = mp_set_subcheck_state(sc_oid_test, STATE_OK);
-			xasprintf(&sc_oid_test.output, "%s - No previous data to calculate rate - assume okay",
-					  sc_oid_test.output);
+			xasprintf(&sc_oid_test.output, "%s - %s - assume okay", sc_oid_test.output,
+					  no_rate_reason);
 		}
 	}
 
@@ -601,340 +1204,281 @@ check_snmp_evaluation evaluate_single_unit(response_value response,
 	return result;
 }
 
-char *_np_state_generate_key(int argc, char **argv);
-
-/*
- * If time=NULL, use current time. Create state file, with state format
- * version, default text. Writes version, time, and data. Avoid locking
- * problems - use mv to write and then swap. Possible loss of state data if
- * two things writing to same key at same time.
- * Will die with UNKNOWN if errors
- */
-void np_state_write_string(state_key stateKey, time_t timestamp, char *stringToStore) {
-	time_t current_time;
-	if (timestamp == 0) {
-		time(&current_time);
-	} else {
-		current_time = timestamp;
+check_snmp_table_row *check_snmp_table_get_row(check_snmp_table *table, const oid *index,
+											   size_t index_length) {
+	// Columns are walked in lexicographic order, so new rows are usually appended
+	size_t lower = 0;
+	size_t upper = table->number_of_rows;
+	if (upper > 0 && snmp_oid_compare(table->rows[upper - 1].index,
+									  table->rows[upper - 1].index_length, index,
+									  index_length) < 0) {
+		lower = upper;
 	}
 
-	int result = 0;
-
-	/* If file doesn't currently exist, create directories */
-	if (access(stateKey._filename, F_OK) != 0) {
-		char *directories = NULL;
-		result = asprintf(&directories, "%s", stateKey._filename);
-		if (result < 0) {
-			die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
-		}
-
-		for (char *p = directories + 1; *p; p++) {
-			if (*p == '/') {
-				*p = '\0';
-				if ((access(directories, F_OK) != 0) && (mkdir(directories, S_IRWXU) != 0)) {
-					/* Can't free this! Otherwise error message is wrong! */
-					/* np_free(directories); */
-					die(STATE_UNKNOWN, _("Cannot create directory: %s"), directories);
-				}
-				*p = '/';
-			}
-		}
-
-		if (directories) {
-			free(directories);
+	while (lower < upper) {
+		size_t middle = lower + ((upper - lower) / 2);
+		int cmp = snmp_oid_compare(table->rows[middle].index, table->rows[middle].index_length,
+								   index, index_length);
+		if (cmp == 0) {
+			return &table->rows[middle];
 		}
-	}
-
-	char *temp_file = NULL;
-	result = asprintf(&temp_file, "%s.XXXXXX", stateKey._filename);
-	if (result < 0) {
-		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
-	}
-
-	int temp_file_desc = 0;
-	if ((temp_file_desc = mkstemp(temp_file)) == -1) {
-		if (temp_file) {
-			free(temp_file);
+		if (cmp < 0) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
 		}
-		die(STATE_UNKNOWN, _("Cannot create temporary filename"));
 	}
 
-	FILE *temp_file_pointer = fdopen(temp_file_desc, "w");
-	if (temp_file_pointer == NULL) {
-		close(temp_file_desc);
-		unlink(temp_file);
-		if (temp_file) {
-			free(temp_file);
+	if (table->number_of_rows == table->rows_size) {
+		table->rows_size = (table->rows_size == 0) ? 32 : table->rows_size * 2;
+		table->rows = realloc(table->rows, table->rows_size * sizeof(check_snmp_table_row));
+		if (table->rows == NULL) {
+			die(STATE_UNKNOWN, "memory allocation failed");
 		}
-		die(STATE_UNKNOWN, _("Unable to open temporary state file"));
 	}
 
-	fprintf(temp_file_pointer, "# NP State file\n");
-	fprintf(temp_file_pointer, "%d\n", NP_STATE_FORMAT_VERSION);
-	fprintf(temp_file_pointer, "%d\n", stateKey.data_version);
-	fprintf(temp_file_pointer, "%lu\n", current_time);
-	fprintf(temp_file_pointer, "%s\n", stringToStore);
-
-	fchmod(temp_file_desc, S_IRUSR | S_IWUSR | S_IRGRP);
+	memmove(&table->rows[lower + 1], &table->rows[lower],
+			(table->number_of_rows - lower) * sizeof(check_snmp_table_row));
+	table->number_of_rows++;
 
-	fflush(temp_file_pointer);
-
-	result = fclose(temp_file_pointer);
+	check_snmp_table_row *row = &table->rows[lower];
+	*row = (check_snmp_table_row){
+		.index_length = index_length,
+		.values = calloc(table->number_of_columns, sizeof(response_value)),
+		.label = NULL,
+	};
+	if (row->values == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	memcpy(row->index, index, index_length * sizeof(oid));
 
-	fsync(temp_file_desc);
+	return row;
+}
 
-	if (result != 0) {
-		unlink(temp_file);
-		if (temp_file) {
-			free(temp_file);
+check_snmp_table do_snmp_table_walk(check_snmp_config_snmp_parameters parameters) {
+	if (parameters.ignore_mib_parsing_errors) {
+		char *opt_toggle_res = snmp_mib_toggle_options("e");
+		if (opt_toggle_res != NULL) {
+			die(STATE_UNKNOWN, "Unable to disable MIB parsing errors");
 		}
-		die(STATE_UNKNOWN, _("Error writing temp file"));
 	}
 
-	if (rename(temp_file, stateKey._filename) != 0) {
-		unlink(temp_file);
-		if (temp_file) {
-			free(temp_file);
-		}
-		die(STATE_UNKNOWN, _("Cannot rename state temp file"));
-	}
+	// the label columns are walked together with the test units, behind them
+	check_snmp_table result = {
+		.errorcode = OK,
+		.number_of_columns = parameters.num_of_test_units + parameters.num_of_label_columns,
+	};
 
-	if (temp_file) {
-		free(temp_file);
+	typedef struct {
+		oid column[MAX_OID_LEN];
+		size_t column_length;
+		// the last OID received for the column, the next request continues there
+		oid cursor[MAX_OID_LEN];
+		size_t cursor_length;
+		bool done;
+	} column_walk;
+
+	column_walk *columns = calloc(result.number_of_columns, sizeof(column_walk));
+	size_t *active_columns = calloc(result.number_of_columns, sizeof(size_t));
+	if (columns == NULL || active_columns == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
 	}
-}
 
-/*
- * Read the state file
- */
-bool _np_state_read_file(FILE *state_file, state_key stateKey) {
-	time_t current_time;
-	time(&current_time);
+	for (size_t i = 0; i < result.number_of_columns; i++) {
+		const char *column_name = (i < parameters.num_of_test_units)
+									  ? parameters.test_units[i].oid
+									  : parameters.label_columns[i - parameters.num_of_test_units];
+		if (verbose > 0) {
+			printf("Column %zu to walk: %s\n", i, column_name);
+		}
 
-	/* Note: This introduces a limit of 8192 bytes in the string data */
-	char *line = (char *)calloc(1, 8192);
-	if (line == NULL) {
-		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+		columns[i].column_length = MAX_OID_LEN;
+		if (check_snmp_parse_oid(column_name, columns[i].column, &columns[i].column_length) ==
+			NULL) {
+			snmp_perror("Parsing failure");
+			die(STATE_UNKNOWN, "Failed to parse OID\n");
+		}
+		memcpy(columns[i].cursor, columns[i].column, columns[i].column_length * sizeof(oid));
+		columns[i].cursor_length = columns[i].column_length;
 	}
 
-	bool status = false;
-	enum {
-		STATE_FILE_VERSION,
-		STATE_DATA_VERSION,
-		STATE_DATA_TIME,
-		STATE_DATA_TEXT,
-		STATE_DATA_END
-	} expected = STATE_FILE_VERSION;
-
-	int failure = 0;
-	while (!failure && (fgets(line, 8192, state_file)) != NULL) {
-		size_t pos = strlen(line);
-		if (line[pos - 1] == '\n') {
-			line[pos - 1] = '\0';
-		}
+	const int timeout_safety_tolerance = 5;
+	alarm((timeout_interval * (unsigned int)parameters.snmp_session.retries) +
+		  timeout_safety_tolerance);
 
-		if (line[0] == '#') {
-			continue;
+	engine_cache_use engine_cache;
+	struct snmp_session *active_session = NULL;
+	// sysUpTime.0 goes into the first request, in front of the columns
+	bool uptime_pending = parameters.query_agent_uptime;
+
+	while (true) {
+		if (active_session == NULL) {
+			active_session =
+				open_session(parameters.snmp_session, parameters.use_engine_cache, &engine_cache);
+			if (active_session == NULL) {
+				int pcliberr = 0;
+				int psnmperr = 0;
+				char *pperrstring = NULL;
+				snmp_error(&parameters.snmp_session, &pcliberr, &psnmperr, &pperrstring);
+				die(STATE_UNKNOWN, "Failed to open SNMP session: %s\n", pperrstring);
+			}
 		}
 
-		switch (expected) {
-		case STATE_FILE_VERSION: {
-			int i = atoi(line);
-			if (i != NP_STATE_FORMAT_VERSION) {
-				failure++;
-			} else {
-				expected = STATE_DATA_VERSION;
+		size_t number_of_active_columns = 0;
+		for (size_t i = 0; i < result.number_of_columns; i++) {
+			if (!columns[i].done) {
+				active_columns[number_of_active_columns++] = i;
 			}
-		} break;
-		case STATE_DATA_VERSION: {
-			int i = atoi(line);
-			if (i != stateKey.data_version) {
-				failure++;
-			} else {
-				expected = STATE_DATA_TIME;
-			}
-		} break;
-		case STATE_DATA_TIME: {
-			/* If time > now, error */
-			time_t data_time = strtoul(line, NULL, 10);
-			if (data_time > current_time) {
-				failure++;
-			} else {
-				stateKey.state_data->time = data_time;
-				expected = STATE_DATA_TEXT;
-			}
-		} break;
-		case STATE_DATA_TEXT:
-			stateKey.state_data->data = strdup(line);
-			if (stateKey.state_data->data == NULL) {
-				die(STATE_UNKNOWN, _("Cannot execute strdup: %s"), strerror(errno));
-			}
-			stateKey.state_data->length = strlen(line);
-			expected = STATE_DATA_END;
-			status = true;
-			break;
-		case STATE_DATA_END:;
 		}
-	}
-
-	if (line) {
-		free(line);
-	}
-	return status;
-}
-/*
- * Will return NULL if no data is available (first run). If key currently
- * exists, read data. If state file format version is not expected, return
- * as if no data. Get state data version number and compares to expected.
- * If numerically lower, then return as no previous state. die with UNKNOWN
- * if exceptional error.
- */
-state_data *np_state_read(state_key stateKey) {
-	/* Open file. If this fails, no previous state found */
-	FILE *statefile = fopen(stateKey._filename, "r");
-	state_data *this_state_data = (state_data *)calloc(1, sizeof(state_data));
-	if (statefile != NULL) {
 
-		if (this_state_data == NULL) {
-			die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+		if (number_of_active_columns == 0) {
+			break;
 		}
 
-		this_state_data->data = NULL;
-		stateKey.state_data = this_state_data;
-
-		if (_np_state_read_file(statefile, stateKey)) {
-			this_state_data->errorcode = OK;
+		// SNMPv1 does not know GETBULK, walk it row by row
+		struct snmp_pdu *pdu = NULL;
+		if (parameters.snmp_session.version == SNMP_VERSION_1) {
+			pdu = snmp_pdu_create(SNMP_MSG_GETNEXT);
 		} else {
-			this_state_data->errorcode = ERROR;
+			pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
+			pdu->non_repeaters = uptime_pending ? 1 : 0;
+			pdu->max_repetitions = parameters.max_repetitions;
 		}
 
-		fclose(statefile);
-	} else {
-		// Failed to open state file
-		this_state_data->errorcode = ERROR;
-	}
-
-	return stateKey.state_data;
-}
-
-/*
- * Internal function. Returns either:
- *   envvar NAGIOS_PLUGIN_STATE_DIRECTORY
- *   statically compiled shared state directory
- */
-char *_np_state_calculate_location_prefix(void) {
-	char *env_dir;
-
-	/* Do not allow passing MP_STATE_PATH in setuid plugins
-	 * for security reasons */
-	if (!mp_suid()) {
-		env_dir = getenv("MP_STATE_PATH");
-		if (env_dir && env_dir[0] != '\0') {
-			return env_dir;
+		if (uptime_pending) {
+			// the next OID behind sysUpTime is sysUpTime.0
+			snmp_add_null_var(pdu, sysuptime_oid, OID_LENGTH(sysuptime_oid) - 1);
 		}
-		/* This is the former ENV, for backward-compatibility */
-		env_dir = getenv("NAGIOS_PLUGIN_STATE_DIRECTORY");
-		if (env_dir && env_dir[0] != '\0') {
-			return env_dir;
+
+		for (size_t i = 0; i < number_of_active_columns; i++) {
+			column_walk *column = &columns[active_columns[i]];
+			snmp_add_null_var(pdu, column->cursor, column->cursor_length);
 		}
-	}
 
-	return NP_STATE_DIR_PREFIX;
-}
+		struct snmp_pdu *response = NULL;
+		int snmp_query_status = snmp_synch_response(active_session, pdu, &response);
+		result.number_of_requests++;
+
+		if (!(snmp_query_status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR)) {
+			int pcliberr = 0;
+			int psnmperr = 0;
+			char *pperrstring = NULL;
+			snmp_error(active_session, &pcliberr, &psnmperr, &pperrstring);
+
+			if (snmp_query_status == STAT_ERROR && engine_is_stale(&engine_cache, psnmperr)) {
+				// ask again after the discovery, the cursors did not move
+				forget_engine(&engine_cache, parameters.snmp_session.peername);
+				snmp_free_pdu(response);
+				snmp_close(active_session);
+				active_session = NULL;
+				continue;
+			}
 
-/*
- * Initiatializer for state routines.
- * Sets variables. Generates filename. Returns np_state_key. die with
- * UNKNOWN if exception
- */
-state_key np_enable_state(char *keyname, int expected_data_version, const char *plugin_name,
-						  int argc, char **argv) {
-	state_key *this_state = (state_key *)calloc(1, sizeof(state_key));
-	if (this_state == NULL) {
-		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
-	}
+			if (psnmperr == SNMPERR_TIMEOUT) {
+				// We exit with critical here for some historical reason
+				die(STATE_CRITICAL, "SNMP query ran into a timeout\n");
+			}
+			die(STATE_UNKNOWN, "SNMP query failed: %s\n", pperrstring);
+		}
 
-	char *temp_keyname = NULL;
-	if (keyname == NULL) {
-		temp_keyname = _np_state_generate_key(argc, argv);
-	} else {
-		temp_keyname = strdup(keyname);
-		if (temp_keyname == NULL) {
-			die(STATE_UNKNOWN, _("Cannot execute strdup: %s"), strerror(errno));
+		// The repetitions are interleaved: one variable binding per requested column each
+		bool *got_a_value = calloc(number_of_active_columns, sizeof(bool));
+		if (got_a_value == NULL) {
+			die(STATE_UNKNOWN, "memory allocation failed");
 		}
-	}
 
-	/* Die if invalid characters used for keyname */
-	char *tmp_char = temp_keyname;
-	while (*tmp_char != '\0') {
-		if (!(isalnum(*tmp_char) || *tmp_char == '_')) {
-			die(STATE_UNKNOWN, _("Invalid character for keyname - only alphanumerics or '_'"));
+		netsnmp_variable_list *first_column_value = response->variables;
+		if (uptime_pending && first_column_value != NULL) {
+			if (first_column_value->type == ASN_TIMETICKS &&
+				snmp_oid_compare(first_column_value->name, first_column_value->name_length,
+								 sysuptime_oid, OID_LENGTH(sysuptime_oid)) == 0) {
+				result.agent_uptime = (unsigned long)*(first_column_value->val.integer);
+			}
+			first_column_value = first_column_value->next_variable;
+			uptime_pending = false;
 		}
-		tmp_char++;
-	}
-	this_state->name = temp_keyname;
-	this_state->plugin_name = (char *)plugin_name;
-	this_state->data_version = expected_data_version;
-	this_state->state_data = NULL;
 
-	/* Calculate filename */
-	char *temp_filename = NULL;
-	int error = asprintf(&temp_filename, "%s/%lu/%s/%s", _np_state_calculate_location_prefix(),
-						 (unsigned long)geteuid(), plugin_name, this_state->name);
-	if (error < 0) {
-		die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
-	}
+		size_t position = 0;
+		for (netsnmp_variable_list *vars = first_column_value; vars != NULL;
+			 vars = vars->next_variable, position++) {
+			size_t active_index = position % number_of_active_columns;
+			size_t column_index = active_columns[active_index];
+			column_walk *column = &columns[column_index];
 
-	this_state->_filename = temp_filename;
+			if (column->done) {
+				continue;
+			}
+			got_a_value[active_index] = true;
+
+			if (vars->type == SNMP_ENDOFMIBVIEW || vars->type == SNMP_NOSUCHOBJECT ||
+				vars->type == SNMP_NOSUCHINSTANCE || vars->name_length <= column->column_length ||
+				snmp_oid_compare(column->column, column->column_length, vars->name,
+								 column->column_length) != 0) {
+				// left the column
+				column->done = true;
+				continue;
+			}
 
-	return *this_state;
-}
+			if (snmp_oid_compare(vars->name, vars->name_length, column->cursor,
+								 column->cursor_length) <= 0) {
+				// a broken agent would let us walk in circles
+				if (verbose > 0) {
+					printf("OID not increasing in column %zu, stopping there\n", column_index);
+				}
+				column->done = true;
+				continue;
+			}
 
-/*
- * Returns a string to use as a keyname, based on an md5 hash of argv, thus
- * hopefully a unique key per service/plugin invocation. Use the extra-opts
- * parse of argv, so that uniqueness in parameters are reflected there.
- */
-char *_np_state_generate_key(int argc, char **argv) {
-	unsigned char result[256];
+			check_snmp_table_row *row =
+				check_snmp_table_get_row(&result, &vars->name[column->column_length],
+										 vars->name_length - column->column_length);
+			row->values[column_index] = snmp_variable_to_response_value(vars);
 
-#ifdef MOPL_USE_OPENSSL
-	/*
-	 * This code path is chosen if openssl is available (which should be the most common
-	 * scenario). Alternatively, the gnulib implementation/
-	 *
-	 */
-	EVP_MD_CTX *ctx = EVP_MD_CTX_new();
+			memcpy(column->cursor, vars->name, vars->name_length * sizeof(oid));
+			column->cursor_length = vars->name_length;
+		}
 
-	EVP_DigestInit(ctx, EVP_sha256());
+		for (size_t i = 0; i < number_of_active_columns; i++) {
+			if (!got_a_value[i]) {
+				// the agent did not answer for this column, do not ask again forever
+				columns[active_columns[i]].done = true;
+			}
+		}
 
-	for (int i = 0; i < argc; i++) {
-		EVP_DigestUpdate(ctx, argv[i], strlen(argv[i]));
+		free(got_a_value);
+		snmp_free_pdu(response);
 	}
 
-	EVP_DigestFinal(ctx, result, NULL);
-#else
-
-	struct sha256_ctx ctx;
+	remember_engine(active_session, &engine_cache);
+	snmp_close(active_session);
 
-	for (int i = 0; i < this_monitoring_plugin->argc; i++) {
-		sha256_process_bytes(argv[i], strlen(argv[i]), &ctx);
-	}
+	/* disable alarm again */
+	alarm(0);
 
-	sha256_finish_ctx(&ctx, result);
-#endif // MOPL_USE_OPENSSL
+	// Name the rows by their label columns
+	for (size_t i = 0; i < result.number_of_rows; i++) {
+		check_snmp_table_row *row = &result.rows[i];
+		for (size_t column_index = parameters.num_of_test_units;
+			 column_index < result.number_of_columns; column_index++) {
+			const response_value *label = &row->values[column_index];
+			if (label->oid_length == 0 || label->type != ASN_OCTET_STR) {
+				continue;
+			}
 
-	char keyname[41];
-	for (int i = 0; i < 20; ++i) {
-		sprintf(&keyname[2 * i], "%02x", result[i]);
+			if (row->label == NULL) {
+				row->label = strdup(label->string_response);
+			} else {
+				xasprintf(&row->label, "%s %s", row->label, label->string_response);
+			}
+		}
 	}
 
-	keyname[40] = '\0';
-
-	char *keyname_copy = strdup(keyname);
-	if (keyname_copy == NULL) {
-		die(STATE_UNKNOWN, _("Cannot execute strdup: %s"), strerror(errno));
+	if (verbose > 0) {
+		printf("Walked %zu rows in %zu requests\n", result.number_of_rows,
+			   result.number_of_requests);
 	}
 
-	return keyname_copy;
+	free(columns);
+	free(active_columns);
+	return result;
 }
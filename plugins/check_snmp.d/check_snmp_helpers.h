@@ -1,6 +1,7 @@
 #pragma once
 
 #include "./config.h"
+#include "../../lib/utils_base.h"
 #include <net-snmp/library/asn1.h>
 
 check_snmp_test_unit check_snmp_test_unit_init();
@@ -23,20 +24,86 @@ typedef struct {
 	int errorcode;
 	response_value *response_values;
 	size_t number_of_results;
+	// only set by do_snmp_queries, which does not die if a host fails
+	mp_state_enum error_state;
+	char *error_message;
+	// sysUpTime.0 of the agent if query_agent_uptime is set, 0 if it is not known
+	unsigned long long agent_uptime;
 } snmp_responces;
 snmp_responces do_snmp_query(check_snmp_config_snmp_parameters parameters);
 
+/*
+ * Queries the test units on every host concurrently, in one process. The session
+ * parameters are used for all of them with the host as peername. At most max_in_flight
+ * requests are outstanding at any time. A failing host gets an errorcode of ERROR with
+ * error_state and error_message in its result, the others continue.
+ */
+snmp_responces *do_snmp_queries(check_snmp_config_snmp_parameters parameters, char **hosts,
+								size_t number_of_hosts, size_t max_in_flight);
+
+typedef struct {
+	// the OID of the row without the column, e.g. the ifIndex
+	oid index[MAX_OID_LEN];
+	size_t index_length;
+	// one value per column, the OID length is zero if the row has no value in the column
+	response_value *values;
+	// value(s) of the label columns
+	char *label;
+} check_snmp_table_row;
+
+typedef struct {
+	int errorcode;
+	// sorted by index
+	check_snmp_table_row *rows;
+	size_t number_of_rows;
+	size_t rows_size;
+	// the test units, followed by the label columns
+	size_t number_of_columns;
+	size_t number_of_requests;
+	// sysUpTime.0 of the agent if query_agent_uptime is set, 0 if it is not known
+	unsigned long long agent_uptime;
+} check_snmp_table;
+
+/*
+ * Walks the OIDs of the test units and the label columns as columns of a table with
+ * GETBULK (GETNEXT for SNMPv1), all columns in the same request. The values are joined
+ * into rows by their index.
+ */
+check_snmp_table do_snmp_table_walk(check_snmp_config_snmp_parameters parameters);
+
+/*
+ * Returns the row with this index, a new one is inserted if there is none
+ */
+check_snmp_table_row *check_snmp_table_get_row(check_snmp_table *table, const oid *index,
+											   size_t index_length);
+
+// earlier values of an OID which are kept for --rate-window, including the previous one
+#define CHECK_SNMP_RATE_SAMPLES 16
+
+// counters keep the raw value in uIntVal, the other types the one after --offset/--multiplier
+typedef union {
+	unsigned long long uIntVal;
+	long long intVal;
+	double doubleVal;
+} check_snmp_state_value;
+
+typedef struct {
+	time_t timestamp;
+	check_snmp_state_value value;
+} check_snmp_state_sample;
+
 // state is similar to response, but only numerics and a timestamp
 typedef struct {
 	time_t timestamp;
 	oid oid[MAX_OID_LEN];
 	size_t oid_length;
 	unsigned char type;
-	union {
-		unsigned long long uIntVal;
-		long long intVal;
-		double doubleVal;
-	} value;
+	check_snmp_state_value value;
+	// sysUpTime of the agent when the value was read, 0 if it is not known
+	unsigned long long agent_uptime;
+	// the values before this one, the newest first
+	size_t number_of_samples;
+	check_snmp_state_sample samples[CHECK_SNMP_RATE_SAMPLES];
 } check_snmp_state_entry;
 
 typedef struct {
@@ -46,27 +113,6 @@ typedef struct {
 check_snmp_evaluation evaluate_single_unit(response_value response,
 										   check_snmp_evaluation_parameters eval_params,
 										   check_snmp_test_unit test_unit, time_t query_timestamp,
+										   unsigned long long agent_uptime,
 										   check_snmp_state_entry prev_state,
 										   bool have_previous_state);
-
-#define NP_STATE_FORMAT_VERSION 1
-
-typedef struct state_data_struct {
-	time_t time;
-	void *data;
-	size_t length; /* Of binary data */
-	int errorcode;
-} state_data;
-
-typedef struct state_key_struct {
-	char *name;
-	char *plugin_name;
-	int data_version;
-	char *_filename;
-	state_data *state_data;
-} state_key;
-
-state_data *np_state_read(state_key stateKey);
-state_key np_enable_state(char *keyname, int expected_data_version, const char *plugin_name,
-						  int argc, char **argv);
-void np_state_write_string(state_key stateKey, time_t timestamp, char *stringToStore);
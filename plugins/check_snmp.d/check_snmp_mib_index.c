@@ -0,0 +1,554 @@
+/*****************************************************************************
+ *
+ * Precompiled MIB index of check_snmp
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Symbolic OIDs require net-snmp to parse MIB files on every start, with a
+ * large set of MIBs that takes more time than the query itself.
+ * --mib-index-compile writes the loaded MIB tree once into an index file:
+ * the labels, modules and OIDs of all objects together with their types
+ * and enumerations. --mib-index maps that file and resolves names with
+ * binary searches instead, no MIB is loaded at all.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_snmp_mib_index.h"
+#include "./check_snmp_state.h"
+#include "../utils.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <net-snmp/library/parse.h>
+
+typedef struct {
+	check_snmp_mib_index_object *objects;
+	size_t number_of_objects;
+	size_t objects_size;
+
+	uint32_t *subids;
+	size_t number_of_subids;
+	size_t subids_size;
+
+	check_snmp_mib_index_enum *enums;
+	size_t number_of_enums;
+	size_t enums_size;
+
+	char *strings;
+	size_t strings_length;
+	size_t strings_size;
+
+	// offsets of the module names which are known already, by modid
+	int *modids;
+	uint32_t *module_strings;
+	size_t number_of_modules;
+} index_builder;
+
+static void *grow(void *array, size_t *size, size_t needed, size_t element_size) {
+	if (needed <= *size) {
+		return array;
+	}
+
+	size_t new_size = (*size == 0) ? 1024 : *size;
+	while (new_size < needed) {
+		new_size *= 2;
+	}
+
+	void *tmp = realloc(array, new_size * element_size);
+	if (tmp == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	*size = new_size;
+	return tmp;
+}
+
+static uint32_t add_string(index_builder *builder, const char *string) {
+	size_t length = strlen(string) + 1;
+	builder->strings = grow(builder->strings, &builder->strings_size,
+							builder->strings_length + length, sizeof(char));
+
+	uint32_t offset = (uint32_t)builder->strings_length;
+	memcpy(&builder->strings[offset], string, length);
+	builder->strings_length += length;
+	return offset;
+}
+
+static uint32_t add_module(index_builder *builder, int modid) {
+	for (size_t i = 0; i < builder->number_of_modules; i++) {
+		if (builder->modids[i] == modid) {
+			return builder->module_strings[i];
+		}
+	}
+
+	char module[256];
+	module_name(modid, module);
+
+	builder->modids = realloc(builder->modids, (builder->number_of_modules + 1) * sizeof(int));
+	builder->module_strings =
+		realloc(builder->module_strings, (builder->number_of_modules + 1) * sizeof(uint32_t));
+	if (builder->modids == NULL || builder->module_strings == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	builder->modids[builder->number_of_modules] = modid;
+	builder->module_strings[builder->number_of_modules] = add_string(builder, module);
+	return builder->module_strings[builder->number_of_modules++];
+}
+
+static int compare_subid(const void *first, const void *second) {
+	const struct tree *first_node = *(struct tree *const *)first;
+	const struct tree *second_node = *(struct tree *const *)second;
+	return (first_node->subid > second_node->subid) - (first_node->subid < second_node->subid);
+}
+
+/*
+ * Adds the siblings and their subtrees in the order of their OIDs
+ */
+static void add_subtree(index_builder *builder, struct tree *siblings, uint32_t path[],
+						size_t depth) {
+	size_t number_of_siblings = 0;
+	for (struct tree *node = siblings; node != NULL; node = node->next_peer) {
+		number_of_siblings++;
+	}
+	if (number_of_siblings == 0 || depth >= MAX_OID_LEN) {
+		return;
+	}
+
+	struct tree **nodes = calloc(number_of_siblings, sizeof(struct tree *));
+	if (nodes == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	size_t position = 0;
+	for (struct tree *node = siblings; node != NULL; node = node->next_peer) {
+		nodes[position++] = node;
+	}
+	qsort(nodes, number_of_siblings, sizeof(struct tree *), compare_subid);
+
+	for (size_t i = 0; i < number_of_siblings; i++) {
+		struct tree *node = nodes[i];
+		path[depth] = (uint32_t)node->subid;
+
+		builder->objects = grow(builder->objects, &builder->objects_size,
+								builder->number_of_objects + 1, sizeof(check_snmp_mib_index_object));
+		builder->subids = grow(builder->subids, &builder->subids_size,
+							   builder->number_of_subids + depth + 1, sizeof(uint32_t));
+
+		check_snmp_mib_index_object *object = &builder->objects[builder->number_of_objects++];
+		*object = (check_snmp_mib_index_object){
+			.label = add_string(builder, (node->label != NULL) ? node->label : ""),
+			.module = add_module(builder, node->modid),
+			.oid = (uint32_t)builder->number_of_subids,
+			.oid_length = (uint32_t)depth + 1,
+			.first_enum = (uint32_t)builder->number_of_enums,
+			.type = (uint32_t)node->type,
+		};
+		memcpy(&builder->subids[builder->number_of_subids], path, (depth + 1) * sizeof(uint32_t));
+		builder->number_of_subids += depth + 1;
+
+		for (struct enum_list *enums = node->enums; enums != NULL; enums = enums->next) {
+			builder->enums = grow(builder->enums, &builder->enums_size,
+								  builder->number_of_enums + 1, sizeof(check_snmp_mib_index_enum));
+			builder->enums[builder->number_of_enums++] = (check_snmp_mib_index_enum){
+				.value = enums->value,
+				.label = add_string(builder, (enums->label != NULL) ? enums->label : ""),
+			};
+			object->number_of_enums++;
+		}
+
+		add_subtree(builder, node->child_list, path, depth + 1);
+	}
+
+	free(nodes);
+}
+
+// qsort has no context, the labels are compared while the index is written
+static const index_builder *sorting_builder;
+
+static int compare_label(const void *first, const void *second) {
+	const check_snmp_mib_index_object *first_object =
+		&sorting_builder->objects[*(const uint32_t *)first];
+	const check_snmp_mib_index_object *second_object =
+		&sorting_builder->objects[*(const uint32_t *)second];
+
+	int result = strcmp(&sorting_builder->strings[first_object->label],
+						&sorting_builder->strings[second_object->label]);
+	if (result == 0) {
+		result = strcmp(&sorting_builder->strings[first_object->module],
+						&sorting_builder->strings[second_object->module]);
+	}
+	return result;
+}
+
+size_t check_snmp_mib_index_write(const char *path, struct tree *tree_head) {
+	index_builder builder = {};
+	uint32_t path_buffer[MAX_OID_LEN];
+	add_subtree(&builder, tree_head, path_buffer, 0);
+
+	uint32_t *by_label = calloc(builder.number_of_objects + 1, sizeof(uint32_t));
+	if (by_label == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	for (size_t i = 0; i < builder.number_of_objects; i++) {
+		by_label[i] = (uint32_t)i;
+	}
+	sorting_builder = &builder;
+	qsort(by_label, builder.number_of_objects, sizeof(uint32_t), compare_label);
+
+	check_snmp_mib_index_header header = {
+		.format_version = CHECK_SNMP_MIB_INDEX_FORMAT_VERSION,
+		.number_of_objects = (uint32_t)builder.number_of_objects,
+		.number_of_subids = (uint32_t)builder.number_of_subids,
+		.number_of_enums = (uint32_t)builder.number_of_enums,
+		.strings_length = (uint32_t)builder.strings_length,
+	};
+	memcpy(header.magic, CHECK_SNMP_MIB_INDEX_MAGIC, sizeof(header.magic));
+
+	size_t objects_length = builder.number_of_objects * sizeof(check_snmp_mib_index_object);
+	size_t by_label_length = builder.number_of_objects * sizeof(uint32_t);
+	size_t subids_length = builder.number_of_subids * sizeof(uint32_t);
+	size_t enums_length = builder.number_of_enums * sizeof(check_snmp_mib_index_enum);
+	size_t data_length =
+		objects_length + by_label_length + subids_length + enums_length + builder.strings_length;
+	if (sizeof(header) + data_length > UINT32_MAX) {
+		die(STATE_UNKNOWN, "The MIB index would be too large\n");
+	}
+
+	header.objects_offset = sizeof(header);
+	header.by_label_offset = header.objects_offset + (uint32_t)objects_length;
+	header.subids_offset = header.by_label_offset + (uint32_t)by_label_length;
+	header.enums_offset = header.subids_offset + (uint32_t)subids_length;
+	header.strings_offset = header.enums_offset + (uint32_t)enums_length;
+
+	char *data = malloc(data_length + 1);
+	if (data == NULL) {
+		die(STATE_UNKNOWN, "memory allocation failed");
+	}
+	char *position = data;
+	memcpy(position, builder.objects, objects_length);
+	position += objects_length;
+	memcpy(position, by_label, by_label_length);
+	position += by_label_length;
+	memcpy(position, builder.subids, subids_length);
+	position += subids_length;
+	memcpy(position, builder.enums, enums_length);
+	position += enums_length;
+	memcpy(position, builder.strings, builder.strings_length);
+
+	check_snmp_state_write_file(path, &header, sizeof(header), data, data_length);
+
+	free(data);
+	free(by_label);
+	free(builder.objects);
+	free(builder.subids);
+	free(builder.enums);
+	free(builder.strings);
+	free(builder.modids);
+	free(builder.module_strings);
+	return builder.number_of_objects;
+}
+
+typedef struct {
+	const check_snmp_mib_index_header *header;
+	size_t length;
+
+	const check_snmp_mib_index_object *objects;
+	const uint32_t *by_label;
+	const uint32_t *subids;
+	const check_snmp_mib_index_enum *enums;
+	const char *strings;
+} mib_index;
+
+// like the MIB tree of net-snmp, there is one index for the whole run
+static mib_index loaded_index;
+
+static bool section_fits(size_t file_length, uint32_t offset, size_t count, size_t element_size) {
+	return offset <= file_length && count <= (file_length - offset) / element_size;
+}
+
+bool check_snmp_mib_index_load(const char *path) {
+	int file_descriptor = open(path, O_RDONLY);
+	if (file_descriptor < 0) {
+		return false;
+	}
+
+	struct stat file_status;
+	void *mapping = NULL;
+	size_t length = 0;
+	if (fstat(file_descriptor, &file_status) == 0 &&
+		(size_t)file_status.st_size >= sizeof(check_snmp_mib_index_header)) {
+		length = (size_t)file_status.st_size;
+		mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (mapping == MAP_FAILED) {
+			mapping = NULL;
+		}
+	}
+	close(file_descriptor);
+
+	if (mapping == NULL) {
+		return false;
+	}
+
+	const check_snmp_mib_index_header *header = mapping;
+	const char *base = mapping;
+	if (memcmp(header->magic, CHECK_SNMP_MIB_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+		header->format_version != CHECK_SNMP_MIB_INDEX_FORMAT_VERSION ||
+		!section_fits(length, header->objects_offset, header->number_of_objects,
+					  sizeof(check_snmp_mib_index_object)) ||
+		!section_fits(length, header->by_label_offset, header->number_of_objects,
+					  sizeof(uint32_t)) ||
+		!section_fits(length, header->subids_offset, header->number_of_subids,
+					  sizeof(uint32_t)) ||
+		!section_fits(length, header->enums_offset, header->number_of_enums,
+					  sizeof(check_snmp_mib_index_enum)) ||
+		!section_fits(length, header->strings_offset, header->strings_length, sizeof(char)) ||
+		header->strings_length == 0 ||
+		base[header->strings_offset + header->strings_length - 1] != '\0') {
+		munmap(mapping, length);
+		return false;
+	}
+
+	const check_snmp_mib_index_object *objects =
+		(const check_snmp_mib_index_object *)(base + header->objects_offset);
+	const uint32_t *by_label = (const uint32_t *)(base + header->by_label_offset);
+	for (uint32_t i = 0; i < header->number_of_objects; i++) {
+		if (objects[i].label >= header->strings_length ||
+			objects[i].module >= header->strings_length ||
+			objects[i].oid_length > MAX_OID_LEN ||
+			objects[i].oid_length > header->number_of_subids ||
+			objects[i].oid > header->number_of_subids - objects[i].oid_length ||
+			objects[i].number_of_enums > header->number_of_enums ||
+			objects[i].first_enum > header->number_of_enums - objects[i].number_of_enums ||
+			by_label[i] >= header->number_of_objects) {
+			munmap(mapping, length);
+			return false;
+		}
+	}
+
+	const check_snmp_mib_index_enum *enums =
+		(const check_snmp_mib_index_enum *)(base + header->enums_offset);
+	for (uint32_t i = 0; i < header->number_of_enums; i++) {
+		if (enums[i].label >= header->strings_length) {
+			munmap(mapping, length);
+			return false;
+		}
+	}
+
+	if (loaded_index.header != NULL) {
+		munmap((void *)loaded_index.header, loaded_index.length);
+	}
+	loaded_index = (mib_index){
+		.header = header,
+		.length = length,
+		.objects = objects,
+		.by_label = by_label,
+		.subids = (const uint32_t *)(base + header->subids_offset),
+		.enums = enums,
+		.strings = base + header->strings_offset,
+	};
+	return true;
+}
+
+/*
+ * Compares the label of an object with the first label_length characters of name
+ */
+static int compare_object_label(const check_snmp_mib_index_object *object, const char *name,
+								size_t label_length) {
+	const char *label = &loaded_index.strings[object->label];
+	int result = strncmp(label, name, label_length);
+	if (result == 0 && label[label_length] != '\0') {
+		return 1;
+	}
+	return result;
+}
+
+static const check_snmp_mib_index_object *find_label(const char *module, size_t module_length,
+													 const char *name, size_t label_length) {
+	// the first object with this label
+	size_t lower = 0;
+	size_t upper = loaded_index.header->number_of_objects;
+	while (lower < upper) {
+		size_t middle = lower + ((upper - lower) / 2);
+		if (compare_object_label(&loaded_index.objects[loaded_index.by_label[middle]], name,
+								 label_length) < 0) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	for (size_t i = lower; i < loaded_index.header->number_of_objects; i++) {
+		const check_snmp_mib_index_object *object = &loaded_index.objects[loaded_index.by_label[i]];
+		if (compare_object_label(object, name, label_length) != 0) {
+			break;
+		}
+
+		const char *object_module = &loaded_index.strings[object->module];
+		if (module == NULL || (strncmp(object_module, module, module_length) == 0 &&
+							   object_module[module_length] == '\0')) {
+			return object;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Resolves [MODULE::]label[.subid...], the index part has to be numeric
+ */
+static bool resolve_name(const char *input, oid *result, size_t *length) {
+	const char *module = NULL;
+	size_t module_length = 0;
+	const char *name = input;
+
+	const char *separator = strstr(input, "::");
+	if (separator != NULL) {
+		module = input;
+		module_length = (size_t)(separator - input);
+		name = separator + 2;
+	}
+
+	size_t label_length = strcspn(name, ".");
+	if (label_length == 0 || isdigit((unsigned char)name[0])) {
+		return false;
+	}
+
+	const check_snmp_mib_index_object *object =
+		find_label(module, module_length, name, label_length);
+	if (object == NULL || object->oid_length > *length) {
+		return false;
+	}
+
+	size_t result_length = 0;
+	for (; result_length < object->oid_length; result_length++) {
+		result[result_length] = loaded_index.subids[object->oid + result_length];
+	}
+
+	const char *suffix = name + label_length;
+	while (*suffix == '.') {
+		suffix++;
+		char *end = NULL;
+		unsigned long subid = strtoul(suffix, &end, 10);
+		if (end == suffix || result_length >= *length) {
+			return false;
+		}
+		result[result_length++] = subid;
+		suffix = end;
+	}
+
+	if (*suffix != '\0') {
+		return false;
+	}
+
+	*length = result_length;
+	return true;
+}
+
+oid *check_snmp_parse_oid(const char *input, oid *result, size_t *length) {
+	if (loaded_index.header != NULL && resolve_name(input, result, length)) {
+		return result;
+	}
+	return snmp_parse_oid(input, result, length);
+}
+
+static int compare_object_oid(const check_snmp_mib_index_object *object, const oid *name,
+							  size_t length) {
+	for (size_t i = 0; i < object->oid_length && i < length; i++) {
+		uint32_t subid = loaded_index.subids[object->oid + i];
+		if (subid != name[i]) {
+			return (subid < name[i]) ? -1 : 1;
+		}
+	}
+	return (object->oid_length > length) - (object->oid_length < length);
+}
+
+static const check_snmp_mib_index_object *find_oid(const oid *name, size_t length) {
+	size_t lower = 0;
+	size_t upper = loaded_index.header->number_of_objects;
+	while (lower < upper) {
+		size_t middle = lower + ((upper - lower) / 2);
+		int result = compare_object_oid(&loaded_index.objects[middle], name, length);
+		if (result == 0) {
+			return &loaded_index.objects[middle];
+		}
+		if (result < 0) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+	return NULL;
+}
+
+int check_snmp_snprint_objid(char *buffer, size_t buffer_length, const oid *name, size_t length) {
+	if (loaded_index.header != NULL) {
+		// the longest known prefix names the OID, the rest is the index
+		for (size_t prefix_length = length; prefix_length > 0; prefix_length--) {
+			const check_snmp_mib_index_object *object = find_oid(name, prefix_length);
+			if (object == NULL) {
+				continue;
+			}
+
+			size_t written = (size_t)snprintf(buffer, buffer_length, "%s::%s",
+											  &loaded_index.strings[object->module],
+											  &loaded_index.strings[object->label]);
+			for (size_t i = prefix_length; i < length && written < buffer_length; i++) {
+				written += (size_t)snprintf(buffer + written, buffer_length - written, ".%lu",
+											(unsigned long)name[i]);
+			}
+			return (written < buffer_length) ? (int)written : -1;
+		}
+	}
+	return snprint_objid(buffer, buffer_length, name, length);
+}
+
+const char *check_snmp_enum_label(const oid *name, size_t length, long value) {
+	if (loaded_index.header != NULL) {
+		for (size_t prefix_length = length; prefix_length > 0; prefix_length--) {
+			const check_snmp_mib_index_object *object = find_oid(name, prefix_length);
+			if (object == NULL) {
+				continue;
+			}
+
+			for (uint32_t i = 0; i < object->number_of_enums; i++) {
+				const check_snmp_mib_index_enum *entry = &loaded_index.enums[object->first_enum + i];
+				if (entry->value == value) {
+					return &loaded_index.strings[entry->label];
+				}
+			}
+			return NULL;
+		}
+	}
+
+	struct tree *tree_head = get_tree_head();
+	if (tree_head == NULL) {
+		return NULL;
+	}
+	struct tree *node = get_tree(name, length, tree_head);
+	for (struct enum_list *entry = (node != NULL) ? node->enums : NULL; entry != NULL;
+		 entry = entry->next) {
+		if (entry->value == value) {
+			return entry->label;
+		}
+	}
+	return NULL;
+}
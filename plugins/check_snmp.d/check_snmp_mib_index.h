@@ -0,0 +1,83 @@
+#pragma once
+/* Precompiled MIB index of check_snmp, see --mib-index and --mib-index-compile */
+
+#include "./config.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECK_SNMP_MIB_INDEX_MAGIC "NPMIBIDX"
+#define CHECK_SNMP_MIB_INDEX_FORMAT_VERSION 1
+
+/*
+ * The file starts with the header, the sections follow at the given offsets. All numbers
+ * are in host byte order, the index is meant for the machine which compiled it.
+ */
+typedef struct {
+	char magic[8];
+	uint32_t format_version;
+	uint32_t number_of_objects;
+	// check_snmp_mib_index_object, sorted by OID
+	uint32_t objects_offset;
+	// uint32_t numbers of the objects, sorted by label and module
+	uint32_t by_label_offset;
+	// uint32_t sub-identifiers of the OIDs of all objects
+	uint32_t subids_offset;
+	uint32_t number_of_subids;
+	// check_snmp_mib_index_enum
+	uint32_t enums_offset;
+	uint32_t number_of_enums;
+	// labels and module names, each terminated by '\0'
+	uint32_t strings_offset;
+	uint32_t strings_length;
+} check_snmp_mib_index_header;
+
+// a node of the MIB tree
+typedef struct {
+	// offsets in the strings
+	uint32_t label;
+	uint32_t module;
+	// position of the OID in the sub-identifiers
+	uint32_t oid;
+	uint32_t oid_length;
+	// the enumeration of the values, e.g. up(1) of ifOperStatus
+	uint32_t first_enum;
+	uint32_t number_of_enums;
+	// TYPE_* of the MIB parser
+	uint32_t type;
+} check_snmp_mib_index_object;
+
+typedef struct {
+	int32_t value;
+	uint32_t label;
+} check_snmp_mib_index_enum;
+
+/*
+ * Writes the objects of the loaded MIB tree into an index file, returns the number of
+ * objects. Dies with UNKNOWN on errors.
+ */
+size_t check_snmp_mib_index_write(const char *path, struct tree *tree_head);
+
+/*
+ * Maps an index file for check_snmp_parse_oid and check_snmp_snprint_objid, returns false if
+ * it is not usable
+ */
+bool check_snmp_mib_index_load(const char *path);
+
+/*
+ * Like snmp_parse_oid, but symbolic names like IF-MIB::ifDescr.1 or sysUpTime.0 are
+ * resolved with the MIB index if one is loaded
+ */
+oid *check_snmp_parse_oid(const char *input, oid *result, size_t *length);
+
+/*
+ * Like snprint_objid, but uses the MIB index if one is loaded
+ */
+int check_snmp_snprint_objid(char *buffer, size_t buffer_length, const oid *name, size_t length);
+
+/*
+ * The label of value in the enumeration of the object, e.g. "up" for 1 of ifOperStatus.3.
+ * Looks in the MIB index if one is loaded, otherwise in the loaded MIBs. NULL if the object
+ * or the value is unknown.
+ */
+const char *check_snmp_enum_label(const oid *name, size_t length, long value);
@@ -0,0 +1,298 @@
+/*****************************************************************************
+ *
+ * Binary state file of check_snmp
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * check_snmp --rate remembers the previous value of every OID. The values
+ * are kept as an array of fixed size check_snmp_state_entry records behind
+ * a small header, so reading them is a mmap and a few checks, without any
+ * text parsing and without a size limit.
+ *
+ * A new state is written into a temporary file which replaces the old one
+ * with rename, readers see either the old or the new file. A lock file
+ * next to it keeps concurrent runs from reading while one of them writes.
+ *
+ * The engines of SNMPv3 agents (--engine-cache) are kept the same way,
+ * one small file per agent.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "./check_snmp_state.h"
+#include "../utils.h"
+#include "../../lib/utils_base.h"
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern int verbose;
+extern const char *progname;
+
+static int lock_state(const char *path, int operation) {
+	char *lock_path = NULL;
+	xasprintf(&lock_path, "%s.lock", path);
+
+	int lock_descriptor = open(lock_path, (operation == LOCK_EX) ? (O_RDWR | O_CREAT) : O_RDONLY,
+							   S_IRUSR | S_IWUSR);
+	free(lock_path);
+
+	if (lock_descriptor >= 0 && flock(lock_descriptor, operation) != 0) {
+		close(lock_descriptor);
+		return -1;
+	}
+
+	return lock_descriptor;
+}
+
+check_snmp_state check_snmp_state_read(const char *path) {
+	check_snmp_state result = {.errorcode = ERROR};
+
+	// nobody ever wrote the state if there is no lock file, reading it is still fine
+	int lock_descriptor = lock_state(path, LOCK_SH);
+
+	int file_descriptor = open(path, O_RDONLY);
+	if (file_descriptor < 0) {
+		if (lock_descriptor >= 0) {
+			close(lock_descriptor);
+		}
+		return result;
+	}
+
+	struct stat file_status;
+	if (fstat(file_descriptor, &file_status) == 0 &&
+		(size_t)file_status.st_size >= sizeof(check_snmp_state_header)) {
+		result.mapping_length = (size_t)file_status.st_size;
+		result.mapping =
+			mmap(NULL, result.mapping_length, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (result.mapping == MAP_FAILED) {
+			result.mapping = NULL;
+		}
+	}
+
+	// the mapping stays valid after close and a later rename
+	close(file_descriptor);
+	if (lock_descriptor >= 0) {
+		close(lock_descriptor);
+	}
+
+	if (result.mapping == NULL) {
+		return result;
+	}
+
+	const check_snmp_state_header *header = result.mapping;
+	time_t current_time = time(NULL);
+
+	if (memcmp(header->magic, CHECK_SNMP_STATE_MAGIC, sizeof(header->magic)) != 0 ||
+		header->format_version != CHECK_SNMP_STATE_FORMAT_VERSION ||
+		header->entry_size != sizeof(check_snmp_state_entry) ||
+		header->number_of_entries > (result.mapping_length - sizeof(check_snmp_state_header)) /
+										sizeof(check_snmp_state_entry) ||
+		result.mapping_length != sizeof(check_snmp_state_header) +
+									 (header->number_of_entries * sizeof(check_snmp_state_entry)) ||
+		header->timestamp > current_time) {
+		if (verbose > 0) {
+			printf("State file %s is not usable, starting over\n", path);
+		}
+		check_snmp_state_release(&result);
+		return result;
+	}
+
+	result.errorcode = OK;
+	result.entries =
+		(const check_snmp_state_entry *)((const char *)result.mapping +
+										 sizeof(check_snmp_state_header));
+	result.number_of_entries = header->number_of_entries;
+	result.timestamp = (time_t)header->timestamp;
+	return result;
+}
+
+void check_snmp_state_release(check_snmp_state *state) {
+	if (state->mapping != NULL) {
+		munmap(state->mapping, state->mapping_length);
+	}
+	state->mapping = NULL;
+	state->mapping_length = 0;
+	state->entries = NULL;
+	state->number_of_entries = 0;
+	state->errorcode = ERROR;
+}
+
+static bool write_all(int file_descriptor, const void *data, size_t length) {
+	const char *position = data;
+	while (length > 0) {
+		ssize_t written = write(file_descriptor, position, length);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		position += written;
+		length -= (size_t)written;
+	}
+	return true;
+}
+
+void check_snmp_state_write_file(const char *path, const void *header, size_t header_length,
+								 const void *data, size_t data_length) {
+	/* If file doesn't currently exist, create directories */
+	if (access(path, F_OK) != 0) {
+		char *directories = strdup(path);
+		if (directories == NULL) {
+			die(STATE_UNKNOWN, _("Cannot allocate memory: %s"), strerror(errno));
+		}
+
+		for (char *ptr = directories + 1; *ptr; ptr++) {
+			if (*ptr == '/') {
+				*ptr = '\0';
+				if ((access(directories, F_OK) != 0) && (mkdir(directories, S_IRWXU) != 0)) {
+					die(STATE_UNKNOWN, _("Cannot create directory: %s"), directories);
+				}
+				*ptr = '/';
+			}
+		}
+		free(directories);
+	}
+
+	int lock_descriptor = lock_state(path, LOCK_EX);
+	if (lock_descriptor < 0) {
+		die(STATE_UNKNOWN, _("Cannot lock state file %s: %s"), path, strerror(errno));
+	}
+
+	char *temp_file = NULL;
+	xasprintf(&temp_file, "%s.XXXXXX", path);
+
+	int temp_file_desc = mkstemp(temp_file);
+	if (temp_file_desc == -1) {
+		die(STATE_UNKNOWN, _("Cannot create temporary filename"));
+	}
+
+	bool success = write_all(temp_file_desc, header, header_length) &&
+				   write_all(temp_file_desc, data, data_length);
+
+	fchmod(temp_file_desc, S_IRUSR | S_IWUSR | S_IRGRP);
+	success = success && fsync(temp_file_desc) == 0;
+	success = (close(temp_file_desc) == 0) && success;
+
+	if (!success) {
+		unlink(temp_file);
+		die(STATE_UNKNOWN, _("Error writing temp file"));
+	}
+
+	if (rename(temp_file, path) != 0) {
+		unlink(temp_file);
+		die(STATE_UNKNOWN, _("Cannot rename state temp file"));
+	}
+
+	free(temp_file);
+	/* closing the lock file releases the lock */
+	close(lock_descriptor);
+}
+
+void check_snmp_state_write(const char *path, time_t timestamp,
+							const check_snmp_state_entry *entries, size_t number_of_entries) {
+	check_snmp_state_header header = {
+		.format_version = CHECK_SNMP_STATE_FORMAT_VERSION,
+		.entry_size = sizeof(check_snmp_state_entry),
+		.number_of_entries = number_of_entries,
+		.timestamp = timestamp,
+	};
+	memcpy(header.magic, CHECK_SNMP_STATE_MAGIC, sizeof(header.magic));
+
+	check_snmp_state_write_file(path, &header, sizeof(header), entries,
+								number_of_entries * sizeof(check_snmp_state_entry));
+}
+
+char *check_snmp_engine_cache_path(const char *peername) {
+	char *key_name = NULL;
+	xasprintf(&key_name, "engine_%s", peername);
+	for (char *ptr = key_name; *ptr != '\0'; ptr++) {
+		if (!isalnum((unsigned char)*ptr)) {
+			*ptr = '_';
+		}
+	}
+
+	state_key engine_key = np_enable_state(key_name, 1, progname, 0, NULL);
+	free(key_name);
+	return engine_key._filename;
+}
+
+check_snmp_engine check_snmp_engine_cache_read(const char *path) {
+	check_snmp_engine result = {.errorcode = ERROR};
+
+	int lock_descriptor = lock_state(path, LOCK_SH);
+	int file_descriptor = open(path, O_RDONLY);
+
+	check_snmp_engine_record record;
+	ssize_t read_length = -1;
+	if (file_descriptor >= 0) {
+		read_length = read(file_descriptor, &record, sizeof(record));
+		close(file_descriptor);
+	}
+	if (lock_descriptor >= 0) {
+		close(lock_descriptor);
+	}
+
+	if (read_length != (ssize_t)sizeof(record) ||
+		memcmp(record.magic, CHECK_SNMP_ENGINE_MAGIC, sizeof(record.magic)) != 0 ||
+		record.format_version != CHECK_SNMP_ENGINE_FORMAT_VERSION ||
+		record.engine_id_length == 0 || record.engine_id_length > CHECK_SNMP_ENGINE_ID_MAX_LENGTH ||
+		record.timestamp > time(NULL)) {
+		return result;
+	}
+
+	result.errorcode = OK;
+	memcpy(result.engine_id, record.engine_id, record.engine_id_length);
+	result.engine_id_length = record.engine_id_length;
+	result.engine_boots = record.engine_boots;
+	result.engine_time = record.engine_time;
+	result.timestamp = (time_t)record.timestamp;
+	return result;
+}
+
+void check_snmp_engine_cache_write(const char *path, check_snmp_engine engine) {
+	check_snmp_engine_record record = {
+		.format_version = CHECK_SNMP_ENGINE_FORMAT_VERSION,
+		.engine_id_length = (uint32_t)engine.engine_id_length,
+		.engine_boots = engine.engine_boots,
+		.engine_time = engine.engine_time,
+		.timestamp = engine.timestamp,
+	};
+	memcpy(record.magic, CHECK_SNMP_ENGINE_MAGIC, sizeof(record.magic));
+	memcpy(record.engine_id, engine.engine_id, engine.engine_id_length);
+
+	check_snmp_state_write_file(path, &record, sizeof(record), NULL, 0);
+}
+
+void check_snmp_engine_cache_remove(const char *path) {
+	int lock_descriptor = lock_state(path, LOCK_EX);
+	unlink(path);
+	if (lock_descriptor >= 0) {
+		close(lock_descriptor);
+	}
+}
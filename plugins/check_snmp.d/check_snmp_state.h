@@ -0,0 +1,95 @@
+#pragma once
+/* Binary state file of check_snmp for --rate */
+
+#include "./check_snmp_helpers.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define CHECK_SNMP_STATE_MAGIC "NPSNMPST"
+// increase when the meaning of check_snmp_state_entry changes, its size is checked anyway
+#define CHECK_SNMP_STATE_FORMAT_VERSION 2
+
+typedef struct {
+	char magic[8];
+	uint32_t format_version;
+	uint32_t entry_size;
+	uint64_t number_of_entries;
+	int64_t timestamp;
+} check_snmp_state_header;
+
+typedef struct {
+	int errorcode;
+	// points into the mapping of the file
+	const check_snmp_state_entry *entries;
+	size_t number_of_entries;
+	time_t timestamp;
+
+	void *mapping;
+	size_t mapping_length;
+} check_snmp_state;
+
+/*
+ * Maps the state file into memory. errorcode is ERROR if there is no usable state: the
+ * file does not exist, is not a state file of this version or is from the future.
+ */
+check_snmp_state check_snmp_state_read(const char *path);
+
+void check_snmp_state_release(check_snmp_state *state);
+
+/*
+ * Replaces the state file atomically with a new one holding the entries. Dies with
+ * UNKNOWN if that is not possible.
+ */
+void check_snmp_state_write(const char *path, time_t timestamp,
+							const check_snmp_state_entry *entries, size_t number_of_entries);
+
+/*
+ * Replaces the file at path with header and data the same way, creating the directories
+ * if necessary. Dies with UNKNOWN on errors.
+ */
+void check_snmp_state_write_file(const char *path, const void *header, size_t header_length,
+								 const void *data, size_t data_length);
+
+#define CHECK_SNMP_ENGINE_MAGIC "NPSNMPEN"
+#define CHECK_SNMP_ENGINE_FORMAT_VERSION 1
+// RFC 3411 limits an snmpEngineID to 32 octets
+#define CHECK_SNMP_ENGINE_ID_MAX_LENGTH 32
+
+// file format of a cached engine
+typedef struct {
+	char magic[8];
+	uint32_t format_version;
+	uint32_t engine_id_length;
+	unsigned char engine_id[CHECK_SNMP_ENGINE_ID_MAX_LENGTH];
+	uint32_t engine_boots;
+	uint32_t engine_time;
+	int64_t timestamp;
+} check_snmp_engine_record;
+
+// the authoritative engine of an SNMPv3 agent, engine_time is the one at timestamp
+typedef struct {
+	int errorcode;
+	unsigned char engine_id[CHECK_SNMP_ENGINE_ID_MAX_LENGTH];
+	size_t engine_id_length;
+	unsigned int engine_boots;
+	unsigned int engine_time;
+	time_t timestamp;
+} check_snmp_engine;
+
+/*
+ * Location of the cached engine of the agent, next to the state files
+ */
+char *check_snmp_engine_cache_path(const char *peername);
+
+/*
+ * errorcode is ERROR if the engine of the agent is not known
+ */
+check_snmp_engine check_snmp_engine_cache_read(const char *path);
+
+void check_snmp_engine_cache_write(const char *path, check_snmp_engine engine);
+
+/*
+ * Forgets the engine, e.g. because the agent does not know it any more
+ */
+void check_snmp_engine_cache_remove(const char *path);
@@ -20,6 +20,15 @@
 
 #define DEFAULT_PORT    "161"
 #define DEFAULT_RETRIES 5
+#define DEFAULT_MAX_REPETITIONS 25
+// OIDs in one PDU, less if the agent answers tooBig
+#define DEFAULT_OIDS_PER_REQUEST 32
+// PDUs of a query which are sent before waiting for a response
+#define SNMP_PIPELINE_DEPTH 4
+// requests in flight over all hosts if there are several
+#define DEFAULT_MAX_REQUESTS_IN_FLIGHT 64
+// seconds the engineTime of an agent may drift from the cached one before it is stored again
+#define ENGINE_CACHE_TIME_TOLERANCE 10
 
 typedef struct eval_method {
 	bool crit_string;
@@ -36,6 +45,14 @@ typedef struct check_snmp_test_unit {
 
 typedef struct {
 	struct snmp_session snmp_session;
+	// peernames of the agents, the session is used for each of them
+	char **hosts;
+	size_t number_of_hosts;
+	size_t max_requests_in_flight;
+	// remember the engines of SNMPv3 agents instead of discovering them on every run
+	bool use_engine_cache;
+	// ask for sysUpTime.0 along with the test units to notice restarts of the agent
+	bool query_agent_uptime;
 	// use getnet instead of get
 	bool use_getnext;
 
@@ -45,6 +62,14 @@ typedef struct {
 
 	check_snmp_test_unit *test_units;
 	size_t num_of_test_units;
+	size_t oids_per_request;
+
+	// walk the OIDs of the test units as table columns instead of querying them
+	bool table_mode;
+	long max_repetitions;
+	// columns whose values name the rows of the table, e.g. ifDescr
+	char **label_columns;
+	size_t num_of_label_columns;
 } check_snmp_config_snmp_parameters;
 
 typedef struct {
@@ -68,6 +93,8 @@ typedef struct {
 	// activate rate calculation
 	bool calculate_rate;
 	unsigned int rate_multiplier;
+	// seconds of earlier values the rate is computed over, 0 for the previous value only
+	unsigned int rate_window;
 } check_snmp_evaluation_parameters;
 
 typedef struct check_snmp_config {
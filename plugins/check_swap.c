@@ -55,6 +55,7 @@ typedef struct {
 static swap_config_wrapper process_arguments(int argc, char **argv);
 void print_usage(void);
 static void print_help(swap_config /*config*/);
+static mp_subcheck evaluate_swap_activity(swap_config config, int argc, char **argv);
 
 int verbose;
 
@@ -106,6 +107,11 @@ int main(int argc, char **argv) {
 	if (config.output_format_is_set) {
 		mp_set_format(config.output_format);
 	}
+
+	if (config.check_activity) {
+		mp_add_subcheck_to_check(&overall, evaluate_swap_activity(config, argc, argv));
+	}
+
 	mp_subcheck sc1 = mp_subcheck_init();
 	sc1 = mp_set_subcheck_default_state(sc1, STATE_OK);
 
@@ -233,22 +239,152 @@ int check_swap(float free_swap_mb, float total_swap_mb, swap_config config) {
 	return STATE_OK;
 }
 
-#define output_format_index CHAR_MAX + 1
+/* Version of the data format in the state file */
+#define SWAP_ACTIVITY_STATE_VERSION 1
+
+static mp_subcheck evaluate_swap_activity_rate(const char *label, const char *description,
+											   unsigned long long previous,
+											   unsigned long long current, double time_diff,
+											   mp_thresholds thresholds) {
+	mp_subcheck sc = mp_subcheck_init();
+
+	double rate = (double)(current - previous) / time_diff;
+
+	mp_perfdata pd = perfdata_init();
+	pd.label = (char *)label;
+	pd = mp_set_pd_value(pd, rate);
+	pd = mp_set_pd_min_value(pd, mp_create_pd_value(0));
+	pd = mp_pd_set_thresholds(pd, thresholds);
+
+	sc = mp_set_subcheck_state(sc, mp_get_pd_status(pd));
+	mp_add_perfdata_to_subcheck(&sc, pd);
+	xasprintf(&sc.output, _("%s: %.2f/s"), description, rate);
+
+	return sc;
+}
+
+static void write_swap_activity_state(state_key stateKey, time_t time,
+									  swap_activity_counters counters) {
+	char *state_string = NULL;
+	xasprintf(&state_string, "%llu %llu %llu", counters.pswpin, counters.pswpout,
+			  counters.pgmajfault);
+	np_state_write_string(stateKey, time, state_string);
+	free(state_string);
+}
+
+static mp_subcheck evaluate_swap_activity(swap_config config, int argc, char **argv) {
+	mp_subcheck sc_activity = mp_subcheck_init();
+	sc_activity = mp_set_subcheck_default_state(sc_activity, STATE_OK);
+
+	swap_activity_result activity = getSwapActivityFromProcVmstat(PROC_VMSTAT);
+	time_t current_time = time(NULL);
+
+	if (activity.errorcode != STATE_OK) {
+		sc_activity = mp_set_subcheck_state(sc_activity, STATE_UNKNOWN);
+		xasprintf(&sc_activity.output, _("Failed to read swap activity from %s"), PROC_VMSTAT);
+		return sc_activity;
+	}
+
+	state_key stateKey = np_enable_state(NULL, SWAP_ACTIVITY_STATE_VERSION, progname, argc, argv);
+	state_data *previous_state = np_state_read(stateKey);
+
+	swap_activity_counters previous = {0};
+	bool have_previous_state = false;
+	if (previous_state != NULL && previous_state->errorcode == OK && previous_state->data != NULL &&
+		sscanf(previous_state->data, "%llu %llu %llu", &previous.pswpin, &previous.pswpout,
+			   &previous.pgmajfault) == 3) {
+		have_previous_state = true;
+	}
+
+	if (!have_previous_state) {
+		write_swap_activity_state(stateKey, current_time, activity.counters);
+		sc_activity = mp_set_subcheck_state(sc_activity, STATE_OK);
+		sc_activity.output =
+			(char *)_("Swap activity: no previous data to calculate rates - assume okay");
+		return sc_activity;
+	}
+
+	double time_diff = difftime(current_time, previous_state->time);
+	if (time_diff == 0) {
+		// keep the previous state, otherwise a rerun within the same second loses the interval
+		sc_activity = mp_set_subcheck_state(sc_activity, STATE_OK);
+		sc_activity.output = (char *)_("Swap activity: no rate yet, the last run was just now");
+		return sc_activity;
+	}
+	if (time_diff < 0) {
+		// the clock went backwards, start over with the current values
+		write_swap_activity_state(stateKey, current_time, activity.counters);
+		sc_activity = mp_set_subcheck_state(sc_activity, STATE_OK);
+		sc_activity.output = (char *)_("Swap activity: the clock went backwards - assume okay");
+		return sc_activity;
+	}
+
+	write_swap_activity_state(stateKey, current_time, activity.counters);
+
+	if (previous.pswpin > activity.counters.pswpin ||
+		previous.pswpout > activity.counters.pswpout ||
+		previous.pgmajfault > activity.counters.pgmajfault) {
+		// counters went backwards, the system was probably rebooted
+		sc_activity = mp_set_subcheck_state(sc_activity, STATE_OK);
+		sc_activity.output = (char *)_("Swap activity: counters were reset - assume okay");
+		return sc_activity;
+	}
+
+	if (verbose) {
+		printf("Swap activity over the last %.0f seconds\n", time_diff);
+	}
+
+	xasprintf(&sc_activity.output, _("Swap activity over the last %.0fs"), time_diff);
+
+	mp_add_subcheck_to_subcheck(&sc_activity, evaluate_swap_activity_rate(
+												  "swap_in", _("Swapped in"), previous.pswpin,
+												  activity.counters.pswpin, time_diff,
+												  config.th_swap_in));
+	mp_add_subcheck_to_subcheck(&sc_activity, evaluate_swap_activity_rate(
+												  "swap_out", _("Swapped out"), previous.pswpout,
+												  activity.counters.pswpout, time_diff,
+												  config.th_swap_out));
+	mp_add_subcheck_to_subcheck(
+		&sc_activity, evaluate_swap_activity_rate("major_faults", _("Major page faults"),
+												  previous.pgmajfault, activity.counters.pgmajfault,
+												  time_diff, config.th_major_faults));
+
+	return sc_activity;
+}
+
+enum {
+	output_format_index = CHAR_MAX + 1,
+	activity_index,
+	warning_swap_in_index,
+	critical_swap_in_index,
+	warning_swap_out_index,
+	critical_swap_out_index,
+	warning_major_faults_index,
+	critical_major_faults_index,
+};
 
 /* process command-line arguments */
 swap_config_wrapper process_arguments(int argc, char **argv) {
 	swap_config_wrapper conf_wrapper = {.errorcode = OK};
 	conf_wrapper.config = swap_config_init();
 
-	static struct option longopts[] = {{"warning", required_argument, 0, 'w'},
-									   {"critical", required_argument, 0, 'c'},
-									   {"allswaps", no_argument, 0, 'a'},
-									   {"no-swap", required_argument, 0, 'n'},
-									   {"verbose", no_argument, 0, 'v'},
-									   {"version", no_argument, 0, 'V'},
-									   {"help", no_argument, 0, 'h'},
-									   {"output-format", required_argument, 0, output_format_index},
-									   {0, 0, 0, 0}};
+	static struct option longopts[] = {
+		{"warning", required_argument, 0, 'w'},
+		{"critical", required_argument, 0, 'c'},
+		{"allswaps", no_argument, 0, 'a'},
+		{"no-swap", required_argument, 0, 'n'},
+		{"verbose", no_argument, 0, 'v'},
+		{"version", no_argument, 0, 'V'},
+		{"help", no_argument, 0, 'h'},
+		{"output-format", required_argument, 0, output_format_index},
+		{"activity", no_argument, 0, activity_index},
+		{"warning-swap-in", required_argument, 0, warning_swap_in_index},
+		{"critical-swap-in", required_argument, 0, critical_swap_in_index},
+		{"warning-swap-out", required_argument, 0, warning_swap_out_index},
+		{"critical-swap-out", required_argument, 0, critical_swap_out_index},
+		{"warning-major-faults", required_argument, 0, warning_major_faults_index},
+		{"critical-major-faults", required_argument, 0, critical_major_faults_index},
+		{0, 0, 0, 0}};
 
 	while (true) {
 		int option = 0;
@@ -331,6 +467,45 @@ swap_config_wrapper process_arguments(int argc, char **argv) {
 		case 'v': /* verbose */
 			verbose++;
 			break;
+		case activity_index:
+			conf_wrapper.config.check_activity = true;
+			break;
+		case warning_swap_in_index:
+		case critical_swap_in_index:
+		case warning_swap_out_index:
+		case critical_swap_out_index:
+		case warning_major_faults_index:
+		case critical_major_faults_index: {
+			mp_range_parsed tmp = mp_parse_range_string(optarg);
+			if (tmp.error != MP_PARSING_SUCCESS) {
+				die(STATE_UNKNOWN, "failed to parse swap activity threshold: %s", optarg);
+			}
+
+			swap_config *config = &conf_wrapper.config;
+			switch (option_char) {
+			case warning_swap_in_index:
+				config->th_swap_in = mp_thresholds_set_warn(config->th_swap_in, tmp.range);
+				break;
+			case critical_swap_in_index:
+				config->th_swap_in = mp_thresholds_set_crit(config->th_swap_in, tmp.range);
+				break;
+			case warning_swap_out_index:
+				config->th_swap_out = mp_thresholds_set_warn(config->th_swap_out, tmp.range);
+				break;
+			case critical_swap_out_index:
+				config->th_swap_out = mp_thresholds_set_crit(config->th_swap_out, tmp.range);
+				break;
+			case warning_major_faults_index:
+				config->th_major_faults =
+					mp_thresholds_set_warn(config->th_major_faults, tmp.range);
+				break;
+			default:
+				config->th_major_faults =
+					mp_thresholds_set_crit(config->th_major_faults, tmp.range);
+				break;
+			}
+			config->check_activity = true;
+		} break;
 		case output_format_index: {
 			parsed_output_format parser = mp_parse_output_format(optarg);
 			if (!parser.parsing_success) {
@@ -399,6 +574,16 @@ void print_help(swap_config config) {
 		   _("Resulting state when there is no swap regardless of thresholds. "
 			 "Default:"),
 		   state_text(config.no_swap_state));
+	printf(" %s\n", "--activity");
+	printf("    %s\n", _("Additionally report swap-in, swap-out and major page fault rates"));
+	printf("    %s\n", _("per second, computed from the /proc/vmstat counters of the last run"));
+	printf(" %s\n", "--warning-swap-in=RANGE, --critical-swap-in=RANGE");
+	printf("    %s\n", _("Thresholds for the swap-in rate (pages/s)"));
+	printf(" %s\n", "--warning-swap-out=RANGE, --critical-swap-out=RANGE");
+	printf("    %s\n", _("Thresholds for the swap-out rate (pages/s)"));
+	printf(" %s\n", "--warning-major-faults=RANGE, --critical-major-faults=RANGE");
+	printf("    %s\n", _("Thresholds for the major page fault rate (faults/s)"));
+	printf("    %s\n", _("All of the activity thresholds imply --activity"));
 	printf(UT_OUTPUT_FORMAT);
 	printf(UT_VERBOSE);
 
@@ -407,6 +592,8 @@ void print_help(swap_config config) {
 	printf(" %s\n", _("Both INTEGER and PERCENT thresholds can be specified, "
 					  "they are all checked."));
 	printf(" %s\n", _("On AIX, if -a is specified, uses lsps -a, otherwise uses lsps -s."));
+	printf(" %s\n", _("--activity is only available on Linux. The counters are kept in a state"));
+	printf(" %s\n", _("file below $MP_STATE_PATH, the first run only initializes them."));
 
 	printf(UT_SUPPORT);
 }
@@ -415,4 +602,5 @@ void print_usage(void) {
 	printf("%s\n", _("Usage:"));
 	printf(" %s [-av] -w <percent_free>%% -c <percent_free>%%\n", progname);
 	printf("  -w <bytes_free> -c <bytes_free> [-n <state>]\n");
+	printf("  [--activity] [--warning-swap-in=RANGE] [--critical-swap-in=RANGE] ...\n");
 }
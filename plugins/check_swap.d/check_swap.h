@@ -3,6 +3,11 @@
 #include "../common.h"
 #include "../../lib/output.h"
 #include "../../lib/states.h"
+#include "../../lib/thresholds.h"
+
+#ifndef PROC_VMSTAT
+#	define PROC_VMSTAT "/proc/vmstat"
+#endif
 
 #ifndef SWAP_CONVERSION
 #	define SWAP_CONVERSION 1
@@ -25,6 +30,20 @@ typedef struct {
 	swap_metrics metrics;
 } swap_result;
 
+/*
+ * Paging counters from /proc/vmstat, all of them are monotonic since boot
+ */
+typedef struct {
+	unsigned long long pswpin;     // pages swapped in
+	unsigned long long pswpout;    // pages swapped out
+	unsigned long long pgmajfault; // major page faults
+} swap_activity_counters;
+
+typedef struct {
+	int errorcode;
+	swap_activity_counters counters;
+} swap_activity_result;
+
 typedef struct {
 	bool allswaps;
 	mp_state_enum no_swap_state;
@@ -35,6 +54,12 @@ typedef struct {
 	bool on_aix;
 	int conversion_factor;
 
+	// swap activity (rates computed from /proc/vmstat counters between two runs)
+	bool check_activity;
+	mp_thresholds th_swap_in;
+	mp_thresholds th_swap_out;
+	mp_thresholds th_major_faults;
+
 	bool output_format_is_set;
 	mp_output_format output_format;
 } swap_config;
@@ -43,6 +68,7 @@ swap_config swap_config_init(void);
 
 swap_result get_swap_data(swap_config config);
 swap_result getSwapFromProcMeminfo(char path_to_proc_meminfo[]);
+swap_activity_result getSwapActivityFromProcVmstat(char path_to_proc_vmstat[]);
 swap_result getSwapFromSwapCommand(swap_config config, const char swap_command[],
 								   const char swap_format[]);
 swap_result getSwapFromSwapctl_BSD(swap_config config);
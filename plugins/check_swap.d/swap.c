@@ -1,6 +1,7 @@
 #include "./check_swap.d/check_swap.h"
 #include "../popen.h"
 #include "../utils.h"
+#include "../../lib/utils_procfs.h"
 #include "common.h"
 
 extern int verbose;
@@ -16,6 +17,11 @@ swap_config swap_config_init(void) {
 
 	tmp.output_format_is_set = false;
 
+	tmp.check_activity = false;
+	tmp.th_swap_in = mp_thresholds_init();
+	tmp.th_swap_out = mp_thresholds_init();
+	tmp.th_major_faults = mp_thresholds_init();
+
 #ifdef _AIX
 	tmp.on_aix = true;
 #else
@@ -65,89 +71,95 @@ swap_result get_swap_data(swap_config config) {
 }
 
 swap_result getSwapFromProcMeminfo(char proc_meminfo[]) {
-	FILE *meminfo_file_ptr;
-	meminfo_file_ptr = fopen(proc_meminfo, "r");
-
 	swap_result result = {};
 	result.errorcode = STATE_UNKNOWN;
 
-	if (meminfo_file_ptr == NULL) {
+	enum {
+		SWAP_TOTAL,
+		SWAP_FREE,
+		SWAP_CACHED,
+		SWAP_NETBSD,
+	};
+
+	mp_procfs_field fields[] = {
+		[SWAP_TOTAL] = {.key = "SwapTotal"},
+		[SWAP_FREE] = {.key = "SwapFree"},
+		[SWAP_CACHED] = {.key = "SwapCached"},
+		/* NetBSD has a single line looking like "Swap: 123 123 123" (total, used, free) in Bytes */
+		[SWAP_NETBSD] = {.key = "Swap"},
+	};
+
+	mp_procfs_keyset keyset;
+	mp_procfs_keyset_init(&keyset, fields, sizeof(fields) / sizeof(fields[0]));
+
+	if (mp_procfs_read_kv(proc_meminfo, &keyset) == ERROR) {
 		// failed to open meminfo file
 		// errno should contain an error
-		result.errorcode = STATE_UNKNOWN;
 		return result;
 	}
 
-	unsigned long swap_total = 0;
-	unsigned long swap_used = 0;
-	unsigned long swap_free = 0;
-
-	bool found_total = false;
-	bool found_free = false;
-
-	char input_buffer[MAX_INPUT_BUFFER];
-	char str[32];
-
-	while (fgets(input_buffer, MAX_INPUT_BUFFER - 1, meminfo_file_ptr)) {
-
-		/*
-		 * The following sscanf call looks for a line looking like: "Swap: 123
-		 * 123 123" which exists on NetBSD (at least),
-		 * The unit should be Bytes
-		 */
-		if (sscanf(input_buffer, "%*[S]%*[w]%*[a]%*[p]%*[:] %lu %lu %lu", &swap_total, &swap_used,
-				   &swap_free) == 3) {
-			found_total = true;
-			found_free = true;
-			// Set error
-			result.errorcode = STATE_OK;
-			// Break out of fgets here, since both scanf expressions might match (NetBSD for
-			// example)
-			break;
-		}
-
-		/*
-		 * The following sscanf call looks for lines looking like:
-		 * "SwapTotal: 123" and "SwapFree: 123" This format exists at least
-		 * on Debian Linux with a 5.* kernel
-		 */
-		unsigned long tmp_KB = 0;
-		int sscanf_result = sscanf(input_buffer,
-								   "%*[S]%*[w]%*[a]%*[p]%[TotalFreCchd]%*[:] %lu "
-								   "%*[k]%*[B]",
-								   str, &tmp_KB);
-
-		if (sscanf_result == 2) {
+	if (fields[SWAP_NETBSD].found && fields[SWAP_NETBSD].number_of_values == 3) {
+		result.metrics.total = fields[SWAP_NETBSD].values[0];
+		result.metrics.used = fields[SWAP_NETBSD].values[1];
+		result.metrics.free = fields[SWAP_NETBSD].values[2];
+		result.errorcode = STATE_OK;
+		return result;
+	}
 
-			if (verbose >= 3) {
-				printf("Got %s with %lu\n", str, tmp_KB);
-			}
+	if (!fields[SWAP_TOTAL].found || !fields[SWAP_FREE].found) {
+		return result;
+	}
 
-			/* I think this part is always in Kb, so convert to bytes */
-			if (strcmp("Total", str) == 0) {
-				swap_total = tmp_KB * 1000;
-				found_total = true;
-			} else if (strcmp("Free", str) == 0) {
-				swap_free += tmp_KB * 1000;
-				found_free = true;
-			} else if (strcmp("Cached", str) == 0) {
-				swap_free += tmp_KB * 1000;
+	if (verbose >= 3) {
+		for (size_t i = SWAP_TOTAL; i <= SWAP_CACHED; i++) {
+			if (fields[i].found) {
+				printf("Got %s with %llu\n", fields[i].key, fields[i].values[0]);
 			}
-
-			result.errorcode = STATE_OK;
 		}
 	}
 
-	fclose(meminfo_file_ptr);
+	unsigned long long swap_total = fields[SWAP_TOTAL].values[0];
+	unsigned long long swap_free = fields[SWAP_FREE].values[0];
+	if (fields[SWAP_CACHED].found) {
+		swap_free += fields[SWAP_CACHED].values[0];
+	}
 
 	result.metrics.total = swap_total;
 	result.metrics.free = swap_free;
 	result.metrics.used = swap_total - swap_free;
+	result.errorcode = STATE_OK;
+
+	return result;
+}
+
+swap_activity_result getSwapActivityFromProcVmstat(char proc_vmstat[]) {
+	swap_activity_result result = {
+		.errorcode = STATE_UNKNOWN,
+	};
 
-	if (!found_free || !found_total) {
-		result.errorcode = STATE_UNKNOWN;
+	mp_procfs_field fields[] = {
+		{.key = "pswpin"},
+		{.key = "pswpout"},
+		{.key = "pgmajfault"},
+	};
+
+	mp_procfs_keyset keyset;
+	mp_procfs_keyset_init(&keyset, fields, sizeof(fields) / sizeof(fields[0]));
+
+	if (mp_procfs_read_kv(proc_vmstat, &keyset) != 3) {
+		return result;
+	}
+
+	result.counters.pswpin = fields[0].values[0];
+	result.counters.pswpout = fields[1].values[0];
+	result.counters.pgmajfault = fields[2].values[0];
+
+	if (verbose >= 3) {
+		printf("Got pswpin %llu, pswpout %llu, pgmajfault %llu\n", result.counters.pswpin,
+			   result.counters.pswpout, result.counters.pgmajfault);
 	}
 
+	result.errorcode = STATE_OK;
 	return result;
 }
 
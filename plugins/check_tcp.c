@@ -36,6 +36,7 @@ const char *email = "devel@monitoring-plugins.org";
 #include "./netutils.h"
 #include "./utils.h"
 #include "./check_tcp.d/config.h"
+#include "./check_tcp.d/check_tcp_helpers.h"
 #include "output.h"
 #include "states.h"
 
@@ -249,6 +250,18 @@ int main(int argc, char **argv) {
 		mp_set_format(config.output_format);
 	}
 
+	if (config.targets_count > 0) {
+		/* every target has its own deadline, the alarm only ends a hanging process */
+		size_t rounds =
+			(config.targets_count + config.max_connections - 1) / config.max_connections;
+		signal(SIGALRM, socket_timeout_alarm_handler);
+		alarm((unsigned int)(rounds + 1) * socket_timeout);
+
+		overall = check_tcp_check_targets(config);
+		alarm(0);
+		mp_exit(overall);
+	}
+
 	mp_set_ok_summary(&overall, "Connection succeeded");
 
 	/* set up the timer */
@@ -503,6 +516,9 @@ static check_tcp_config_wrapper process_arguments(int argc, char **argv, check_t
 	enum {
 		SNI_OPTION = CHAR_MAX + 1,
 		output_format_index,
+		target_index,
+		target_file_index,
+		max_connections_index,
 	};
 
 	static struct option longopts[] = {
@@ -533,6 +549,9 @@ static check_tcp_config_wrapper process_arguments(int argc, char **argv, check_t
 		{"sni", required_argument, 0, SNI_OPTION},
 		{"certificate", required_argument, 0, 'D'},
 		{"output-format", required_argument, 0, output_format_index},
+		{"target", required_argument, 0, target_index},
+		{"target-file", required_argument, 0, target_file_index},
+		{"max-connections", required_argument, 0, max_connections_index},
 		{0, 0, 0, 0}};
 
 	if (argc < 2) {
@@ -744,7 +763,42 @@ static check_tcp_config_wrapper process_arguments(int argc, char **argv, check_t
 			config.output_format = parser.output_format;
 			break;
 		}
+		case target_index:
+			check_tcp_add_targets(optarg, &config.targets, &config.targets_count);
+			break;
+		case target_file_index:
+			check_tcp_read_targets(optarg, &config.targets, &config.targets_count);
+			break;
+		case max_connections_index:
+			if (!is_intpos(optarg)) {
+				usage4(_("Maximum number of connections must be a positive integer"));
+			}
+			config.max_connections = strtoul(optarg, NULL, 10);
+			break;
+		}
+	}
+
+	if (config.targets_count > 0) {
+		if (config.protocol != IPPROTO_TCP) {
+			usage4(_("Several targets can only be checked over TCP"));
+		}
+		if (config.use_tls) {
+			usage4(_("Several targets can not be checked with SSL"));
+		}
+		if (config.delay > 0) {
+			usage4(_("Several targets can not be checked with a delay"));
+		}
+
+		for (size_t i = 0; i < config.targets_count; i++) {
+			if (config.targets[i].port == 0) {
+				if (config.server_port == 0) {
+					usage2(_("Target without a port, use host:port or -p"),
+						   config.targets[i].host);
+				}
+				config.targets[i].port = config.server_port;
+			}
 		}
+		check_tcp_remove_duplicate_targets(config.targets, &config.targets_count);
 	}
 
 	int index = optind;
@@ -818,6 +872,19 @@ void print_help(const char *service) {
 	printf("    %s\n", _("SSL server_name"));
 #endif
 
+	printf(" %s\n", "--target=HOST[:PORT][,HOST[:PORT]...]");
+	printf("    %s\n", _("Check these targets instead of -H, all at the same time (may be"));
+	printf("    %s\n", _("repeated). Use [ADDRESS]:PORT for IPv6 addresses, the port defaults"));
+	printf("    %s\n", _("to -p. Every target gets its own result and the timeout of -t. The"));
+	printf("    %s\n", _("host names are resolved before the first connection is opened, the"));
+	printf("    %s\n", _("timeout starts with the connection"));
+	printf(" %s\n", "--target-file=FILE");
+	printf("    %s\n", _("Read targets from FILE, one per line"));
+	printf(" %s\n", "--max-connections=INTEGER");
+	printf("    %s\n", _("Number of connections to the targets open at the same time"));
+	printf("    %s", _("(default: "));
+	printf("%d)\n", DEFAULT_MAX_CONNECTIONS);
+
 	printf(UT_WARN_CRIT);
 
 	printf(UT_CONN_TIMEOUT, DEFAULT_SOCKET_TIMEOUT);
@@ -835,4 +902,7 @@ void print_usage(void) {
 	printf("[-e <expect string>] [-q <quit string>][-m <maximum bytes>] [-d <delay>]\n");
 	printf("[-t <timeout seconds>] [-r <refuse state>] [-M <mismatch state>] [-v] [-4|-6] [-j]\n");
 	printf("[-D <warn days cert expire>[,<crit days cert expire>]] [-S <use SSL>] [-E]\n");
+	printf("%s --target <host:port>[,<host:port>...] | --target-file <file> [-p port]\n",
+		   progname);
+	printf("[--max-connections <number>] [options of the first form except -S, -D and -d]\n");
 }
@@ -0,0 +1,742 @@
+/*****************************************************************************
+ *
+ * Helpers for check_tcp
+ *
+ * License: GPL
+ * Copyright (c) 2026 Monitoring Plugins Development Team
+ *
+ * Description:
+ *
+ * Sweeping the ports of thousands of endpoints with one check_tcp process
+ * per endpoint spends most of the time starting processes and waiting for
+ * one connection after another. With --target a single process runs the
+ * connect, send and expect steps for all endpoints of a list at the same
+ * time on non-blocking sockets, driven by epoll.
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "../common.h"
+#include "./check_tcp_helpers.h"
+#include "../netutils.h"
+#include "../utils.h"
+#include <ctype.h>
+#include <netdb.h>
+#include <time.h>
+#ifdef HAVE_SYS_EPOLL_H
+#	include <sys/epoll.h>
+#endif
+
+extern int verbosity;
+
+check_tcp_config check_tcp_config_init() {
+	check_tcp_config result = {
+		.server_address = "127.0.0.1",
+		.host_specified = false,
+		.server_port = 0,
+
+		.protocol = IPPROTO_TCP,
+		.service = "TCP",
+		.send = NULL,
+		.quit = NULL,
+		.server_expect = NULL,
+		.server_expect_count = 0,
+		.use_tls = false,
+#ifdef HAVE_SSL
+		.sni = NULL,
+		.sni_specified = false,
+		.check_cert = false,
+		.days_till_exp_warn = 0,
+		.days_till_exp_crit = 0,
+#endif // HAVE_SSL
+		.match_flags = NP_MATCH_EXACT,
+		.expect_mismatch_state = STATE_WARNING,
+		.delay = 0,
+
+		.warning_time_set = false,
+		.warning_time = 0,
+		.critical_time_set = false,
+		.critical_time = 0,
+
+		.econn_refuse_state = STATE_CRITICAL,
+
+		.maxbytes = 0,
+
+		.hide_output = false,
+
+		.output_format_set = false,
+
+		.targets = NULL,
+		.targets_count = 0,
+		.max_connections = DEFAULT_MAX_CONNECTIONS,
+	};
+	return result;
+}
+
+check_tcp_target_wrapper check_tcp_parse_target(const char *input) {
+	check_tcp_target_wrapper result = {
+		.errorcode = ERROR,
+		.target =
+			{
+				.host = NULL,
+				.port = 0,
+			},
+	};
+
+	const char *host = input;
+	size_t host_length = 0;
+	const char *port = NULL;
+	if (input[0] == '[') {
+		const char *end = strchr(input, ']');
+		if (end == NULL || end == input + 1) {
+			return result;
+		}
+		host = input + 1;
+		host_length = (size_t)(end - host);
+		if (end[1] == ':') {
+			port = end + 2;
+		} else if (end[1] != '\0') {
+			return result;
+		}
+	} else {
+		const char *colon = strchr(input, ':');
+		/* an IPv6 address without brackets has no port */
+		if (colon != NULL && strchr(colon + 1, ':') == NULL) {
+			host_length = (size_t)(colon - input);
+			port = colon + 1;
+		} else {
+			host_length = strlen(input);
+		}
+	}
+
+	if (host_length == 0 || strcspn(host, " \t/") < host_length) {
+		return result;
+	}
+
+	if (port != NULL) {
+		long port_number = strtol(port, NULL, 10);
+		if (port[0] == '\0' || strspn(port, "0123456789") != strlen(port) || port_number < 1 ||
+			port_number > 65535) {
+			return result;
+		}
+		result.target.port = (int)port_number;
+	}
+
+	result.target.host = strndup(host, host_length);
+	if (result.target.host == NULL) {
+		die(STATE_UNKNOWN, _("Allocation failed"));
+	}
+	result.errorcode = OK;
+	return result;
+}
+
+static void add_target(const char *input, check_tcp_target **targets,
+					   size_t targets_count[static 1]) {
+	check_tcp_target_wrapper parsed = check_tcp_parse_target(input);
+	if (parsed.errorcode != OK) {
+		usage2(_("Invalid target, expecting host[:port]"), input);
+	}
+
+	check_tcp_target *tmp = realloc(*targets, sizeof(check_tcp_target) * (*targets_count + 1));
+	if (tmp == NULL) {
+		die(STATE_UNKNOWN, _("Allocation failed"));
+	}
+	*targets = tmp;
+	(*targets)[(*targets_count)++] = parsed.target;
+}
+
+void check_tcp_add_targets(char *list, check_tcp_target **targets, size_t targets_count[static 1]) {
+	for (char *entry = strtok(list, ","); entry != NULL; entry = strtok(NULL, ",")) {
+		add_target(entry, targets, targets_count);
+	}
+}
+
+void check_tcp_read_targets(const char *path, check_tcp_target **targets,
+							size_t targets_count[static 1]) {
+	FILE *target_file = fopen(path, "r");
+	if (target_file == NULL) {
+		usage2(_("file does not exist or is not readable"), path);
+	}
+
+	char line[MAX_INPUT_BUFFER];
+	while (fgets(line, sizeof(line), target_file) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		char *entry = line;
+		while (isspace((unsigned char)*entry)) {
+			entry++;
+		}
+		if (*entry == '\0' || *entry == '#') {
+			continue;
+		}
+		for (char *end = entry + strlen(entry); end > entry && isspace((unsigned char)end[-1]);
+			 end--) {
+			end[-1] = '\0';
+		}
+
+		add_target(entry, targets, targets_count);
+	}
+
+	fclose(target_file);
+}
+
+void check_tcp_remove_duplicate_targets(check_tcp_target *targets, size_t targets_count[static 1]) {
+	size_t kept = 0;
+	for (size_t i = 0; i < *targets_count; i++) {
+		bool duplicate = false;
+		for (size_t j = 0; j < kept && !duplicate; j++) {
+			duplicate = targets[j].port == targets[i].port &&
+						strcasecmp(targets[j].host, targets[i].host) == 0;
+		}
+		if (duplicate) {
+			if (verbosity > 0) {
+				printf(_("Ignoring the duplicate target %s:%d\n"), targets[i].host,
+					   targets[i].port);
+			}
+			free(targets[i].host);
+			continue;
+		}
+		targets[kept++] = targets[i];
+	}
+	*targets_count = kept;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* some protocols wait for further input, so stop reading after this long without data */
+static const double READ_TIMEOUT = 2.0;
+
+typedef enum {
+	TARGET_CONNECTING,
+	TARGET_SENDING,
+	TARGET_RECEIVING,
+	TARGET_DONE,
+} target_phase;
+
+/* one slot of the connection window, reused once its target is done */
+typedef struct {
+	size_t index;
+	const check_tcp_target *target;
+	target_phase phase;
+	int socket_descriptor;
+	struct addrinfo *addresses;
+	// the address to try if the current connection attempt fails
+	struct addrinfo *next_address;
+	int connect_error;
+
+	double start_time;
+	double deadline;
+	// extended by every read, 0 until the first data arrived
+	double read_deadline;
+
+	size_t sent;
+	char *received;
+	size_t received_length;
+	enum np_match_result match;
+} target_connection;
+
+static double monotonic_seconds(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1.0e9);
+}
+
+static char *target_name(const check_tcp_target *target) {
+	char *result = NULL;
+	if (strchr(target->host, ':') != NULL) {
+		xasprintf(&result, "[%s]:%d", target->host, target->port);
+	} else {
+		xasprintf(&result, "%s:%d", target->host, target->port);
+	}
+	return result;
+}
+
+static mp_subcheck target_failed(const check_tcp_target *target, mp_state_enum state,
+								 const char *reason) {
+	mp_subcheck result = mp_subcheck_init();
+	result = mp_set_subcheck_state(result, state);
+	char *name = target_name(target);
+	xasprintf(&result.output, "%s - %s", name, reason);
+	free(name);
+	return result;
+}
+
+/* the same evaluation as for a single target: answer, then connection time */
+static mp_subcheck target_succeeded(const target_connection *connection,
+									const check_tcp_config *config, double elapsed_time) {
+	char *name = target_name(connection->target);
+
+	if (config->server_expect_count > 0 && connection->received_length == 0) {
+		mp_subcheck result = target_failed(connection->target, STATE_CRITICAL,
+										   _("Received no data when some was expected"));
+		free(name);
+		return result;
+	}
+
+	mp_subcheck result = mp_subcheck_init();
+	result = mp_set_subcheck_state(result, STATE_OK);
+
+	mp_perfdata time_pd = perfdata_init();
+	time_pd = mp_set_pd_value(time_pd, elapsed_time);
+	xasprintf(&time_pd.label, "%s_time", name);
+	time_pd.uom = "s";
+
+	char *time_output = NULL;
+	if (config->critical_time_set && elapsed_time > config->critical_time) {
+		result = mp_set_subcheck_state(result, STATE_CRITICAL);
+		xasprintf(&time_output, "connection time %fs exceeded critical threshold (%f)",
+				  elapsed_time, config->critical_time);
+	} else if (config->warning_time_set && elapsed_time > config->warning_time) {
+		result = mp_set_subcheck_state(result, STATE_WARNING);
+		xasprintf(&time_output, "connection time %fs exceeded warning threshold (%f)",
+				  elapsed_time, config->warning_time);
+	} else {
+		xasprintf(&time_output, "connection time %fs", elapsed_time);
+	}
+
+	if (config->critical_time_set) {
+		time_pd.crit_present = true;
+		time_pd.crit = mp_range_init();
+		time_pd.crit.end = mp_create_pd_value(config->critical_time);
+		time_pd.crit.end_infinity = false;
+	}
+	if (config->warning_time_set) {
+		time_pd.warn_present = true;
+		time_pd.warn = mp_range_init();
+		time_pd.warn.end = mp_create_pd_value(config->warning_time);
+		time_pd.warn.end_infinity = false;
+	}
+	mp_add_perfdata_to_subcheck(&result, time_pd);
+
+	const char *answer_output = "";
+	if (connection->match == NP_MATCH_FAILURE) {
+		result = mp_set_subcheck_state(
+			result, max_state_alt(mp_compute_subcheck_state(result), config->expect_mismatch_state));
+		answer_output = _(", answer failed to match expectation");
+	} else if (connection->match == NP_MATCH_SUCCESS) {
+		answer_output = _(", answer matched expectation");
+	}
+
+	xasprintf(&result.output, "%s - %s%s", name, time_output, answer_output);
+	free(time_output);
+	free(name);
+	return result;
+}
+
+static void watch_socket(int epoll_descriptor, target_connection *connection, uint32_t events,
+						 int operation) {
+	struct epoll_event event = {
+		.events = events,
+		.data.ptr = connection,
+	};
+	if (epoll_ctl(epoll_descriptor, operation, connection->socket_descriptor, &event) != 0) {
+		die(STATE_UNKNOWN, _("epoll_ctl failed: %s\n"), strerror(errno));
+	}
+}
+
+static void close_connection(target_connection *connection) {
+	if (connection->socket_descriptor >= 0) {
+		/* closing the socket also removes it from the epoll set */
+		close(connection->socket_descriptor);
+		connection->socket_descriptor = -1;
+	}
+}
+
+/* starts a connection to the next address of the target, false if none is left */
+static bool connect_next_address(int epoll_descriptor, target_connection *connection) {
+	while (connection->next_address != NULL) {
+		struct addrinfo *address = connection->next_address;
+		connection->next_address = address->ai_next;
+
+		int socket_descriptor =
+			socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+				   address->ai_protocol);
+		if (socket_descriptor < 0) {
+			connection->connect_error = errno;
+			continue;
+		}
+
+		if (connect(socket_descriptor, address->ai_addr, address->ai_addrlen) != 0 &&
+			errno != EINPROGRESS) {
+			connection->connect_error = errno;
+			close(socket_descriptor);
+			continue;
+		}
+
+		/* the socket becomes writable once the connection is established or failed */
+		connection->socket_descriptor = socket_descriptor;
+		connection->phase = TARGET_CONNECTING;
+		watch_socket(epoll_descriptor, connection, EPOLLOUT, EPOLL_CTL_ADD);
+		return true;
+	}
+	return false;
+}
+
+static void finish_target(target_connection *connection, const check_tcp_config *config,
+						  mp_subcheck *results, mp_state_enum failure_state,
+						  const char *failure_reason) {
+	if (failure_reason != NULL) {
+		results[connection->index] =
+			target_failed(connection->target, failure_state, failure_reason);
+	} else {
+		if (connection->match == NP_MATCH_RETRY) {
+			connection->match = NP_MATCH_FAILURE;
+		}
+
+		if (config->quit != NULL) {
+			/* best effort, the answer has been evaluated already */
+			if (send(connection->socket_descriptor, config->quit, strlen(config->quit),
+					 MSG_NOSIGNAL) < 0 &&
+				verbosity > 1) {
+				printf("%s: sending the quit string failed: %s\n", connection->target->host,
+					   strerror(errno));
+			}
+		}
+		results[connection->index] = target_succeeded(
+			connection, config, monotonic_seconds() - connection->start_time);
+	}
+
+	if (verbosity > 1) {
+		printf("%s\n", results[connection->index].output);
+	}
+
+	close_connection(connection);
+	freeaddrinfo(connection->addresses);
+	connection->addresses = NULL;
+	free(connection->received);
+	connection->received = NULL;
+	connection->phase = TARGET_DONE;
+}
+
+/* the addresses of a target, resolved before the first connection is started */
+typedef struct {
+	struct addrinfo *addresses;
+	// 0 or the error of getaddrinfo
+	int error;
+} target_addresses;
+
+static target_addresses resolve_target(const check_tcp_target *target) {
+	struct addrinfo hints = {
+		.ai_family = address_family,
+		.ai_socktype = SOCK_STREAM,
+		.ai_protocol = IPPROTO_TCP,
+		.ai_flags = AI_NUMERICSERV,
+	};
+	char port[8];
+	snprintf(port, sizeof(port), "%d", target->port);
+
+	target_addresses result = {0};
+	result.error = getaddrinfo(target->host, port, &hints, &result.addresses);
+	if (result.error != 0) {
+		result.addresses = NULL;
+	}
+	return result;
+}
+
+/* takes ownership of the addresses */
+static void start_target(int epoll_descriptor, target_connection *connection, size_t index,
+						 target_addresses addresses, const check_tcp_config *config,
+						 mp_subcheck *results) {
+	*connection = (target_connection){
+		.index = index,
+		.target = &config->targets[index],
+		.socket_descriptor = -1,
+		.addresses = addresses.addresses,
+		.match = NP_MATCH_NONE,
+	};
+	connection->start_time = monotonic_seconds();
+	connection->deadline = connection->start_time + socket_timeout;
+
+	if (addresses.error != 0) {
+		char *reason = NULL;
+		xasprintf(&reason, _("Could not resolve the host: %s"), gai_strerror(addresses.error));
+		finish_target(connection, config, results, STATE_UNKNOWN, reason);
+		free(reason);
+		return;
+	}
+
+	connection->next_address = connection->addresses;
+	if (!connect_next_address(epoll_descriptor, connection)) {
+		char *reason = NULL;
+		xasprintf(&reason, _("Connection failed: %s"), strerror(connection->connect_error));
+		finish_target(connection, config, results, STATE_CRITICAL, reason);
+		free(reason);
+	}
+}
+
+static void connection_failed(int epoll_descriptor, target_connection *connection,
+							  const check_tcp_config *config, mp_subcheck *results) {
+	close_connection(connection);
+	if (connect_next_address(epoll_descriptor, connection)) {
+		return;
+	}
+
+	if (connection->connect_error == ECONNREFUSED) {
+		finish_target(connection, config, results, config->econn_refuse_state,
+					  _("Connection was REFUSED"));
+	} else {
+		char *reason = NULL;
+		xasprintf(&reason, _("Connection failed: %s"), strerror(connection->connect_error));
+		finish_target(connection, config, results, STATE_CRITICAL, reason);
+		free(reason);
+	}
+}
+
+/* sends what is left of the send string, then waits for the answer if one is expected */
+static void continue_conversation(int epoll_descriptor, target_connection *connection,
+								  const check_tcp_config *config, mp_subcheck *results) {
+	size_t send_length = config->send != NULL ? strlen(config->send) : 0;
+	while (connection->sent < send_length) {
+		/* a peer which closed the connection must not kill the whole run with SIGPIPE */
+		ssize_t sent = send(connection->socket_descriptor, config->send + connection->sent,
+							send_length - connection->sent, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				/* the socket is still watched for EPOLLOUT */
+				connection->phase = TARGET_SENDING;
+				return;
+			}
+			if (errno == EPIPE || errno == ECONNRESET) {
+				finish_target(connection, config, results, STATE_CRITICAL,
+							  _("Connection closed while sending"));
+				return;
+			}
+			char *reason = NULL;
+			xasprintf(&reason, _("Sending failed: %s"), strerror(errno));
+			finish_target(connection, config, results, STATE_CRITICAL, reason);
+			free(reason);
+			return;
+		}
+		connection->sent += (size_t)sent;
+	}
+
+	if (config->server_expect_count == 0) {
+		finish_target(connection, config, results, STATE_OK, NULL);
+		return;
+	}
+
+	connection->phase = TARGET_RECEIVING;
+	watch_socket(epoll_descriptor, connection, EPOLLIN, EPOLL_CTL_MOD);
+}
+
+static void receive_answer(target_connection *connection, const check_tcp_config *config,
+						   mp_subcheck *results) {
+	char buffer[4096];
+	while (true) {
+		ssize_t received = read(connection->socket_descriptor, buffer, sizeof(buffer));
+		if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			connection->read_deadline = monotonic_seconds() + READ_TIMEOUT;
+			return;
+		}
+		if (received <= 0) {
+			/* the server closed the connection, evaluate what we got */
+			break;
+		}
+
+		char *tmp = realloc(connection->received, connection->received_length + received + 1);
+		if (tmp == NULL) {
+			die(STATE_UNKNOWN, _("Allocation failed"));
+		}
+		connection->received = tmp;
+		memcpy(&connection->received[connection->received_length], buffer, received);
+		connection->received_length += received;
+		connection->received[connection->received_length] = '\0';
+
+		/* stop reading if user-forced */
+		if (config->maxbytes && connection->received_length >= (size_t)config->maxbytes) {
+			break;
+		}
+
+		connection->match = np_expect_match(connection->received, config->server_expect,
+											(int)config->server_expect_count, config->match_flags);
+		if (connection->match != NP_MATCH_RETRY) {
+			break;
+		}
+	}
+
+	finish_target(connection, config, results, STATE_OK, NULL);
+}
+
+static void handle_event(int epoll_descriptor, target_connection *connection, uint32_t events,
+						 const check_tcp_config *config, mp_subcheck *results) {
+	switch (connection->phase) {
+	case TARGET_CONNECTING: {
+		int error = 0;
+		socklen_t error_length = sizeof(error);
+		if (getsockopt(connection->socket_descriptor, SOL_SOCKET, SO_ERROR, &error,
+					   &error_length) != 0) {
+			error = errno;
+		}
+		if (error != 0) {
+			connection->connect_error = error;
+			connection_failed(epoll_descriptor, connection, config, results);
+			return;
+		}
+		continue_conversation(epoll_descriptor, connection, config, results);
+		return;
+	}
+	case TARGET_SENDING:
+		if (events & (EPOLLERR | EPOLLHUP)) {
+			finish_target(connection, config, results, STATE_CRITICAL,
+						  _("Connection closed while sending"));
+			return;
+		}
+		continue_conversation(epoll_descriptor, connection, config, results);
+		return;
+	case TARGET_RECEIVING:
+		receive_answer(connection, config, results);
+		return;
+	case TARGET_DONE:
+		return;
+	}
+}
+
+/* ends the targets whose time is up, returns the milliseconds until the next deadline */
+static int expire_targets(target_connection *connections, size_t connections_count,
+						  const check_tcp_config *config, mp_subcheck *results) {
+	double now = monotonic_seconds();
+	double next_deadline = now + socket_timeout;
+
+	for (size_t i = 0; i < connections_count; i++) {
+		target_connection *connection = &connections[i];
+		if (connection->phase == TARGET_DONE) {
+			continue;
+		}
+
+		if (now >= connection->deadline) {
+			char *reason = NULL;
+			xasprintf(&reason, _("Socket timeout after %u seconds"), socket_timeout);
+			finish_target(connection, config, results, socket_timeout_state, reason);
+			free(reason);
+			continue;
+		}
+
+		if (connection->phase == TARGET_RECEIVING && connection->received_length > 0 &&
+			now >= connection->read_deadline) {
+			/* the server stopped talking, evaluate what we got */
+			finish_target(connection, config, results, STATE_OK, NULL);
+			continue;
+		}
+
+		if (connection->deadline < next_deadline) {
+			next_deadline = connection->deadline;
+		}
+		if (connection->phase == TARGET_RECEIVING && connection->received_length > 0 &&
+			connection->read_deadline < next_deadline) {
+			next_deadline = connection->read_deadline;
+		}
+	}
+
+	/* round up, waking up before the deadline would only spin */
+	return (int)((next_deadline - now) * 1000.0) + 1;
+}
+
+mp_check check_tcp_check_targets(check_tcp_config config) {
+	size_t count = config.targets_count;
+	size_t window = config.max_connections < count ? config.max_connections : count;
+
+	target_connection *connections = calloc(window, sizeof(target_connection));
+	mp_subcheck *results = calloc(count, sizeof(mp_subcheck));
+	struct epoll_event *events = calloc(window, sizeof(struct epoll_event));
+	if (connections == NULL || results == NULL || events == NULL) {
+		die(STATE_UNKNOWN, _("Allocation failed"));
+	}
+
+	/*
+	 * getaddrinfo blocks, so the names are resolved before the first connection is started.
+	 * Inside the event loop a slow name server would stall the connections in flight and eat
+	 * into their timeout.
+	 */
+	target_addresses *addresses = calloc(count, sizeof(target_addresses));
+	if (addresses == NULL) {
+		die(STATE_UNKNOWN, _("Allocation failed"));
+	}
+	for (size_t i = 0; i < count; i++) {
+		addresses[i] = resolve_target(&config.targets[i]);
+	}
+
+	int epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_descriptor < 0) {
+		die(STATE_UNKNOWN, _("epoll_create1 failed: %s\n"), strerror(errno));
+	}
+
+	/*
+	 * a window of connections moves over the list, so the number of open sockets stays
+	 * bounded. A slot whose target is done gets the next target of the list.
+	 */
+	size_t next = 0;
+	size_t done = 0;
+	for (size_t i = 0; i < window; i++) {
+		connections[i].phase = TARGET_DONE;
+		connections[i].socket_descriptor = -1;
+	}
+
+	while (done < count) {
+		for (size_t i = 0; i < window && next < count; i++) {
+			if (connections[i].phase == TARGET_DONE) {
+				start_target(epoll_descriptor, &connections[i], next, addresses[next], &config,
+							 results);
+				next++;
+			}
+		}
+
+		int wait_time = expire_targets(connections, window, &config, results);
+
+		int ready = epoll_wait(epoll_descriptor, events, (int)window, wait_time);
+		if (ready < 0 && errno != EINTR) {
+			die(STATE_UNKNOWN, _("epoll_wait failed: %s\n"), strerror(errno));
+		}
+
+		for (int i = 0; i < ready; i++) {
+			handle_event(epoll_descriptor, events[i].data.ptr, events[i].events, &config,
+						 results);
+		}
+
+		expire_targets(connections, window, &config, results);
+
+		done = next;
+		for (size_t i = 0; i < window; i++) {
+			if (connections[i].phase != TARGET_DONE) {
+				done--;
+			}
+		}
+	}
+
+	close(epoll_descriptor);
+
+	/* subchecks are prepended, add them backwards to keep the order of the list */
+	mp_check overall = mp_check_init();
+	for (size_t i = count; i > 0; i--) {
+		mp_add_subcheck_to_check(&overall, results[i - 1]);
+	}
+
+	free(events);
+	free(addresses);
+	free(results);
+	free(connections);
+
+	return overall;
+}
+
+#else
+
+mp_check check_tcp_check_targets(check_tcp_config config) {
+	(void)config;
+	die(STATE_UNKNOWN, _("Checking several targets needs epoll, which is not available\n"));
+}
+
+#endif /* HAVE_SYS_EPOLL_H */
@@ -0,0 +1,46 @@
+#pragma once
+/* Helpers of check_tcp, mostly for checking many targets at once, see --target */
+
+#include "./config.h"
+#include "../../lib/output.h"
+#include <stddef.h>
+
+enum {
+	DEFAULT_MAX_CONNECTIONS = 256,
+};
+
+typedef struct {
+	int errorcode;
+	check_tcp_target target;
+} check_tcp_target_wrapper;
+
+/*
+ * Parses host[:port] or [IPv6 address][:port], the port is 0 if there is none
+ */
+check_tcp_target_wrapper check_tcp_parse_target(const char *input);
+
+/*
+ * Adds the comma separated targets of a --target argument
+ */
+void check_tcp_add_targets(char *list, check_tcp_target **targets, size_t targets_count[static 1]);
+
+/*
+ * Reads targets from a file, one per line. Empty lines and lines starting with '#' are
+ * ignored
+ */
+void check_tcp_read_targets(const char *path, check_tcp_target **targets,
+							size_t targets_count[static 1]);
+
+/*
+ * Drops targets with the same host and port as an earlier one, their perfdata labels would
+ * clash. Keeps the order of the list.
+ */
+void check_tcp_remove_duplicate_targets(check_tcp_target *targets, size_t targets_count[static 1]);
+
+/*
+ * Runs the connect, send and expect steps for all targets at the same time on non-blocking
+ * sockets, with at most config.max_connections connections open at once. Every target gets
+ * socket_timeout seconds for the whole conversation. Returns one subcheck per target, in the
+ * order of the list.
+ */
+mp_check check_tcp_check_targets(check_tcp_config config);
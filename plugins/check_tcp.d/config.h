@@ -5,6 +5,12 @@
 #include "states.h"
 #include <netinet/in.h>
 
+/* a host:port of the multi target mode, see --target */
+typedef struct {
+	char *host;
+	int port;
+} check_tcp_target;
+
 typedef struct {
 	char *server_address;
 	bool host_specified;
@@ -41,44 +47,12 @@ typedef struct {
 
 	bool output_format_set;
 	mp_output_format output_format;
-} check_tcp_config;
 
-check_tcp_config check_tcp_config_init() {
-	check_tcp_config result = {
-		.server_address = "127.0.0.1",
-		.host_specified = false,
-		.server_port = 0,
-
-		.protocol = IPPROTO_TCP,
-		.service = "TCP",
-		.send = NULL,
-		.quit = NULL,
-		.server_expect = NULL,
-		.server_expect_count = 0,
-		.use_tls = false,
-#ifdef HAVE_SSL
-		.sni = NULL,
-		.sni_specified = false,
-		.check_cert = false,
-		.days_till_exp_warn = 0,
-		.days_till_exp_crit = 0,
-#endif // HAVE_SSL
-		.match_flags = NP_MATCH_EXACT,
-		.expect_mismatch_state = STATE_WARNING,
-		.delay = 0,
-
-		.warning_time_set = false,
-		.warning_time = 0,
-		.critical_time_set = false,
-		.critical_time = 0,
-
-		.econn_refuse_state = STATE_CRITICAL,
-
-		.maxbytes = 0,
-
-		.hide_output = false,
+	// checked concurrently instead of server_address, one subcheck each (--target)
+	check_tcp_target *targets;
+	size_t targets_count;
+	// number of connections of the targets open at the same time
+	size_t max_connections;
+} check_tcp_config;
 
-		.output_format_set = false,
-	};
-	return result;
-}
+check_tcp_config check_tcp_config_init();
@@ -31,6 +31,8 @@
 #include "output.h"
 #include "states.h"
 #include <sys/types.h>
+#include <ctype.h>
+#include <fcntl.h>
 #include "netutils.h"
 
 unsigned int socket_timeout = DEFAULT_SOCKET_TIMEOUT;
@@ -40,6 +42,9 @@ bool was_refused = false;
 
 int address_family = AF_UNSPEC;
 
+/* time between two connection attempts, the value RFC 8305 recommends */
+static const int CONNECTION_ATTEMPT_DELAY = 250; /* milliseconds */
+
 /* handles socket timeouts */
 void socket_timeout_alarm_handler(int sig) {
 	mp_subcheck timeout_sc = mp_subcheck_init();
@@ -57,6 +62,109 @@ void socket_timeout_alarm_handler(int sig) {
 	mp_exit(overall);
 }
 
+void np_line_reader_init(np_line_reader *reader, int socket) {
+	reader->socket = socket;
+	reader->tls_read = NULL;
+	reader->start = 0;
+	reader->end = 0;
+}
+
+void np_line_reader_set_tls(np_line_reader *reader, int (*tls_read)(void *buf, int num)) {
+	reader->tls_read = tls_read;
+	/*
+	 * whatever the server sent after the plain text reply to STARTTLS must not be mistaken for
+	 * data of the encrypted session
+	 */
+	reader->start = 0;
+	reader->end = 0;
+}
+
+/* reads as much as is available into the empty buffer, returns the result of the read */
+static ssize_t np_line_reader_fill(np_line_reader *reader) {
+	reader->start = 0;
+	reader->end = 0;
+
+	ssize_t received;
+	if (reader->tls_read != NULL) {
+		received = reader->tls_read(reader->buffer, (int)sizeof(reader->buffer));
+	} else {
+		received = read(reader->socket, reader->buffer, sizeof(reader->buffer));
+	}
+
+	if (received > 0) {
+		reader->end = (size_t)received;
+	}
+	return received;
+}
+
+/*
+ * Receive one line, copy it into buf and nul-terminate it. Returns the number of bytes
+ * written to buf (excluding the '\0'), 0 on EOF, -2 if the line does not fit into buf and
+ * <0 on other errors. A last line without '\n' is returned as it is once the server closed
+ * the connection.
+ */
+int np_recvline(np_line_reader *reader, char *buf, size_t bufsize) {
+	size_t length = 0;
+
+	while (length < bufsize - 1) {
+		if (reader->start == reader->end) {
+			ssize_t received = np_line_reader_fill(reader);
+			if (received <= 0) {
+				buf[length] = '\0';
+				return (length > 0) ? (int)length : (int)received;
+			}
+		}
+
+		const char *data = &reader->buffer[reader->start];
+		size_t available = reader->end - reader->start;
+		if (available > bufsize - 1 - length) {
+			available = bufsize - 1 - length;
+		}
+
+		const char *newline = memchr(data, '\n', available);
+		size_t chunk = (newline != NULL) ? (size_t)(newline - data) + 1 : available;
+
+		memcpy(&buf[length], data, chunk);
+		reader->start += chunk;
+		length += chunk;
+
+		if (newline != NULL) {
+			buf[length] = '\0';
+			return (int)length;
+		}
+	}
+
+	buf[length] = '\0';
+	return -2;
+}
+
+/*
+ * Receive one or more lines, copy them into buf and nul-terminate it.  Returns
+ * the number of bytes written to buf (excluding the '\0') or 0 on EOF or <0 on
+ * error.  Works for all protocols which format multiline replies as follows:
+ *
+ * ``The format for multiline replies requires that every line, except the last,
+ * begin with the reply code, followed immediately by a hyphen, `-' (also known
+ * as minus), followed by text.  The last line will begin with the reply code,
+ * followed immediately by <SP>, optionally some text, and <CRLF>.  As noted
+ * above, servers SHOULD send the <SP> if subsequent text is not sent, but
+ * clients MUST be prepared for it to be omitted.'' (RFC 2821, 4.2.1)
+ */
+int np_recvlines(np_line_reader *reader, char *buf, size_t bufsize) {
+	int result;
+	int counter;
+
+	for (counter = 0; /* forever */; counter += result) {
+		if (!((result = np_recvline(reader, buf + counter, bufsize - counter)) > 3 &&
+			  isdigit((int)buf[counter]) && isdigit((int)buf[counter + 1]) &&
+			  isdigit((int)buf[counter + 2]) && buf[counter + 3] == '-')) {
+			break;
+		}
+	}
+
+	return (result <= 0) ? result : result + counter;
+}
+
 /* connects to a host on a specified tcp port, sends a string, and gets a
 	 response. loops on select-recv until timeout or eof to get all of a
 	 multi-packet answer */
@@ -152,6 +260,142 @@ mp_state_enum process_request(const char *server_address, const int server_port,
 	return result;
 }
 
+/*
+ * Connects to the first of the addresses which answers, like RFC 8305 ("Happy Eyeballs")
+ * describes it. The attempts alternate between the address families, starting with the
+ * first one getaddrinfo returned. Another attempt starts whenever the running ones did not
+ * succeed within CONNECTION_ATTEMPT_DELAY or all of them failed already, so a host with a
+ * broken IPv6 setup does not stall the connection to its IPv4 address. The first
+ * established connection wins and the other attempts are closed.
+ *
+ * Returns STATE_OK with a blocking socket, STATE_UNKNOWN if no socket could be created at
+ * all and STATE_CRITICAL if no connection could be established.
+ */
+static mp_state_enum happy_eyeballs_connect(struct addrinfo *addresses, int socktype,
+											int *socketDescriptor) {
+	size_t number_of_addresses = 0;
+	for (struct addrinfo *address = addresses; address != NULL; address = address->ai_next) {
+		number_of_addresses++;
+	}
+
+	struct addrinfo **order = calloc(number_of_addresses, sizeof(struct addrinfo *));
+	struct pollfd *attempts = calloc(number_of_addresses, sizeof(struct pollfd));
+	if (order == NULL || attempts == NULL) {
+		die(STATE_UNKNOWN, _("Allocation failed"));
+	}
+
+	/* interleave the address families */
+	size_t ordered = 0;
+	struct addrinfo *preferred = addresses;
+	struct addrinfo *other = addresses;
+	while (ordered < number_of_addresses) {
+		while (preferred != NULL && preferred->ai_family != addresses->ai_family) {
+			preferred = preferred->ai_next;
+		}
+		if (preferred != NULL) {
+			order[ordered++] = preferred;
+			preferred = preferred->ai_next;
+		}
+		while (other != NULL && other->ai_family == addresses->ai_family) {
+			other = other->ai_next;
+		}
+		if (other != NULL) {
+			order[ordered++] = other;
+			other = other->ai_next;
+		}
+	}
+
+	size_t started = 0;
+	size_t running = 0;
+	bool socket_created = false;
+	int winner = -1;
+	int winner_flags = 0;
+
+	while (winner < 0 && (started < number_of_addresses || running > 0)) {
+		if (started < number_of_addresses) {
+			struct addrinfo *address = order[started++];
+			int attempt = socket(address->ai_family, socktype, address->ai_protocol);
+			if (attempt < 0) {
+				continue;
+			}
+			socket_created = true;
+
+			int flags = fcntl(attempt, F_GETFL, 0);
+			fcntl(attempt, F_SETFL, flags | O_NONBLOCK);
+
+			if (connect(attempt, address->ai_addr, address->ai_addrlen) == 0) {
+				winner = attempt;
+				winner_flags = flags;
+				break;
+			}
+
+			if (errno != EINPROGRESS) {
+				if (errno == ECONNREFUSED) {
+					was_refused = true;
+				}
+				close(attempt);
+				continue;
+			}
+
+			attempts[running].fd = attempt;
+			attempts[running].events = POLLOUT;
+			attempts[running].revents = 0;
+			running++;
+		}
+
+		/* wait for the running attempts until the next one is due */
+		int ready = poll(attempts, running,
+						 (started < number_of_addresses) ? CONNECTION_ATTEMPT_DELAY : -1);
+		if (ready < 0 && errno != EINTR) {
+			break;
+		}
+
+		for (size_t i = running; ready > 0 && i > 0; i--) {
+			struct pollfd *attempt = &attempts[i - 1];
+			if (attempt->revents == 0) {
+				continue;
+			}
+
+			int error = 0;
+			socklen_t error_length = sizeof(error);
+			if (getsockopt(attempt->fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0) {
+				error = errno;
+			}
+
+			if (error == 0) {
+				winner = attempt->fd;
+				winner_flags = fcntl(winner, F_GETFL, 0) & ~O_NONBLOCK;
+			} else {
+				if (error == ECONNREFUSED) {
+					was_refused = true;
+				}
+				close(attempt->fd);
+			}
+			*attempt = attempts[--running];
+
+			if (winner >= 0) {
+				break;
+			}
+		}
+	}
+
+	/* cancel the attempts which lost */
+	for (size_t i = 0; i < running; i++) {
+		close(attempts[i].fd);
+	}
+	free(attempts);
+	free(order);
+
+	if (winner < 0) {
+		return socket_created ? STATE_CRITICAL : STATE_UNKNOWN;
+	}
+
+	fcntl(winner, F_SETFL, winner_flags);
+	*socketDescriptor = winner;
+	was_refused = false;
+	return STATE_OK;
+}
+
 /* opens a tcp or udp connection to a remote host or local socket */
 mp_state_enum np_net_connect(const char *host_name, int port, int *socketDescriptor,
 							 const int proto) {
@@ -197,40 +441,14 @@ mp_state_enum np_net_connect(const char *host_name, int port, int *socketDescrip
 			return STATE_UNKNOWN;
 		}
 
-		struct addrinfo *addressPointer = res;
-		while (addressPointer) {
-			/* attempt to create a socket */
-			*socketDescriptor =
-				socket(addressPointer->ai_family, socktype, addressPointer->ai_protocol);
-
-			if (*socketDescriptor < 0) {
-				// printf("%s\n", _("Socket creation failed"));
-				freeaddrinfo(addressPointer);
-				return STATE_UNKNOWN;
-			}
-
-			/* attempt to open a connection */
-			result =
-				connect(*socketDescriptor, addressPointer->ai_addr, addressPointer->ai_addrlen);
-
-			if (result == 0) {
-				was_refused = false;
-				break;
-			}
-
-			if (result < 0) {
-				switch (errno) {
-				case ECONNREFUSED:
-					was_refused = true;
-					break;
-				}
-			}
+		mp_state_enum connect_state = happy_eyeballs_connect(res, socktype, socketDescriptor);
+		freeaddrinfo(res);
 
-			close(*socketDescriptor);
-			addressPointer = addressPointer->ai_next;
+		if (connect_state == STATE_UNKNOWN) {
+			// printf("%s\n", _("Socket creation failed"));
+			return STATE_UNKNOWN;
 		}
-
-		freeaddrinfo(res);
+		result = (connect_state == STATE_OK) ? 0 : -1;
 
 	} else {
 		/* else the hostname is interpreted as a path to a unix socket */
@@ -31,6 +31,7 @@
 #ifndef _NETUTILS_H_
 #define _NETUTILS_H_
 
+#include "common.h"
 #include "output.h"
 #include "states.h"
 #include "utils.h"
@@ -89,6 +90,27 @@ extern int address_family;
 
 void socket_timeout_alarm_handler(int) __attribute__((noreturn));
 
+/*
+ * Buffered reading of line based protocols like SMTP. The reader reads ahead as much as the
+ * server sent and hands out one line after the other, instead of one read per byte.
+ */
+#define NP_LINE_READER_BUFFER_SIZE 8192
+typedef struct {
+	int socket;
+	/* reads from the TLS connection instead of the socket if set, see np_line_reader_set_tls */
+	int (*tls_read)(void *buf, int num);
+	char buffer[NP_LINE_READER_BUFFER_SIZE];
+	/* the unread data is buffer[start] to buffer[end - 1] */
+	size_t start;
+	size_t end;
+} np_line_reader;
+
+void np_line_reader_init(np_line_reader *reader, int socket);
+/* switches to a TLS connection on the socket, data read ahead before the switch is dropped */
+void np_line_reader_set_tls(np_line_reader *reader, int (*tls_read)(void *buf, int num));
+int np_recvline(np_line_reader *reader, char *buf, size_t bufsize);
+int np_recvlines(np_line_reader *reader, char *buf, size_t bufsize);
+
 /* SSL-Related functionality */
 #ifdef HAVE_SSL
 #	define MP_SSLv2            1
@@ -110,6 +132,7 @@ int np_net_ssl_init_with_hostname_version_and_cert(int socket, char *host_name,
 void np_net_ssl_cleanup(void);
 int np_net_ssl_write(const void *buf, int num);
 int np_net_ssl_read(void *buf, int num);
+#	define np_line_reader_start_tls(reader) np_line_reader_set_tls(reader, np_net_ssl_read)
 
 typedef enum {
 	ALL_OK,
@@ -133,5 +156,13 @@ net_ssl_check_cert_result np_net_ssl_check_cert2(unsigned int days_till_exp_warn
 
 mp_state_enum np_net_ssl_check_cert(int days_till_exp_warn, int days_till_exp_crit);
 mp_subcheck mp_net_ssl_check_cert(int days_till_exp_warn, int days_till_exp_crit);
+/* the expiry check for a certificate whose common name and expiry time are already known */
+mp_subcheck mp_net_ssl_check_certificate_expiry(const char *commonName, time_t tm_t,
+												int days_till_exp_warn, int days_till_exp_crit);
+#	ifdef MOPL_USE_OPENSSL
+/* extracts the common name and the expiry time of a certificate, returns an error or NULL */
+const char *np_net_ssl_get_certificate_expiry(X509 *certificate, char *common_name,
+											  size_t common_name_size, time_t *expiry);
+#	endif /* MOPL_USE_OPENSSL */
 #endif /* HAVE_SSL */
 #endif /* _NETUTILS_H_ */
@@ -456,29 +456,24 @@ mp_state_enum np_net_ssl_check_cert(int days_till_exp_warn, int days_till_exp_cr
 #	endif /* MOPL_USE_OPENSSL */
 }
 
-mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_warn,
-										 int days_till_exp_crit) {
-	mp_subcheck sc_cert = mp_subcheck_init();
 #	ifdef MOPL_USE_OPENSSL
-	if (!certificate) {
-		xasprintf(&sc_cert.output, _("No server certificate present to inspect"));
-		sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
-		return sc_cert;
-	}
-
+/*
+ * Extracts the common name and the expiry time of a certificate, these are all the
+ * expiry check needs. Returns an error message or NULL.
+ */
+const char *np_net_ssl_get_certificate_expiry(X509 *certificate, char *common_name,
+											  size_t common_name_size, time_t *expiry) {
 	/* Extract CN from certificate subject */
 	X509_NAME *subj = X509_get_subject_name(certificate);
 
 	if (!subj) {
-		xasprintf(&sc_cert.output, _("Cannot retrieve certificate subject"));
-		sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
-		return sc_cert;
+		return _("Cannot retrieve certificate subject");
 	}
 
-	char commonName[MAX_CN_LENGTH] = "";
-	int cnlen = X509_NAME_get_text_by_NID(subj, NID_commonName, commonName, sizeof(commonName));
+	int cnlen =
+		X509_NAME_get_text_by_NID(subj, NID_commonName, common_name, (int)common_name_size);
 	if (cnlen == -1) {
-		strcpy(commonName, _("Unknown CN"));
+		snprintf(common_name, common_name_size, "%s", _("Unknown CN"));
 	}
 
 	/* Retrieve timestamp of certificate */
@@ -489,9 +484,7 @@ mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_wa
 	/* Generate tm structure to process timestamp */
 	if (expiry_timestamp->type == V_ASN1_UTCTIME) {
 		if (expiry_timestamp->length < 10) {
-			xasprintf(&sc_cert.output, _("Wrong time format in certificate"));
-			sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
-			return sc_cert;
+			return _("Wrong time format in certificate");
 		}
 
 		stamp.tm_year = (expiry_timestamp->data[0] - '0') * 10 + (expiry_timestamp->data[1] - '0');
@@ -502,9 +495,7 @@ mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_wa
 		offset = 0;
 	} else {
 		if (expiry_timestamp->length < 12) {
-			xasprintf(&sc_cert.output, _("Wrong time format in certificate"));
-			sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
-			return sc_cert;
+			return _("Wrong time format in certificate");
 		}
 		stamp.tm_year = (expiry_timestamp->data[0] - '0') * 1000 +
 						(expiry_timestamp->data[1] - '0') * 100 +
@@ -525,7 +516,44 @@ mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_wa
 				   (expiry_timestamp->data[11 + offset] - '0');
 	stamp.tm_isdst = -1;
 
-	time_t tm_t = timegm(&stamp);
+	*expiry = timegm(&stamp);
+	return NULL;
+}
+#	endif /* MOPL_USE_OPENSSL */
+
+mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_warn,
+										 int days_till_exp_crit) {
+	mp_subcheck sc_cert = mp_subcheck_init();
+#	ifdef MOPL_USE_OPENSSL
+	if (!certificate) {
+		xasprintf(&sc_cert.output, _("No server certificate present to inspect"));
+		sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
+		return sc_cert;
+	}
+
+	char commonName[MAX_CN_LENGTH] = "";
+	time_t expiry = 0;
+	const char *error =
+		np_net_ssl_get_certificate_expiry(certificate, commonName, sizeof(commonName), &expiry);
+	X509_free(certificate);
+	if (error != NULL) {
+		xasprintf(&sc_cert.output, "%s", error);
+		sc_cert = mp_set_subcheck_state(sc_cert, STATE_CRITICAL);
+		return sc_cert;
+	}
+
+	return mp_net_ssl_check_certificate_expiry(commonName, expiry, days_till_exp_warn,
+											   days_till_exp_crit);
+#	else  /* ifndef MOPL_USE_OPENSSL */
+	xasprintf(&sc_cert.output, _("Plugin does not support checking certificates"));
+	sc_cert = mp_set_subcheck_state(sc_cert, STATE_WARNING);
+	return sc_cert;
+#	endif /* MOPL_USE_OPENSSL */
+}
+
+mp_subcheck mp_net_ssl_check_certificate_expiry(const char *commonName, time_t tm_t,
+												int days_till_exp_warn, int days_till_exp_crit) {
+	mp_subcheck sc_cert = mp_subcheck_init();
 	double time_left = difftime(tm_t, time(NULL));
 	int days_left = (int)(time_left / 86400);
 	char *timeZone = getenv("TZ");
@@ -580,12 +608,6 @@ mp_subcheck mp_net_ssl_check_certificate(X509 *certificate, int days_till_exp_wa
 		xasprintf(&sc_cert.output, _("Certificate '%s' will expire on %s"), commonName, timestamp);
 		sc_cert = mp_set_subcheck_state(sc_cert, STATE_OK);
 	}
-	X509_free(certificate);
-	return sc_cert;
-#	else  /* ifndef MOPL_USE_OPENSSL */
-	xasprintf(&sc_cert.output, _("Plugin does not support checking certificates"));
-	sc_cert = mp_set_subcheck_state(sc_cert, STATE_WARNING);
 	return sc_cert;
-#	endif /* MOPL_USE_OPENSSL */
 }
 #endif /* HAVE_SSL */
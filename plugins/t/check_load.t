@@ -16,7 +16,7 @@ my $successScaledOutput = "/^LOAD OK - scaled load average: $loadValue, $loadVal
 my $failureOutput = "/^LOAD CRITICAL - total load average: $loadValue, $loadValue, $loadValue/";
 my $failurScaledOutput = "/^LOAD CRITICAL - scaled load average: $loadValue, $loadValue, $loadValue - total load average: $loadValue, $loadValue, $loadValue/";
 
-plan tests => 8;
+plan tests => 11;
 
 $res = NPTest->testCmd( "./check_load -w 100,100,100 -c 100,100,100" );
 cmp_ok( $res->return_code, 'eq', 0, "load not over 100");
@@ -41,3 +41,14 @@ like( $res->perf_output, "/'load15'=$loadValue;~:100.0+;~:110.0+/", "Test handli
 $res = NPTest->testCmd( "./check_load -w 100,100,100 -c 100,100,100 -r" );
 cmp_ok( $res->return_code, 'eq', 0, "load not over 100");
 # like( $res->output, $successScaledOutput, "Output OK");
+
+SKIP: {
+	skip "no pressure stall information available", 3 unless -r "/proc/pressure/cpu";
+
+	$res = NPTest->testCmd( "./check_load -w 100 -c 100 --pressure --warning-pressure 100 --critical-pressure 100" );
+	cmp_ok( $res->return_code, 'eq', 0, "pressure not over 100%");
+	like( $res->perf_output, "/'cpu_some_avg10'=[0-9.]+%;~:100.0+;~:100.0+;0;100/", "Perfdata for cpu pressure with thresholds");
+
+	$res = NPTest->testCmd( "./check_load -w 100 -c 100 --critical-procs-running 0" );
+	cmp_ok( $res->return_code, 'eq', 2, "At least check_load itself is running");
+}
@@ -0,0 +1,38 @@
+#! /usr/bin/perl -w -I ..
+#
+# Memory Tests via check_memory
+#
+#
+
+use strict;
+use Test::More;
+use NPTest;
+
+my $res;
+
+plan skip_all => "check_memory not compiled" unless (-x "check_memory");
+
+plan tests => 8;
+
+$res = NPTest->testCmd( "./check_memory -w 0: -c 0:" );
+cmp_ok( $res->return_code, 'eq', 0, "Available memory is at least 0%");
+like( $res->perf_output, "/'available'=[0-9.]+%;;;0;100/", "Perfdata for available memory");
+like( $res->perf_output, qr/'mem_total'=[0-9]+B;;;0(\s|$)/, "Perfdata for total memory");
+
+$res = NPTest->testCmd( "./check_memory -w 101: -c 101:" );
+cmp_ok( $res->return_code, 'eq', 2, "Available memory is never over 100%");
+
+$res = NPTest->testCmd( "./check_memory -w 101: -c 0:" );
+cmp_ok( $res->return_code, 'eq', 1, "Warning threshold for available memory");
+
+$res = NPTest->testCmd( "./check_memory -c foo" );
+cmp_ok( $res->return_code, 'eq', 3, "Invalid threshold");
+
+$res = NPTest->testCmd( "./check_memory -C /does/not/exist" );
+cmp_ok( $res->return_code, 'eq', 3, "Missing cgroup is unknown");
+
+SKIP: {
+	skip "no pressure stall information available", 1 unless (-r "/proc/pressure/memory");
+	$res = NPTest->testCmd( "./check_memory --pressure --critical-pressure 100" );
+	like( $res->perf_output, "/'memory_some_avg10'=[0-9.]+%/", "Perfdata for memory pressure");
+}
@@ -11,7 +11,7 @@ use vars qw($tests $has_ipv6);
 BEGIN {
     use NPTest;
     $has_ipv6 = NPTest::has_ipv6();
-    $tests = $has_ipv6 ? 14 : 11;
+    $tests = $has_ipv6 ? 18 : 15;
 }
 
 
@@ -45,6 +45,10 @@ if($internet_access ne "no") {
 # so that perl doesn't interpret the \r\n and is passed onto command line correctly
 $t += checkCmd( "./check_tcp $host_tcp_http      -p 80 -E -s ".'"GET / HTTP/1.1\r\n\r\n"'." -e 'ThisShouldntMatch' -j", 1, $failedExpect );
 
+# several targets at once, one result each
+$t += checkCmd( "./check_tcp --target $host_tcp_http:80,$host_tls_http -p 443 -w 300 -c 600", 0, '/connection time.*connection time/s' );
+$t += checkCmd( "./check_tcp --target $host_tcp_http:80,$host_tcp_http:81 -t 1",       2, '/:81 - (Connection was REFUSED|Socket timeout)/' );
+
 # IPv6 checks
 if($has_ipv6) {
   $t += checkCmd( "./check_tcp $host_tcp_http      -p 80 -wt 300 -ct 600 -6 ",   0, $successOutput );
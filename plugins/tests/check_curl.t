@@ -19,6 +19,7 @@ use warnings;
 use Test::More;
 use NPTest;
 use FindBin qw($Bin);
+use File::Temp qw(tempdir);
 
 use URI;
 use URI::QueryParam;
@@ -29,6 +30,7 @@ $ENV{'LC_TIME'} = "C";
 
 my $common_tests = 111;
 my $ssl_only_tests = 12;
+my $curl_only_tests = 28;
 # Check that all dependent modules are available
 eval "use HTTP::Daemon 6.01;";
 plan skip_all => 'HTTP::Daemon >= 6.01 required' if $@;
@@ -69,7 +71,7 @@ if ($@) {
 	plan skip_all => "Missing required module for test: $@";
 } else {
 	if (-x "./$plugin") {
-		plan tests => $common_tests * 2 + $ssl_only_tests + $advanced_checks;
+		plan tests => $common_tests * 2 + $ssl_only_tests + $advanced_checks + $curl_only_tests;
 	} else {
 		plan skip_all => "No $plugin compiled";
 	}
@@ -328,6 +330,10 @@ sub run_server {
 				$c->send_basic_header;
 				$c->send_crlf;
 				$c->send_response(HTTP::Response->new( 200, 'OK', undef, $r->header ('Host')));
+			} elsif ($r->url->path eq "/json") {
+				$c->send_response(HTTP::Response->new( 200, 'OK', ['Content-Type' => 'application/json'], '{"status": "UP", "queue": {"depth": 17, "names": ["a", "b"]}}' ));
+			} elsif ($r->url->path eq "/metrics") {
+				$c->send_response(HTTP::Response->new( 200, 'OK', ['Content-Type' => 'text/plain; version=0.0.4'], "# TYPE http_requests_total counter\nhttp_requests_total{code=\"200\"} 1027\nhttp_requests_total{code=\"500\"} 3\nup 1\n" ));
 			} elsif ($r->url->path eq "/chunked") {
 				my $chunks = ["chunked", "encoding", "test\n"];
 				$c->send_response(HTTP::Response->new( 200, 'OK', undef, sub {
@@ -504,6 +510,95 @@ SKIP: {
 	}
 }
 
+# multi URL mode
+SKIP: {
+	skip "multi URL mode is only available in check_curl", $curl_only_tests if $plugin ne 'check_curl';
+
+	$cmd = "./$plugin --multi-url http://127.0.0.1:$port_http/file/root --multi-url http://127.0.0.1:$port_http/statuscode/500 -s Root";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 2, $cmd );
+	like( $result->output, '/.*Testing http://127.0.0.1:\d+/file/root.*/', "Output contains the first URL: ".$result->output );
+	like( $result->perf_output, "/'url1_time'=[\\d\\.]+s/", "Perfdata of the first URL is prefixed" );
+	like( $result->perf_output, "/'url2_time'=[\\d\\.]+s/", "Perfdata of the second URL is prefixed" );
+	unlike( $result->perf_output, "/'connections'=/", "Connections are only reported with --multi-path" );
+
+	# body matching while receiving
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /file/root -s Root --stop-on-match";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, $cmd );
+
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /file/root -s Root --max-body-size 2";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 2, $cmd );
+	like( $result->output, '/.*transfer stopped after 2 bytes of the body.*/', "Output shows the truncated body: ".$result->output );
+
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /metrics -r '1027[[:space:]]+http_requests_total'";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, "Regex matching a newline still finds a match across lines: ".$result->output );
+
+	# persistent DNS and TLS session cache
+	my $cache_dir = tempdir( CLEANUP => 1 );
+	$cmd = "./$plugin -H localhost -p $port_http -u /file/root --session-cache $cache_dir";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, $cmd );
+	my $cache_file = do { local ( @ARGV, $/ ) = "$cache_dir/localhost_$port_http"; <> };
+	like( $cache_file, '/^dns \d+ localhost \S+$/m', "Address is cached" );
+	$result = NPTest->testCmd( "$cmd -v" );
+	like( $result->output, '/session cache: curl CURLOPT_RESOLVE: localhost:\d+:/', "Cached address is used: ".$result->output );
+
+	# thresholds per phase of the transfer
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /file/root --warning-firstbyte 0:0 -E";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 1, $cmd );
+	like( $result->output, '/.*Time to first byte: [\d\.]+s.*/', "Output contains the phase subcheck: ".$result->output );
+	like( $result->perf_output, "/'time_namelookup'=[\\d\\.]+s/", "Extended perfdata contains the name lookup time" );
+
+	# several paths over one connection
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http --multi-path /file/root --multi-path /statuscode/200";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, $cmd );
+	like( $result->output, '/.*2 requests used \d+ new connection\(s\).*/', "Output contains the number of connections: ".$result->output );
+
+	# JSON assertions
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /json --json-expect '\$.status==\"UP\"' --json-value '\$.queue.depth'";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, $cmd );
+	like( $result->perf_output, "/'queue.depth'=17;/", "Perfdata contains the JSON value" );
+
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /json --json-critical 10 --json-value '\$.queue.depth'";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 2, $cmd );
+
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /json --json-expect '\$.queue.names[1]==\"c\"'";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 2, $cmd );
+	like( $result->output, '/.*\$.queue.names\[1\] is "b", expected "c".*/', "Output shows the found and the expected value: ".$result->output );
+
+	# Prometheus metrics
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /metrics --prometheus up --prometheus-warning 2 --prometheus 'http_requests_total{code=~\"5..\"}'";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 1, $cmd );
+	like( $result->perf_output, "/'http_requests_total_code_500'=3;~:2;/", "Perfdata contains the selected series: ".$result->perf_output );
+
+	$cmd = "./$plugin -H 127.0.0.1 -p $port_http -u /metrics --prometheus does_not_exist";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 3, $cmd );
+
+	# certificate expiry sweep
+	SKIP: {
+		skip "HTTP::Daemon::SSL not installed", 3 if ! exists $servers->{https};
+		my $host_list = "$cache_dir/hosts";
+		open( my $hosts, '>', $host_list ) or die "Unable to write $host_list: $!";
+		print $hosts "# servers\n127.0.0.1:$port_https\n\n127.0.0.1:$port_https_expired\n";
+		close( $hosts );
+		$cmd = "./$plugin --cert-sweep $host_list -C 14";
+		$result = NPTest->testCmd( $cmd );
+		is( $result->return_code, 2, $cmd );
+		like( $result->output, "/.*127.0.0.1:$port_https - Certificate 'Monitoring Plugins' will expire on.*/", "Output contains the valid certificate: ".$result->output );
+		like( $result->output, "/.*127.0.0.1:$port_https_expired - Certificate 'Monitoring Plugins' expired on.*/", "Output contains the expired certificate: ".$result->output );
+	}
+}
+
 
 sub run_common_tests {
 	my ($opts) = @_;
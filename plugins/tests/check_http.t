@@ -13,7 +13,7 @@ use IO::Socket::INET;
 
 $ENV{'LC_TIME'} = "C";
 
-my $common_tests = 73;
+my $common_tests = 76;
 my $virtual_port_tests = 8;
 my $ssl_only_tests = 12;
 my $chunked_encoding_special_tests = 1;
@@ -179,6 +179,10 @@ sub run_server {
 					$c->send_crlf;
 					sleep 1;
 					$c->send_response("slow");
+				} elsif ($r->method eq "GET" and $r->url->path eq "/linger") {
+					# complete response, but the connection is kept open for a while
+					$c->send_response(HTTP::Response->new( 200, 'OK', ['Content-Length' => 6], 'linger' ));
+					sleep 3;
 				} elsif ($r->url->path eq "/method") {
 					if ($r->method eq "DELETE") {
 						$c->send_error(HTTP::Status->RC_METHOD_NOT_ALLOWED);
@@ -399,6 +403,13 @@ sub run_common_tests {
 	$result->output =~ /in ([\d\.]+) second/;
 	cmp_ok( $1, ">", 1, "Time is > 1 second" );
 
+	$cmd = "$command -u /linger -s linger";
+	$result = NPTest->testCmd( $cmd );
+	is( $result->return_code, 0, "$cmd");
+	like( $result->output, '/^HTTP OK: HTTP/1.1 200 OK - \d+ bytes in [\d\.]+ second/', "Output correct: ".$result->output );
+	$result->output =~ /in ([\d\.]+) second/;
+	cmp_ok( $1, "<", 2, "Reading stops at the end of the message" );
+
 	$cmd = "$command -u /statuscode/200";
 	$result = NPTest->testCmd( $cmd );
 	is( $result->return_code, 0, $cmd);
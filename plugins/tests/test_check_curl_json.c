@@ -0,0 +1,157 @@
+/*****************************************************************************
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "common.h"
+#include "../check_curl.d/check_curl_json.h"
+#include "../../tap/tap.h"
+
+void print_usage(void) {}
+
+const char *progname = "test_check_curl_json";
+
+static const char document[] =
+	"{\"status\": \"UP\", \"components\": {\"db\": {\"status\": \"DOWN\", \"details\": "
+	"[1, 2, {\"error\": \"timeout \\\"x\\\" \\u00e4\\ud83d\\ude00\"}]}, \"disk\": "
+	"{\"free\": 1.5e3, \"ok\": true}}, \"queue\": {\"depth\": 17, \"empty\": [], "
+	"\"name\": null}, \"checks\": [{\"name\": \"a\"}, {\"name\": \"b\"}]}";
+
+static check_curl_json_query parse(const char *expression, bool is_assertion) {
+	return check_curl_json_parse_query(expression, is_assertion).query;
+}
+
+int main(void) {
+	plan_tests(30);
+
+	check_curl_json_query_wrapper parsed = check_curl_json_parse_query("$.status==\"UP\"", true);
+	ok(parsed.errorcode == OK, "Query: assertion is parsed");
+	ok(parsed.query.segments_count == 1 && strcmp(parsed.query.segments[0].key, "status") == 0,
+	   "Query: the key is recorded");
+	ok(parsed.query.comparison == CHECK_CURL_JSON_EQUAL &&
+		   parsed.query.expected_type == CHECK_CURL_JSON_STRING &&
+		   strcmp(parsed.query.expected, "UP") == 0,
+	   "Query: the expected string is unescaped");
+
+	parsed = check_curl_json_parse_query("$.checks[1][\"name\"] != \"a\"", true);
+	ok(parsed.errorcode == OK && parsed.query.segments_count == 3 &&
+		   parsed.query.segments[1].key == NULL && parsed.query.segments[1].index == 1 &&
+		   strcmp(parsed.query.segments[2].key, "name") == 0,
+	   "Query: index and quoted key are parsed");
+	ok(parsed.query.comparison == CHECK_CURL_JSON_NOT_EQUAL &&
+		   strcmp(parsed.query.path, "$.checks[1][\"name\"]") == 0,
+	   "Query: != and the path are recorded");
+
+	parsed = check_curl_json_parse_query("$.queue.depth", false);
+	ok(parsed.errorcode == OK && strcmp(parsed.query.label, "queue.depth") == 0,
+	   "Query: the label is the path without $.");
+	ok(check_curl_json_parse_query("status==\"UP\"", true).errorcode == ERROR,
+	   "Query: a path without $ is an error");
+	ok(check_curl_json_parse_query("$.status", true).errorcode == ERROR,
+	   "Query: an assertion without comparison is an error");
+	ok(check_curl_json_parse_query("$.status==UP", true).errorcode == ERROR,
+	   "Query: an unquoted string is an error");
+	ok(check_curl_json_parse_query("$.status==\"UP\"", false).errorcode == ERROR,
+	   "Query: a value with comparison is an error");
+	ok(check_curl_json_parse_query("$.checks[x]", false).errorcode == ERROR,
+	   "Query: an invalid index is an error");
+
+	check_curl_json_query queries[] = {
+		parse("$.status==\"UP\"", true),
+		parse("$.components.db.status", false),
+		parse("$.components.db.details[2].error", false),
+		parse("$.components.disk.free", false),
+		parse("$.components.disk.ok==true", true),
+		parse("$.queue.depth", false),
+		parse("$.queue.empty", false),
+		parse("$.queue.name==null", true),
+		parse("$.checks[1].name", false),
+		parse("$.missing", false),
+	};
+	size_t queries_count = sizeof(queries) / sizeof(queries[0]);
+
+	/* the document in chunks of one byte, every boundary is somewhere in a token */
+	check_curl_json_parser *parser = check_curl_json_parser_new(queries, queries_count);
+	bool valid = true;
+	for (size_t i = 0; i < strlen(document); i++) {
+		valid = valid && check_curl_json_parser_feed(parser, &document[i], 1);
+	}
+	check_curl_json_parser_finish(parser);
+	ok(valid && parser->error == NULL, "Parser: the document is valid");
+	ok(parser->matches_found == queries_count - 1, "Parser: all present paths are found");
+
+	ok(parser->matches[0].type == CHECK_CURL_JSON_STRING &&
+		   strcmp(parser->matches[0].value, "UP") == 0,
+	   "Parser: top level string");
+	ok(strcmp(parser->matches[1].value, "DOWN") == 0, "Parser: nested keys are not confused");
+	ok(strcmp(parser->matches[2].value, "timeout \"x\" \xc3\xa4\xf0\x9f\x98\x80") == 0,
+	   "Parser: escapes and surrogate pairs are decoded");
+	ok(parser->matches[3].type == CHECK_CURL_JSON_NUMBER &&
+		   strcmp(parser->matches[3].value, "1.5e3") == 0,
+	   "Parser: number with exponent");
+	ok(parser->matches[4].type == CHECK_CURL_JSON_TRUE, "Parser: true");
+	ok(parser->matches[5].type == CHECK_CURL_JSON_NUMBER &&
+		   strcmp(parser->matches[5].value, "17") == 0,
+	   "Parser: integer");
+	ok(parser->matches[6].type == CHECK_CURL_JSON_ARRAY, "Parser: containers are recorded");
+	ok(parser->matches[7].type == CHECK_CURL_JSON_NULL, "Parser: null");
+	ok(strcmp(parser->matches[8].value, "b") == 0, "Parser: array index");
+	ok(!parser->matches[9].found, "Parser: missing path is not found");
+
+	mp_subcheck sc_result = mp_subcheck_init();
+	check_curl_json_evaluate(parser, &sc_result);
+	mp_state_enum states[10];
+	size_t states_count = 0;
+	for (mp_subcheck_list *sc = sc_result.subchecks; sc != NULL && states_count < 10;
+		 sc = sc->next) {
+		states[states_count++] = mp_compute_subcheck_state(sc->subcheck);
+	}
+	ok(states_count == queries_count, "Evaluate: one subcheck per query");
+	ok(states[0] == STATE_OK && states[4] == STATE_OK && states[7] == STATE_OK,
+	   "Evaluate: matching assertions are OK");
+	ok(states[1] == STATE_UNKNOWN && states[9] == STATE_UNKNOWN,
+	   "Evaluate: strings and missing values are UNKNOWN");
+	ok(states[3] == STATE_OK && states[5] == STATE_OK, "Evaluate: numbers without thresholds");
+	check_curl_json_parser_free(parser);
+
+	/* thresholds and a failing assertion */
+	check_curl_json_query depth = parse("$.queue.depth", false);
+	depth.thresholds = mp_thresholds_set_crit(depth.thresholds, mp_parse_range_string("10").range);
+	check_curl_json_query threshold_queries[] = {depth, parse("$.status==\"DOWN\"", true)};
+	parser = check_curl_json_parser_new(threshold_queries, 2);
+	check_curl_json_parser_feed(parser, document, strlen(document));
+	check_curl_json_parser_finish(parser);
+	sc_result = mp_subcheck_init();
+	check_curl_json_evaluate(parser, &sc_result);
+	ok(mp_compute_subcheck_state(sc_result) == STATE_CRITICAL,
+	   "Evaluate: threshold and failing assertion are CRITICAL");
+	check_curl_json_parser_free(parser);
+
+	/* invalid and truncated documents */
+	parser = check_curl_json_parser_new(queries, 1);
+	ok(!check_curl_json_parser_feed(parser, "{\"status\" 1}", 12) && parser->offset == 10,
+	   "Parser: a missing colon is an error at the right offset");
+	check_curl_json_parser_free(parser);
+
+	parser = check_curl_json_parser_new(queries, 1);
+	check_curl_json_parser_feed(parser, "{\"a\": [1, 2", 11);
+	check_curl_json_parser_finish(parser);
+	ok(parser->error != NULL && !parser->matches[0].found,
+	   "Parser: a truncated document is an error");
+	check_curl_json_parser_free(parser);
+
+	return exit_status();
+}
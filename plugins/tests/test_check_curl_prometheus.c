@@ -0,0 +1,179 @@
+/*****************************************************************************
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *
+ *****************************************************************************/
+
+#include "common.h"
+#include "../check_curl.d/check_curl_prometheus.h"
+#include "../../tap/tap.h"
+#include <math.h>
+
+void print_usage(void) {}
+
+const char *progname = "test_check_curl_prometheus";
+
+static const char metrics[] =
+	"# HELP http_requests_total The total number of HTTP requests.\n"
+	"# TYPE http_requests_total counter\n"
+	"http_requests_total{method=\"post\",code=\"200\"} 1027 1395066363000\n"
+	"http_requests_total{method=\"post\",code=\"400\"}    3 1395066363000\n"
+	"http_requests_total{method=\"get\",code=\"503\"} 12\r\n"
+	"http_requests_total_created{method=\"post\",code=\"200\"} 1395066363\n"
+	"\n"
+	"msdos_file_access_time_seconds{path=\"C:\\\\DIR\\\\FILE.TXT\",error=\"Cannot find \\\"x\\\"\"}"
+	" 1.458255915e9\n"
+	"metric_without_timestamp_and_labels 12.47\n"
+	"rpc_duration_seconds{quantile=\"0.5\"} NaN\n"
+	"rpc_duration_seconds_count 2693\n"
+	"queue_depth 42";
+
+static check_curl_prometheus_selector parse(const char *selector) {
+	return check_curl_prometheus_parse_selector(selector).selector;
+}
+
+int main(void) {
+	plan_tests(27);
+
+	check_curl_prometheus_selector_wrapper parsed =
+		check_curl_prometheus_parse_selector("http_requests_total{code=~\"5..\", method!=\"get\"}");
+	ok(parsed.errorcode == OK, "Selector: name and matchers are parsed");
+	ok(strcmp(parsed.selector.name, "http_requests_total") == 0 &&
+		   parsed.selector.matchers_count == 2,
+	   "Selector: name and number of matchers");
+	ok(parsed.selector.matchers[0].type == PROMETHEUS_MATCH_REGEX &&
+		   strcmp(parsed.selector.matchers[0].label, "code") == 0 &&
+		   parsed.selector.matchers[1].type == PROMETHEUS_MATCH_NOT_EQUAL &&
+		   strcmp(parsed.selector.matchers[1].value, "get") == 0,
+	   "Selector: matcher types and values");
+	ok(check_curl_prometheus_parse_selector("up").errorcode == OK,
+	   "Selector: a name alone is accepted");
+	ok(check_curl_prometheus_parse_selector("{code=\"200\"}").errorcode == ERROR,
+	   "Selector: a missing name is an error");
+	ok(check_curl_prometheus_parse_selector("up{code=200}").errorcode == ERROR,
+	   "Selector: an unquoted value is an error");
+	ok(check_curl_prometheus_parse_selector("up{code=\"200\"").errorcode == ERROR,
+	   "Selector: a missing brace is an error");
+	ok(check_curl_prometheus_parse_selector("up{code=~\"(\"}").errorcode == ERROR,
+	   "Selector: an invalid regex is an error");
+
+	check_curl_prometheus_selector selectors[] = {
+		parse("http_requests_total"),
+		parse("http_requests_total{method=\"post\"}"),
+		parse("http_requests_total{code=~\"[45]..\"}"),
+		parse("http_requests_total{code!~\"2..\",method!=\"post\"}"),
+		parse("msdos_file_access_time_seconds{path=\"C:\\\\DIR\\\\FILE.TXT\"}"),
+		parse("metric_without_timestamp_and_labels{le=\"\"}"),
+		parse("rpc_duration_seconds"),
+		parse("queue_depth"),
+		parse("does_not_exist"),
+	};
+	size_t selectors_count = sizeof(selectors) / sizeof(selectors[0]);
+
+	/* every possible split into two chunks */
+	bool same_everywhere = true;
+	for (size_t split = 0; split <= strlen(metrics); split++) {
+		check_curl_prometheus_parser *parser =
+			check_curl_prometheus_parser_new(selectors, selectors_count);
+		check_curl_prometheus_parser_feed(parser, metrics, split);
+		check_curl_prometheus_parser_feed(parser, metrics + split, strlen(metrics) - split);
+		check_curl_prometheus_parser_finish(parser);
+		same_everywhere = same_everywhere && parser->results[0].samples_count == 3 &&
+						  parser->results[7].samples_count == 1 && parser->invalid_lines == 0;
+		check_curl_prometheus_parser_free(parser);
+	}
+	ok(same_everywhere, "Parser: the result does not depend on the chunk boundaries");
+
+	check_curl_prometheus_parser *parser =
+		check_curl_prometheus_parser_new(selectors, selectors_count);
+	for (size_t i = 0; i < strlen(metrics); i++) {
+		check_curl_prometheus_parser_feed(parser, &metrics[i], 1);
+	}
+	check_curl_prometheus_parser_finish(parser);
+
+	ok(parser->lines == 9 && parser->invalid_lines == 0, "Parser: comments are skipped");
+	ok(parser->results[0].samples_count == 3, "Parser: all series of a name are selected");
+	ok(strcmp(parser->results[0].samples[0].series,
+			  "http_requests_total{method=\"post\",code=\"200\"}") == 0 &&
+		   parser->results[0].samples[0].value == 1027,
+	   "Parser: series and value, the timestamp is ignored");
+	ok(strcmp(parser->results[0].samples[0].label, "http_requests_total_method_post_code_200") ==
+		   0,
+	   "Parser: the perfdata label is built from the name and the labels");
+	ok(strcmp(parser->results[4].samples[0].label,
+			  "msdos_file_access_time_seconds_path_C:__DIR__FILE_TXT_error_Cannot_find___x__") ==
+		   0,
+	   "Parser: special characters of the label values are replaced in the perfdata label");
+	ok(parser->results[0].samples[2].value == 12, "Parser: carriage return is ignored");
+	ok(parser->results[1].samples_count == 2, "Parser: equality matcher");
+	ok(parser->results[2].samples_count == 2 && parser->results[2].samples[0].value == 3,
+	   "Parser: regex matcher is anchored");
+	ok(parser->results[3].samples_count == 1 && parser->results[3].samples[0].value == 12,
+	   "Parser: negative matchers");
+	ok(parser->results[4].samples_count == 1 &&
+		   parser->results[4].samples[0].value == 1.458255915e9,
+	   "Parser: escaped label values");
+	ok(parser->results[5].samples_count == 1, "Parser: a missing label matches an empty value");
+	ok(parser->results[6].samples_count == 1 && isnan(parser->results[6].samples[0].value),
+	   "Parser: NaN, the name must match completely");
+	ok(parser->results[7].samples_count == 1 && parser->results[7].samples[0].value == 42,
+	   "Parser: the last line does not need a newline");
+	ok(parser->results[8].samples_count == 0, "Parser: missing metric");
+
+	mp_subcheck sc_result = mp_subcheck_init();
+	check_curl_prometheus_evaluate(parser, &sc_result);
+	ok(mp_compute_subcheck_state(sc_result) == STATE_UNKNOWN,
+	   "Evaluate: a selector without series is UNKNOWN");
+	check_curl_prometheus_parser_free(parser);
+
+	check_curl_prometheus_selector errors = parse("http_requests_total{code=~\"[45]..\"}");
+	errors.thresholds = mp_thresholds_set_warn(errors.thresholds, mp_parse_range_string("5").range);
+	errors.thresholds =
+		mp_thresholds_set_crit(errors.thresholds, mp_parse_range_string("20").range);
+	parser = check_curl_prometheus_parser_new(&errors, 1);
+	check_curl_prometheus_parser_feed(parser, metrics, strlen(metrics));
+	check_curl_prometheus_parser_finish(parser);
+	sc_result = mp_subcheck_init();
+	check_curl_prometheus_evaluate(parser, &sc_result);
+	ok(mp_compute_subcheck_state(sc_result) == STATE_WARNING,
+	   "Evaluate: the worst series determines the state");
+	check_curl_prometheus_parser_free(parser);
+
+	/* a line which is longer than the buffer for split lines */
+	parser = check_curl_prometheus_parser_new(selectors, selectors_count);
+	check_curl_prometheus_parser_feed(parser, "queue_depth{x=\"", 15);
+	char filler[4096];
+	memset(filler, 'a', sizeof(filler));
+	for (size_t i = 0; i < CHECK_CURL_PROMETHEUS_MAX_LINE / sizeof(filler) + 1; i++) {
+		check_curl_prometheus_parser_feed(parser, filler, sizeof(filler));
+	}
+	check_curl_prometheus_parser_feed(parser, "\"} 1\nqueue_depth 7\n", 19);
+	check_curl_prometheus_parser_finish(parser);
+	ok(parser->invalid_lines == 1 && parser->results[7].samples_count == 1 &&
+		   parser->results[7].samples[0].value == 7,
+	   "Parser: overlong lines are skipped");
+	check_curl_prometheus_parser_free(parser);
+
+	parser = check_curl_prometheus_parser_new(selectors, selectors_count);
+	const char *no_comma = "queue_depth{a=\"1\" b=\"2\"} 1\nqueue_depth 7\n";
+	check_curl_prometheus_parser_feed(parser, no_comma, strlen(no_comma));
+	check_curl_prometheus_parser_finish(parser);
+	ok(parser->invalid_lines == 1 && parser->results[7].samples_count == 1 &&
+		   parser->results[7].samples[0].value == 7,
+	   "Parser: labels without a comma between them are invalid");
+	check_curl_prometheus_parser_free(parser);
+
+	return exit_status();
+}
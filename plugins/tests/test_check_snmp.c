@@ -25,6 +25,13 @@
 
 #include "utils_base.c"
 #include "../check_snmp.d/check_snmp_helpers.h"
+#include "../check_snmp.d/check_snmp_state.h"
+#include "../check_snmp.d/check_snmp_mib_index.h"
+
+void print_usage(void) {}
+
+const char *progname = "test_check_snmp";
+int verbose = 0;
 
 char *_np_state_generate_key(int argc, char **argv);
 char *_np_state_calculate_location_prefix(void);
@@ -171,5 +178,182 @@ int main(int argc, char **argv) {
 	np_state_write_string(0, "Bad file");
 	*/
 
+	/* Rows of a table walk are joined by their index */
+	check_snmp_table table = {.number_of_columns = 2};
+	oid index_two[] = {2};
+	oid index_ten[] = {10};
+	oid index_one_three[] = {1, 3};
+	check_snmp_table_row *temp_row = check_snmp_table_get_row(&table, index_ten, 1);
+	temp_row->values[1].oid_length = 1;
+	check_snmp_table_get_row(&table, index_two, 1);
+	check_snmp_table_get_row(&table, index_one_three, 2);
+	ok(table.number_of_rows == 3, "Got a row for every index");
+	temp_row = check_snmp_table_get_row(&table, index_ten, 1);
+	ok(table.number_of_rows == 3 && temp_row->values[1].oid_length == 1,
+	   "Got the same row for a known index");
+	ok(table.rows[0].index_length == 2 && table.rows[1].index[0] == 2 &&
+		   table.rows[2].index[0] == 10,
+	   "Rows are sorted by index");
+
+	for (oid i = 1000; i > 0; i--) {
+		check_snmp_table_get_row(&table, &i, 1);
+	}
+	bool sorted = table.number_of_rows == 1001;
+	for (size_t i = 1; i < table.number_of_rows; i++) {
+		sorted = sorted && snmp_oid_compare(table.rows[i - 1].index, table.rows[i - 1].index_length,
+											table.rows[i].index, table.rows[i].index_length) < 0;
+	}
+	ok(sorted, "Rows stay sorted if they come in backwards");
+
+	/* Binary state of --rate */
+	char state_file[] = "/tmp/test_check_snmp_state_XXXXXX";
+	close(mkstemp(state_file));
+	check_snmp_state snmp_state = check_snmp_state_read(state_file);
+	ok(snmp_state.errorcode == ERROR, "An empty file is no state");
+
+	check_snmp_state_entry entries[300] = {};
+	for (size_t i = 0; i < 300; i++) {
+		entries[i].oid[0] = i;
+		entries[i].oid_length = 1;
+		entries[i].type = ASN_COUNTER64;
+		entries[i].value.uIntVal = i * 1000;
+		entries[i].timestamp = current_time;
+	}
+	check_snmp_state_write(state_file, current_time, entries, 300);
+	snmp_state = check_snmp_state_read(state_file);
+	ok(snmp_state.errorcode == OK && snmp_state.number_of_entries == 300 &&
+		   snmp_state.timestamp == current_time,
+	   "State is read back");
+	ok(memcmp(snmp_state.entries, entries, sizeof(entries)) == 0, "State entries are unchanged");
+	check_snmp_state_release(&snmp_state);
+
+	ok(truncate(state_file, sizeof(check_snmp_state_header) + (299 * sizeof(entries[0]))) == 0 &&
+		   check_snmp_state_read(state_file).errorcode == ERROR,
+	   "A truncated state is no state");
+
+	FILE *temp_fp = fopen(state_file, "w");
+	fprintf(temp_fp, "# NP State file\n1\n1\n%ld\nAAAA\n", (long)current_time);
+	fclose(temp_fp);
+	ok(check_snmp_state_read(state_file).errorcode == ERROR, "A text state is no state");
+
+	check_snmp_state_write(state_file, time(NULL) + 3600, entries, 1);
+	ok(check_snmp_state_read(state_file).errorcode == ERROR, "A state from the future is no state");
+
+	/* Cached SNMPv3 engine */
+	check_snmp_engine engine = {
+		.engine_id = {0x80, 0x00, 0x1f, 0x88, 0x04},
+		.engine_id_length = 5,
+		.engine_boots = 7,
+		.engine_time = 123456,
+		.timestamp = current_time,
+	};
+	check_snmp_engine_cache_write(state_file, engine);
+	check_snmp_engine cached_engine = check_snmp_engine_cache_read(state_file);
+	ok(cached_engine.errorcode == OK && cached_engine.engine_id_length == 5 &&
+		   memcmp(cached_engine.engine_id, engine.engine_id, 5) == 0 &&
+		   cached_engine.engine_boots == 7 && cached_engine.engine_time == 123456 &&
+		   cached_engine.timestamp == current_time,
+	   "Engine is read back");
+	ok(check_snmp_state_read(state_file).errorcode == ERROR, "An engine is no state");
+	check_snmp_engine_cache_remove(state_file);
+	ok(check_snmp_engine_cache_read(state_file).errorcode == ERROR, "A removed engine is unknown");
+
+	/* Rates of counters */
+	check_snmp_evaluation_parameters rate_params = check_snmp_config_init().evaluation_params;
+	rate_params.calculate_rate = true;
+	check_snmp_test_unit rate_unit = check_snmp_test_unit_init();
+	rate_unit.oid = "ifInOctets.1";
+
+	response_value counter = {
+		.oid = {1, 3, 6, 1, 2, 1, 2, 2, 1, 10, 1},
+		.oid_length = 11,
+		.type = ASN_COUNTER,
+		.value.uIntVal = 200,
+	};
+	check_snmp_state_entry previous_counter = {
+		.timestamp = current_time - 10,
+		.oid_length = 11,
+		.type = ASN_COUNTER,
+		.value.uIntVal = UINT32_MAX - 295,
+		.agent_uptime = 100000,
+	};
+	check_snmp_evaluation rate_eval = evaluate_single_unit(
+		counter, rate_params, rate_unit, current_time, 101000, previous_counter, true);
+	ok(strstr(rate_eval.sc.output, "Value: 49.6") != NULL && rate_eval.state.number_of_samples == 1,
+	   "A wrapped Counter32 gives the rate of the increase");
+
+	rate_eval = evaluate_single_unit(counter, rate_params, rate_unit, current_time, 50,
+									 previous_counter, true);
+	ok(strstr(rate_eval.sc.output, "Agent restarted") != NULL &&
+		   rate_eval.state.number_of_samples == 0,
+	   "A restart of the agent starts over");
+
+	counter.type = ASN_COUNTER64;
+	previous_counter.type = ASN_COUNTER64;
+	rate_eval = evaluate_single_unit(counter, rate_params, rate_unit, current_time, 101000,
+									 previous_counter, true);
+	ok(strstr(rate_eval.sc.output, "Counter was reset") != NULL &&
+		   rate_eval.state.number_of_samples == 0,
+	   "A Counter64 which went back was reset");
+
+	// 100 per second until 20 seconds ago, 200 since then
+	counter.value.uIntVal = 9000;
+	previous_counter.value.uIntVal = 7000;
+	previous_counter.number_of_samples = 2;
+	previous_counter.samples[0] = (check_snmp_state_sample){current_time - 20, {.uIntVal = 5000}};
+	previous_counter.samples[1] = (check_snmp_state_sample){current_time - 60, {.uIntVal = 1000}};
+	rate_params.rate_window = 30;
+	rate_eval = evaluate_single_unit(counter, rate_params, rate_unit, current_time, 101000,
+									 previous_counter, true);
+	ok(strstr(rate_eval.sc.output, "Value: 200") != NULL && rate_eval.state.number_of_samples == 2,
+	   "The rate is computed over the window");
+	rate_params.rate_window = 60;
+	rate_eval = evaluate_single_unit(counter, rate_params, rate_unit, current_time, 101000,
+									 previous_counter, true);
+	ok(strstr(rate_eval.sc.output, "Value: 133.3") != NULL &&
+		   rate_eval.state.number_of_samples == 3,
+	   "Older samples are used with a longer window");
+
+	/* Precompiled MIB index */
+	struct tree mib_nodes[3] = {
+		{.label = "iso", .subid = 1},
+		{.label = "ifDescr", .subid = 2},
+		{.label = "ifType", .subid = 3},
+	};
+	mib_nodes[0].child_list = &mib_nodes[2];
+	mib_nodes[2].next_peer = &mib_nodes[1];
+	struct enum_list if_types[2] = {
+		{.value = 1, .label = "other"},
+		{.value = 6, .label = "ethernetCsmacd"},
+	};
+	if_types[0].next = &if_types[1];
+	mib_nodes[2].enums = &if_types[0];
+	ok(check_snmp_mib_index_write(state_file, &mib_nodes[0]) == 3, "MIB index is written");
+	ok(check_snmp_mib_index_load(state_file), "MIB index is loaded");
+
+	oid parsed_oid[MAX_OID_LEN];
+	size_t parsed_oid_length = MAX_OID_LEN;
+	ok(check_snmp_parse_oid("ifDescr.5", parsed_oid, &parsed_oid_length) != NULL &&
+		   parsed_oid_length == 3 && parsed_oid[0] == 1 && parsed_oid[1] == 2 &&
+		   parsed_oid[2] == 5,
+	   "Symbolic OID is resolved with the MIB index");
+
+	char objid_string[256];
+	check_snmp_snprint_objid(objid_string, sizeof(objid_string), parsed_oid, parsed_oid_length);
+	ok(strstr(objid_string, "::ifDescr.5") != NULL, "OID is printed with the MIB index");
+
+	oid if_type_oid[] = {1, 3, 5};
+	const char *if_type = check_snmp_enum_label(if_type_oid, 3, 6);
+	ok(if_type != NULL && strcmp(if_type, "ethernetCsmacd") == 0,
+	   "Enumerated value is named with the MIB index");
+	ok(check_snmp_enum_label(if_type_oid, 3, 2) == NULL, "Unknown enumerated value has no name");
+
+	check_snmp_state_write(state_file, current_time, entries, 1);
+	ok(!check_snmp_mib_index_load(state_file), "A state is no MIB index");
+
+	char lock_file[sizeof(state_file) + 5];
+	sprintf(lock_file, "%s.lock", state_file);
+	unlink(lock_file);
+
 	np_cleanup();
 }
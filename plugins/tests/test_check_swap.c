@@ -12,10 +12,16 @@ const char *progname = "test_check_swap";
 int main(void) {
 	swap_result test_data = getSwapFromProcMeminfo("./var/proc_meminfo");
 
-	plan_tests(4);
+	plan_tests(8);
 
 	ok(test_data.errorcode == 0, "Test whether we manage to retrieve swap data");
 	ok(test_data.metrics.total == 34233905152, "Is the total Swap correct");
 	ok(test_data.metrics.free == 34233905152, "Is the free Swap correct");
 	ok(test_data.metrics.used == 0, "Is the used Swap correct");
+
+	swap_activity_result activity = getSwapActivityFromProcVmstat("./var/proc_vmstat");
+	ok(activity.errorcode == 0, "Test whether we manage to retrieve swap activity");
+	ok(activity.counters.pswpin == 4711, "Is pswpin correct");
+	ok(activity.counters.pswpout == 81615, "Is pswpout correct");
+	ok(activity.counters.pgmajfault == 401, "Is pgmajfault correct");
 }